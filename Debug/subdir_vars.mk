@@ -9,33 +9,87 @@ CMD_SRCS += \
 ../enet_lwip_ccs.cmd 
 
 C_SRCS += \
+../clock_freq.c \
+../clock_gptimer.c \
+../clock_systick.c \
 ../enet_fs.c \
 ../enet_lwip.c \
-../startup_ccs.c 
+../hotpath.c \
+../snapshot.c \
+../startup_ccs.c \
+../telemetry.c \
+../wakeup.c \
+../wheel.c \
+../workq.c 
 
 C_DEPS += \
+./clock_freq.d \
+./clock_gptimer.d \
+./clock_systick.d \
 ./enet_fs.d \
 ./enet_lwip.d \
-./startup_ccs.d 
+./hotpath.d \
+./snapshot.d \
+./startup_ccs.d \
+./telemetry.d \
+./wakeup.d \
+./wheel.d \
+./workq.d 
 
 OBJS += \
+./clock_freq.obj \
+./clock_gptimer.obj \
+./clock_systick.obj \
 ./enet_fs.obj \
 ./enet_lwip.obj \
-./startup_ccs.obj 
+./hotpath.obj \
+./snapshot.obj \
+./startup_ccs.obj \
+./telemetry.obj \
+./wakeup.obj \
+./wheel.obj \
+./workq.obj 
 
 OBJS__QUOTED += \
+"clock_freq.obj" \
+"clock_gptimer.obj" \
+"clock_systick.obj" \
 "enet_fs.obj" \
 "enet_lwip.obj" \
-"startup_ccs.obj" 
+"hotpath.obj" \
+"snapshot.obj" \
+"startup_ccs.obj" \
+"telemetry.obj" \
+"wakeup.obj" \
+"wheel.obj" \
+"workq.obj" 
 
 C_DEPS__QUOTED += \
+"clock_freq.d" \
+"clock_gptimer.d" \
+"clock_systick.d" \
 "enet_fs.d" \
 "enet_lwip.d" \
-"startup_ccs.d" 
+"hotpath.d" \
+"snapshot.d" \
+"startup_ccs.d" \
+"telemetry.d" \
+"wakeup.d" \
+"wheel.d" \
+"workq.d" 
 
 C_SRCS__QUOTED += \
+"../clock_freq.c" \
+"../clock_gptimer.c" \
+"../clock_systick.c" \
 "../enet_fs.c" \
 "../enet_lwip.c" \
-"../startup_ccs.c" 
+"../hotpath.c" \
+"../snapshot.c" \
+"../startup_ccs.c" \
+"../telemetry.c" \
+"../wakeup.c" \
+"../wheel.c" \
+"../workq.c" 
 
 
@@ -6,33 +6,75 @@ SHELL = cmd.exe
 
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
+../third_party/ptpd-1.1.0/src/dep-tiva/ptpd_delayreq.c \
 ../third_party/ptpd-1.1.0/src/dep-tiva/ptpd_msg.c \
+../third_party/ptpd-1.1.0/src/dep-tiva/ptpd_msg_v2.c \
+../third_party/ptpd-1.1.0/src/dep-tiva/ptpd_pdv.c \
+../third_party/ptpd-1.1.0/src/dep-tiva/ptpd_rate.c \
 ../third_party/ptpd-1.1.0/src/dep-tiva/ptpd_servo.c \
+../third_party/ptpd-1.1.0/src/dep-tiva/ptpd_servo_kalman.c \
+../third_party/ptpd-1.1.0/src/dep-tiva/ptpd_servo_linreg.c \
+../third_party/ptpd-1.1.0/src/dep-tiva/ptpd_servo_pi.c \
 ../third_party/ptpd-1.1.0/src/dep-tiva/ptpd_timer.c 
 
 C_DEPS += \
+./third_party/ptpd-1.1.0/src/dep-tiva/ptpd_delayreq.d \
 ./third_party/ptpd-1.1.0/src/dep-tiva/ptpd_msg.d \
+./third_party/ptpd-1.1.0/src/dep-tiva/ptpd_msg_v2.d \
+./third_party/ptpd-1.1.0/src/dep-tiva/ptpd_pdv.d \
+./third_party/ptpd-1.1.0/src/dep-tiva/ptpd_rate.d \
 ./third_party/ptpd-1.1.0/src/dep-tiva/ptpd_servo.d \
+./third_party/ptpd-1.1.0/src/dep-tiva/ptpd_servo_kalman.d \
+./third_party/ptpd-1.1.0/src/dep-tiva/ptpd_servo_linreg.d \
+./third_party/ptpd-1.1.0/src/dep-tiva/ptpd_servo_pi.d \
 ./third_party/ptpd-1.1.0/src/dep-tiva/ptpd_timer.d 
 
 OBJS += \
+./third_party/ptpd-1.1.0/src/dep-tiva/ptpd_delayreq.obj \
 ./third_party/ptpd-1.1.0/src/dep-tiva/ptpd_msg.obj \
+./third_party/ptpd-1.1.0/src/dep-tiva/ptpd_msg_v2.obj \
+./third_party/ptpd-1.1.0/src/dep-tiva/ptpd_pdv.obj \
+./third_party/ptpd-1.1.0/src/dep-tiva/ptpd_rate.obj \
 ./third_party/ptpd-1.1.0/src/dep-tiva/ptpd_servo.obj \
+./third_party/ptpd-1.1.0/src/dep-tiva/ptpd_servo_kalman.obj \
+./third_party/ptpd-1.1.0/src/dep-tiva/ptpd_servo_linreg.obj \
+./third_party/ptpd-1.1.0/src/dep-tiva/ptpd_servo_pi.obj \
 ./third_party/ptpd-1.1.0/src/dep-tiva/ptpd_timer.obj 
 
 OBJS__QUOTED += \
+"third_party\ptpd-1.1.0\src\dep-tiva\ptpd_delayreq.obj" \
 "third_party\ptpd-1.1.0\src\dep-tiva\ptpd_msg.obj" \
+"third_party\ptpd-1.1.0\src\dep-tiva\ptpd_msg_v2.obj" \
+"third_party\ptpd-1.1.0\src\dep-tiva\ptpd_pdv.obj" \
+"third_party\ptpd-1.1.0\src\dep-tiva\ptpd_rate.obj" \
 "third_party\ptpd-1.1.0\src\dep-tiva\ptpd_servo.obj" \
+"third_party\ptpd-1.1.0\src\dep-tiva\ptpd_servo_kalman.obj" \
+"third_party\ptpd-1.1.0\src\dep-tiva\ptpd_servo_linreg.obj" \
+"third_party\ptpd-1.1.0\src\dep-tiva\ptpd_servo_pi.obj" \
 "third_party\ptpd-1.1.0\src\dep-tiva\ptpd_timer.obj" 
 
 C_DEPS__QUOTED += \
+"third_party\ptpd-1.1.0\src\dep-tiva\ptpd_delayreq.d" \
 "third_party\ptpd-1.1.0\src\dep-tiva\ptpd_msg.d" \
+"third_party\ptpd-1.1.0\src\dep-tiva\ptpd_msg_v2.d" \
+"third_party\ptpd-1.1.0\src\dep-tiva\ptpd_pdv.d" \
+"third_party\ptpd-1.1.0\src\dep-tiva\ptpd_rate.d" \
 "third_party\ptpd-1.1.0\src\dep-tiva\ptpd_servo.d" \
+"third_party\ptpd-1.1.0\src\dep-tiva\ptpd_servo_kalman.d" \
+"third_party\ptpd-1.1.0\src\dep-tiva\ptpd_servo_linreg.d" \
+"third_party\ptpd-1.1.0\src\dep-tiva\ptpd_servo_pi.d" \
 "third_party\ptpd-1.1.0\src\dep-tiva\ptpd_timer.d" 
 
 C_SRCS__QUOTED += \
+"../third_party/ptpd-1.1.0/src/dep-tiva/ptpd_delayreq.c" \
 "../third_party/ptpd-1.1.0/src/dep-tiva/ptpd_msg.c" \
+"../third_party/ptpd-1.1.0/src/dep-tiva/ptpd_msg_v2.c" \
+"../third_party/ptpd-1.1.0/src/dep-tiva/ptpd_pdv.c" \
+"../third_party/ptpd-1.1.0/src/dep-tiva/ptpd_rate.c" \
 "../third_party/ptpd-1.1.0/src/dep-tiva/ptpd_servo.c" \
+"../third_party/ptpd-1.1.0/src/dep-tiva/ptpd_servo_kalman.c" \
+"../third_party/ptpd-1.1.0/src/dep-tiva/ptpd_servo_linreg.c" \
+"../third_party/ptpd-1.1.0/src/dep-tiva/ptpd_servo_pi.c" \
 "../third_party/ptpd-1.1.0/src/dep-tiva/ptpd_timer.c" 
 
 
@@ -8,37 +8,49 @@ SHELL = cmd.exe
 C_SRCS += \
 ../third_party/ptpd-1.1.0/src/arith.c \
 ../third_party/ptpd-1.1.0/src/bmc.c \
+../third_party/ptpd-1.1.0/src/bmc_v2.c \
 ../third_party/ptpd-1.1.0/src/protocol.c \
+../third_party/ptpd-1.1.0/src/protocol_v2.c \
 ../third_party/ptpd-1.1.0/src/ptpd.c 
 
 C_DEPS += \
 ./third_party/ptpd-1.1.0/src/arith.d \
 ./third_party/ptpd-1.1.0/src/bmc.d \
+./third_party/ptpd-1.1.0/src/bmc_v2.d \
 ./third_party/ptpd-1.1.0/src/protocol.d \
+./third_party/ptpd-1.1.0/src/protocol_v2.d \
 ./third_party/ptpd-1.1.0/src/ptpd.d 
 
 OBJS += \
 ./third_party/ptpd-1.1.0/src/arith.obj \
 ./third_party/ptpd-1.1.0/src/bmc.obj \
+./third_party/ptpd-1.1.0/src/bmc_v2.obj \
 ./third_party/ptpd-1.1.0/src/protocol.obj \
+./third_party/ptpd-1.1.0/src/protocol_v2.obj \
 ./third_party/ptpd-1.1.0/src/ptpd.obj 
 
 OBJS__QUOTED += \
 "third_party\ptpd-1.1.0\src\arith.obj" \
 "third_party\ptpd-1.1.0\src\bmc.obj" \
+"third_party\ptpd-1.1.0\src\bmc_v2.obj" \
 "third_party\ptpd-1.1.0\src\protocol.obj" \
+"third_party\ptpd-1.1.0\src\protocol_v2.obj" \
 "third_party\ptpd-1.1.0\src\ptpd.obj" 
 
 C_DEPS__QUOTED += \
 "third_party\ptpd-1.1.0\src\arith.d" \
 "third_party\ptpd-1.1.0\src\bmc.d" \
+"third_party\ptpd-1.1.0\src\bmc_v2.d" \
 "third_party\ptpd-1.1.0\src\protocol.d" \
+"third_party\ptpd-1.1.0\src\protocol_v2.d" \
 "third_party\ptpd-1.1.0\src\ptpd.d" 
 
 C_SRCS__QUOTED += \
 "../third_party/ptpd-1.1.0/src/arith.c" \
 "../third_party/ptpd-1.1.0/src/bmc.c" \
+"../third_party/ptpd-1.1.0/src/bmc_v2.c" \
 "../third_party/ptpd-1.1.0/src/protocol.c" \
+"../third_party/ptpd-1.1.0/src/protocol_v2.c" \
 "../third_party/ptpd-1.1.0/src/ptpd.c" 
 
 
@@ -0,0 +1,82 @@
+//*****************************************************************************
+//
+// clock_freq.c - Frequency steering of a tick-based clock with a fractional
+// phase accumulator.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include "clock_freq.h"
+
+//*****************************************************************************
+//
+// Set the tick length that makes the clock run fast (positive) or slow
+// (negative) by i32Ppb parts per billion, given the nominal number of timer
+// cycles per tick.
+//
+// For the clock to gain i32Ppb, each tick must last
+//
+//     ui32Nominal * 1e9 / (1e9 + i32Ppb)
+//
+// cycles, which is computed exactly, to 2^-32 cycles, as the nominal length
+// less a correction.  Using the exact quotient rather than the first-order
+// ui32Nominal * (1 - i32Ppb / 1e9) matters at the ends of the servo's range,
+// where the realised rates differ by i32Ppb squared over 1e9, which is
+// 1e5 ppb at 1e7 ppb.
+//
+//*****************************************************************************
+void
+ClockFreqSet(tClockFreq *psFreq, uint32_t ui32Nominal, int32_t i32Ppb)
+{
+    uint64_t ui64Num;
+    uint64_t ui64Corr;
+    uint64_t ui64Period;
+    uint32_t ui32Den;
+
+    //
+    // The correction is ui32Nominal * |i32Ppb| / (1e9 + i32Ppb), found as a
+    // quotient and a 32-bit fraction of the remainder.  The numerator fits
+    // in 64 bits for any 32-bit nominal and |i32Ppb| below 2^31, and the
+    // remainder is below 2^30, so neither step overflows.
+    //
+    ui64Num = (uint64_t)ui32Nominal *
+              (uint32_t)((i32Ppb < 0) ? -i32Ppb : i32Ppb);
+    ui32Den = (uint32_t)(1000000000 + i32Ppb);
+    ui64Corr = ((ui64Num / ui32Den) << 32) +
+               (((ui64Num % ui32Den) << 32) / ui32Den);
+
+    ui64Period = (uint64_t)ui32Nominal << 32;
+    if(i32Ppb < 0)
+    {
+        ui64Period += ui64Corr;
+    }
+    else
+    {
+        ui64Period -= ui64Corr;
+    }
+
+    psFreq->ui32Cycles = (uint32_t)(ui64Period >> 32);
+    psFreq->ui32Frac = (uint32_t)ui64Period;
+}
+
+//*****************************************************************************
+//
+// Return the number of timer cycles in the next tick, advancing the phase
+// accumulator.
+//
+//*****************************************************************************
+uint32_t
+ClockFreqNext(const tClockFreq *psFreq, uint32_t *pui32Phase)
+{
+    uint32_t ui32Phase;
+
+    ui32Phase = *pui32Phase + psFreq->ui32Frac;
+    if(ui32Phase < *pui32Phase)
+    {
+        *pui32Phase = ui32Phase;
+        return(psFreq->ui32Cycles + 1);
+    }
+
+    *pui32Phase = ui32Phase;
+    return(psFreq->ui32Cycles);
+}
@@ -0,0 +1,63 @@
+//*****************************************************************************
+//
+// clock_freq.h - Frequency steering of a tick-based clock with a fractional
+// phase accumulator.
+//
+// A clock that advances by a fixed amount of time on every tick of a timer
+// is steered by changing the number of timer cycles in each tick.  The exact
+// number of cycles per tick for a given rate is held in 32.32 fixed point,
+// and a 32-bit phase accumulator spreads the fractional cycles evenly over
+// the ticks: every tick whose addition carries out of the accumulator is one
+// cycle longer.  The realised rate matches the requested one to far better
+// than a part per billion, and the period never differs from the ideal by
+// more than one cycle at any tick.
+//
+//*****************************************************************************
+
+#ifndef __CLOCK_FREQ_H__
+#define __CLOCK_FREQ_H__
+
+#include <stdint.h>
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+//*****************************************************************************
+//
+// A steered tick length: whole timer cycles, and 2^-32 cycles.
+//
+//*****************************************************************************
+typedef struct
+{
+    uint32_t ui32Cycles;
+    uint32_t ui32Frac;
+}
+tClockFreq;
+
+//*****************************************************************************
+//
+// Prototypes.
+//
+//*****************************************************************************
+extern void ClockFreqSet(tClockFreq *psFreq, uint32_t ui32Nominal,
+                         int32_t i32Ppb);
+extern uint32_t ClockFreqNext(const tClockFreq *psFreq, uint32_t *pui32Phase);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CLOCK_FREQ_H__
@@ -0,0 +1,321 @@
+//*****************************************************************************
+//
+// clock_gptimer.c - PTP clock kept by a free-running general-purpose timer.
+//
+// Timer 5 counts processor clocks down through its full 32-bit range.  The
+// monotonic time is a 64-bit nanosecond count at the last fold, plus the
+// clocks counted since then multiplied by the length of a clock.  That length
+// is held in 32.32 fixed point, so a rate trim of one part in 2^32 ns per
+// clock (well under 1 ppb) takes effect with no dithering, and the fraction
+// of a nanosecond left over at each fold is carried into the next.  PTP time
+// is the monotonic time plus an offset, kept as the current second and the
+// monotonic time at which it began, as in clock_systick.c.
+//
+// The SysTick interrupt folds the elapsed count into the base on every tick,
+// long before the 32-bit counter could wrap, and is the only writer of the
+// fold state.  It publishes the state under a sequence count that readers
+// check, so nothing here disables interrupts.  adjFreq() leaves the new clock
+// length for the next fold to pick up, and setTime() fills in the offset slot
+// not in use and then switches to it.
+//
+//*****************************************************************************
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "inc/hw_memmap.h"
+#include "inc/hw_timer.h"
+#include "inc/hw_types.h"
+#include "driverlib/rom.h"
+#include "driverlib/rom_map.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
+#include "clock_ops.h"
+
+//*****************************************************************************
+//
+// The timer used as the clock.
+//
+//*****************************************************************************
+#define CLOCK_TIMER_BASE        TIMER5_BASE
+#define CLOCK_TIMER_PERIPH      SYSCTL_PERIPH_TIMER5
+
+//*****************************************************************************
+//
+// Read the timer counter.
+//
+//*****************************************************************************
+#define CLOCK_TIMER_VALUE()     HWREG(CLOCK_TIMER_BASE + TIMER_O_TAR)
+
+//*****************************************************************************
+//
+// The state published by the SysTick handler under g_ui32GPTimerSeq: the
+// monotonic time at the last fold in whole nanoseconds and 2^-32 ns, the
+// timer count it corresponds to, and the length of a processor clock in
+// 32.32 fixed-point nanoseconds since then.
+//
+//*****************************************************************************
+static volatile uint32_t g_ui32GPTimerSeq;
+static volatile uint64_t g_ui64GPTimerBaseNs;
+static volatile uint32_t g_ui32GPTimerBaseFrac;
+static volatile uint32_t g_ui32GPTimerOrigin;
+static volatile uint32_t g_ui32GPTimerStepInt;
+static volatile uint32_t g_ui32GPTimerStepFrac;
+
+//*****************************************************************************
+//
+// The nominal length of a processor clock, and the length last requested by
+// adjFreq(), in 32.32 fixed-point nanoseconds.  The requested length is held
+// in a slot pair so that the SysTick handler never sees half of an update.
+//
+//*****************************************************************************
+static uint64_t g_ui64GPTimerNominal;
+static volatile uint64_t g_pui64GPTimerStep[2];
+static volatile uint32_t g_ui32GPTimerStepIdx;
+
+//*****************************************************************************
+//
+// The PTP time offset slots written by setTime(), the one in use, and a count
+// of setTime() calls so that a reader can tell if a slot changed under it.
+// The SysTick handler also advances the second in the slot in use.
+//
+//*****************************************************************************
+typedef struct
+{
+    uint32_t ui32Seconds;
+    uint64_t ui64SecondNs;
+}
+tGPTimerOffset;
+
+static volatile tGPTimerOffset g_psGPTimerOffset[2];
+static volatile uint32_t g_ui32GPTimerOffsetIdx;
+static volatile uint32_t g_ui32GPTimerOffsetGen;
+
+//*****************************************************************************
+//
+// The nanoseconds and 2^-32 ns fraction from a fold to a given timer count.
+//
+//*****************************************************************************
+static uint64_t
+GPTimerElapsed(uint32_t ui32Origin, uint32_t ui32Now, uint32_t ui32StepInt,
+               uint32_t ui32StepFrac, uint32_t ui32BaseFrac,
+               uint32_t *pui32Frac)
+{
+    uint32_t ui32Elapsed;
+    uint64_t ui64Frac;
+
+    //
+    // The timer counts down, so this is correct across a wrap.
+    //
+    ui32Elapsed = ui32Origin - ui32Now;
+
+    ui64Frac = ((uint64_t)ui32Elapsed * ui32StepFrac) + ui32BaseFrac;
+    *pui32Frac = (uint32_t)ui64Frac;
+
+    return(((uint64_t)ui32Elapsed * ui32StepInt) + (ui64Frac >> 32));
+}
+
+//*****************************************************************************
+//
+// Read the monotonic time and the PTP time offset.
+//
+//*****************************************************************************
+static uint64_t
+GPTimerNow(uint32_t *pui32Seconds, uint64_t *pui64SecondNs)
+{
+    volatile tGPTimerOffset *psOffset;
+    uint32_t ui32Seq;
+    uint32_t ui32Gen;
+    uint32_t ui32Frac;
+    uint64_t ui64Ns;
+
+    do
+    {
+        ui32Seq = g_ui32GPTimerSeq;
+        ui32Gen = g_ui32GPTimerOffsetGen;
+
+        psOffset = &g_psGPTimerOffset[g_ui32GPTimerOffsetIdx];
+        *pui32Seconds = psOffset->ui32Seconds;
+        *pui64SecondNs = psOffset->ui64SecondNs;
+
+        ui64Ns = g_ui64GPTimerBaseNs +
+                 GPTimerElapsed(g_ui32GPTimerOrigin, CLOCK_TIMER_VALUE(),
+                                g_ui32GPTimerStepInt, g_ui32GPTimerStepFrac,
+                                g_ui32GPTimerBaseFrac, &ui32Frac);
+    }
+    while((ui32Seq != g_ui32GPTimerSeq) ||
+          (ui32Gen != g_ui32GPTimerOffsetGen));
+
+    return(ui64Ns);
+}
+
+//*****************************************************************************
+//
+// Start the timer running freely from zero time.
+//
+//*****************************************************************************
+static void
+ClockGPTimerInit(uint32_t ui32SysClock, uint32_t ui32TickHz)
+{
+    MAP_SysCtlPeripheralEnable(CLOCK_TIMER_PERIPH);
+    while(!MAP_SysCtlPeripheralReady(CLOCK_TIMER_PERIPH))
+    {
+    }
+
+    MAP_TimerConfigure(CLOCK_TIMER_BASE, TIMER_CFG_PERIODIC);
+    MAP_TimerLoadSet(CLOCK_TIMER_BASE, TIMER_A, 0xFFFFFFFF);
+
+    g_ui64GPTimerNominal = (1000000000ULL << 32) / ui32SysClock;
+    g_pui64GPTimerStep[0] = g_ui64GPTimerNominal;
+    g_ui32GPTimerStepIdx = 0;
+    g_ui32GPTimerStepInt = (uint32_t)(g_ui64GPTimerNominal >> 32);
+    g_ui32GPTimerStepFrac = (uint32_t)g_ui64GPTimerNominal;
+
+    g_ui64GPTimerBaseNs = 0;
+    g_ui32GPTimerBaseFrac = 0;
+    g_psGPTimerOffset[0].ui32Seconds = 0;
+    g_psGPTimerOffset[0].ui64SecondNs = 0;
+    g_ui32GPTimerOffsetIdx = 0;
+
+    MAP_TimerEnable(CLOCK_TIMER_BASE, TIMER_A);
+    g_ui32GPTimerOrigin = CLOCK_TIMER_VALUE();
+}
+
+//*****************************************************************************
+//
+// Fold the elapsed count into the base at the old clock length, switch to the
+// length last requested, and report a new second.
+//
+//*****************************************************************************
+static bool
+ClockGPTimerTick(void)
+{
+    volatile tGPTimerOffset *psOffset;
+    uint32_t ui32Now;
+    uint32_t ui32Frac;
+    uint64_t ui64Step;
+    bool bSecond;
+
+    g_ui32GPTimerSeq++;
+
+    ui32Now = CLOCK_TIMER_VALUE();
+    g_ui64GPTimerBaseNs += GPTimerElapsed(g_ui32GPTimerOrigin, ui32Now,
+                                          g_ui32GPTimerStepInt,
+                                          g_ui32GPTimerStepFrac,
+                                          g_ui32GPTimerBaseFrac, &ui32Frac);
+    g_ui32GPTimerBaseFrac = ui32Frac;
+    g_ui32GPTimerOrigin = ui32Now;
+
+    ui64Step = g_pui64GPTimerStep[g_ui32GPTimerStepIdx];
+    g_ui32GPTimerStepInt = (uint32_t)(ui64Step >> 32);
+    g_ui32GPTimerStepFrac = (uint32_t)ui64Step;
+
+    bSecond = false;
+    psOffset = &g_psGPTimerOffset[g_ui32GPTimerOffsetIdx];
+    while((g_ui64GPTimerBaseNs - psOffset->ui64SecondNs) >= 1000000000)
+    {
+        psOffset->ui64SecondNs += 1000000000;
+        psOffset->ui32Seconds++;
+        bSecond = true;
+    }
+
+    g_ui32GPTimerSeq++;
+
+    return(bSecond);
+}
+
+//*****************************************************************************
+//
+// Read the time.  Less than a tick has passed since the last fold, so the
+// nanoseconds since the start of the current second fit in 32 bits.
+//
+//*****************************************************************************
+static void
+ClockGPTimerGetTime(uint32_t *pui32Seconds, uint32_t *pui32Nanoseconds)
+{
+    uint32_t ui32Seconds;
+    uint32_t ui32Nanoseconds;
+    uint64_t ui64SecondNs;
+
+    ui32Nanoseconds = (uint32_t)(GPTimerNow(&ui32Seconds, &ui64SecondNs) -
+                                 ui64SecondNs);
+
+    if(ui32Nanoseconds >= 1000000000)
+    {
+        ui32Seconds++;
+        ui32Nanoseconds -= 1000000000;
+    }
+
+    *pui32Seconds = ui32Seconds;
+    *pui32Nanoseconds = ui32Nanoseconds;
+}
+
+//*****************************************************************************
+//
+// Set the time by changing the offset from the monotonic time.
+//
+//*****************************************************************************
+static void
+ClockGPTimerSetTime(uint32_t ui32Seconds, uint32_t ui32Nanoseconds)
+{
+    volatile tGPTimerOffset *psOffset;
+    uint32_t ui32Unused;
+    uint32_t ui32Idx;
+    uint64_t ui64Unused;
+    uint64_t ui64MonoNs;
+
+    ui64MonoNs = GPTimerNow(&ui32Unused, &ui64Unused);
+
+    ui32Idx = g_ui32GPTimerOffsetIdx ^ 1;
+    psOffset = &g_psGPTimerOffset[ui32Idx];
+    psOffset->ui32Seconds = ui32Seconds;
+    psOffset->ui64SecondNs = ui64MonoNs - ui32Nanoseconds;
+
+    g_ui32GPTimerOffsetIdx = ui32Idx;
+    g_ui32GPTimerOffsetGen++;
+}
+
+//*****************************************************************************
+//
+// Change the length of a clock.  The SysTick handler folds the time up to its
+// next tick in at the old length and then switches to the new one, so the
+// change does not step the clock.
+//
+//*****************************************************************************
+static void
+ClockGPTimerAdjFreq(int32_t i32Ppb)
+{
+    uint32_t ui32Idx;
+
+    ui32Idx = g_ui32GPTimerStepIdx ^ 1;
+    g_pui64GPTimerStep[ui32Idx] =
+        g_ui64GPTimerNominal +
+        (((int64_t)g_ui64GPTimerNominal * i32Ppb) / 1000000000);
+    g_ui32GPTimerStepIdx = ui32Idx;
+}
+
+//*****************************************************************************
+//
+// The resolution is one processor clock, rounded up to whole nanoseconds.
+//
+//*****************************************************************************
+static uint32_t
+ClockGPTimerResolution(void)
+{
+    return(g_ui32GPTimerStepInt + (g_ui32GPTimerStepFrac ? 1 : 0));
+}
+
+//*****************************************************************************
+//
+// The general-purpose timer clock source.
+//
+//*****************************************************************************
+const tClockOps g_sClockGPTimer =
+{
+    "gptimer",
+    ClockGPTimerInit,
+    ClockGPTimerTick,
+    ClockGPTimerGetTime,
+    ClockGPTimerSetTime,
+    ClockGPTimerAdjFreq,
+    ClockGPTimerResolution
+};
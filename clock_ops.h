@@ -0,0 +1,99 @@
+//*****************************************************************************
+//
+// clock_ops.h - The interface between the PTP clock hooks and the hardware
+// that keeps the local time.
+//
+// getTime(), setTime(), adjFreq() and lwIPHostGetTime() dispatch through a
+// tClockOps table, so the time source can be changed without touching PTPd.
+// Each implementation keeps seconds and nanoseconds of local time, can be
+// set, and can have its rate trimmed in parts per billion.
+//
+//*****************************************************************************
+
+#ifndef __CLOCK_OPS_H__
+#define __CLOCK_OPS_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+//*****************************************************************************
+//
+// A clock source.
+//
+//*****************************************************************************
+typedef struct
+{
+    //
+    // A short name for reports.
+    //
+    const char *pcName;
+
+    //
+    // Start the clock.  ui32SysClock is the processor clock in Hz and
+    // ui32TickHz the rate at which pfnTick is called.  The SysTick timer has
+    // already been set up to interrupt at that rate.
+    //
+    void (*pfnInit)(uint32_t ui32SysClock, uint32_t ui32TickHz);
+
+    //
+    // Called from the SysTick interrupt handler on every tick.  Returns true
+    // if the seconds count advanced since the previous tick.
+    //
+    bool (*pfnTick)(void);
+
+    //
+    // Read the current time.  This may be called from any context that does
+    // not preempt the SysTick interrupt, with interrupts enabled or not, and
+    // completes in bounded time.
+    //
+    void (*pfnGetTime)(uint32_t *pui32Seconds, uint32_t *pui32Nanoseconds);
+
+    //
+    // Set the current time.  This and pfnAdjFreq are called from one context
+    // at a time, below the SysTick priority, and do not disable interrupts.
+    //
+    void (*pfnSetTime)(uint32_t ui32Seconds, uint32_t ui32Nanoseconds);
+
+    //
+    // Run the clock fast (positive) or slow (negative) by the given number of
+    // parts per billion relative to nominal.
+    //
+    void (*pfnAdjFreq)(int32_t i32Ppb);
+
+    //
+    // The smallest step between two different readings of the clock, in
+    // nanoseconds.
+    //
+    uint32_t (*pfnResolution)(void);
+}
+tClockOps;
+
+//*****************************************************************************
+//
+// The available clock sources.
+//
+//*****************************************************************************
+extern const tClockOps g_sClockSysTick;
+extern const tClockOps g_sClockGPTimer;
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CLOCK_OPS_H__
@@ -0,0 +1,386 @@
+//*****************************************************************************
+//
+// clock_systick.c - PTP clock kept by the SysTick interrupt.
+//
+// The SysTick interrupt adds a fixed number of nanoseconds to a 64-bit
+// monotonic count on every tick.  PTP time is that count plus an offset, which
+// only setTime() changes.  The clock rate is trimmed by changing the SysTick
+// reload value, with the fraction of a processor clock per tick spread evenly
+// over the ticks by the phase accumulator in clock_freq.c.  Readings between
+// ticks are interpolated from the SysTick counter, so the resolution is one
+// processor clock.  The length of a clock is held in 32.32 fixed-point
+// nanoseconds, so any processor clock that is a multiple of the tick rate
+// can be used, and is scaled so that each period covers exactly one tick.
+//
+// The offset is kept as the current PTP second and the monotonic count at
+// which that second began, so that neither the tick nor a read needs a 64-bit
+// division to split the time into seconds and nanoseconds.
+//
+// Nothing here disables interrupts.  The SysTick handler is the only writer
+// of the state that readers interpolate from, and publishes it under a
+// sequence count that every update changes.  A reader takes a snapshot, then
+// checks that the count has not moved, which can only fail if a tick
+// preempted it, so it goes round at most once more.  setTime() and adjFreq()
+// run at a lower priority than SysTick and never write anything the SysTick
+// handler is using.  Each has a pair of slots: it fills in the one not in use
+// and then switches to it with a single store.
+//
+// Readers must not run at a higher priority than the SysTick interrupt.
+//
+//*****************************************************************************
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "inc/hw_nvic.h"
+#include "inc/hw_types.h"
+#include "driverlib/rom.h"
+#include "driverlib/rom_map.h"
+#include "driverlib/systick.h"
+#include "clock_freq.h"
+#include "clock_ops.h"
+
+//*****************************************************************************
+//
+// The processor clock and SysTick rates, the length of a SysTick period in
+// nanoseconds, and the length of a processor clock rounded up to whole
+// nanoseconds.
+//
+//*****************************************************************************
+static uint32_t g_ui32ClockSysClock;
+static uint32_t g_ui32ClockTickHz;
+static uint32_t g_ui32ClockTickNs;
+static uint32_t g_ui32ClockCycleNs;
+
+//*****************************************************************************
+//
+// The PTP time offset: the current PTP second, and the monotonic time at
+// which it began.
+//
+//*****************************************************************************
+typedef struct
+{
+    uint32_t ui32Seconds;
+    uint64_t ui64SecondNs;
+}
+tClockOffset;
+
+//*****************************************************************************
+//
+// The state published by the SysTick handler under g_ui32ClockSeq: the
+// monotonic time in nanoseconds since the clock was started, as of the last
+// tick, and the SysTick period that is running now and the one that will run
+// next, each with the length of a processor clock within it in 32.32
+// fixed-point nanoseconds.  The phase accumulator is private to the SysTick
+// handler.
+//
+//*****************************************************************************
+static volatile uint32_t g_ui32ClockSeq;
+static volatile uint64_t g_ui64ClockMonoNs;
+static volatile unsigned long g_ulClockPeriod;
+static volatile unsigned long g_ulClockNextPeriod;
+static volatile uint64_t g_ui64ClockStep;
+static volatile uint64_t g_ui64ClockNextStep;
+static uint32_t g_ui32ClockPhase;
+
+//*****************************************************************************
+//
+// The offset slots written by setTime(), the one in use, and a count of
+// setTime() calls so that a reader can tell if a slot changed under it.
+// The SysTick handler also advances the second in the slot in use.
+//
+//*****************************************************************************
+static volatile tClockOffset g_psClockOffset[2];
+static volatile uint32_t g_ui32ClockOffsetIdx;
+static volatile uint32_t g_ui32ClockOffsetGen;
+
+//*****************************************************************************
+//
+// The SysTick period slots written by adjFreq(), in processor clocks and
+// 2^-32 clocks, and the one in use.
+//
+//*****************************************************************************
+static volatile tClockFreq g_psClockRate[2];
+static volatile uint32_t g_ui32ClockRateIdx;
+
+#ifdef DEBUG
+//*****************************************************************************
+//
+// Debug counters: reads that found a SysTick wrap not yet handled, and reads
+// that had to be repeated.
+//
+//*****************************************************************************
+volatile unsigned long g_ulSysTickWrapDetect;
+volatile unsigned long g_ulSysTickWrapTime;
+volatile unsigned long g_ulGetTimeRetryCount;
+#endif
+
+//*****************************************************************************
+//
+// The length of a processor clock in a SysTick period of a given number of
+// clocks, in 32.32 fixed-point nanoseconds.  A period of any length then
+// advances the interpolated time by exactly one tick.
+//
+//*****************************************************************************
+static uint64_t
+ClockSysTickStep(unsigned long ulPeriod)
+{
+    return(((uint64_t)g_ui32ClockTickNs << 32) / ulPeriod);
+}
+
+//*****************************************************************************
+//
+// Start the clock from the reload value already programmed into SysTick.
+//
+//*****************************************************************************
+static void
+ClockSysTickInit(uint32_t ui32SysClock, uint32_t ui32TickHz)
+{
+    g_ui32ClockSysClock = ui32SysClock;
+    g_ui32ClockTickHz = ui32TickHz;
+    g_ui32ClockTickNs = 1000000000 / ui32TickHz;
+    g_ui32ClockCycleNs = (1000000000 + ui32SysClock - 1) / ui32SysClock;
+
+    g_ui64ClockMonoNs = 0;
+    g_ulClockPeriod = MAP_SysTickPeriodGet();
+    g_ulClockNextPeriod = g_ulClockPeriod;
+    g_ui64ClockStep = ClockSysTickStep(g_ulClockPeriod);
+    g_ui64ClockNextStep = g_ui64ClockStep;
+
+    g_psClockRate[0].ui32Cycles = g_ulClockPeriod;
+    g_psClockRate[0].ui32Frac = 0;
+    g_ui32ClockRateIdx = 0;
+    g_ui32ClockPhase = 0;
+
+    g_psClockOffset[0].ui32Seconds = 0;
+    g_psClockOffset[0].ui64SecondNs = 0;
+    g_ui32ClockOffsetIdx = 0;
+}
+
+//*****************************************************************************
+//
+// Advance the time by one SysTick period and program the next reload value.
+//
+//*****************************************************************************
+static bool
+ClockSysTickTick(void)
+{
+    volatile tClockOffset *psOffset;
+    tClockFreq sRate;
+    bool bSecond;
+
+    //
+    // Mark the published state as changing.
+    //
+    g_ui32ClockSeq++;
+
+    //
+    // Update internal time.
+    //
+    bSecond = false;
+    g_ui64ClockMonoNs += g_ui32ClockTickNs;
+    psOffset = &g_psClockOffset[g_ui32ClockOffsetIdx];
+    if((g_ui64ClockMonoNs - psOffset->ui64SecondNs) >= 1000000000)
+    {
+        psOffset->ui64SecondNs += 1000000000;
+        psOffset->ui32Seconds++;
+        bSecond = true;
+    }
+
+    //
+    // The period that has just started is the one programmed on the last
+    // tick.
+    //
+    g_ulClockPeriod = g_ulClockNextPeriod;
+    g_ui64ClockStep = g_ui64ClockNextStep;
+
+    //
+    // For each tick, set the next reload value for fine tuning the clock.
+    //
+    sRate = g_psClockRate[g_ui32ClockRateIdx];
+    g_ulClockNextPeriod = ClockFreqNext(&sRate, &g_ui32ClockPhase);
+    MAP_SysTickPeriodSet(g_ulClockNextPeriod);
+    g_ui64ClockNextStep = ClockSysTickStep(g_ulClockNextPeriod);
+
+    //
+    // Publish the new state.
+    //
+    g_ui32ClockSeq++;
+
+    return(bSecond);
+}
+
+//*****************************************************************************
+//
+// Read the monotonic time, interpolated to the current processor clock, and
+// the PTP time offset.
+//
+// A SysTick wrap whose interrupt has not yet run, because the reader has
+// interrupts disabled or is inside the interrupt latency, shows up as a
+// pending SysTick exception.  The counter has then already reloaded, so the
+// tick is accounted for here instead of the time going back by a period.
+//
+//*****************************************************************************
+static uint64_t
+ClockSysTickNow(uint32_t *pui32Seconds, uint64_t *pui64SecondNs)
+{
+    volatile tClockOffset *psOffset;
+    uint32_t ui32Seq;
+    uint32_t ui32Gen;
+    unsigned long ulValue;
+    unsigned long ulPeriod;
+    uint64_t ui64Step;
+    uint64_t ui64MonoNs;
+
+    while(1)
+    {
+        ui32Seq = g_ui32ClockSeq;
+        ui32Gen = g_ui32ClockOffsetGen;
+
+        psOffset = &g_psClockOffset[g_ui32ClockOffsetIdx];
+        *pui32Seconds = psOffset->ui32Seconds;
+        *pui64SecondNs = psOffset->ui64SecondNs;
+        ui64MonoNs = g_ui64ClockMonoNs;
+        ulPeriod = g_ulClockPeriod;
+        ui64Step = g_ui64ClockStep;
+
+        ulValue = MAP_SysTickValueGet();
+        if(HWREG(NVIC_INT_CTRL) & NVIC_INT_CTRL_PENDSTSET)
+        {
+            //
+            // The counter has wrapped into the next period.  Read it again
+            // in case the wrap came just after the first read.
+            //
+            ulValue = MAP_SysTickValueGet();
+            ui64MonoNs += g_ui32ClockTickNs;
+            ulPeriod = g_ulClockNextPeriod;
+            ui64Step = g_ui64ClockNextStep;
+
+#ifdef DEBUG
+            g_ulSysTickWrapDetect++;
+            g_ulSysTickWrapTime = *pui32Seconds;
+#endif
+        }
+
+        if((ui32Seq == g_ui32ClockSeq) && (ui32Gen == g_ui32ClockOffsetGen))
+        {
+            break;
+        }
+
+#ifdef DEBUG
+        g_ulGetTimeRetryCount++;
+#endif
+    }
+
+    //
+    // Add the part of the current period that has elapsed.  The product is
+    // below 2^32 times the tick length, so it fits in 64 bits.
+    //
+    return(ui64MonoNs +
+           ((((uint64_t)((ulPeriod - 1) - ulValue)) * ui64Step) >> 32));
+}
+
+//*****************************************************************************
+//
+// Read the time.  The nanoseconds since the start of the cached second fit
+// in 32 bits, so splitting the time needs no division.
+//
+//*****************************************************************************
+static void
+ClockSysTickGetTime(uint32_t *pui32Seconds, uint32_t *pui32Nanoseconds)
+{
+    uint32_t ui32Seconds;
+    uint32_t ui32Nanoseconds;
+    uint64_t ui64SecondNs;
+
+    ui32Nanoseconds = (uint32_t)(ClockSysTickNow(&ui32Seconds,
+                                                 &ui64SecondNs) -
+                                 ui64SecondNs);
+
+    //
+    // Adjust for any case where we accumulate more than 1 second's worth of
+    // nanoseconds.
+    //
+    if(ui32Nanoseconds >= 1000000000)
+    {
+        ui32Seconds++;
+        ui32Nanoseconds -= 1000000000;
+    }
+
+    *pui32Seconds = ui32Seconds;
+    *pui32Nanoseconds = ui32Nanoseconds;
+}
+
+//*****************************************************************************
+//
+// Set the time by changing the offset from the monotonic time, which carries
+// on undisturbed.  The start of the second is a fixed point on the monotonic
+// scale, so a tick between reading the clock and switching slots does no
+// harm.
+//
+//*****************************************************************************
+static void
+ClockSysTickSetTime(uint32_t ui32Seconds, uint32_t ui32Nanoseconds)
+{
+    volatile tClockOffset *psOffset;
+    uint32_t ui32Unused;
+    uint32_t ui32Idx;
+    uint64_t ui64Unused;
+    uint64_t ui64MonoNs;
+
+    ui64MonoNs = ClockSysTickNow(&ui32Unused, &ui64Unused);
+
+    ui32Idx = g_ui32ClockOffsetIdx ^ 1;
+    psOffset = &g_psClockOffset[ui32Idx];
+    psOffset->ui32Seconds = ui32Seconds;
+    psOffset->ui64SecondNs = ui64MonoNs - ui32Nanoseconds;
+
+    g_ui32ClockOffsetIdx = ui32Idx;
+    g_ui32ClockOffsetGen++;
+}
+
+//*****************************************************************************
+//
+// Adjust the SysTick periodic interval to trim the clock rate.  The new
+// period goes in the slot not in use, and the SysTick handler picks it up on
+// its next tick.
+//
+//*****************************************************************************
+static void
+ClockSysTickAdjFreq(int32_t i32Ppb)
+{
+    tClockFreq sRate;
+    uint32_t ui32Idx;
+
+    ClockFreqSet(&sRate, g_ui32ClockSysClock / g_ui32ClockTickHz, i32Ppb);
+
+    ui32Idx = g_ui32ClockRateIdx ^ 1;
+    g_psClockRate[ui32Idx] = sRate;
+    g_ui32ClockRateIdx = ui32Idx;
+}
+
+//*****************************************************************************
+//
+// The resolution is one processor clock, rounded up to whole nanoseconds.
+//
+//*****************************************************************************
+static uint32_t
+ClockSysTickResolution(void)
+{
+    return(g_ui32ClockCycleNs);
+}
+
+//*****************************************************************************
+//
+// The SysTick clock source.
+//
+//*****************************************************************************
+const tClockOps g_sClockSysTick =
+{
+    "systick",
+    ClockSysTickInit,
+    ClockSysTickTick,
+    ClockSysTickGetTime,
+    ClockSysTickSetTime,
+    ClockSysTickAdjFreq,
+    ClockSysTickResolution
+};
@@ -34,6 +34,8 @@
 #include "httpserver_raw/fsdata.h"
 #include "fatfs/src/ff.h"
 #include "fatfs/src/diskio.h"
+#include "hotpath.h"
+#include "telemetry.h"
 
 //*****************************************************************************
 //
@@ -49,6 +51,47 @@
 //*****************************************************************************
 #include "enet_fsdata.h"
 
+//*****************************************************************************
+//
+// Generators for the files below.  The argument is the number in the name,
+// or zero if the name has none.
+//
+//*****************************************************************************
+static uint32_t
+HotpathFile(char *pcBuf, uint32_t ui32Size, uint32_t ui32Arg)
+{
+    return(HotpathFormat(pcBuf, ui32Size));
+}
+
+//*****************************************************************************
+//
+// Files whose contents are generated by the application each time they are
+// opened, and the largest size of each.  A '*' in a name matches a decimal
+// number, which is passed to the generator: the telemetry files take it as
+// the cursor to read from, carried in the path because httpd drops a query
+// string unless CGI is enabled.
+//
+//*****************************************************************************
+typedef struct
+{
+    const char *pcName;
+    uint32_t (*pfnFormat)(char *pcBuf, uint32_t ui32Size, uint32_t ui32Arg);
+    uint32_t ui32Size;
+}
+tGeneratedFile;
+
+static const tGeneratedFile g_psGeneratedFiles[] =
+{
+    { "/hotpath.txt", HotpathFile, HOTPATH_TEXT_SIZE },
+    { "/telemetry.csv", TelemetryFormatCsv, TELEMETRY_CSV_SIZE },
+    { "/telemetry.bin", TelemetryFormatBin, TELEMETRY_BIN_SIZE },
+    { "/telemetry/*.csv", TelemetryFormatCsv, TELEMETRY_CSV_SIZE },
+    { "/telemetry/*.bin", TelemetryFormatBin, TELEMETRY_BIN_SIZE }
+};
+
+#define NUM_GENERATED_FILES     (sizeof(g_psGeneratedFiles) /                \
+                                 sizeof(g_psGeneratedFiles[0]))
+
 //*****************************************************************************
 //
 // The following are data structures used by FatFs.
@@ -92,15 +135,97 @@ fs_tick(uint32_t ui32TickMS)
     ui32TickCounter += ui32TickMS;
 
     //
-    // Check to see if the FAT FS tick needs to run.
+    // Run the FAT FS tick once for every 10 ms that has passed, since the
+    // caller's tick may be longer than that.
     //
-    if(ui32TickCounter >= 10)
+    while(ui32TickCounter >= 10)
     {
-        ui32TickCounter = 0;
+        ui32TickCounter -= 10;
         disk_timerproc();
     }
 }
 
+//*****************************************************************************
+//
+// Match a name against a generated file's name, taking the number matched by
+// a '*' in it.  Returns true if the name matches.
+//
+//*****************************************************************************
+static bool
+fs_match_generated(const char *pcName, const char *pcPattern,
+                   uint32_t *pui32Arg)
+{
+    *pui32Arg = 0;
+
+    while(*pcPattern != '*')
+    {
+        if(*pcName != *pcPattern)
+        {
+            return(false);
+        }
+        if(*pcName == '\0')
+        {
+            return(true);
+        }
+        pcName++;
+        pcPattern++;
+    }
+
+    //
+    // At least one digit, and no more than fit.
+    //
+    if((*pcName < '0') || (*pcName > '9'))
+    {
+        return(false);
+    }
+    while((*pcName >= '0') && (*pcName <= '9'))
+    {
+        if(*pui32Arg > ((0xFFFFFFFF - 9) / 10))
+        {
+            return(false);
+        }
+        *pui32Arg = (*pui32Arg * 10) + (*pcName++ - '0');
+    }
+
+    return(ustrcmp(pcName, pcPattern + 1) == 0);
+}
+
+//*****************************************************************************
+//
+// Open a generated file, if that is what is being requested.  The text is
+// allocated along with the file structure, so fs_close() frees both.
+//
+//*****************************************************************************
+static struct fs_file *
+fs_open_generated(const char *pcName)
+{
+    const tGeneratedFile *psGen;
+    struct fs_file *psFile;
+    uint32_t ui32Idx, ui32Arg;
+
+    for(ui32Idx = 0; ui32Idx < NUM_GENERATED_FILES; ui32Idx++)
+    {
+        psGen = &g_psGeneratedFiles[ui32Idx];
+        if(fs_match_generated(pcName, psGen->pcName, &ui32Arg))
+        {
+            psFile = mem_malloc(sizeof(struct fs_file) + psGen->ui32Size);
+            if(psFile == NULL)
+            {
+                return(NULL);
+            }
+
+            psFile->data = (char *)(psFile + 1);
+            psFile->len = psGen->pfnFormat((char *)psFile->data,
+                                           psGen->ui32Size, ui32Arg);
+            psFile->index = psFile->len;
+            psFile->pextension = NULL;
+            return(psFile);
+        }
+    }
+
+    return(NULL);
+}
+
 //*****************************************************************************
 //
 // Open a file and return a handle to the file, if found.  Otherwise,
@@ -115,6 +240,15 @@ fs_open(const char *pcName)
     FIL *psFatFile = NULL;
     FRESULT fresult = FR_OK;
 
+    //
+    // See if a generated file is being requested.
+    //
+    psFile = fs_open_generated(pcName);
+    if(psFile != NULL)
+    {
+        return(psFile);
+    }
+
     //
     // Allocate memory for the file system structure.
     //
@@ -42,6 +42,14 @@
 #include "utils/uartstdio.h"
 
 #include "httpserver_raw/httpd.h"
+#include "enet_fs.h"
+#include "clock_ops.h"
+#include "hotpath.h"
+#include "snapshot.h"
+#include "telemetry.h"
+#include "wakeup.h"
+#include "wheel.h"
+#include "workq.h"
 
 #include "drivers/pinout.h"
 
@@ -77,10 +85,12 @@
 
 //*****************************************************************************
 //
-// Defines for setting up the system clock.
+// Defines for setting up the system clock.  SysTick only keeps the PTP
+// clock now, so it runs no faster than the clock sources need; the timers
+// are run by the timer wheel, which wakes the processor only when one is due.
 //
 //*****************************************************************************
-#define SYSTICKHZ               100
+#define SYSTICKHZ               10
 #define SYSTICKMS               (1000 / SYSTICKHZ)
 #define SYSTICKUS               (1000000 / SYSTICKHZ)
 #define SYSTICKNS               (1000000000 / SYSTICKHZ)
@@ -93,6 +103,15 @@
 //*****************************************************************************
 #define SYSTICK_INT_PRIORITY    0x80
 #define ETHERNET_INT_PRIORITY   0xC0
+#define WAKEUP_INT_PRIORITY     0xC0
+
+//*****************************************************************************
+//
+// The interval at which the lwIP library's timers are run.  This divides
+// both the host timer and the TCP timer intervals.
+//
+//*****************************************************************************
+#define LWIP_TIMER_MS           50
 
 //*****************************************************************************
 //
@@ -105,6 +124,21 @@ static volatile unsigned long g_ulFlags;
 #define FLAG_PTPDINIT           2           // PTPd has been initialized.
 #define FLAG_PTPTIMESET         3           // PTP set GMT time.
 #define FLAG_IPUPDATE           4           // The IP address has changed.
+#define FLAG_HOTPATH            5           // Print the hot-path report.
+#define FLAG_RXSTAMP            6           // g_ui32RxSeconds/Ns not yet used.
+#define FLAG_PTPDWAKE           7           // A PTPd interval timer expired.
+
+//*****************************************************************************
+//
+// The jobs run from the main loop, highest priority first.  The interrupt
+// handlers only update the clock, capture timestamps, set flags and post
+// these; all of the TCP/IP, HTTP and PTPd work is done by the jobs.
+//
+//*****************************************************************************
+#define WORK_ETHERNET           0           // Ethernet controller service.
+#define WORK_TIMERS             1           // Timer wheel, when one is due.
+#define WORK_SECOND             2           // Time of day, once per second.
+#define WORK_SNAPSHOT           3           // Save the servo snapshot.
 
 //*****************************************************************************
 //
@@ -119,16 +153,17 @@ uint32_t g_ui32IPAddress;
 //
 //*****************************************************************************
 uint32_t g_ui32SysClock;
-uint32_t g_tickNs;
 
 //*****************************************************************************
 //
-// Local data for clocks and timers.
+// The source of the PTP clock.  Build with CLOCK_OPS defined as one of the
+// tClockOps in clock_ops.h to use a different one.
 //
 //*****************************************************************************
-static volatile unsigned long g_ulNewSystemTickReload = 0;
-static volatile unsigned long g_ulSystemTickHigh = 0;
-static volatile unsigned long g_ulSystemTickReload = 0;
+#ifndef CLOCK_OPS
+#define CLOCK_OPS               g_sClockSysTick
+#endif
+static const tClockOps *g_psClockOps = &CLOCK_OPS;
 
 //*****************************************************************************
 //
@@ -146,6 +181,43 @@ static RunTimeOpts g_sRtOpts;
 //*****************************************************************************
 volatile unsigned long g_ulSystemTimeTicks;
 
+//*****************************************************************************
+//
+// The timer wheel, the timer that runs the lwIP library's timers from it, and
+// the wakeup time at which the lwIP timers last ran.
+//
+//*****************************************************************************
+static tWheel g_sWheel;
+static tWheelTimer g_sLwIPTimer;
+static uint32_t g_ui32LwIPTimerMs;
+
+//*****************************************************************************
+//
+// The time at which the Ethernet interrupt was taken, kept as the receive
+// timestamp of the first frame that the Ethernet job then reads.
+//
+//*****************************************************************************
+static volatile uint32_t g_ui32RxSeconds;
+static volatile uint32_t g_ui32RxNanoseconds;
+
+//*****************************************************************************
+//
+// Whether the EEPROM holding the servo snapshot can be used, and the
+// snapshot waiting to be saved to it.
+//
+//*****************************************************************************
+static bool g_bSnapshot;
+static ServoSnapshot g_sSnapshot;
+
+#ifdef HOTPATH_ENABLE
+//*****************************************************************************
+//
+// The work queue counts printed with the hot-path report.
+//
+//*****************************************************************************
+static char g_pcWorkText[WORK_TEXT_SIZE];
+#endif
+
 //*****************************************************************************
 //
 // Local function prototypes.
@@ -200,14 +272,6 @@ const char *g_ppcMonth[12] =
 //*****************************************************************************
 static unsigned long g_ulLastIPAddr = 0;
 
-//*****************************************************************************
-//
-// System Time - Internal representaion.
-//
-//*****************************************************************************
-volatile unsigned long g_ulSystemTimeSeconds;
-volatile unsigned long g_ulSystemTimeNanoSeconds;
-
 //*****************************************************************************
 //
 // The random number seed, which corresponds to the most recently returned
@@ -297,6 +361,8 @@ lwIPHostTimerHandler(void)
     unsigned long ulIPAddress;
 #endif
 
+    HOTPATH_ENTER(HOTPATH_HOST_TIMER);
+
     //
     // Get the local IP address.
     //
@@ -352,68 +418,52 @@ lwIPHostTimerHandler(void)
     {
         ptpd_tick();
     }
+
+    HOTPATH_EXIT(HOTPATH_HOST_TIMER);
 }
 
 //*****************************************************************************
 //
-// The interrupt handler for the SysTick interrupt.
+// The interrupt handler for the SysTick interrupt.  Everything except the
+// clock update and the file system tick is left to the jobs.
 //
 //*****************************************************************************
 void
 SysTickIntHandler(void)
 {
-    unsigned long ulTemp;
-    struct tm sLocalTime;
-
     //
-    // Update internal time and set PPS output, if needed.
+    // The entry latency is the time since the SysTick counter wrapped.
     //
-    g_ulSystemTimeNanoSeconds += SYSTICKNS;
-    if(g_ulSystemTimeNanoSeconds >= 1000000000)
-    {
-//        ROM_GPIOPinWrite(PPS_GPIO_BASE, PPS_GPIO_PIN, PPS_GPIO_PIN);
-        g_ulSystemTimeNanoSeconds -= 1000000000;
-        g_ulSystemTimeSeconds += 1;
-        HWREGBITW(&g_ulFlags, FLAG_PPSOUT) = 1;
-    }
+    HOTPATH_LATENCY(HOTPATH_SYSTICK,
+                    (MAP_SysTickPeriodGet() - 1) - MAP_SysTickValueGet());
+    HOTPATH_ENTER(HOTPATH_SYSTICK);
 
     //
-    // Set a new System Tick Reload Value.
+    // Update the clock and set PPS output, if needed.
     //
-    ulTemp = g_ulSystemTickReload;
-    if(ulTemp != g_ulNewSystemTickReload)
+    if(g_psClockOps->pfnTick())
     {
-        g_ulSystemTickReload = g_ulNewSystemTickReload;
-
-        g_ulSystemTimeNanoSeconds = ((g_ulSystemTimeNanoSeconds / SYSTICKNS) *
-                                     SYSTICKNS);
-    }
+//        ROM_GPIOPinWrite(PPS_GPIO_BASE, PPS_GPIO_PIN, PPS_GPIO_PIN);
+        HWREGBITW(&g_ulFlags, FLAG_PPSOUT) = 1;
 
-    //
-    // For each tick, set the next reload value for fine tuning the clock.
-    //
-    ulTemp = g_ulSystemTimeTicks;
-    if((ulTemp % g_tickNs) < g_ulSystemTickHigh)
-    {
-        MAP_SysTickPeriodSet(g_ulSystemTickReload + 1);
-    }
-    else
-    {
-        MAP_SysTickPeriodSet(g_ulSystemTickReload);
+#ifdef HOTPATH_ENABLE
+        //
+        // Have the second job print the hot-path report now and then.
+        //
+        if(((g_ulSystemTimeTicks / SYSTICKHZ) % HOTPATH_REPORT_S) == 0)
+        {
+            HWREGBITW(&g_ulFlags, FLAG_HOTPATH) = 1;
+        }
+#endif
     }
 
-    //
-    // Service the PTPd Timer.
-    //
-    timerTick(SYSTICKMS);
-
     //
     // Increment the run-time tick counter.
     //
     g_ulSystemTimeTicks++;
 
     //
-    // Clear PPS output when needed and display time of day.
+    // Clear PPS output when needed and have the time of day displayed.
     //
     if(HWREGBITW(&g_ulFlags, FLAG_PPSOFF))
     {
@@ -427,26 +477,7 @@ SysTickIntHandler(void)
         //
         HWREGBITW(&g_ulFlags, FLAG_PPSOFF) = 0;
 
-        //
-        // Only print the date and time if PTPd has been started (in other
-        // words, if an IP address has been obtained).
-        //
-        if(HWREGBITW(&g_ulFlags, FLAG_PTPDINIT))
-        {
-            //
-            // Convert the elapsed seconds (ulSeconds) into time structure.
-            //
-            ulocaltime(g_ulSystemTimeSeconds, &sLocalTime);
-
-            //
-            // Print out the date and time.
-            //
-            UARTprintf("\r%3s %3s %2d, %4d %02d:%02d:%02d (GMT)",
-                       g_ppcDay[sLocalTime.tm_wday],
-                       g_ppcMonth[sLocalTime.tm_mon], sLocalTime.tm_mday,
-                       sLocalTime.tm_year, sLocalTime.tm_hour, sLocalTime.tm_min,
-                       sLocalTime.tm_sec);
-        }
+        WorkPost(WORK_SECOND);
     }
 
     //
@@ -462,191 +493,367 @@ SysTickIntHandler(void)
     }
 
     //
-    // Call the lwIP timer handler.
+    // Run the file system tick here rather than in a job, because the SD
+    // card driver busy-waits in the Ethernet job for the counters it
+    // decrements.
     //
-    lwIPTimer(SYSTICKMS);
+    fs_tick(SYSTICKMS);
+
+    HOTPATH_EXIT(HOTPATH_SYSTICK);
 }
 
 //*****************************************************************************
 //
-// Display Statistics.  For now, do nothing, but this could be used to either
-// update a web page, send data to the serial port, or to the OLED display.
-//
-// Refer to the ptpd software "src/dep/sys.c" for example code.
+// The interrupt handler for the Ethernet interrupt.  This takes the receive
+// timestamp, masks the interrupt and leaves the controller to the Ethernet
+// job, which unmasks it again.  lwIPTimer() and timerWake() also raise this
+// interrupt, to have the lwIP or PTPd timers serviced, so the timestamp is
+// only taken when the controller has received a frame.
 //
 //*****************************************************************************
 void
-displayStats(RunTimeOpts *rtOpts, PtpClock *ptpClock)
+EthernetIntHandler(void)
 {
+    uint32_t ui32Seconds;
+    uint32_t ui32Nanoseconds;
+
+    HOTPATH_ENTER(HOTPATH_ETHERNET);
+
+    if(EMACIntStatus(EMAC0_BASE, false) & EMAC_INT_RECEIVE)
+    {
+        g_psClockOps->pfnGetTime(&ui32Seconds, &ui32Nanoseconds);
+        g_ui32RxSeconds = ui32Seconds;
+        g_ui32RxNanoseconds = ui32Nanoseconds;
+        HWREGBITW(&g_ulFlags, FLAG_RXSTAMP) = 1;
+    }
+
+    MAP_IntDisable(INT_EMAC0);
+    WorkPost(WORK_ETHERNET);
+
+    HOTPATH_EXIT(HOTPATH_ETHERNET);
 }
 
 //*****************************************************************************
 //
-// This function returns the local time (in PTPd internal time format).  This
-// time is maintained by the SysTick interrupt.
+// The Ethernet job.  All of the TCP/IP and HTTP work, and the PTPd protocol
+// engine, runs from lwIPEthernetIntHandler().
+//
+//*****************************************************************************
+static void
+EthernetWork(void)
+{
+    lwIPEthernetIntHandler();
+
+    //
+    // Run the protocol engine for an interval timer that has expired since
+    // the host timer last ran it, so that intervals shorter than
+    // HOST_TMR_INTERVAL are kept.
+    //
+    if(HWREGBITW(&g_ulFlags, FLAG_PTPDWAKE))
+    {
+        ptpd_tick();
+    }
+
+    //
+    // A timestamp the frames read did not use belongs to this interrupt, not
+    // to the frames of the next.
+    //
+    HWREGBITW(&g_ulFlags, FLAG_RXSTAMP) = 0;
+
+    //
+    // Anything the controller flagged since lwIPEthernetIntHandler() read its
+    // status interrupts again now, and posts this job again.
+    //
+    MAP_IntEnable(INT_EMAC0);
+}
+
+//*****************************************************************************
 //
-// Note: It is very important to ensure that we detect cases where the system
-// tick rolls over during this function.  If we don't do this, there is a race
-// condition that will cause the reported time to be off by a second or so
-// once in a blue moon.  This, in turn, causes large perturbations in the
-// 1588 time controller resulting in large deltas for many seconds as the
-// controller tries to compensate.
+// The interrupt handler for the wakeup timer, which is taken when the next
+// timer on the wheel is due.
 //
 //*****************************************************************************
 void
-getTime(TimeInternal *time)
+WakeupIntHandler(void)
+{
+    WakeupIntClear();
+    WorkPost(WORK_TIMERS);
+}
+
+//*****************************************************************************
+//
+// The timer job.  This runs every timer on the wheel that has come due, and
+// sets the wakeup for the next one.
+//
+//*****************************************************************************
+static void
+TimerWork(void)
 {
-    unsigned long ulTime1;
-    unsigned long ulTime2;
-    unsigned long ulSeconds;
-    unsigned long ulPeriod;
-    unsigned long ulNanoseconds;
-
-    //
-    // We read the SysTick value twice, sandwiching taking snapshots of
-    // the seconds, nanoseconds and period values.  If the second SysTick read
-    // gives us a higher number than the first read, we know that it wrapped
-    // somewhere between the two reads so our seconds and nanoseconds
-    // snapshots are suspect.  If this occurs, we go round again.  Note that
-    // it is not sufficient merely to read the values with interrupts disabled
-    // since the SysTick counter keeps counting regardless of whether or not
-    // the wrap interrupt has been serviced.
+    uint32_t ui32Next;
+
+    //
+    // If the next timer came due while the wakeup was being set, run it now
+    // rather than wait for an interrupt that will not be taken.
     //
     do
     {
-        ulTime1 = MAP_SysTickValueGet();
-        ulSeconds = g_ulSystemTimeSeconds;
-        ulNanoseconds = g_ulSystemTimeNanoSeconds;
-        ulPeriod = MAP_SysTickPeriodGet();
-        ulTime2 = MAP_SysTickValueGet();
-
-#ifdef DEBUG
-        //
-        // In debug builds, keep track of the number of times this function was
-        // called just as the SysTick wrapped.
-        //
-        if(ulTime2 > ulTime1)
+        WheelAdvance(&g_sWheel, WakeupNow());
+        if(!WheelNextExpiry(&g_sWheel, &ui32Next))
         {
-            g_ulSysTickWrapDetect++;
-            g_ulSysTickWrapTime = ulSeconds;
+            ui32Next = g_sWheel.ui32Now + WAKEUP_MAX_MS;
         }
-#endif
     }
-    while(ulTime2 > ulTime1);
+    while(!WakeupSet(ui32Next));
+}
 
-    //
-    // Fill in the seconds field from the snapshot we just took.
-    //
-    time->seconds = ulSeconds;
+//*****************************************************************************
+//
+// Run the lwIP library's timers, which go on to run the host timer and with
+// it the PTPd protocol engine.
+//
+//*****************************************************************************
+static void
+LwIPTimerExpire(void *pvArg)
+{
+    uint32_t ui32Now;
+
+    ui32Now = WakeupNow();
+    lwIPTimer(ui32Now - g_ui32LwIPTimerMs);
+    g_ui32LwIPTimerMs = ui32Now;
+}
+
+//*****************************************************************************
+//
+// Return the timer wheel, on which PTPd's interval timers run.
+//
+//*****************************************************************************
+tWheel *
+timerWheel(void)
+{
+    return(&g_sWheel);
+}
+
+//*****************************************************************************
+//
+// Have the PTPd protocol engine run for one of its interval timers, which
+// has expired.  This is called from the timer job, and the engine is run by
+// the Ethernet job, as the rest of the lwIP work is.  That job is only
+// posted from the Ethernet interrupt, so the interrupt is raised for it, as
+// lwIPTimer() does.
+//
+//*****************************************************************************
+void
+timerWake(void)
+{
+    HWREGBITW(&g_ulFlags, FLAG_PTPDWAKE) = 1;
+    MAP_IntPendSet(INT_EMAC0);
+}
+
+//*****************************************************************************
+//
+// The second job.  This displays the time of day, and the hot-path report
+// when it is due.
+//
+//*****************************************************************************
+static void
+SecondWork(void)
+{
+    uint32_t ui32Seconds;
+    uint32_t ui32Nanoseconds;
+    struct tm sLocalTime;
 
     //
-    // Fill in the nanoseconds field from the snapshots.
+    // Only print the date and time if PTPd has been started (in other
+    // words, if an IP address has been obtained).
     //
-    time->nanoseconds = (ulNanoseconds + (ulPeriod - ulTime2) * g_tickNs);
+    if(HWREGBITW(&g_ulFlags, FLAG_PTPDINIT))
+    {
+        //
+        // Convert the elapsed seconds (ui32Seconds) into time structure.
+        //
+        g_psClockOps->pfnGetTime(&ui32Seconds, &ui32Nanoseconds);
+        ulocaltime(ui32Seconds, &sLocalTime);
+
+        //
+        // Print out the date and time.
+        //
+        UARTprintf("\r%3s %3s %2d, %4d %02d:%02d:%02d (GMT)",
+                   g_ppcDay[sLocalTime.tm_wday],
+                   g_ppcMonth[sLocalTime.tm_mon], sLocalTime.tm_mday,
+                   sLocalTime.tm_year, sLocalTime.tm_hour, sLocalTime.tm_min,
+                   sLocalTime.tm_sec);
+    }
 
+#ifdef HOTPATH_ENABLE
     //
-    // Adjust for any case where we accumulate more than 1 second's worth of
-    // nanoseconds.
+    // Print the hot-path report and the work queue counts when the SysTick
+    // handler asks for them.
     //
-    if(time->nanoseconds >= 1000000000)
+    if(HWREGBITW(&g_ulFlags, FLAG_HOTPATH))
     {
-#ifdef DEBUG
-        g_ulGetTimeWrapCount++;
+        HWREGBITW(&g_ulFlags, FLAG_HOTPATH) = 0;
+        HotpathPrint();
+        WorkFormat(g_pcWorkText, sizeof(g_pcWorkText));
+        UARTprintf("%s", g_pcWorkText);
+    }
 #endif
-        time->seconds++;
-        time->nanoseconds -= 1000000000;
+}
+
+//*****************************************************************************
+//
+// The snapshot job.  This saves the servo snapshot to the EEPROM, which takes
+// too long to do in the protocol engine.
+//
+//*****************************************************************************
+static void
+SnapshotWork(void)
+{
+    if(!SnapshotSave(&g_sSnapshot, sizeof(g_sSnapshot)))
+    {
+        UARTprintf("\nSnapshot not saved.\n");
     }
 }
 
 //*****************************************************************************
 //
-// Get the RX Timestamp.  This is called from the lwIP low_level_input function
-// when configured to include PTPd support.
+// The jobs, in WORK_* order.
+//
+//*****************************************************************************
+static const tWorkJob g_psWorkJobs[] =
+{
+    { "ethernet", EthernetWork, HOTPATH_WORK_ETHERNET },
+    { "timers", TimerWork, HOTPATH_WORK_TIMERS },
+    { "second", SecondWork, HOTPATH_WORK_SECOND },
+    { "snapshot", SnapshotWork, HOTPATH_WORK_SNAPSHOT }
+};
+
+//*****************************************************************************
+//
+// Display Statistics.  Each servo update and change of port state is recorded
+// as a sample in the telemetry ring, which the web server serves as
+// /telemetry.csv and /telemetry.bin.  The Sync's send time is its receive
+// time less the master to slave delay just measured.
 //
 //*****************************************************************************
 void
-lwIPHostGetTime(u32_t *time_s, u32_t *time_ns)
+displayStats(RunTimeOpts *rtOpts, PtpClock *ptpClock)
 {
-    TimeInternal psRxTime;
+    volatile tTelemetrySample *psSample;
+    TimeInternal sSent;
+
+    subTime(&sSent, &ptpClock->sync_receive_time,
+            &ptpClock->master_to_slave_delay);
+
+    psSample = TelemetryClaim();
+    psSample->ui32T1Sec = sSent.seconds;
+    psSample->ui32T1NSec = sSent.nanoseconds;
+    psSample->ui32T2Sec = ptpClock->sync_receive_time.seconds;
+    psSample->ui32T2NSec = ptpClock->sync_receive_time.nanoseconds;
+    psSample->i32Offset = ptpClock->offset_from_master.nanoseconds;
+    psSample->i32Delay = ptpClock->one_way_delay.nanoseconds;
+    psSample->i32Adj = ptpClock->rate.adj;
+    psSample->i32Drift = ptpClock->observed_drift;
+    psSample->ui16SyncSeq = ptpClock->parent_last_sync_sequence_number;
+    psSample->ui8State = ptpClock->port_state;
+    TelemetryCommit(psSample);
+}
 
-    //
-    // Get the current IEEE1588 time.
-    //
-    getTime(&psRxTime);
+//*****************************************************************************
+//
+// This function returns the local time (in PTPd internal time format).  This
+// time is maintained by the clock source.
+//
+//*****************************************************************************
+void
+getTime(TimeInternal *time)
+{
+    uint32_t ui32Seconds;
+    uint32_t ui32Nanoseconds;
+
+    HOTPATH_ENTER(HOTPATH_GETTIME);
 
+    g_psClockOps->pfnGetTime(&ui32Seconds, &ui32Nanoseconds);
+    time->seconds = ui32Seconds;
+    time->nanoseconds = ui32Nanoseconds;
+
+    HOTPATH_EXIT(HOTPATH_GETTIME);
+}
+
+//*****************************************************************************
+//
+// Get the RX Timestamp.  This is called from the lwIP low_level_input function
+// when configured to include PTPd support, in the Ethernet job.
+//
+//*****************************************************************************
+void
+lwIPHostGetTime(u32_t *time_s, u32_t *time_ns)
+{
     //
-    // Fill in the appropriate return values.
+    // The first frame read after an Ethernet interrupt is stamped with the
+    // time the interrupt was taken, not the time the Ethernet job got to it.
+    // Any more frames read by the same job arrived while it ran, so take
+    // their time straight from the clock source.
     //
-    *time_s = psRxTime.seconds;
-    *time_ns = psRxTime.nanoseconds;
+    if(HWREGBITW(&g_ulFlags, FLAG_RXSTAMP))
+    {
+        HWREGBITW(&g_ulFlags, FLAG_RXSTAMP) = 0;
+        *time_s = g_ui32RxSeconds;
+        *time_ns = g_ui32RxNanoseconds;
+    }
+    else
+    {
+        g_psClockOps->pfnGetTime((uint32_t *)time_s, (uint32_t *)time_ns);
+    }
 }
 
 //*****************************************************************************
 //
-// This function returns a random number, using the functions in random.c.
+// This function returns a random number from a linear congruence generator
+// kept in the caller's seed.  Re-seeding the entropy pool in random.c on
+// every call cost an MD4 hash each time, for numbers that only spread the
+// Delay_Req messages out.  The low bits of the generator repeat with a short
+// period, so the top 16 bits are the ones returned.
 //
 //*****************************************************************************
 UInteger16
 getRand(UInteger32 *seed)
 {
-    unsigned long ulTemp;
-    UInteger16 uiTemp;
+    *seed = (*seed * 1664525) + 1013904223;
 
-    //
-    // Re-seed the random number generator.
-    //
-    RandomAddEntropy(*seed);
-    RandomSeed();
-
-    //
-    // Get a random number and return a 16-bit, truncated version.
-    //
-    ulTemp = RandomNumber();
-    uiTemp = (UInteger16)(ulTemp & 0xFFFF);
-    return(uiTemp);
+    return((UInteger16)(*seed >> 16));
 }
 
 //*****************************************************************************
 //
 // This function will set the local time (provided in PTPd internal time
-// format).  This time is maintained by the SysTick interrupt.
+// format).  This time is maintained by the clock source.
 //
 //*****************************************************************************
 void
 setTime(TimeInternal *time)
 {
-    sys_prot_t sProt;
-
     //
-    // Update the System Tick Handler time values from the given PTPd time
-    // (fine-tuning is handled in the System Tick handler).  We need to update
-    // these variables with interrupts disabled since the update must be
-    // atomic.
+    // Update the clock source from the given PTPd time.  The clock source
+    // publishes the new time to its readers without disabling interrupts.
     //
-    sProt = sys_arch_protect();
-    g_ulSystemTimeSeconds = time->seconds;
-    g_ulSystemTimeNanoSeconds = time->nanoseconds;
+    g_psClockOps->pfnSetTime(time->seconds, time->nanoseconds);
 
     //
     // Set the flag indicating that PTP has set our system clock.
     //
     HWREGBITW(&g_ulFlags, FLAG_PTPTIMESET) = 1;
-
-    sys_arch_unprotect(sProt);
 }
 
 //*****************************************************************************
 //
 // Based on the value (adj) provided by the PTPd Clock Servo routine, this
-// function will adjust the SysTick periodic interval to allow fine-tuning of
+// function will trim the rate of the clock source to allow fine-tuning of
 // the PTP Clock.
 //
 //*****************************************************************************
 Boolean
 adjFreq(Integer32 adj)
 {
-    unsigned long ulTemp;
-
     //
     // Check for max/min value of adjustment.
     //
@@ -659,35 +866,44 @@ adjFreq(Integer32 adj)
         adj = -ADJ_MAX;
     }
 
-    //
-    // Convert input to nanoseconds / systick.
-    //
-    adj = adj / SYSTICKHZ;
+    g_psClockOps->pfnAdjFreq(adj);
 
     //
-    // Get the nominal tick reload value and convert to nano seconds.
-    //
-    ulTemp = (g_ui32SysClock / SYSTICKHZ) * g_tickNs;
-
-    //
-    // Factor in the adjustment.
+    // Return.
     //
-    ulTemp -= adj;
+    return(TRUE);
+}
 
-    //
-    // Get a modulo count of nanoseconds for fine tuning.
-    //
-    g_ulSystemTickHigh = ulTemp % g_tickNs;
+//*****************************************************************************
+//
+// Recall the servo snapshot saved before the last restart, for a warm start.
+//
+//*****************************************************************************
+Boolean
+loadSnapshot(ServoSnapshot *snap)
+{
+    if(!g_bSnapshot)
+    {
+        return(FALSE);
+    }
 
-    //
-    // Set the reload value.
-    //
-    g_ulNewSystemTickReload = ulTemp / g_tickNs;
+    return(SnapshotLoad(snap, sizeof(*snap)) ? TRUE : FALSE);
+}
 
-    //
-    // Return.
-    //
-    return(TRUE);
+//*****************************************************************************
+//
+// Keep the servo snapshot for a warm start after a restart.  The EEPROM is
+// programmed later, by the snapshot job.
+//
+//*****************************************************************************
+void
+saveSnapshot(ServoSnapshot *snap)
+{
+    if(g_bSnapshot)
+    {
+        g_sSnapshot = *snap;
+        WorkPost(WORK_SNAPSHOT);
+    }
 }
 
 //*****************************************************************************
@@ -722,12 +938,35 @@ ptpd_init(void)
     memcpy(g_sRtOpts.ifaceName, "LMI", strlen("LMI"));
     g_sRtOpts.noResetClock = DEFAULT_NO_RESET_CLOCK;
     g_sRtOpts.noAdjust = FALSE;
-    g_sRtOpts.displayStats = FALSE;
+    g_sRtOpts.displayStats = TRUE;
     g_sRtOpts.csvStats = FALSE;
     g_sRtOpts.unicastAddress[0] = 0;
-    g_sRtOpts.ap = DEFAULT_AP;
-    g_sRtOpts.ai = DEFAULT_AI;
+    g_sRtOpts.ap = SCHEDULED_GAIN;
+    g_sRtOpts.ai = SCHEDULED_GAIN;
     g_sRtOpts.s = DEFAULT_DELAY_S;
+    g_sRtOpts.stepThreshold = DEFAULT_STEP_THRESHOLD;
+    g_sRtOpts.slewThreshold = DEFAULT_SLEW_THRESHOLD;
+    g_sRtOpts.slewWindow = DEFAULT_SLEW_WINDOW;
+    g_sRtOpts.slewMax = DEFAULT_SLEW_MAX;
+    g_sRtOpts.holdoverWindow = DEFAULT_HOLDOVER_WINDOW;
+    g_sRtOpts.holdoverDriftRate = DEFAULT_HOLDOVER_DRIFT_RATE;
+    g_sRtOpts.servo = DEFAULT_SERVO;
+    g_sRtOpts.freqFirst = DEFAULT_FREQ_FIRST;
+    g_sRtOpts.pdvFilter = DEFAULT_PDV_FILTER;
+    g_sRtOpts.pdvGate = DEFAULT_PDV_GATE;
+    g_sRtOpts.delayReqAdapt = DEFAULT_DELAY_REQ_ADAPT;
+    g_sRtOpts.delayReqMin = DEFAULT_DELAY_REQ_MIN;
+    g_sRtOpts.delayReqMax = DEFAULT_DELAY_REQ_MAX;
+    g_sRtOpts.delayReqNoise = DEFAULT_DELAY_REQ_NOISE;
+    g_sRtOpts.delayReqLimit = DEFAULT_DELAY_REQ_LIMIT;
+    g_sRtOpts.ptpVersion = DEFAULT_PTP_VERSION;
+    g_sRtOpts.domainNumber = DEFAULT_DOMAIN_NUMBER;
+    g_sRtOpts.priority1 = DEFAULT_PRIORITY1;
+    g_sRtOpts.priority2 = DEFAULT_PRIORITY2;
+    g_sRtOpts.announceInterval = DEFAULT_ANNOUNCE_INTERVAL;
+    g_sRtOpts.announceReceiptTimeout = DEFAULT_ANNOUNCE_RECEIPT_TIMEOUT;
+    g_sRtOpts.delayReqInterval = DEFAULT_DELAY_REQ_INTERVAL;
+    g_sRtOpts.twoStep = FALSE;
     g_sRtOpts.inboundLatency.seconds = 0;
     g_sRtOpts.inboundLatency.nanoseconds = DEFAULT_INBOUND_LATENCY;
     g_sRtOpts.outboundLatency.seconds = 0;
@@ -781,8 +1020,13 @@ ptpd_tick(void)
 {
     //
     // Run the protocol engine for each pass through the main process loop.
+    // This runs any interval timer that has expired, so there is no need to
+    // run it again for the wakeup.
     //
+    HWREGBITW(&g_ulFlags, FLAG_PTPDWAKE) = 0;
+    HOTPATH_ENTER(HOTPATH_PROTOCOL_LOOP);
     protocol_loop(&g_sRtOpts, &g_sPTPClock);
+    HOTPATH_EXIT(HOTPATH_PROTOCOL_LOOP);
 }
 
 
@@ -801,13 +1045,30 @@ int main(void)
     SysCtlMOSCConfigSet(SYSCTL_MOSC_HIGHFREQ);
 
     //
-    // Run from the PLL at 40 MHz. (chosen so that g_tickNs is an integer value)
+    // Run from the PLL at 120 MHz.  The clock sources work in fixed-point
+    // nanoseconds per processor clock, so this need only be a multiple of
+    // SYSTICKHZ.
     //
     g_ui32SysClock = MAP_SysCtlClockFreqSet((SYSCTL_XTAL_25MHZ |
                                              SYSCTL_OSC_MAIN |
                                              SYSCTL_USE_PLL |
-                                             SYSCTL_CFG_VCO_480), 40000000);
-    g_tickNs = 1000000000 / g_ui32SysClock;
+                                             SYSCTL_CFG_VCO_480), 120000000);
+
+    //
+    // Start the hot-path instrumentation, if it is built in.
+    //
+    HOTPATH_INIT();
+
+    //
+    // Set up the work queue before any interrupt handler can post to it.
+    //
+    WorkInit(g_psWorkJobs, sizeof(g_psWorkJobs) / sizeof(g_psWorkJobs[0]));
+
+    //
+    // Start the time base that the timer wheel runs from.
+    //
+    WakeupInit(g_ui32SysClock);
+    WheelInit(&g_sWheel, WakeupNow);
 
     //
     // Configure the device pins.
@@ -828,13 +1089,27 @@ int main(void)
     //
     // Configure SysTick for a periodic interrupt.
     //
-    ROM_SysTickPeriodSet(g_ui32SysClock / SYSTICKHZ);
-    g_ulSystemTickReload = ROM_SysTickPeriodGet();
-    g_ulNewSystemTickReload = g_ulSystemTickReload;
     MAP_SysTickPeriodSet(g_ui32SysClock / SYSTICKHZ);
+
+    //
+    // Start the PTP clock source before the SysTick interrupt that drives it.
+    //
+    g_psClockOps->pfnInit(g_ui32SysClock, SYSTICKHZ);
+    UARTprintf("Clock source: %s, %d ns\n", g_psClockOps->pcName,
+               g_psClockOps->pfnResolution());
+
     MAP_SysTickEnable();
     MAP_SysTickIntEnable();
 
+    //
+    // Find the servo snapshot kept in the EEPROM, for PTPd to start warm.
+    //
+    g_bSnapshot = SnapshotInit();
+    if(!g_bSnapshot)
+    {
+        UARTprintf("EEPROM unavailable, no warm start.\n");
+    }
+
     //
     // Configure the hardware MAC address for Ethernet Controller filtering of
     // incoming packets.  The MAC address will be stored in the non-volatile
@@ -876,18 +1151,36 @@ int main(void)
     lwIPInit(g_ui32SysClock, pui8MACArray, 0, 0, 0, IPADDR_USE_DHCP);
 
     //
-    // Set the interrupt priorities.  We set the SysTick interrupt to a higher
-    // priority than the Ethernet interrupt to ensure that the file system
-    // tick is processed if SysTick occurs while the Ethernet handler is being
-    // processed.  This is very likely since all the TCP/IP and HTTP work is
-    // done in the context of the Ethernet interrupt.
+    // Initialize the file system and the web server.
+    //
+    fs_init();
+    httpd_init();
+
+    //
+    // Run the lwIP timers from the wheel, and set the first wakeup.
+    //
+    WheelTimerStart(&g_sWheel, &g_sLwIPTimer, LwIPTimerExpire, 0,
+                    LWIP_TIMER_MS, LWIP_TIMER_MS);
+    WorkPost(WORK_TIMERS);
+    MAP_IntPrioritySet(WAKEUP_INT, WAKEUP_INT_PRIORITY);
+    MAP_IntEnable(WAKEUP_INT);
+
+    //
+    // Set the interrupt priorities.  The handlers are short now that the
+    // work is done by the jobs, but the SysTick interrupt is kept above the
+    // Ethernet and wakeup interrupts so that the clock is updated on time.
     //
     MAP_IntPrioritySet(INT_EMAC0, ETHERNET_INT_PRIORITY);
     MAP_IntPrioritySet(FAULT_SYSTICK, SYSTICK_INT_PRIORITY);
 
+    //
+    // Run the jobs posted by the interrupt handlers, in priority order, and
+    // sleep until the next interrupt when there are none.
+    //
     for (;;)
     {
-
+        WorkRun();
+        WorkSleep();
     }
 
 }
@@ -0,0 +1,160 @@
+//*****************************************************************************
+//
+// bench.c - Timing and reporting helpers shared by the host benchmarks.
+//
+// Results are printed one per line as space separated key=value pairs so that
+// they can be collected per commit and compared by scripts.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include "bench.h"
+#ifdef BENCH_DWT
+#include "inc/hw_types.h"
+#endif
+
+//*****************************************************************************
+//
+// The number of back-to-back timer reads used to calibrate timer overhead.
+//
+//*****************************************************************************
+#define BENCH_CALIBRATE_COUNT   1000
+
+#ifdef BENCH_DWT
+//*****************************************************************************
+//
+// The Cortex-M debug registers used to run the DWT cycle counter.
+//
+//*****************************************************************************
+#define BENCH_DEMCR             0xE000EDFC
+#define BENCH_DEMCR_TRCENA      0x01000000
+#define BENCH_DWT_CTRL          0xE0001000
+#define BENCH_DWT_CYCCNTENA     0x00000001
+#define BENCH_DWT_CYCCNT        0xE0001004
+
+//*****************************************************************************
+//
+// The cycle counter is 32 bits wide, so it is extended to 64 bits in
+// software.  This is correct as long as it is read at least once per wrap
+// (35 seconds at 120 MHz), which every benchmark run does.
+//
+//*****************************************************************************
+static uint32_t g_ui32LastCycles;
+static uint64_t g_ui64CyclesHigh;
+#endif
+
+//*****************************************************************************
+//
+// Return a count of CPU cycles, or 0 if there is no cycle counter.
+//
+//*****************************************************************************
+uint64_t
+BenchCyclesNow(void)
+{
+#ifdef BENCH_DWT
+    uint32_t ui32Now;
+
+    if(!(HWREG(BENCH_DWT_CTRL) & BENCH_DWT_CYCCNTENA))
+    {
+        HWREG(BENCH_DEMCR) |= BENCH_DEMCR_TRCENA;
+        HWREG(BENCH_DWT_CYCCNT) = 0;
+        HWREG(BENCH_DWT_CTRL) |= BENCH_DWT_CYCCNTENA;
+    }
+
+    ui32Now = HWREG(BENCH_DWT_CYCCNT);
+    if(ui32Now < g_ui32LastCycles)
+    {
+        g_ui64CyclesHigh += 0x100000000ULL;
+    }
+    g_ui32LastCycles = ui32Now;
+
+    return(g_ui64CyclesHigh + ui32Now);
+#else
+    return(0);
+#endif
+}
+
+//*****************************************************************************
+//
+// Return a monotonic timestamp in nanoseconds.
+//
+//*****************************************************************************
+uint64_t
+BenchNowNs(void)
+{
+#ifdef BENCH_DWT
+    return((BenchCyclesNow() * 1000000000ULL) / BENCH_CPU_HZ);
+#else
+    struct timespec sNow;
+
+    clock_gettime(CLOCK_MONOTONIC, &sNow);
+
+    return(((uint64_t)sNow.tv_sec * 1000000000) + (uint64_t)sNow.tv_nsec);
+#endif
+}
+
+//*****************************************************************************
+//
+// Return the smallest observed cost of a pair of BenchNowNs() calls.  This is
+// subtracted from individually timed operations.
+//
+//*****************************************************************************
+uint64_t
+BenchOverheadNs(void)
+{
+    uint64_t ui64Start, ui64Delta, ui64Min;
+    int iIdx;
+
+    ui64Min = UINT64_MAX;
+    for(iIdx = 0; iIdx < BENCH_CALIBRATE_COUNT; iIdx++)
+    {
+        ui64Start = BenchNowNs();
+        ui64Delta = BenchNowNs() - ui64Start;
+        if(ui64Delta < ui64Min)
+        {
+            ui64Min = ui64Delta;
+        }
+    }
+
+    return(ui64Min);
+}
+
+//*****************************************************************************
+//
+// Print one benchmark result.
+//
+//*****************************************************************************
+void
+BenchReport(const char *pcName, uint64_t ui64Ops, uint64_t ui64ElapsedNs)
+{
+    BenchReportCycles(pcName, ui64Ops, ui64ElapsedNs, 0);
+}
+
+//*****************************************************************************
+//
+// Print one benchmark result, with its cycle count if one was measured.
+//
+//*****************************************************************************
+void
+BenchReportCycles(const char *pcName, uint64_t ui64Ops, uint64_t ui64ElapsedNs,
+                  uint64_t ui64Cycles)
+{
+    double dNsPerOp, dOpsPerSec;
+
+    dNsPerOp = ui64Ops ? ((double)ui64ElapsedNs / (double)ui64Ops) : 0.0;
+    dOpsPerSec = ui64ElapsedNs ? ((double)ui64Ops * 1e9 /
+                                  (double)ui64ElapsedNs) : 0.0;
+
+    printf("bench=%s ops=%llu ns=%llu ns_per_op=%.1f ops_per_sec=%.0f",
+           pcName, (unsigned long long)ui64Ops,
+           (unsigned long long)ui64ElapsedNs, dNsPerOp, dOpsPerSec);
+    if(ui64Cycles)
+    {
+        printf(" cycles=%llu cycles_per_op=%.1f",
+               (unsigned long long)ui64Cycles,
+               ui64Ops ? ((double)ui64Cycles / (double)ui64Ops) : 0.0);
+    }
+    printf("\n");
+}
@@ -0,0 +1,59 @@
+//*****************************************************************************
+//
+// bench.h - Timing and reporting helpers shared by the host benchmarks.
+//
+//*****************************************************************************
+
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <stdint.h>
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+//*****************************************************************************
+//
+// When the benchmarks are built for the target with BENCH_DWT defined, time
+// is taken from the Cortex-M DWT cycle counter and results also carry cycle
+// counts.  BENCH_CPU_HZ must then match the configured system clock.
+//
+//*****************************************************************************
+#ifdef BENCH_DWT
+#define BENCH_HAVE_CYCLES
+#ifndef BENCH_CPU_HZ
+#define BENCH_CPU_HZ            120000000
+#endif
+#endif
+
+//*****************************************************************************
+//
+// Prototypes.
+//
+//*****************************************************************************
+extern uint64_t BenchNowNs(void);
+extern uint64_t BenchCyclesNow(void);
+extern uint64_t BenchOverheadNs(void);
+extern void BenchReport(const char *pcName, uint64_t ui64Ops,
+                        uint64_t ui64ElapsedNs);
+extern void BenchReportCycles(const char *pcName, uint64_t ui64Ops,
+                              uint64_t ui64ElapsedNs, uint64_t ui64Cycles);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __BENCH_H__
@@ -0,0 +1,327 @@
+//*****************************************************************************
+//
+// bench_clock.c - Read cost and resolution of the PTP clock sources.
+//
+// Every clock source in clock_ops.h is run through the same benchmarks:
+// reading the time, setting it and trimming its rate.  Each benchmark runs a
+// fixed number of iterations, is repeated several times and reports its
+// fastest repeat.  Then the clock is read back to back to find the smallest
+// step between two different readings, which is reported next to the
+// resolution the source claims.
+//
+// On the host only the simulated source exists, and it does not move between
+// reads.  Built for the target with BENCH_DWT defined, the SysTick and
+// general-purpose timer sources are compared instead.
+//
+//     bench_clock [-n iterations] [-r repeats] [name-filter]
+//
+//*****************************************************************************
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "clock_ops.h"
+#ifdef BENCH_DWT
+#include "driverlib/rom_map.h"
+#include "driverlib/systick.h"
+#else
+#include "ptpd_host.h"
+#endif
+
+//*****************************************************************************
+//
+// Benchmark parameters.
+//
+//*****************************************************************************
+#define DEFAULT_ITERATIONS      1000000
+#define DEFAULT_REPEATS         5
+#define RESOLUTION_READS        100000
+#define BENCH_TICK_HZ           10
+
+//*****************************************************************************
+//
+// The processor clock handed to the clock sources.  The simulated source
+// ignores it.
+//
+//*****************************************************************************
+#ifdef BENCH_DWT
+#define BENCH_CLOCK_HZ          BENCH_CPU_HZ
+#else
+#define BENCH_CLOCK_HZ          120000000
+#endif
+
+//*****************************************************************************
+//
+// The clock sources under test.
+//
+//*****************************************************************************
+static const tClockOps * const g_ppsClocks[] =
+{
+#ifdef BENCH_DWT
+    &g_sClockSysTick,
+    &g_sClockGPTimer
+#else
+    &g_sClockSim
+#endif
+};
+
+#define NUM_CLOCKS              (sizeof(g_ppsClocks) / sizeof(g_ppsClocks[0]))
+
+//*****************************************************************************
+//
+// One benchmark: its name, and a function that runs it against a clock
+// source for a given number of iterations.
+//
+//*****************************************************************************
+typedef struct
+{
+    const char *pcName;
+    void (*pfnRun)(const tClockOps *psClock, uint32_t ui32Iterations);
+}
+tBenchmark;
+
+//*****************************************************************************
+//
+// Results are folded into this so that the compiler cannot discard the work.
+//
+//*****************************************************************************
+static volatile uint32_t g_ui32Sink;
+
+#ifndef BENCH_DWT
+//*****************************************************************************
+//
+// The node whose clock the simulated source reads.
+//
+//*****************************************************************************
+static tHostNode g_sNode;
+#endif
+
+//*****************************************************************************
+//
+// Benchmarks.
+//
+//*****************************************************************************
+static void
+BenchGetTime(const tClockOps *psClock, uint32_t ui32Iterations)
+{
+    uint32_t ui32Idx, ui32Seconds, ui32Nanoseconds, ui32Sum = 0;
+
+    for(ui32Idx = 0; ui32Idx < ui32Iterations; ui32Idx++)
+    {
+        psClock->pfnGetTime(&ui32Seconds, &ui32Nanoseconds);
+        ui32Sum += ui32Nanoseconds;
+    }
+
+    g_ui32Sink += ui32Sum;
+}
+
+static void
+BenchSetTime(const tClockOps *psClock, uint32_t ui32Iterations)
+{
+    uint32_t ui32Idx, ui32Seconds, ui32Nanoseconds;
+
+    psClock->pfnGetTime(&ui32Seconds, &ui32Nanoseconds);
+    for(ui32Idx = 0; ui32Idx < ui32Iterations; ui32Idx++)
+    {
+        psClock->pfnSetTime(ui32Seconds, ui32Nanoseconds);
+    }
+}
+
+static void
+BenchAdjFreq(const tClockOps *psClock, uint32_t ui32Iterations)
+{
+    uint32_t ui32Idx;
+
+    for(ui32Idx = 0; ui32Idx < ui32Iterations; ui32Idx++)
+    {
+        psClock->pfnAdjFreq((int32_t)(ui32Idx & 0xFFF) - 0x800);
+    }
+
+    psClock->pfnAdjFreq(0);
+}
+
+//*****************************************************************************
+//
+// The benchmark table.
+//
+//*****************************************************************************
+static const tBenchmark g_psBenchmarks[] =
+{
+    { "get_time", BenchGetTime },
+    { "set_time", BenchSetTime },
+    { "adj_freq", BenchAdjFreq }
+};
+
+#define NUM_BENCHMARKS          (sizeof(g_psBenchmarks) /                     \
+                                 sizeof(g_psBenchmarks[0]))
+
+//*****************************************************************************
+//
+// Read a clock back to back and report the smallest non-zero step seen,
+// alongside the resolution the source claims.
+//
+//*****************************************************************************
+static void
+ResolutionReport(const tClockOps *psClock)
+{
+    uint32_t ui32Idx, ui32Seconds, ui32Nanoseconds, ui32Changes;
+    uint64_t ui64Prev, ui64Now, ui64MinStep;
+
+    psClock->pfnGetTime(&ui32Seconds, &ui32Nanoseconds);
+    ui64Prev = ((uint64_t)ui32Seconds * 1000000000) + ui32Nanoseconds;
+    ui64MinStep = 0;
+    ui32Changes = 0;
+
+    for(ui32Idx = 0; ui32Idx < RESOLUTION_READS; ui32Idx++)
+    {
+        psClock->pfnGetTime(&ui32Seconds, &ui32Nanoseconds);
+        ui64Now = ((uint64_t)ui32Seconds * 1000000000) + ui32Nanoseconds;
+        if(ui64Now != ui64Prev)
+        {
+            if(!ui64MinStep || ((ui64Now - ui64Prev) < ui64MinStep))
+            {
+                ui64MinStep = ui64Now - ui64Prev;
+            }
+            ui32Changes++;
+        }
+        ui64Prev = ui64Now;
+    }
+
+    printf("clock=%s resolution_ns=%u min_step_ns=%llu reads=%u changes=%u\n",
+           psClock->pcName, psClock->pfnResolution(),
+           (unsigned long long)ui64MinStep, RESOLUTION_READS, ui32Changes);
+}
+
+//*****************************************************************************
+//
+// Start the clock sources.
+//
+//*****************************************************************************
+static void
+ClockInit(void)
+{
+    uint32_t ui32Idx;
+#ifdef BENCH_DWT
+    //
+    // The SysTick source interpolates from the SysTick counter, which must be
+    // running.  Its interrupt is not needed for these measurements.
+    //
+    MAP_SysTickPeriodSet(BENCH_CLOCK_HZ / BENCH_TICK_HZ);
+    MAP_SysTickEnable();
+#else
+    static const uint8_t pui8UUID[PTP_UUID_LENGTH] =
+        { 0x00, 0x1a, 0xb6, 0x00, 0x00, 0x01 };
+
+    HostNodeInit(&g_sNode, pui8UUID, true);
+    HostClockInit(&g_sNode.sClock, 1000000000LL * 1000000, 0.0);
+    HostNodeSelect(&g_sNode);
+#endif
+
+    for(ui32Idx = 0; ui32Idx < NUM_CLOCKS; ui32Idx++)
+    {
+        g_ppsClocks[ui32Idx]->pfnInit(BENCH_CLOCK_HZ, BENCH_TICK_HZ);
+        g_ppsClocks[ui32Idx]->pfnSetTime(1000000, 0);
+    }
+}
+
+//*****************************************************************************
+//
+// Benchmark entry point.
+//
+//*****************************************************************************
+int
+main(int argc, char *argv[])
+{
+    uint32_t ui32Iterations, ui32Repeats, ui32Clock, ui32Idx, ui32Rep;
+    uint64_t ui64Start, ui64Ns, ui64BestNs, ui64Cycles, ui64BestCycles;
+    const tClockOps *psClock;
+    const char *pcFilter;
+    char pcName[64];
+    int iArg;
+
+    ui32Iterations = DEFAULT_ITERATIONS;
+    ui32Repeats = DEFAULT_REPEATS;
+    pcFilter = NULL;
+
+    for(iArg = 1; iArg < argc; iArg++)
+    {
+        if(!strcmp(argv[iArg], "-n") && ((iArg + 1) < argc))
+        {
+            ui32Iterations = (uint32_t)strtoul(argv[++iArg], NULL, 0);
+        }
+        else if(!strcmp(argv[iArg], "-r") && ((iArg + 1) < argc))
+        {
+            ui32Repeats = (uint32_t)strtoul(argv[++iArg], NULL, 0);
+        }
+        else if(argv[iArg][0] != '-')
+        {
+            pcFilter = argv[iArg];
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-n iterations] [-r repeats] "
+                    "[name-filter]\n", argv[0]);
+            return(1);
+        }
+    }
+    if((ui32Iterations == 0) || (ui32Repeats == 0))
+    {
+        fprintf(stderr, "iterations and repeats must be non-zero\n");
+        return(1);
+    }
+
+    ClockInit();
+
+    for(ui32Clock = 0; ui32Clock < NUM_CLOCKS; ui32Clock++)
+    {
+        psClock = g_ppsClocks[ui32Clock];
+
+        for(ui32Idx = 0; ui32Idx < NUM_BENCHMARKS; ui32Idx++)
+        {
+            snprintf(pcName, sizeof(pcName), "clock.%s.%s", psClock->pcName,
+                     g_psBenchmarks[ui32Idx].pcName);
+            if(pcFilter && !strstr(pcName, pcFilter))
+            {
+                continue;
+            }
+
+            //
+            // One untimed pass to warm the caches, then keep the fastest of
+            // the timed repeats.
+            //
+            g_psBenchmarks[ui32Idx].pfnRun(psClock, ui32Iterations / 16 + 1);
+
+            ui64BestNs = UINT64_MAX;
+            ui64BestCycles = 0;
+            for(ui32Rep = 0; ui32Rep < ui32Repeats; ui32Rep++)
+            {
+                ui64Cycles = BenchCyclesNow();
+                ui64Start = BenchNowNs();
+                g_psBenchmarks[ui32Idx].pfnRun(psClock, ui32Iterations);
+                ui64Ns = BenchNowNs() - ui64Start;
+                ui64Cycles = BenchCyclesNow() - ui64Cycles;
+
+                if(ui64Ns < ui64BestNs)
+                {
+                    ui64BestNs = ui64Ns;
+                    ui64BestCycles = ui64Cycles;
+                }
+            }
+
+            BenchReportCycles(pcName, ui32Iterations, ui64BestNs,
+                              ui64BestCycles);
+        }
+
+        if(!pcFilter || strstr(psClock->pcName, pcFilter))
+        {
+            ResolutionReport(psClock);
+        }
+    }
+
+    printf("# iterations=%u repeats=%u\n", ui32Iterations, ui32Repeats);
+
+    return(0);
+}
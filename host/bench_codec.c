@@ -0,0 +1,446 @@
+//*****************************************************************************
+//
+// bench_codec.c - Microbenchmarks for the PTP message codec, the time
+// arithmetic and the best master clock comparison.
+//
+// These are the routines that run on every received message: the offset
+// based packers and unpackers in dep-tiva/ptpd_msg.c, normalizeTime(),
+// addTime() and subTime() in arith.c and bmcDataSetComparison() in bmc.c.
+// Each benchmark runs a fixed number of iterations over a small table of
+// varied inputs, is repeated several times and reports its fastest repeat,
+// which keeps the numbers stable from run to run.
+//
+//     bench_codec [-n iterations] [-r repeats] [name-filter]
+//
+//*****************************************************************************
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "ptpd_host.h"
+
+//*****************************************************************************
+//
+// Benchmark parameters.  The input tables are a power of two in size so that
+// they can be indexed with a mask.
+//
+//*****************************************************************************
+#define DEFAULT_ITERATIONS      1000000
+#define DEFAULT_REPEATS         5
+#define INPUT_COUNT             64
+#define INPUT_MASK              (INPUT_COUNT - 1)
+
+//*****************************************************************************
+//
+// bmc.c does not export a prototype for the data set comparison.
+//
+//*****************************************************************************
+extern Integer8 bmcDataSetComparison(MsgHeader *psHeaderA, MsgSync *psSyncA,
+                                     MsgHeader *psHeaderB, MsgSync *psSyncB,
+                                     PtpClock *psPTPClock);
+
+//*****************************************************************************
+//
+// One benchmark: its name, and a function that runs it for a given number of
+// iterations.
+//
+//*****************************************************************************
+typedef struct
+{
+    const char *pcName;
+    void (*pfnRun)(uint32_t ui32Iterations);
+}
+tBenchmark;
+
+//*****************************************************************************
+//
+// Benchmark inputs.
+//
+//*****************************************************************************
+static tHostNode g_sNode;
+static Octet g_ppcSyncPacket[INPUT_COUNT][PACKET_SIZE];
+static Octet g_pcOutBuf[PACKET_SIZE];
+static TimeRepresentation g_psOrigin[INPUT_COUNT];
+static TimeInternal g_psTimeA[INPUT_COUNT];
+static TimeInternal g_psTimeB[INPUT_COUNT];
+static MsgHeader g_psHeader[INPUT_COUNT];
+static MsgSync g_psSync[INPUT_COUNT];
+static MsgHeader g_sRequestHeader;
+static MsgManagement g_psManagement[INPUT_COUNT];
+
+//*****************************************************************************
+//
+// Results are folded into this so that the compiler cannot discard the work.
+//
+//*****************************************************************************
+static volatile uint32_t g_ui32Sink;
+
+//*****************************************************************************
+//
+// A small deterministic generator for the input tables.
+//
+//*****************************************************************************
+static uint32_t g_ui32Seed = 12345;
+
+static uint32_t
+InputRand(void)
+{
+    g_ui32Seed = (g_ui32Seed * 1103515245) + 12345;
+
+    return(g_ui32Seed >> 8);
+}
+
+//*****************************************************************************
+//
+// Build the input tables.
+//
+//*****************************************************************************
+static void
+InputInit(void)
+{
+    static const uint8_t pui8UUID[PTP_UUID_LENGTH] =
+        { 0x00, 0x1a, 0xb6, 0x00, 0x00, 0x01 };
+    static const UInteger8 pui8Keys[] =
+    {
+        PTP_MM_OBTAIN_IDENTITY,
+        PTP_MM_GET_DEFAULT_DATA_SET,
+        PTP_MM_GET_CURRENT_DATA_SET,
+        PTP_MM_GET_PARENT_DATA_SET,
+        PTP_MM_GET_PORT_DATA_SET,
+        PTP_MM_GET_GLOBAL_TIME_DATA_SET,
+        PTP_MM_GET_FOREIGN_DATA_SET
+    };
+    PtpClock *psClock;
+    uint32_t ui32Idx;
+
+    HostNodeInit(&g_sNode, pui8UUID, false);
+    HostClockInit(&g_sNode.sClock, 1000000000LL * 1000000, 0.0);
+    HostNodeStart(&g_sNode);
+    HostNodeSelect(&g_sNode);
+    psClock = &g_sNode.sPTPClock;
+
+    for(ui32Idx = 0; ui32Idx < INPUT_COUNT; ui32Idx++)
+    {
+        //
+        // Timestamps, with a mix of signs and of nanosecond fields that do
+        // and do not need normalizing.
+        //
+        g_psOrigin[ui32Idx].seconds = 1000000 + InputRand();
+        g_psOrigin[ui32Idx].nanoseconds = InputRand() % 1000000000;
+        g_psTimeA[ui32Idx].seconds = (Integer32)(InputRand() % 4) - 2;
+        g_psTimeA[ui32Idx].nanoseconds = (Integer32)(InputRand() % 3000000000U) -
+                                         1500000000;
+        g_psTimeB[ui32Idx].seconds = (Integer32)(InputRand() % 4) - 2;
+        g_psTimeB[ui32Idx].nanoseconds = (Integer32)(InputRand() % 1000000000) -
+                                         500000000;
+
+        //
+        // Sync messages as the master would send them.
+        //
+        psClock->last_sync_event_sequence_number = (UInteger16)ui32Idx;
+        msgPackHeader((char *)g_ppcSyncPacket[ui32Idx], psClock);
+        msgPackSync((char *)g_ppcSyncPacket[ui32Idx], FALSE,
+                    &g_psOrigin[ui32Idx], psClock);
+
+        //
+        // Candidate masters for the BMC, differing in stratum, identifier,
+        // variance, steps removed and sequence so that every branch of the
+        // comparison is taken.
+        //
+        msgUnpackHeader((char *)g_ppcSyncPacket[ui32Idx],
+                        &g_psHeader[ui32Idx]);
+        msgUnpackSync((char *)g_ppcSyncPacket[ui32Idx], &g_psSync[ui32Idx]);
+        g_psHeader[ui32Idx].sourceUuid[PTP_UUID_LENGTH - 1] =
+            (Octet)(InputRand() % 4);
+        memcpy(g_psSync[ui32Idx].grandmasterClockUuid,
+               g_psHeader[ui32Idx].sourceUuid, PTP_UUID_LENGTH);
+        g_psSync[ui32Idx].grandmasterClockStratum =
+            (UInteger8)(1 + (InputRand() % 4));
+        memcpy(g_psSync[ui32Idx].grandmasterClockIdentifier,
+               (InputRand() & 1) ? IDENTIFIER_DFLT : "GPS\0",
+               PTP_CODE_STRING_LENGTH);
+        g_psSync[ui32Idx].grandmasterClockVariance =
+            (Integer16)(InputRand() % 2000) - 1000;
+        g_psSync[ui32Idx].grandmasterPreferred = InputRand() & 1;
+        g_psSync[ui32Idx].localStepsRemoved = (UInteger16)(InputRand() % 3);
+        g_psSync[ui32Idx].grandmasterSequenceId = (UInteger16)InputRand();
+
+        //
+        // Management requests, cycling through the GET keys that produce a
+        // response.
+        //
+        memset(&g_psManagement[ui32Idx], 0, sizeof(MsgManagement));
+        g_psManagement[ui32Idx].managementMessageKey =
+            pui8Keys[ui32Idx % (sizeof(pui8Keys) / sizeof(pui8Keys[0]))];
+        g_psManagement[ui32Idx].startingBoundaryHops = MM_STARTING_BOUNDARY_HOPS;
+        g_psManagement[ui32Idx].boundaryHops = MM_STARTING_BOUNDARY_HOPS;
+    }
+
+    g_sRequestHeader = g_psHeader[0];
+}
+
+//*****************************************************************************
+//
+// Codec benchmarks.
+//
+//*****************************************************************************
+static void
+BenchUnpackHeader(uint32_t ui32Iterations)
+{
+    MsgHeader sHeader;
+    uint32_t ui32Idx, ui32Sum = 0;
+
+    for(ui32Idx = 0; ui32Idx < ui32Iterations; ui32Idx++)
+    {
+        msgUnpackHeader((char *)g_ppcSyncPacket[ui32Idx & INPUT_MASK],
+                        &sHeader);
+        ui32Sum += sHeader.sequenceId;
+    }
+
+    g_ui32Sink += ui32Sum;
+}
+
+static void
+BenchUnpackSync(uint32_t ui32Iterations)
+{
+    MsgSync sSync;
+    uint32_t ui32Idx, ui32Sum = 0;
+
+    for(ui32Idx = 0; ui32Idx < ui32Iterations; ui32Idx++)
+    {
+        msgUnpackSync((char *)g_ppcSyncPacket[ui32Idx & INPUT_MASK], &sSync);
+        ui32Sum += sSync.originTimestamp.nanoseconds;
+    }
+
+    g_ui32Sink += ui32Sum;
+}
+
+static void
+BenchPackHeader(uint32_t ui32Iterations)
+{
+    uint32_t ui32Idx;
+
+    for(ui32Idx = 0; ui32Idx < ui32Iterations; ui32Idx++)
+    {
+        msgPackHeader((char *)g_pcOutBuf, &g_sNode.sPTPClock);
+    }
+
+    g_ui32Sink += g_pcOutBuf[20];
+}
+
+static void
+BenchPackSync(uint32_t ui32Iterations)
+{
+    uint32_t ui32Idx;
+
+    for(ui32Idx = 0; ui32Idx < ui32Iterations; ui32Idx++)
+    {
+        msgPackSync((char *)g_pcOutBuf, FALSE,
+                    &g_psOrigin[ui32Idx & INPUT_MASK], &g_sNode.sPTPClock);
+    }
+
+    g_ui32Sink += g_pcOutBuf[40];
+}
+
+static void
+BenchPackManagementResponse(uint32_t ui32Iterations)
+{
+    uint32_t ui32Idx, ui32Sum = 0;
+
+    for(ui32Idx = 0; ui32Idx < ui32Iterations; ui32Idx++)
+    {
+        ui32Sum += msgPackManagementResponse((char *)g_pcOutBuf,
+                                             &g_sRequestHeader,
+                                             &g_psManagement[ui32Idx &
+                                                             INPUT_MASK],
+                                             &g_sNode.sPTPClock);
+    }
+
+    g_ui32Sink += ui32Sum;
+}
+
+//*****************************************************************************
+//
+// Time arithmetic benchmarks.
+//
+//*****************************************************************************
+static void
+BenchNormalizeTime(uint32_t ui32Iterations)
+{
+    TimeInternal sTime;
+    uint32_t ui32Idx, ui32Sum = 0;
+
+    for(ui32Idx = 0; ui32Idx < ui32Iterations; ui32Idx++)
+    {
+        sTime = g_psTimeA[ui32Idx & INPUT_MASK];
+        normalizeTime(&sTime);
+        ui32Sum += sTime.nanoseconds;
+    }
+
+    g_ui32Sink += ui32Sum;
+}
+
+static void
+BenchAddTime(uint32_t ui32Iterations)
+{
+    TimeInternal sTime;
+    uint32_t ui32Idx, ui32Sum = 0;
+
+    for(ui32Idx = 0; ui32Idx < ui32Iterations; ui32Idx++)
+    {
+        addTime(&sTime, &g_psTimeA[ui32Idx & INPUT_MASK],
+                &g_psTimeB[(ui32Idx + 7) & INPUT_MASK]);
+        ui32Sum += sTime.nanoseconds;
+    }
+
+    g_ui32Sink += ui32Sum;
+}
+
+static void
+BenchSubTime(uint32_t ui32Iterations)
+{
+    TimeInternal sTime;
+    uint32_t ui32Idx, ui32Sum = 0;
+
+    for(ui32Idx = 0; ui32Idx < ui32Iterations; ui32Idx++)
+    {
+        subTime(&sTime, &g_psTimeA[ui32Idx & INPUT_MASK],
+                &g_psTimeB[(ui32Idx + 7) & INPUT_MASK]);
+        ui32Sum += sTime.nanoseconds;
+    }
+
+    g_ui32Sink += ui32Sum;
+}
+
+//*****************************************************************************
+//
+// Best master clock benchmark.
+//
+//*****************************************************************************
+static void
+BenchDataSetComparison(uint32_t ui32Iterations)
+{
+    uint32_t ui32Idx, ui32A, ui32B;
+    int32_t i32Sum = 0;
+
+    for(ui32Idx = 0; ui32Idx < ui32Iterations; ui32Idx++)
+    {
+        ui32A = ui32Idx & INPUT_MASK;
+        ui32B = (ui32Idx * 7 + 3) & INPUT_MASK;
+        i32Sum += bmcDataSetComparison(&g_psHeader[ui32A], &g_psSync[ui32A],
+                                       &g_psHeader[ui32B], &g_psSync[ui32B],
+                                       &g_sNode.sPTPClock);
+    }
+
+    g_ui32Sink += (uint32_t)i32Sum;
+}
+
+//*****************************************************************************
+//
+// The benchmark table.
+//
+//*****************************************************************************
+static const tBenchmark g_psBenchmarks[] =
+{
+    { "msg.unpack_header", BenchUnpackHeader },
+    { "msg.unpack_sync", BenchUnpackSync },
+    { "msg.pack_header", BenchPackHeader },
+    { "msg.pack_sync", BenchPackSync },
+    { "msg.pack_management_response", BenchPackManagementResponse },
+    { "arith.normalize_time", BenchNormalizeTime },
+    { "arith.add_time", BenchAddTime },
+    { "arith.sub_time", BenchSubTime },
+    { "bmc.data_set_comparison", BenchDataSetComparison }
+};
+
+#define NUM_BENCHMARKS          (sizeof(g_psBenchmarks) /                     \
+                                 sizeof(g_psBenchmarks[0]))
+
+//*****************************************************************************
+//
+// Benchmark entry point.
+//
+//*****************************************************************************
+int
+main(int argc, char *argv[])
+{
+    uint32_t ui32Iterations, ui32Repeats, ui32Idx, ui32Rep;
+    uint64_t ui64Start, ui64Ns, ui64BestNs, ui64Cycles, ui64BestCycles;
+    const char *pcFilter;
+    int iArg;
+
+    ui32Iterations = DEFAULT_ITERATIONS;
+    ui32Repeats = DEFAULT_REPEATS;
+    pcFilter = NULL;
+
+    for(iArg = 1; iArg < argc; iArg++)
+    {
+        if(!strcmp(argv[iArg], "-n") && ((iArg + 1) < argc))
+        {
+            ui32Iterations = (uint32_t)strtoul(argv[++iArg], NULL, 0);
+        }
+        else if(!strcmp(argv[iArg], "-r") && ((iArg + 1) < argc))
+        {
+            ui32Repeats = (uint32_t)strtoul(argv[++iArg], NULL, 0);
+        }
+        else if(argv[iArg][0] != '-')
+        {
+            pcFilter = argv[iArg];
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-n iterations] [-r repeats] "
+                    "[name-filter]\n", argv[0]);
+            return(1);
+        }
+    }
+    if((ui32Iterations == 0) || (ui32Repeats == 0))
+    {
+        fprintf(stderr, "iterations and repeats must be non-zero\n");
+        return(1);
+    }
+
+    InputInit();
+
+    for(ui32Idx = 0; ui32Idx < NUM_BENCHMARKS; ui32Idx++)
+    {
+        if(pcFilter && !strstr(g_psBenchmarks[ui32Idx].pcName, pcFilter))
+        {
+            continue;
+        }
+
+        //
+        // One untimed pass to warm the caches, then keep the fastest of the
+        // timed repeats.
+        //
+        g_psBenchmarks[ui32Idx].pfnRun(ui32Iterations / 16 + 1);
+
+        ui64BestNs = UINT64_MAX;
+        ui64BestCycles = 0;
+        for(ui32Rep = 0; ui32Rep < ui32Repeats; ui32Rep++)
+        {
+            ui64Cycles = BenchCyclesNow();
+            ui64Start = BenchNowNs();
+            g_psBenchmarks[ui32Idx].pfnRun(ui32Iterations);
+            ui64Ns = BenchNowNs() - ui64Start;
+            ui64Cycles = BenchCyclesNow() - ui64Cycles;
+
+            if(ui64Ns < ui64BestNs)
+            {
+                ui64BestNs = ui64Ns;
+                ui64BestCycles = ui64Cycles;
+            }
+        }
+
+        BenchReportCycles(g_psBenchmarks[ui32Idx].pcName, ui32Iterations,
+                          ui64BestNs, ui64BestCycles);
+    }
+
+    printf("# iterations=%u repeats=%u inputs=%u\n", ui32Iterations,
+           ui32Repeats, INPUT_COUNT);
+
+    return(0);
+}
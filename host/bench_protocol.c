@@ -0,0 +1,343 @@
+//*****************************************************************************
+//
+// bench_protocol.c - Throughput benchmark for the PTPd protocol engine.
+//
+// A slave-only node (configured exactly as ptpd_init() configures the target)
+// is fed canned Sync, Follow_Up and Delay_Resp messages from a simulated
+// master.  Every message is processed by one protocol_loop() pass, which runs
+// handle() and the servo, and only those calls are timed.  The syncs are
+// played at the log2 interval given, and the time the engine spends on them
+// is also given as the share of one CPU it takes at that rate.
+//
+//     bench_protocol [-n syncs] [-i log2interval]
+//
+//*****************************************************************************
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "hotpath.h"
+#include "ptpd_host.h"
+
+//*****************************************************************************
+//
+// Benchmark parameters.
+//
+//*****************************************************************************
+#define DEFAULT_SYNC_COUNT      200000
+#define WARMUP_SYNC_COUNT       64
+#define PATH_DELAY_NS           10000
+#define SLAVE_OFFSET_NS         250000
+#define SLAVE_OSC_PPB           20000.0
+
+//*****************************************************************************
+//
+// The kinds of message timed by the benchmark.
+//
+//*****************************************************************************
+enum
+{
+    MSG_SYNC,
+    MSG_FOLLOWUP,
+    MSG_DELAYREQ,
+    MSG_DELAYRESP,
+    MSG_COUNT
+};
+
+static const char *g_ppcMsgName[MSG_COUNT] =
+{
+    "protocol_loop.sync",
+    "protocol_loop.followup",
+    "protocol_loop.delayreq_loopback",
+    "protocol_loop.delayresp"
+};
+
+//*****************************************************************************
+//
+// Benchmark state.
+//
+//*****************************************************************************
+static tHostNode g_sMaster;
+static tHostNode g_sSlave;
+static int64_t g_i64TrueNs;
+static bool g_bDelayReqSent;
+static MsgHeader g_sDelayReqHeader;
+static uint64_t g_pui64Ops[MSG_COUNT];
+static uint64_t g_pui64Ns[MSG_COUNT];
+static uint64_t g_ui64Overhead;
+static bool g_bTiming;
+static Integer8 g_i8SyncInterval = DEFAULT_SYNC_INTERVAL;
+
+//*****************************************************************************
+//
+// The slave's transmit hook.  The only message a slave-only node sends is a
+// Delay_Req; remember its header so that the master can answer it.
+//
+//*****************************************************************************
+static void
+SlaveTx(tHostNode *psNode, bool bEvent, const Octet *pcData,
+        uint32_t ui32Length, const TimeInternal *psTxTime)
+{
+    if(bEvent && (ui32Length >= HEADER_LENGTH) &&
+       (pcData[32] == PTP_DELAY_REQ_MESSAGE))
+    {
+        msgUnpackHeader((char *)pcData, &g_sDelayReqHeader);
+        g_bDelayReqSent = true;
+    }
+}
+
+//*****************************************************************************
+//
+// Advance true time, and the slave's clock and timers with it.
+//
+//*****************************************************************************
+static void
+AdvanceTime(int64_t i64Ns)
+{
+    g_i64TrueNs += i64Ns;
+    HostClockAdvance(&g_sSlave.sClock, i64Ns);
+}
+
+//*****************************************************************************
+//
+// Run one protocol engine pass on the slave, timing it if the benchmark is
+// in its measurement phase.
+//
+//*****************************************************************************
+static void
+RunSlave(int iMsg)
+{
+    uint64_t ui64Start, ui64Delta;
+
+    ui64Start = BenchNowNs();
+    HostNodeRun(&g_sSlave);
+    ui64Delta = BenchNowNs() - ui64Start;
+
+    if(g_bTiming)
+    {
+        g_pui64Ops[iMsg]++;
+        g_pui64Ns[iMsg] += (ui64Delta > g_ui64Overhead) ?
+                           (ui64Delta - g_ui64Overhead) : 0;
+    }
+}
+
+//*****************************************************************************
+//
+// Deliver a master message to the slave and process it.
+//
+//*****************************************************************************
+static void
+DeliverToSlave(int iMsg, bool bEvent, Octet *pcBuf, uint32_t ui32Length)
+{
+    TimeInternal sRxTime;
+
+    HostClockToInternal(g_sSlave.sClock.i64Ns, &sRxTime);
+    HostNodeDeliver(&g_sSlave, bEvent, pcBuf, ui32Length, &sRxTime);
+    RunSlave(iMsg);
+}
+
+//*****************************************************************************
+//
+// Play one sync interval: Sync, Follow_Up and, when the slave asks for one,
+// the Delay_Req loopback and the Delay_Resp.
+//
+//*****************************************************************************
+static void
+PlaySyncInterval(void)
+{
+    PtpClock *psMaster;
+    TimeInternal sTime;
+    TimeRepresentation sExtTime;
+    int64_t i64SyncNs;
+    Octet pcBuf[PACKET_SIZE];
+
+    psMaster = &g_sMaster.sPTPClock;
+
+    //
+    // The slave only accepts a Sync whose sequence number is greater than
+    // the last one, so restart the sequence when it is about to wrap.  This
+    // happens outside the timed region.
+    //
+    if(psMaster->last_sync_event_sequence_number == 0xfffe)
+    {
+        psMaster->last_sync_event_sequence_number = 0;
+        g_sSlave.sPTPClock.parent_last_sync_sequence_number = 0;
+    }
+
+    //
+    // Sync, stamped approximately since a Follow_Up will carry the precise
+    // origin timestamp.
+    //
+    i64SyncNs = g_i64TrueNs;
+    psMaster->last_sync_event_sequence_number++;
+    psMaster->grandmaster_sequence_number =
+        psMaster->last_sync_event_sequence_number;
+    HostClockToInternal(i64SyncNs, &sTime);
+    fromInternalTime(&sTime, &sExtTime, FALSE);
+    memset(pcBuf, 0, sizeof(pcBuf));
+    msgPackHeader(pcBuf, psMaster);
+    msgPackSync(pcBuf, FALSE, &sExtTime, psMaster);
+    AdvanceTime(PATH_DELAY_NS);
+    DeliverToSlave(MSG_SYNC, true, pcBuf, SYNC_PACKET_LENGTH);
+
+    //
+    // Follow_Up with the precise origin timestamp.
+    //
+    psMaster->last_general_event_sequence_number++;
+    msgPackFollowUp(pcBuf, psMaster->last_sync_event_sequence_number,
+                    &sExtTime, psMaster);
+    DeliverToSlave(MSG_FOLLOWUP, false, pcBuf, FOLLOW_UP_PACKET_LENGTH);
+
+    //
+    // If the slave sent a Delay_Req, let it consume the looped-back copy
+    // that provides its transmit timestamp, then answer it.
+    //
+    if(g_bDelayReqSent)
+    {
+        g_bDelayReqSent = false;
+        RunSlave(MSG_DELAYREQ);
+
+        AdvanceTime(PATH_DELAY_NS);
+        HostClockToInternal(g_i64TrueNs, &sTime);
+        fromInternalTime(&sTime, &sExtTime, FALSE);
+        psMaster->last_general_event_sequence_number++;
+        memset(pcBuf, 0, sizeof(pcBuf));
+        msgPackHeader(pcBuf, psMaster);
+        msgPackDelayResp(pcBuf, &g_sDelayReqHeader, &sExtTime, psMaster);
+        DeliverToSlave(MSG_DELAYRESP, false, pcBuf, DELAY_RESP_PACKET_LENGTH);
+    }
+
+    //
+    // Idle for the rest of the sync interval.
+    //
+    AdvanceTime((PTP_SYNC_INTERVAL_TIMEOUT(g_i8SyncInterval) * 1000000LL) -
+                (g_i64TrueNs - i64SyncNs));
+    HostNodeTick(&g_sSlave, PTP_SYNC_INTERVAL_TIMEOUT(g_i8SyncInterval));
+}
+
+//*****************************************************************************
+//
+// Benchmark entry point.
+//
+//*****************************************************************************
+int
+main(int argc, char *argv[])
+{
+    static const uint8_t pui8MasterUUID[PTP_UUID_LENGTH] =
+        { 0x00, 0x1a, 0xb6, 0x00, 0x00, 0x01 };
+    static const uint8_t pui8SlaveUUID[PTP_UUID_LENGTH] =
+        { 0x00, 0x1a, 0xb6, 0x00, 0x00, 0x02 };
+    uint32_t ui32Syncs, ui32Idx;
+    uint64_t ui64Ops, ui64Ns, ui64Wall;
+    double dSyncsPerSec;
+    int iMsg, iArg;
+
+    HOTPATH_INIT();
+
+    ui32Syncs = DEFAULT_SYNC_COUNT;
+    for(iArg = 1; iArg < argc; iArg += 2)
+    {
+        if((iArg + 1 < argc) && !strcmp(argv[iArg], "-n"))
+        {
+            ui32Syncs = (uint32_t)strtoul(argv[iArg + 1], NULL, 0);
+        }
+        else if((iArg + 1 < argc) && !strcmp(argv[iArg], "-i") &&
+                (atoi(argv[iArg + 1]) >= PTP_MIN_LOG_INTERVAL) &&
+                (atoi(argv[iArg + 1]) <= PTP_MAX_LOG_INTERVAL))
+        {
+            g_i8SyncInterval = (Integer8)atoi(argv[iArg + 1]);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-n syncs] [-i log2interval]\n",
+                    argv[0]);
+            return(1);
+        }
+    }
+
+    //
+    // The master is only used to pack messages; it is started so that its
+    // data sets are initialized, and marked follow-up capable so that the
+    // slave exercises the Follow_Up path.
+    //
+    g_i64TrueNs = 1000000000LL * 1000000;
+    HostNodeInit(&g_sMaster, pui8MasterUUID, false);
+    g_sMaster.sRtOpts.syncInterval = g_i8SyncInterval;
+    HostClockInit(&g_sMaster.sClock, g_i64TrueNs, 0.0);
+    HostNodeStart(&g_sMaster);
+    g_sMaster.sPTPClock.clock_followup_capable = TRUE;
+
+    HostNodeInit(&g_sSlave, pui8SlaveUUID, true);
+    g_sSlave.sRtOpts.syncInterval = g_i8SyncInterval;
+    HostClockInit(&g_sSlave.sClock, g_i64TrueNs + SLAVE_OFFSET_NS,
+                  SLAVE_OSC_PPB);
+    g_sSlave.pfnTx = SlaveTx;
+    HostNodeStart(&g_sSlave);
+
+    //
+    // Let the slave select the master and settle before timing anything.
+    //
+    for(ui32Idx = 0; ui32Idx < WARMUP_SYNC_COUNT; ui32Idx++)
+    {
+        PlaySyncInterval();
+    }
+    if(g_sSlave.sPTPClock.port_state != PTP_SLAVE)
+    {
+        fprintf(stderr, "slave failed to lock on to the master (state %d)\n",
+                g_sSlave.sPTPClock.port_state);
+        return(1);
+    }
+
+    g_ui64Overhead = BenchOverheadNs();
+    g_bTiming = true;
+    ui64Wall = BenchNowNs();
+    for(ui32Idx = 0; ui32Idx < ui32Syncs; ui32Idx++)
+    {
+        PlaySyncInterval();
+    }
+    ui64Wall = BenchNowNs() - ui64Wall;
+    g_bTiming = false;
+
+    //
+    // Report each message type and the total, which gives messages/sec and
+    // ns per handle() call.
+    //
+    ui64Ops = 0;
+    ui64Ns = 0;
+    for(iMsg = 0; iMsg < MSG_COUNT; iMsg++)
+    {
+        BenchReport(g_ppcMsgName[iMsg], g_pui64Ops[iMsg], g_pui64Ns[iMsg]);
+        ui64Ops += g_pui64Ops[iMsg];
+        ui64Ns += g_pui64Ns[iMsg];
+    }
+    BenchReport("protocol_loop.handle", ui64Ops, ui64Ns);
+    BenchReport("protocol_loop.wall", ui64Ops, ui64Wall);
+
+    //
+    // The share of one CPU that handling every message of a sync interval
+    // takes at the interval played.
+    //
+    dSyncsPerSec = 1000.0 / PTP_SYNC_INTERVAL_TIMEOUT(g_i8SyncInterval);
+    printf("# syncs=%u sync_interval=%d syncs_per_sec=%.1f "
+           "ns_per_sync=%.1f cpu_pct=%.5f timer_overhead_ns=%llu "
+           "final_offset_ns=%d observed_drift=%d port_state=%d\n",
+           ui32Syncs, g_i8SyncInterval, dSyncsPerSec,
+           (double)ui64Ns / ui32Syncs,
+           ((double)ui64Ns / ui32Syncs) * dSyncsPerSec / 1e7,
+           (unsigned long long)g_ui64Overhead,
+           g_sSlave.sPTPClock.offset_from_master.nanoseconds,
+           g_sSlave.sPTPClock.observed_drift,
+           g_sSlave.sPTPClock.port_state);
+
+#ifdef HOTPATH_ENABLE
+    //
+    // With make HOTPATH=1, also show the instrumentation's view of the run.
+    //
+    HotpathPrint();
+#endif
+
+    return(0);
+}
@@ -0,0 +1,520 @@
+//*****************************************************************************
+//
+// bench_telemetry.c - Check and benchmark the telemetry ring in telemetry.c.
+//
+// First samples are recorded and read back from cursors behind, inside and
+// ahead of the ring, and every sample returned is checked against the one
+// recorded with its number, as are the samples counted as dropped.  The CSV
+// and binary fetches served by the web server are parsed back the same way.
+// Then a writer thread records as fast as it can while a reader thread
+// follows it with a cursor, and no sample read may be torn, repeated or out
+// of order, and every sample must be either read or counted as dropped.
+//
+// Last, the cost of recording a sample from displayStats() is measured, which
+// is what each servo update pays, and that of the fetches.
+//
+//     bench_telemetry [-n samples] [-s seed]
+//
+// The program exits with status 1 if any check fails.
+//
+//*****************************************************************************
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "ptpd_host.h"
+#include "telemetry.h"
+
+//*****************************************************************************
+//
+// Parameters.
+//
+//*****************************************************************************
+#define DEFAULT_SAMPLES         10000000
+#define CHECK_ROUNDS            20000
+#define CONCURRENT_SAMPLES      20000000
+#define FETCH_ROUNDS            20000
+
+//*****************************************************************************
+//
+// A small linear congruential generator, so that runs repeat exactly.
+//
+//*****************************************************************************
+static uint32_t g_ui32Seed;
+
+static uint32_t
+BenchRand(uint32_t ui32Limit)
+{
+    g_ui32Seed = (g_ui32Seed * 1664525) + 1013904223;
+
+    return((uint32_t)(((uint64_t)g_ui32Seed * ui32Limit) >> 32));
+}
+
+static uint32_t g_ui32Errors;
+
+//*****************************************************************************
+//
+// Record a sample whose every field follows from its number, and check one
+// read back against the number it carries.
+//
+//*****************************************************************************
+static void
+Record(void)
+{
+    volatile tTelemetrySample *psSample;
+    uint32_t ui32Seq;
+
+    ui32Seq = TelemetryNext();
+    psSample = TelemetryClaim();
+    psSample->ui32T1Sec = ui32Seq;
+    psSample->ui32T1NSec = ui32Seq * 7;
+    psSample->ui32T2Sec = ui32Seq + 1;
+    psSample->ui32T2NSec = ui32Seq * 11;
+    psSample->i32Offset = (int32_t)(ui32Seq * 13);
+    psSample->i32Delay = (int32_t)(ui32Seq * 17);
+    psSample->i32Adj = (int32_t)(ui32Seq * 19);
+    psSample->i32Drift = (int32_t)(ui32Seq * 23);
+    psSample->ui16SyncSeq = (uint16_t)ui32Seq;
+    psSample->ui8State = (uint8_t)(ui32Seq * 29);
+    TelemetryCommit(psSample);
+}
+
+static bool
+Intact(const tTelemetrySample *psSample)
+{
+    uint32_t ui32Seq;
+
+    ui32Seq = psSample->ui32Seq;
+
+    return((psSample->ui32T1Sec == ui32Seq) &&
+           (psSample->ui32T1NSec == (ui32Seq * 7)) &&
+           (psSample->ui32T2Sec == (ui32Seq + 1)) &&
+           (psSample->ui32T2NSec == (ui32Seq * 11)) &&
+           (psSample->i32Offset == (int32_t)(ui32Seq * 13)) &&
+           (psSample->i32Delay == (int32_t)(ui32Seq * 17)) &&
+           (psSample->i32Adj == (int32_t)(ui32Seq * 19)) &&
+           (psSample->i32Drift == (int32_t)(ui32Seq * 23)) &&
+           (psSample->ui16SyncSeq == (uint16_t)ui32Seq) &&
+           (psSample->ui8State == (uint8_t)(ui32Seq * 29)));
+}
+
+static void
+Fail(const char *pcWhat, uint32_t ui32Cursor, uint32_t ui32Got,
+     uint32_t ui32Want)
+{
+    if(g_ui32Errors++ < 10)
+    {
+        printf("error: %s from cursor %u: %u, expected %u\n", pcWhat,
+               ui32Cursor, ui32Got, ui32Want);
+    }
+}
+
+//*****************************************************************************
+//
+// Record a random number of samples, then read a random number from a
+// random cursor, and check what comes back against what was recorded.
+//
+//*****************************************************************************
+static void
+CheckRead(void)
+{
+    static tTelemetrySample psSamples[TELEMETRY_DEPTH + 16];
+    uint32_t ui32Round, ui32Idx, ui32Next, ui32Oldest, ui32Start, ui32Cursor;
+    uint32_t ui32Max, ui32Count, ui32Dropped, ui32Want, ui32From;
+
+    for(ui32Round = 0; ui32Round < CHECK_ROUNDS; ui32Round++)
+    {
+        for(ui32Idx = BenchRand(TELEMETRY_DEPTH / 2); ui32Idx; ui32Idx--)
+        {
+            Record();
+        }
+
+        ui32Next = TelemetryNext();
+        ui32Oldest = (ui32Next > TELEMETRY_DEPTH) ?
+                     (ui32Next - TELEMETRY_DEPTH) : 0;
+
+        //
+        // Mostly from inside the ring, sometimes from behind it or from
+        // beyond the writer.
+        //
+        switch(BenchRand(4))
+        {
+            case 0:
+            {
+                ui32Start = ui32Next - BenchRand(3 * TELEMETRY_DEPTH);
+                break;
+            }
+
+            case 1:
+            {
+                ui32Start = ui32Next + 1 + BenchRand(1000);
+                break;
+            }
+
+            default:
+            {
+                ui32Start = ui32Next - BenchRand(ui32Next - ui32Oldest + 1);
+                break;
+            }
+        }
+        ui32Max = BenchRand(TELEMETRY_DEPTH + 16) + 1;
+
+        if((int32_t)(ui32Start - ui32Next) > 0)
+        {
+            ui32From = ui32Oldest;
+            ui32Want = 0;
+        }
+        else if((int32_t)(ui32Start - ui32Oldest) < 0)
+        {
+            ui32From = ui32Oldest;
+            ui32Want = ui32Oldest - ui32Start;
+        }
+        else
+        {
+            ui32From = ui32Start;
+            ui32Want = 0;
+        }
+
+        ui32Cursor = ui32Start;
+        ui32Dropped = 0;
+        ui32Count = TelemetryRead(&ui32Cursor, psSamples, ui32Max,
+                                  &ui32Dropped);
+
+        if(ui32Dropped != ui32Want)
+        {
+            Fail("dropped", ui32Start, ui32Dropped, ui32Want);
+        }
+        ui32Want = ((ui32Next - ui32From) < ui32Max) ?
+                   (ui32Next - ui32From) : ui32Max;
+        if(ui32Count != ui32Want)
+        {
+            Fail("count", ui32Start, ui32Count, ui32Want);
+        }
+        if(ui32Cursor != (ui32From + ui32Count))
+        {
+            Fail("next cursor", ui32Start, ui32Cursor, ui32From + ui32Count);
+        }
+        for(ui32Idx = 0; ui32Idx < ui32Count; ui32Idx++)
+        {
+            if((psSamples[ui32Idx].ui32Seq != (ui32From + ui32Idx)) ||
+               !Intact(&psSamples[ui32Idx]))
+            {
+                Fail("sample", ui32Start, psSamples[ui32Idx].ui32Seq,
+                     ui32From + ui32Idx);
+                break;
+            }
+        }
+    }
+}
+
+//*****************************************************************************
+//
+// Fetch everything in the ring through the CSV and binary formats, a
+// buffer at a time as a client would, and parse each back.
+//
+//*****************************************************************************
+static void
+CheckFormats(void)
+{
+    static char pcBuf[TELEMETRY_CSV_SIZE];
+    static char pcBin[TELEMETRY_BIN_SIZE];
+    tTelemetryHeader sHeader;
+    tTelemetrySample sSample;
+    uint32_t ui32Cursor, ui32Next, ui32Dropped, ui32Len, ui32Idx, ui32Seq;
+    uint32_t ui32Want;
+    char *pcLine;
+    int iPos;
+
+    ui32Want = TelemetryNext() - TELEMETRY_DEPTH;
+
+    //
+    // CSV, from a cursor well behind the ring.
+    //
+    ui32Cursor = ui32Want - 5;
+    ui32Dropped = 5;
+    while(ui32Cursor != TelemetryNext())
+    {
+        ui32Len = TelemetryFormatCsv(pcBuf, sizeof(pcBuf), ui32Cursor);
+        pcBuf[(ui32Len < sizeof(pcBuf)) ? ui32Len : (sizeof(pcBuf) - 1)] = 0;
+
+        if((sscanf(pcBuf, "# next=%u dropped=%u", &ui32Next, &ui32Idx) != 2) ||
+           (ui32Idx != ui32Dropped))
+        {
+            Fail("csv header", ui32Cursor, ui32Idx, ui32Dropped);
+            return;
+        }
+        ui32Dropped = 0;
+
+        pcLine = strchr(strchr(pcBuf, '\n') + 1, '\n') + 1;
+        while(*pcLine)
+        {
+            memset(&sSample, 0, sizeof(sSample));
+            if(sscanf(pcLine, "%u,%u.%u,%u.%u,%d,%d,%d,%d,%hu,%hhu%n",
+                      &sSample.ui32Seq, &sSample.ui32T1Sec,
+                      &sSample.ui32T1NSec, &sSample.ui32T2Sec,
+                      &sSample.ui32T2NSec, &sSample.i32Offset,
+                      &sSample.i32Delay, &sSample.i32Adj, &sSample.i32Drift,
+                      &sSample.ui16SyncSeq, &sSample.ui8State, &iPos) != 11)
+            {
+                Fail("csv row", ui32Cursor, 0, ui32Want);
+                return;
+            }
+            if((sSample.ui32Seq != ui32Want) || !Intact(&sSample))
+            {
+                Fail("csv sample", ui32Cursor, sSample.ui32Seq, ui32Want);
+                return;
+            }
+            ui32Want++;
+            pcLine += iPos + 1;
+        }
+
+        if(ui32Next != ui32Want)
+        {
+            Fail("csv next", ui32Cursor, ui32Next, ui32Want);
+            return;
+        }
+        ui32Cursor = ui32Next;
+    }
+
+    //
+    // Binary, from the start of the ring.
+    //
+    ui32Want = TelemetryNext() - TELEMETRY_DEPTH;
+    ui32Cursor = 0;
+    ui32Dropped = ui32Want;
+    while(ui32Cursor != TelemetryNext())
+    {
+        ui32Len = TelemetryFormatBin(pcBin, sizeof(pcBin), ui32Cursor);
+        memcpy(&sHeader, pcBin, sizeof(sHeader));
+
+        if((ui32Len != (sizeof(sHeader) +
+                        (sHeader.ui32Count * sizeof(tTelemetrySample)))) ||
+           (sHeader.ui32Magic != TELEMETRY_MAGIC) ||
+           (sHeader.ui16SampleSize != sizeof(tTelemetrySample)) ||
+           (sHeader.ui32Dropped != ui32Dropped) ||
+           (sHeader.ui32First != ui32Want) ||
+           (sHeader.ui32Next != (ui32Want + sHeader.ui32Count)))
+        {
+            Fail("bin header", ui32Cursor, sHeader.ui32First, ui32Want);
+            return;
+        }
+        ui32Dropped = 0;
+
+        for(ui32Idx = 0; ui32Idx < sHeader.ui32Count; ui32Idx++)
+        {
+            memcpy(&sSample, pcBin + sizeof(sHeader) +
+                   (ui32Idx * sizeof(sSample)), sizeof(sSample));
+            ui32Seq = sSample.ui32Seq;
+            if((ui32Seq != ui32Want) || !Intact(&sSample))
+            {
+                Fail("bin sample", ui32Cursor, ui32Seq, ui32Want);
+                return;
+            }
+            ui32Want++;
+        }
+        ui32Cursor = sHeader.ui32Next;
+    }
+}
+
+//*****************************************************************************
+//
+// A writer thread recording flat out, and a reader following it.
+//
+//*****************************************************************************
+static volatile bool g_bWriterDone;
+static uint32_t g_ui32Written;
+
+static void *
+Writer(void *pvArg)
+{
+    uint32_t ui32Idx;
+
+    for(ui32Idx = 0; ui32Idx < g_ui32Written; ui32Idx++)
+    {
+        Record();
+    }
+    g_bWriterDone = true;
+
+    return(NULL);
+}
+
+static void
+CheckConcurrent(void)
+{
+    static tTelemetrySample psSamples[64];
+    pthread_t sThread;
+    uint32_t ui32Start, ui32Cursor, ui32Dropped, ui32Read, ui32Count;
+    uint32_t ui32Idx, ui32Max, ui32Torn;
+    bool bDone;
+
+    ui32Start = TelemetryNext();
+    ui32Cursor = ui32Start;
+    ui32Dropped = 0;
+    ui32Read = 0;
+    ui32Torn = 0;
+    g_ui32Written = CONCURRENT_SAMPLES;
+    g_bWriterDone = false;
+
+    if(pthread_create(&sThread, NULL, Writer, NULL))
+    {
+        printf("error: cannot start the writer\n");
+        g_ui32Errors++;
+        return;
+    }
+
+    do
+    {
+        bDone = g_bWriterDone;
+        ui32Max = BenchRand(64) + 1;
+        do
+        {
+            ui32Count = TelemetryRead(&ui32Cursor, psSamples, ui32Max,
+                                      &ui32Dropped);
+            for(ui32Idx = 0; ui32Idx < ui32Count; ui32Idx++)
+            {
+                if(!Intact(&psSamples[ui32Idx]))
+                {
+                    ui32Torn++;
+                }
+                if(psSamples[ui32Idx].ui32Seq !=
+                   (ui32Cursor - ui32Count + ui32Idx))
+                {
+                    Fail("concurrent order", ui32Cursor - ui32Count,
+                         psSamples[ui32Idx].ui32Seq,
+                         ui32Cursor - ui32Count + ui32Idx);
+                }
+            }
+            ui32Read += ui32Count;
+        }
+        while(ui32Count == ui32Max);
+    }
+    while(!bDone);
+
+    pthread_join(sThread, NULL);
+
+    if(ui32Torn)
+    {
+        Fail("torn samples", ui32Start, ui32Torn, 0);
+    }
+    if((ui32Read + ui32Dropped) != CONCURRENT_SAMPLES)
+    {
+        Fail("read and dropped", ui32Start, ui32Read + ui32Dropped,
+             CONCURRENT_SAMPLES);
+    }
+
+    printf("# concurrent samples=%u read=%u dropped=%u torn=%u\n",
+           CONCURRENT_SAMPLES, ui32Read, ui32Dropped, ui32Torn);
+}
+
+//*****************************************************************************
+//
+// Time recording from displayStats(), as a servo update does, and the
+// fetches that the web server serves.
+//
+//*****************************************************************************
+static void
+BenchRecord(uint32_t ui32Samples)
+{
+    static PtpClock sClock;
+    static RunTimeOpts sRtOpts;
+    static char pcBuf[TELEMETRY_CSV_SIZE];
+    uint32_t ui32Idx, ui32Cursor, ui32Count;
+    uint64_t ui64Start;
+
+    sClock.sync_receive_time.seconds = 1700000000;
+    sClock.sync_receive_time.nanoseconds = 123456789;
+    sClock.master_to_slave_delay.nanoseconds = 59250;
+    sClock.offset_from_master.nanoseconds = -42;
+    sClock.one_way_delay.nanoseconds = 59208;
+    sClock.rate.adj = 20150;
+    sClock.observed_drift = 20000;
+    sClock.port_state = PTP_SLAVE;
+
+    ui64Start = BenchNowNs();
+    for(ui32Idx = 0; ui32Idx < ui32Samples; ui32Idx++)
+    {
+        sClock.parent_last_sync_sequence_number = (UInteger16)ui32Idx;
+        displayStats(&sRtOpts, &sClock);
+    }
+    BenchReport("telemetry.record", ui32Samples, BenchNowNs() - ui64Start);
+
+    ui64Start = BenchNowNs();
+    for(ui32Idx = 0; ui32Idx < ui32Samples; ui32Idx++)
+    {
+        TelemetryCommit(TelemetryClaim());
+    }
+    BenchReport("telemetry.claim_commit", ui32Samples,
+                BenchNowNs() - ui64Start);
+
+    //
+    // Full fetches of the oldest samples, reported per sample returned.
+    //
+    ui32Cursor = TelemetryNext() - TELEMETRY_DEPTH;
+    TelemetryFormatCsv(pcBuf, sizeof(pcBuf), ui32Cursor);
+    sscanf(pcBuf, "# next=%u", &ui32Count);
+    ui32Count -= ui32Cursor;
+
+    ui64Start = BenchNowNs();
+    for(ui32Idx = 0; ui32Idx < FETCH_ROUNDS; ui32Idx++)
+    {
+        TelemetryFormatCsv(pcBuf, sizeof(pcBuf), ui32Cursor);
+    }
+    BenchReport("telemetry.csv_sample", (uint64_t)FETCH_ROUNDS * ui32Count,
+                BenchNowNs() - ui64Start);
+
+    ui64Start = BenchNowNs();
+    for(ui32Idx = 0; ui32Idx < FETCH_ROUNDS; ui32Idx++)
+    {
+        TelemetryFormatBin(pcBuf, TELEMETRY_BIN_SIZE, ui32Cursor);
+    }
+    BenchReport("telemetry.bin_sample", (uint64_t)FETCH_ROUNDS *
+                ((TELEMETRY_BIN_SIZE - sizeof(tTelemetryHeader)) /
+                 sizeof(tTelemetrySample)), BenchNowNs() - ui64Start);
+}
+
+//*****************************************************************************
+//
+// Run the checks and the benchmarks.
+//
+//*****************************************************************************
+int
+main(int argc, char *argv[])
+{
+    uint32_t ui32Samples;
+    int iArg;
+
+    ui32Samples = DEFAULT_SAMPLES;
+    g_ui32Seed = 1;
+
+    for(iArg = 1; iArg < argc; iArg++)
+    {
+        if(!strcmp(argv[iArg], "-n") && ((iArg + 1) < argc))
+        {
+            ui32Samples = (uint32_t)strtoul(argv[++iArg], NULL, 0);
+        }
+        else if(!strcmp(argv[iArg], "-s") && ((iArg + 1) < argc))
+        {
+            g_ui32Seed = (uint32_t)strtoul(argv[++iArg], NULL, 0);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-n samples] [-s seed]\n", argv[0]);
+            return(1);
+        }
+    }
+
+    CheckRead();
+    CheckFormats();
+    CheckConcurrent();
+    printf("# check depth=%u sample_bytes=%u errors=%u result=%s\n",
+           TELEMETRY_DEPTH, (uint32_t)sizeof(tTelemetrySample), g_ui32Errors,
+           g_ui32Errors ? "fail" : "pass");
+
+    BenchRecord(ui32Samples);
+
+    return(g_ui32Errors ? 1 : 0);
+}
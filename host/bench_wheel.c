@@ -0,0 +1,435 @@
+//*****************************************************************************
+//
+// bench_wheel.c - Check and benchmark the timer wheel in wheel.c.
+//
+// First a random mix of timer starts, stops and time steps is run against
+// the wheel and against a plain list of expiry times, and every expiry is
+// checked: each timer must run on the first advance that reaches its expiry
+// time, and WheelNextExpiry() must give the earliest expiry.
+//
+// Then the cost of starting and stopping timers and of advancing the wheel
+// is measured, next to a list walked on every millisecond as ptpd_timer.c
+// used to walk its IntervalTimers.  Last, the application's own timers are
+// run the way the target runs them, waking only at WheelNextExpiry(), and
+// the wakeups per second are reported against the 100 Hz SysTick polling
+// they replaced.
+//
+//     bench_wheel [-n operations] [-s seed]
+//
+// The program exits with status 1 if any check fails.
+//
+//*****************************************************************************
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "wheel.h"
+
+//*****************************************************************************
+//
+// Parameters.
+//
+//*****************************************************************************
+#define DEFAULT_OPERATIONS      1000000
+#define CHECK_TIMERS            256
+#define BENCH_TIMERS            1024
+#define BENCH_ADVANCE_MS        600000
+#define IDLE_RUN_MS             3600000
+#define POLL_HZ                 100
+
+//*****************************************************************************
+//
+// The time seen by the wheel.
+//
+//*****************************************************************************
+static uint32_t g_ui32Now;
+
+static uint32_t
+BenchWheelNow(void)
+{
+    return(g_ui32Now);
+}
+
+//*****************************************************************************
+//
+// A small linear congruential generator, so that runs repeat exactly.
+//
+//*****************************************************************************
+static uint32_t g_ui32Seed;
+
+static uint32_t
+BenchRand(uint32_t ui32Limit)
+{
+    g_ui32Seed = (g_ui32Seed * 1664525) + 1013904223;
+
+    return((uint32_t)(((uint64_t)g_ui32Seed * ui32Limit) >> 32));
+}
+
+//*****************************************************************************
+//
+// The timers, and what the check expects of each.
+//
+//*****************************************************************************
+static tWheel g_sWheel;
+static tWheelTimer g_psTimer[BENCH_TIMERS];
+static bool g_pbActive[CHECK_TIMERS];
+static uint32_t g_pui32Expiry[CHECK_TIMERS];
+static uint32_t g_pui32Period[CHECK_TIMERS];
+static uint32_t g_pui32Runs[CHECK_TIMERS];
+static uint32_t g_ui32Errors;
+static volatile uint32_t g_ui32Sink;
+
+//*****************************************************************************
+//
+// The handler for the check: count the run, and complain if it is early.
+//
+//*****************************************************************************
+static void
+CheckHandler(void *pvArg)
+{
+    uint32_t ui32Idx;
+
+    ui32Idx = (uint32_t)(uintptr_t)pvArg;
+    g_pui32Runs[ui32Idx]++;
+
+    if(!g_pbActive[ui32Idx] ||
+       ((int32_t)(g_ui32Now - g_pui32Expiry[ui32Idx]) < 0))
+    {
+        if(g_ui32Errors++ < 10)
+        {
+            printf("error: timer %u ran at %u, due at %u\n", ui32Idx,
+                   g_ui32Now, g_pui32Expiry[ui32Idx]);
+        }
+    }
+}
+
+//*****************************************************************************
+//
+// Pick a delay: mostly short, sometimes beyond the reach of the wheel.
+//
+//*****************************************************************************
+static uint32_t
+CheckDelay(void)
+{
+    switch(BenchRand(4))
+    {
+        case 0:
+            return(BenchRand(64));
+        case 1:
+            return(BenchRand(4096));
+        case 2:
+            return(BenchRand(WHEEL_RANGE_MS / 8));
+        default:
+            return(BenchRand(WHEEL_RANGE_MS * 3));
+    }
+}
+
+//*****************************************************************************
+//
+// Run random operations against the wheel and the expected expiry times.
+//
+//*****************************************************************************
+static void
+Check(uint32_t ui32Operations)
+{
+    uint32_t ui32Op, ui32Idx, ui32Cursor, ui32Next, ui32Earliest, ui32Delay;
+    bool bAny;
+
+    g_ui32Now = 0xFFFF0000;
+    WheelInit(&g_sWheel, BenchWheelNow);
+    memset(g_psTimer, 0, sizeof(g_psTimer));
+    ui32Cursor = g_ui32Now;
+
+    for(ui32Op = 0; ui32Op < ui32Operations; ui32Op++)
+    {
+        ui32Idx = BenchRand(CHECK_TIMERS);
+
+        switch(BenchRand(8))
+        {
+            //
+            // Start or restart a timer.  One due before the next millisecond
+            // to be run is run with that millisecond.
+            //
+            case 0:
+            case 1:
+            {
+                ui32Delay = CheckDelay();
+                g_pui32Period[ui32Idx] = BenchRand(2) ? 0 :
+                                         (BenchRand(20000) + 1);
+                g_pui32Expiry[ui32Idx] = g_ui32Now + ui32Delay;
+                if((int32_t)(g_pui32Expiry[ui32Idx] - ui32Cursor) < 0)
+                {
+                    g_pui32Expiry[ui32Idx] = ui32Cursor;
+                }
+                g_pbActive[ui32Idx] = true;
+                WheelTimerStart(&g_sWheel, &g_psTimer[ui32Idx], CheckHandler,
+                                (void *)(uintptr_t)ui32Idx, ui32Delay,
+                                g_pui32Period[ui32Idx]);
+                break;
+            }
+
+            case 2:
+            {
+                g_pbActive[ui32Idx] = false;
+                WheelTimerStop(&g_psTimer[ui32Idx]);
+                break;
+            }
+
+            //
+            // Move the time on and check that exactly the timers due ran.
+            //
+            default:
+            {
+                g_ui32Now += BenchRand(8) ? BenchRand(2000) :
+                                            BenchRand(WHEEL_RANGE_MS / 4);
+                memset(g_pui32Runs, 0, sizeof(g_pui32Runs));
+                WheelAdvance(&g_sWheel, g_ui32Now);
+                ui32Cursor = g_ui32Now + 1;
+
+                for(ui32Idx = 0; ui32Idx < CHECK_TIMERS; ui32Idx++)
+                {
+                    if(g_pbActive[ui32Idx] &&
+                       ((int32_t)(g_ui32Now - g_pui32Expiry[ui32Idx]) >= 0))
+                    {
+                        if(g_pui32Runs[ui32Idx] != 1)
+                        {
+                            if(g_ui32Errors++ < 10)
+                            {
+                                printf("error: timer %u due at %u ran %u "
+                                       "times by %u\n", ui32Idx,
+                                       g_pui32Expiry[ui32Idx],
+                                       g_pui32Runs[ui32Idx], g_ui32Now);
+                            }
+                        }
+                        if(g_pui32Period[ui32Idx])
+                        {
+                            g_pui32Expiry[ui32Idx] +=
+                                g_pui32Period[ui32Idx] *
+                                (((g_ui32Now - g_pui32Expiry[ui32Idx]) /
+                                  g_pui32Period[ui32Idx]) + 1);
+                        }
+                        else
+                        {
+                            g_pbActive[ui32Idx] = false;
+                        }
+                    }
+                    if(g_pbActive[ui32Idx] !=
+                       WheelTimerActive(&g_psTimer[ui32Idx]))
+                    {
+                        if(g_ui32Errors++ < 10)
+                        {
+                            printf("error: timer %u running state wrong at "
+                                   "%u\n", ui32Idx, g_ui32Now);
+                        }
+                    }
+                }
+                break;
+            }
+        }
+
+        //
+        // The next expiry must be that of the earliest timer.
+        //
+        bAny = false;
+        ui32Earliest = 0;
+        for(ui32Idx = 0; ui32Idx < CHECK_TIMERS; ui32Idx++)
+        {
+            if(g_pbActive[ui32Idx] &&
+               (!bAny || ((g_pui32Expiry[ui32Idx] - ui32Cursor) <
+                          (ui32Earliest - ui32Cursor))))
+            {
+                ui32Earliest = g_pui32Expiry[ui32Idx];
+                bAny = true;
+            }
+        }
+        if((WheelNextExpiry(&g_sWheel, &ui32Next) != bAny) ||
+           (bAny && (ui32Next != ui32Earliest)))
+        {
+            if(g_ui32Errors++ < 10)
+            {
+                printf("error: next expiry %u, earliest timer %u\n",
+                       ui32Next, ui32Earliest);
+            }
+        }
+    }
+}
+
+//*****************************************************************************
+//
+// The handler for the benchmarks.
+//
+//*****************************************************************************
+static void
+BenchHandler(void *pvArg)
+{
+    g_ui32Sink++;
+}
+
+//*****************************************************************************
+//
+// Time starting and stopping timers with many others running.
+//
+//*****************************************************************************
+static void
+BenchStartStop(uint32_t ui32Operations)
+{
+    uint32_t ui32Idx, ui32Op;
+    uint64_t ui64Start;
+
+    g_ui32Now = 0;
+    WheelInit(&g_sWheel, BenchWheelNow);
+    memset(g_psTimer, 0, sizeof(g_psTimer));
+    for(ui32Idx = 0; ui32Idx < BENCH_TIMERS; ui32Idx++)
+    {
+        WheelTimerStart(&g_sWheel, &g_psTimer[ui32Idx], BenchHandler, 0,
+                        BenchRand(100000) + 1, 0);
+    }
+
+    ui64Start = BenchNowNs();
+    for(ui32Op = 0; ui32Op < ui32Operations; ui32Op++)
+    {
+        ui32Idx = ui32Op & (BENCH_TIMERS - 1);
+        WheelTimerStop(&g_psTimer[ui32Idx]);
+        WheelTimerStart(&g_sWheel, &g_psTimer[ui32Idx], BenchHandler, 0,
+                        (ui32Op & 0xFFFF) + 1, 0);
+    }
+    BenchReport("wheel.stop_start", ui32Operations,
+                BenchNowNs() - ui64Start);
+}
+
+//*****************************************************************************
+//
+// Time the expiry of many periodic timers, advancing one millisecond at a
+// time, on the wheel and on a list walked every millisecond.
+//
+//*****************************************************************************
+static void
+BenchAdvance(void)
+{
+    static uint32_t pui32Expiry[BENCH_TIMERS], pui32Period[BENCH_TIMERS];
+    uint32_t ui32Idx, ui32Runs;
+    uint64_t ui64Start;
+
+    g_ui32Now = 0;
+    WheelInit(&g_sWheel, BenchWheelNow);
+    memset(g_psTimer, 0, sizeof(g_psTimer));
+    for(ui32Idx = 0; ui32Idx < BENCH_TIMERS; ui32Idx++)
+    {
+        pui32Period[ui32Idx] = BenchRand(60000) + 10;
+        pui32Expiry[ui32Idx] = pui32Period[ui32Idx];
+        WheelTimerStart(&g_sWheel, &g_psTimer[ui32Idx], BenchHandler, 0,
+                        pui32Period[ui32Idx], pui32Period[ui32Idx]);
+    }
+
+    g_ui32Sink = 0;
+    ui64Start = BenchNowNs();
+    for(g_ui32Now = 1; g_ui32Now <= BENCH_ADVANCE_MS; g_ui32Now++)
+    {
+        WheelAdvance(&g_sWheel, g_ui32Now);
+    }
+    BenchReport("wheel.advance_1ms", BENCH_ADVANCE_MS,
+                BenchNowNs() - ui64Start);
+    ui32Runs = g_ui32Sink;
+
+    g_ui32Sink = 0;
+    ui64Start = BenchNowNs();
+    for(g_ui32Now = 1; g_ui32Now <= BENCH_ADVANCE_MS; g_ui32Now++)
+    {
+        for(ui32Idx = 0; ui32Idx < BENCH_TIMERS; ui32Idx++)
+        {
+            if(pui32Expiry[ui32Idx] == g_ui32Now)
+            {
+                pui32Expiry[ui32Idx] += pui32Period[ui32Idx];
+                BenchHandler(0);
+            }
+        }
+    }
+    BenchReport("list.advance_1ms", BENCH_ADVANCE_MS,
+                BenchNowNs() - ui64Start);
+
+    if(ui32Runs != g_ui32Sink)
+    {
+        printf("error: the wheel ran %u timers, the list %u\n", ui32Runs,
+               g_ui32Sink);
+        g_ui32Errors++;
+    }
+}
+
+//*****************************************************************************
+//
+// Run the application's timers as the target does, waking only when the
+// wheel has work, and count the wakeups: the lwIP timers, the PTPd sync
+// interval and receipt timers, and the once-a-second job.
+//
+//*****************************************************************************
+static void
+BenchIdle(void)
+{
+    uint32_t ui32Wakeups, ui32Next;
+
+    g_ui32Now = 0;
+    WheelInit(&g_sWheel, BenchWheelNow);
+    memset(g_psTimer, 0, sizeof(g_psTimer));
+    WheelTimerStart(&g_sWheel, &g_psTimer[0], BenchHandler, 0, 50, 50);
+    WheelTimerStart(&g_sWheel, &g_psTimer[1], BenchHandler, 0, 2000, 2000);
+    WheelTimerStart(&g_sWheel, &g_psTimer[2], BenchHandler, 0, 20000, 20000);
+    WheelTimerStart(&g_sWheel, &g_psTimer[3], BenchHandler, 0, 1000, 1000);
+
+    ui32Wakeups = 0;
+    while(WheelNextExpiry(&g_sWheel, &ui32Next) && (ui32Next < IDLE_RUN_MS))
+    {
+        g_ui32Now = ui32Next;
+        WheelAdvance(&g_sWheel, g_ui32Now);
+        ui32Wakeups++;
+    }
+
+    printf("# idle_run_s=%u wakeups=%u wakeups_per_s=%.1f "
+           "polled_wakeups_per_s=%u\n", IDLE_RUN_MS / 1000, ui32Wakeups,
+           (double)ui32Wakeups * 1000.0 / IDLE_RUN_MS, POLL_HZ);
+}
+
+//*****************************************************************************
+//
+// Run the check and the benchmarks.
+//
+//*****************************************************************************
+int
+main(int argc, char *argv[])
+{
+    uint32_t ui32Operations;
+    int iArg;
+
+    ui32Operations = DEFAULT_OPERATIONS;
+    g_ui32Seed = 1;
+
+    for(iArg = 1; iArg < argc; iArg++)
+    {
+        if(!strcmp(argv[iArg], "-n") && ((iArg + 1) < argc))
+        {
+            ui32Operations = (uint32_t)strtoul(argv[++iArg], NULL, 0);
+        }
+        else if(!strcmp(argv[iArg], "-s") && ((iArg + 1) < argc))
+        {
+            g_ui32Seed = (uint32_t)strtoul(argv[++iArg], NULL, 0);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-n operations] [-s seed]\n",
+                    argv[0]);
+            return(1);
+        }
+    }
+
+    Check(ui32Operations);
+    printf("# check operations=%u errors=%u result=%s\n", ui32Operations,
+           g_ui32Errors, g_ui32Errors ? "fail" : "pass");
+
+    BenchStartStop(ui32Operations);
+    BenchAdvance();
+    BenchIdle();
+
+    return(g_ui32Errors ? 1 : 0);
+}
@@ -0,0 +1,708 @@
+//*****************************************************************************
+//
+// capture.c - Reading and writing PTP traffic in pcap and pcapng files.
+//
+// The reader accepts classic pcap (microsecond or nanosecond, either byte
+// order) and pcapng with any number of sections and interfaces.  Ethernet
+// (with or without VLAN tags), Linux cooked and raw IPv4 link types are
+// understood.  Only unfragmented IPv4/UDP datagrams to port 319 or 320 are
+// returned; everything else is skipped.
+//
+// The writer produces nanosecond pcap files of Ethernet frames carrying the
+// messages to the PTP multicast group, which is enough for the simulator to
+// record traffic that the replay tool and Wireshark can read.
+//
+//*****************************************************************************
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "capture.h"
+
+//*****************************************************************************
+//
+// File format constants.
+//
+//*****************************************************************************
+#define PCAP_MAGIC_US           0xa1b2c3d4
+#define PCAP_MAGIC_NS           0xa1b23c4d
+#define PCAPNG_SHB              0x0a0d0d0a
+#define PCAPNG_IDB              0x00000001
+#define PCAPNG_EPB              0x00000006
+#define PCAPNG_BOM              0x1a2b3c4d
+#define PCAPNG_OPT_TSRESOL      9
+#define PCAPNG_OPT_TSOFFSET     14
+
+#define LINKTYPE_NULL           0
+#define LINKTYPE_ETHERNET       1
+#define LINKTYPE_RAW            101
+#define LINKTYPE_LINUX_SLL      113
+#define LINKTYPE_IPV4           228
+#define LINKTYPE_LINUX_SLL2     276
+
+#define ETHERTYPE_IPV4          0x0800
+#define ETHERTYPE_VLAN          0x8100
+#define ETHERTYPE_QINQ          0x88a8
+#define IP_PROTO_UDP            17
+
+//*****************************************************************************
+//
+// The PTP primary multicast group, 224.0.1.129, and its Ethernet address.
+//
+//*****************************************************************************
+#define PTP_GROUP_ADDR          0xe0000181
+static const uint8_t g_pui8GroupMAC[6] = { 0x01, 0x00, 0x5e, 0x00, 0x01, 0x81 };
+
+//*****************************************************************************
+//
+// Byte order helpers.
+//
+//*****************************************************************************
+static uint16_t
+Swap16(uint16_t ui16Val)
+{
+    return((uint16_t)((ui16Val >> 8) | (ui16Val << 8)));
+}
+
+static uint32_t
+Swap32(uint32_t ui32Val)
+{
+    return((ui32Val >> 24) | ((ui32Val >> 8) & 0xff00) |
+           ((ui32Val << 8) & 0xff0000) | (ui32Val << 24));
+}
+
+static uint16_t
+Get16(const tCapture *psCapture, const uint8_t *pui8Data)
+{
+    uint16_t ui16Val;
+
+    memcpy(&ui16Val, pui8Data, sizeof(ui16Val));
+
+    return(psCapture->bSwap ? Swap16(ui16Val) : ui16Val);
+}
+
+static uint32_t
+Get32(const tCapture *psCapture, const uint8_t *pui8Data)
+{
+    uint32_t ui32Val;
+
+    memcpy(&ui32Val, pui8Data, sizeof(ui32Val));
+
+    return(psCapture->bSwap ? Swap32(ui32Val) : ui32Val);
+}
+
+static uint16_t
+GetBE16(const uint8_t *pui8Data)
+{
+    return((uint16_t)((pui8Data[0] << 8) | pui8Data[1]));
+}
+
+static void
+PutBE16(uint8_t *pui8Data, uint16_t ui16Val)
+{
+    pui8Data[0] = (uint8_t)(ui16Val >> 8);
+    pui8Data[1] = (uint8_t)ui16Val;
+}
+
+static void
+PutBE32(uint8_t *pui8Data, uint32_t ui32Val)
+{
+    PutBE16(pui8Data, (uint16_t)(ui32Val >> 16));
+    PutBE16(pui8Data + 2, (uint16_t)ui32Val);
+}
+
+//*****************************************************************************
+//
+// Make sure the block buffer can hold ui32Size bytes.
+//
+//*****************************************************************************
+static bool
+CaptureReserve(tCapture *psCapture, uint32_t ui32Size)
+{
+    uint8_t *pui8Block;
+
+    if(ui32Size <= psCapture->ui32BlockSize)
+    {
+        return(true);
+    }
+    if(ui32Size > CAPTURE_MAX_BLOCK)
+    {
+        return(false);
+    }
+
+    pui8Block = realloc(psCapture->pui8Block, ui32Size);
+    if(pui8Block == NULL)
+    {
+        return(false);
+    }
+    psCapture->pui8Block = pui8Block;
+    psCapture->ui32BlockSize = ui32Size;
+
+    return(true);
+}
+
+//*****************************************************************************
+//
+// Convert a timestamp in units of 1/ui64TsPerSec seconds to nanoseconds.
+//
+//*****************************************************************************
+static int64_t
+CaptureTsToNs(uint64_t ui64Ts, uint64_t ui64TsPerSec)
+{
+    uint64_t ui64Sec, ui64Frac;
+
+    ui64Sec = ui64Ts / ui64TsPerSec;
+    ui64Frac = ui64Ts % ui64TsPerSec;
+
+    if(ui64TsPerSec <= 1000000000ULL)
+    {
+        ui64Frac = (ui64Frac * 1000000000ULL) / ui64TsPerSec;
+    }
+    else
+    {
+        ui64Frac = (uint64_t)((double)ui64Frac * 1e9 / (double)ui64TsPerSec);
+    }
+
+    return((int64_t)((ui64Sec * 1000000000ULL) + ui64Frac));
+}
+
+//*****************************************************************************
+//
+// Find the PTP message in a captured frame.  Returns true if the frame holds
+// a UDP datagram to one of the PTP ports.
+//
+//*****************************************************************************
+static bool
+CaptureExtract(uint32_t ui32LinkType, const uint8_t *pui8Frame,
+               uint32_t ui32Length, tCapturePTP *psPTP)
+{
+    uint32_t ui32Off, ui32IHL, ui32IPLen, ui32UDPLen;
+    uint16_t ui16Type, ui16Port;
+
+    //
+    // Strip the link layer header, leaving ui32Off at the IPv4 header.
+    //
+    switch(ui32LinkType)
+    {
+        case LINKTYPE_ETHERNET:
+        {
+            if(ui32Length < 14)
+            {
+                return(false);
+            }
+            ui16Type = GetBE16(pui8Frame + 12);
+            ui32Off = 14;
+            while(((ui16Type == ETHERTYPE_VLAN) ||
+                   (ui16Type == ETHERTYPE_QINQ)) &&
+                  (ui32Length >= (ui32Off + 4)))
+            {
+                ui16Type = GetBE16(pui8Frame + ui32Off + 2);
+                ui32Off += 4;
+            }
+            if(ui16Type != ETHERTYPE_IPV4)
+            {
+                return(false);
+            }
+            break;
+        }
+
+        case LINKTYPE_LINUX_SLL:
+        {
+            if((ui32Length < 16) ||
+               (GetBE16(pui8Frame + 14) != ETHERTYPE_IPV4))
+            {
+                return(false);
+            }
+            ui32Off = 16;
+            break;
+        }
+
+        case LINKTYPE_LINUX_SLL2:
+        {
+            if((ui32Length < 20) ||
+               (GetBE16(pui8Frame) != ETHERTYPE_IPV4))
+            {
+                return(false);
+            }
+            ui32Off = 20;
+            break;
+        }
+
+        case LINKTYPE_NULL:
+        {
+            ui32Off = 4;
+            break;
+        }
+
+        case LINKTYPE_RAW:
+        case LINKTYPE_IPV4:
+        {
+            ui32Off = 0;
+            break;
+        }
+
+        default:
+        {
+            return(false);
+        }
+    }
+
+    //
+    // IPv4, unfragmented, carrying UDP.
+    //
+    if((ui32Length < (ui32Off + 20)) || ((pui8Frame[ui32Off] >> 4) != 4))
+    {
+        return(false);
+    }
+    ui32IHL = (pui8Frame[ui32Off] & 0x0f) * 4;
+    ui32IPLen = GetBE16(pui8Frame + ui32Off + 2);
+    if((ui32IHL < 20) || (pui8Frame[ui32Off + 9] != IP_PROTO_UDP) ||
+       (GetBE16(pui8Frame + ui32Off + 6) & 0x3fff) ||
+       (ui32IPLen < (ui32IHL + 8)))
+    {
+        return(false);
+    }
+    if((ui32Off + ui32IPLen) < ui32Length)
+    {
+        ui32Length = ui32Off + ui32IPLen;
+    }
+    ui32Off += ui32IHL;
+    if(ui32Length < (ui32Off + 8))
+    {
+        return(false);
+    }
+
+    //
+    // UDP to the PTP event or general port.
+    //
+    ui16Port = GetBE16(pui8Frame + ui32Off + 2);
+    if((ui16Port != CAPTURE_PORT_EVENT) && (ui16Port != CAPTURE_PORT_GENERAL))
+    {
+        return(false);
+    }
+    ui32UDPLen = GetBE16(pui8Frame + ui32Off + 4);
+    if((ui32UDPLen < 8) || ((ui32Off + ui32UDPLen) > ui32Length))
+    {
+        ui32UDPLen = ui32Length - ui32Off;
+    }
+
+    psPTP->bEvent = (ui16Port == CAPTURE_PORT_EVENT);
+    psPTP->pui8Data = pui8Frame + ui32Off + 8;
+    psPTP->ui32Length = ui32UDPLen - 8;
+
+    return(true);
+}
+
+//*****************************************************************************
+//
+// Parse the options of a pcapng Interface Description Block.
+//
+//*****************************************************************************
+static void
+CaptureParseIDB(tCapture *psCapture, const uint8_t *pui8Body,
+                uint32_t ui32Length)
+{
+    uint32_t ui32Iface, ui32Off, ui32OptLen;
+    uint16_t ui16Code;
+    uint8_t ui8Res;
+    int64_t i64Offset;
+
+    if((ui32Length < 8) || (psCapture->ui32Ifaces >= CAPTURE_MAX_IFACES))
+    {
+        return;
+    }
+
+    ui32Iface = psCapture->ui32Ifaces++;
+    psCapture->pui32IfLinkType[ui32Iface] = Get16(psCapture, pui8Body);
+    psCapture->pui64IfTsPerSec[ui32Iface] = 1000000;
+    psCapture->pi64IfTsOffsetNs[ui32Iface] = 0;
+
+    for(ui32Off = 8; (ui32Off + 4) <= ui32Length; ui32Off += 4 +
+        ((ui32OptLen + 3) & ~3U))
+    {
+        ui16Code = Get16(psCapture, pui8Body + ui32Off);
+        ui32OptLen = Get16(psCapture, pui8Body + ui32Off + 2);
+        if((ui16Code == 0) || ((ui32Off + 4 + ui32OptLen) > ui32Length))
+        {
+            break;
+        }
+
+        if((ui16Code == PCAPNG_OPT_TSRESOL) && (ui32OptLen == 1))
+        {
+            ui8Res = pui8Body[ui32Off + 4];
+            if(ui8Res & 0x80)
+            {
+                psCapture->pui64IfTsPerSec[ui32Iface] =
+                    1ULL << ((ui8Res & 0x7f) > 63 ? 63 : (ui8Res & 0x7f));
+            }
+            else
+            {
+                psCapture->pui64IfTsPerSec[ui32Iface] = 1;
+                while(ui8Res--)
+                {
+                    psCapture->pui64IfTsPerSec[ui32Iface] *= 10;
+                }
+            }
+        }
+        else if((ui16Code == PCAPNG_OPT_TSOFFSET) && (ui32OptLen == 8))
+        {
+            memcpy(&i64Offset, pui8Body + ui32Off + 4, sizeof(i64Offset));
+            if(psCapture->bSwap)
+            {
+                i64Offset = (int64_t)(((uint64_t)Swap32((uint32_t)i64Offset)
+                                       << 32) |
+                                      Swap32((uint32_t)(i64Offset >> 32)));
+            }
+            psCapture->pi64IfTsOffsetNs[ui32Iface] = i64Offset * 1000000000LL;
+        }
+    }
+}
+
+//*****************************************************************************
+//
+// Open a capture file.
+//
+//*****************************************************************************
+bool
+CaptureOpen(tCapture *psCapture, const char *pcPath)
+{
+    uint8_t pui8Hdr[24];
+    uint32_t ui32Magic;
+
+    memset(psCapture, 0, sizeof(tCapture));
+
+    psCapture->pfFile = fopen(pcPath, "rb");
+    if(psCapture->pfFile == NULL)
+    {
+        return(false);
+    }
+
+    if(fread(pui8Hdr, 1, 4, psCapture->pfFile) != 4)
+    {
+        CaptureClose(psCapture);
+        return(false);
+    }
+    memcpy(&ui32Magic, pui8Hdr, 4);
+
+    //
+    // pcapng files start with a Section Header Block, which is read along
+    // with the other blocks.
+    //
+    if(ui32Magic == PCAPNG_SHB)
+    {
+        psCapture->bNG = true;
+        rewind(psCapture->pfFile);
+        return(true);
+    }
+
+    if((ui32Magic == PCAP_MAGIC_US) || (ui32Magic == Swap32(PCAP_MAGIC_US)))
+    {
+        psCapture->ui64TsPerSec = 1000000;
+    }
+    else if((ui32Magic == PCAP_MAGIC_NS) ||
+            (ui32Magic == Swap32(PCAP_MAGIC_NS)))
+    {
+        psCapture->ui64TsPerSec = 1000000000;
+    }
+    else
+    {
+        CaptureClose(psCapture);
+        return(false);
+    }
+    psCapture->bSwap = ((ui32Magic != PCAP_MAGIC_US) &&
+                        (ui32Magic != PCAP_MAGIC_NS));
+
+    if(fread(pui8Hdr + 4, 1, 20, psCapture->pfFile) != 20)
+    {
+        CaptureClose(psCapture);
+        return(false);
+    }
+    psCapture->ui32LinkType = Get32(psCapture, pui8Hdr + 20) & 0xffff;
+
+    return(true);
+}
+
+//*****************************************************************************
+//
+// Read the next record of a classic pcap file.  Returns 1 if a PTP message
+// was found, 0 for a non-PTP frame, or -1 at the end of the file.
+//
+//*****************************************************************************
+static int
+CaptureNextPcap(tCapture *psCapture, tCapturePTP *psPTP)
+{
+    uint8_t pui8Hdr[16];
+    uint32_t ui32CapLen;
+
+    if(fread(pui8Hdr, 1, 16, psCapture->pfFile) != 16)
+    {
+        return(-1);
+    }
+    ui32CapLen = Get32(psCapture, pui8Hdr + 8);
+    if(!CaptureReserve(psCapture, ui32CapLen) ||
+       (fread(psCapture->pui8Block, 1, ui32CapLen, psCapture->pfFile) !=
+        ui32CapLen))
+    {
+        return(-1);
+    }
+    psCapture->ui32Frames++;
+
+    if(!CaptureExtract(psCapture->ui32LinkType, psCapture->pui8Block,
+                       ui32CapLen, psPTP))
+    {
+        return(0);
+    }
+
+    psPTP->i64TimeNs = CaptureTsToNs(((uint64_t)Get32(psCapture, pui8Hdr) *
+                                      psCapture->ui64TsPerSec) +
+                                     Get32(psCapture, pui8Hdr + 4),
+                                     psCapture->ui64TsPerSec);
+
+    return(1);
+}
+
+//*****************************************************************************
+//
+// Read the next block of a pcapng file.  Returns 1 if a PTP message was
+// found, 0 for any other block, or -1 at the end of the file.
+//
+//*****************************************************************************
+static int
+CaptureNextPcapng(tCapture *psCapture, tCapturePTP *psPTP)
+{
+    uint8_t pui8Hdr[12];
+    uint32_t ui32Type, ui32Length, ui32Body, ui32Iface, ui32CapLen, ui32BOM;
+    uint64_t ui64Ts;
+
+    if(fread(pui8Hdr, 1, 8, psCapture->pfFile) != 8)
+    {
+        return(-1);
+    }
+    memcpy(&ui32Type, pui8Hdr, 4);
+
+    //
+    // A Section Header Block sets the byte order for the blocks that follow
+    // it, so its length can only be read after the byte order magic.
+    //
+    if(ui32Type == PCAPNG_SHB)
+    {
+        if(fread(pui8Hdr + 8, 1, 4, psCapture->pfFile) != 4)
+        {
+            return(-1);
+        }
+        memcpy(&ui32BOM, pui8Hdr + 8, 4);
+        if(ui32BOM == PCAPNG_BOM)
+        {
+            psCapture->bSwap = false;
+        }
+        else if(ui32BOM == Swap32(PCAPNG_BOM))
+        {
+            psCapture->bSwap = true;
+        }
+        else
+        {
+            return(-1);
+        }
+        psCapture->ui32Ifaces = 0;
+
+        ui32Length = Get32(psCapture, pui8Hdr + 4);
+        if((ui32Length < 16) || (ui32Length & 3) ||
+           fseek(psCapture->pfFile, ui32Length - 12, SEEK_CUR))
+        {
+            return(-1);
+        }
+
+        return(0);
+    }
+
+    ui32Type = Get32(psCapture, pui8Hdr);
+    ui32Length = Get32(psCapture, pui8Hdr + 4);
+    if((ui32Length < 12) || (ui32Length & 3))
+    {
+        return(-1);
+    }
+    ui32Body = ui32Length - 8;
+    if(!CaptureReserve(psCapture, ui32Body) ||
+       (fread(psCapture->pui8Block, 1, ui32Body, psCapture->pfFile) !=
+        ui32Body))
+    {
+        return(-1);
+    }
+    ui32Body -= 4;
+
+    if(ui32Type == PCAPNG_IDB)
+    {
+        CaptureParseIDB(psCapture, psCapture->pui8Block, ui32Body);
+        return(0);
+    }
+    if((ui32Type != PCAPNG_EPB) || (ui32Body < 20))
+    {
+        return(0);
+    }
+
+    psCapture->ui32Frames++;
+    ui32Iface = Get32(psCapture, psCapture->pui8Block);
+    ui32CapLen = Get32(psCapture, psCapture->pui8Block + 12);
+    if((ui32Iface >= psCapture->ui32Ifaces) || (ui32CapLen > (ui32Body - 20)))
+    {
+        return(0);
+    }
+
+    if(!CaptureExtract(psCapture->pui32IfLinkType[ui32Iface],
+                       psCapture->pui8Block + 20, ui32CapLen, psPTP))
+    {
+        return(0);
+    }
+
+    ui64Ts = ((uint64_t)Get32(psCapture, psCapture->pui8Block + 4) << 32) |
+             Get32(psCapture, psCapture->pui8Block + 8);
+    psPTP->i64TimeNs = CaptureTsToNs(ui64Ts,
+                                     psCapture->pui64IfTsPerSec[ui32Iface]) +
+                       psCapture->pi64IfTsOffsetNs[ui32Iface];
+
+    return(1);
+}
+
+//*****************************************************************************
+//
+// Return the next PTP message in the capture.  Returns 1 if a message was
+// read or 0 at the end of the file.  psPTP->pui8Data is only valid until the
+// next call.
+//
+//*****************************************************************************
+int
+CaptureNextPTP(tCapture *psCapture, tCapturePTP *psPTP)
+{
+    int iResult;
+
+    do
+    {
+        iResult = psCapture->bNG ? CaptureNextPcapng(psCapture, psPTP) :
+                                   CaptureNextPcap(psCapture, psPTP);
+    }
+    while(iResult == 0);
+
+    if(iResult < 0)
+    {
+        return(0);
+    }
+
+    psCapture->ui32PTPFrames++;
+
+    return(1);
+}
+
+//*****************************************************************************
+//
+// Close a capture file.
+//
+//*****************************************************************************
+void
+CaptureClose(tCapture *psCapture)
+{
+    if(psCapture->pfFile)
+    {
+        fclose(psCapture->pfFile);
+        psCapture->pfFile = NULL;
+    }
+
+    free(psCapture->pui8Block);
+    psCapture->pui8Block = NULL;
+    psCapture->ui32BlockSize = 0;
+}
+
+//*****************************************************************************
+//
+// Create a nanosecond pcap file for Ethernet frames.
+//
+//*****************************************************************************
+FILE *
+CaptureWriteOpen(const char *pcPath)
+{
+    FILE *pfFile;
+    uint32_t pui32Hdr[6];
+
+    pfFile = fopen(pcPath, "wb");
+    if(pfFile == NULL)
+    {
+        return(NULL);
+    }
+
+    pui32Hdr[0] = PCAP_MAGIC_NS;
+    pui32Hdr[1] = 2 | (4 << 16);
+    pui32Hdr[2] = 0;
+    pui32Hdr[3] = 0;
+    pui32Hdr[4] = 65535;
+    pui32Hdr[5] = LINKTYPE_ETHERNET;
+    fwrite(pui32Hdr, sizeof(pui32Hdr), 1, pfFile);
+
+    return(pfFile);
+}
+
+//*****************************************************************************
+//
+// Append a PTP message to a capture file, sent from ui32SrcAddr to the PTP
+// multicast group.
+//
+//*****************************************************************************
+void
+CaptureWrite(FILE *pfFile, int64_t i64TimeNs, bool bEvent,
+             uint32_t ui32SrcAddr, const uint8_t *pui8Data,
+             uint32_t ui32Length)
+{
+    uint8_t pui8Frame[14 + 20 + 8];
+    uint32_t pui32Rec[4], ui32Sum, ui32Idx;
+    uint16_t ui16Port;
+
+    ui16Port = bEvent ? CAPTURE_PORT_EVENT : CAPTURE_PORT_GENERAL;
+
+    //
+    // Ethernet header.
+    //
+    memcpy(pui8Frame, g_pui8GroupMAC, 6);
+    pui8Frame[6] = 0x00;
+    pui8Frame[7] = 0x1a;
+    pui8Frame[8] = 0xb6;
+    PutBE16(pui8Frame + 9, (uint16_t)(ui32SrcAddr >> 8));
+    pui8Frame[11] = (uint8_t)ui32SrcAddr;
+    PutBE16(pui8Frame + 12, ETHERTYPE_IPV4);
+
+    //
+    // IPv4 header.
+    //
+    memset(pui8Frame + 14, 0, 20);
+    pui8Frame[14] = 0x45;
+    PutBE16(pui8Frame + 16, (uint16_t)(20 + 8 + ui32Length));
+    pui8Frame[22] = 1;
+    pui8Frame[23] = IP_PROTO_UDP;
+    PutBE32(pui8Frame + 26, ui32SrcAddr);
+    PutBE32(pui8Frame + 30, PTP_GROUP_ADDR);
+    ui32Sum = 0;
+    for(ui32Idx = 0; ui32Idx < 20; ui32Idx += 2)
+    {
+        ui32Sum += GetBE16(pui8Frame + 14 + ui32Idx);
+    }
+    while(ui32Sum >> 16)
+    {
+        ui32Sum = (ui32Sum & 0xffff) + (ui32Sum >> 16);
+    }
+    PutBE16(pui8Frame + 24, (uint16_t)~ui32Sum);
+
+    //
+    // UDP header, without a checksum.
+    //
+    PutBE16(pui8Frame + 34, ui16Port);
+    PutBE16(pui8Frame + 36, ui16Port);
+    PutBE16(pui8Frame + 38, (uint16_t)(8 + ui32Length));
+    PutBE16(pui8Frame + 40, 0);
+
+    pui32Rec[0] = (uint32_t)(i64TimeNs / 1000000000);
+    pui32Rec[1] = (uint32_t)(i64TimeNs % 1000000000);
+    pui32Rec[2] = sizeof(pui8Frame) + ui32Length;
+    pui32Rec[3] = pui32Rec[2];
+    fwrite(pui32Rec, sizeof(pui32Rec), 1, pfFile);
+    fwrite(pui8Frame, sizeof(pui8Frame), 1, pfFile);
+    fwrite(pui8Data, ui32Length, 1, pfFile);
+}
@@ -0,0 +1,137 @@
+//*****************************************************************************
+//
+// capture.h - Reading and writing PTP traffic in pcap and pcapng files.
+//
+//*****************************************************************************
+
+#ifndef __CAPTURE_H__
+#define __CAPTURE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+//*****************************************************************************
+//
+// The UDP ports that carry PTP event and general messages.
+//
+//*****************************************************************************
+#define CAPTURE_PORT_EVENT      319
+#define CAPTURE_PORT_GENERAL    320
+
+//*****************************************************************************
+//
+// The largest block and number of pcapng interfaces handled.
+//
+//*****************************************************************************
+#define CAPTURE_MAX_BLOCK       (16 * 1024 * 1024)
+#define CAPTURE_MAX_IFACES      16
+
+//*****************************************************************************
+//
+// One PTP message extracted from a capture.
+//
+//*****************************************************************************
+typedef struct
+{
+    //
+    // The capture timestamp in nanoseconds since the Unix epoch.
+    //
+    int64_t i64TimeNs;
+
+    //
+    // True if the message was sent to the event port.
+    //
+    bool bEvent;
+
+    //
+    // The UDP payload.
+    //
+    const uint8_t *pui8Data;
+    uint32_t ui32Length;
+}
+tCapturePTP;
+
+//*****************************************************************************
+//
+// An open capture file.
+//
+//*****************************************************************************
+typedef struct
+{
+    FILE *pfFile;
+
+    //
+    // True for pcapng, false for classic pcap.
+    //
+    bool bNG;
+
+    //
+    // True if the current file or section is in the opposite byte order to
+    // the host.
+    //
+    bool bSwap;
+
+    //
+    // Classic pcap: the link type and timestamp units per second.
+    //
+    uint32_t ui32LinkType;
+    uint64_t ui64TsPerSec;
+
+    //
+    // pcapng: the link type, timestamp units and timestamp offset of each
+    // interface in the current section.
+    //
+    uint32_t ui32Ifaces;
+    uint32_t pui32IfLinkType[CAPTURE_MAX_IFACES];
+    uint64_t pui64IfTsPerSec[CAPTURE_MAX_IFACES];
+    int64_t pi64IfTsOffsetNs[CAPTURE_MAX_IFACES];
+
+    //
+    // Statistics.
+    //
+    uint32_t ui32Frames;
+    uint32_t ui32PTPFrames;
+
+    //
+    // The buffer holding the block or record most recently read.
+    //
+    uint8_t *pui8Block;
+    uint32_t ui32BlockSize;
+}
+tCapture;
+
+//*****************************************************************************
+//
+// Prototypes.
+//
+//*****************************************************************************
+extern bool CaptureOpen(tCapture *psCapture, const char *pcPath);
+extern int CaptureNextPTP(tCapture *psCapture, tCapturePTP *psPTP);
+extern void CaptureClose(tCapture *psCapture);
+extern FILE *CaptureWriteOpen(const char *pcPath);
+extern void CaptureWrite(FILE *pfFile, int64_t i64TimeNs, bool bEvent,
+                         uint32_t ui32SrcAddr, const uint8_t *pui8Data,
+                         uint32_t ui32Length);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CAPTURE_H__
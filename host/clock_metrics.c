@@ -0,0 +1,385 @@
+//*****************************************************************************
+//
+// clock_metrics.c - Clock quality metrics (TIE, MTIE, TDEV and Allan
+// deviation) over a series of time offsets.
+//
+// The definitions follow ITU-T G.810 Appendix II, with the time error x(i)
+// sampled every tau0 and an observation interval of tau = n * tau0:
+//
+//   MTIE(n) = max over every window of n + 1 samples of (max x - min x)
+//
+//   TVAR(n) = 1 / (6 n^2 (N - 3n + 1)) *
+//             sum[j = 0 .. N - 3n] (sum[i = j .. j + n - 1]
+//                                   (x(i + 2n) - 2 x(i + n) + x(i)))^2
+//
+//   AVAR(n) = 1 / (2 tau^2 (N - 2n)) *
+//             sum[i = 0 .. N - 2n - 1] (x(i + 2n) - 2 x(i + n) + x(i))^2
+//
+// TDEV and ADEV are the square roots of TVAR and AVAR (the overlapping
+// estimator).  MTIE uses block-wise running extremes for the sliding window
+// and TDEV a running inner sum, so each observation interval costs O(N).
+// MetricsTauList() spaces the intervals logarithmically, so a full report
+// costs O(N log N).
+//
+//*****************************************************************************
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "clock_metrics.h"
+
+//*****************************************************************************
+//
+// The second difference x(i + 2n) - 2 x(i + n) + x(i).
+//
+//*****************************************************************************
+#define METRICS_D2(pdX, i, n)                                                 \
+    ((pdX)[(i) + (2 * (n))] - (2.0 * (pdX)[(i) + (n)]) + (pdX)[(i)])
+
+//*****************************************************************************
+//
+// Maximum and minimum that compile to single instructions, unlike fmax() and
+// fmin() which must handle NaNs.
+//
+//*****************************************************************************
+#define METRICS_MAX(a, b)       (((a) > (b)) ? (a) : (b))
+#define METRICS_MIN(a, b)       (((a) < (b)) ? (a) : (b))
+
+//*****************************************************************************
+//
+// Set up the metrics for a series of ui32Count time error samples, in
+// nanoseconds, taken every dTau0 seconds.  The samples are copied.  Returns
+// false if there is not enough memory.
+//
+//*****************************************************************************
+bool
+MetricsInit(tMetrics *psMetrics, const double *pdX, uint32_t ui32Count,
+            double dTau0)
+{
+    uint32_t ui32Idx;
+    double dSum;
+
+    memset(psMetrics, 0, sizeof(tMetrics));
+    psMetrics->ui32Count = ui32Count;
+    psMetrics->dTau0 = dTau0;
+
+    psMetrics->pdX = malloc((ui32Count + 1) * sizeof(double));
+    psMetrics->pdSufMax = malloc((ui32Count + 1) * sizeof(double));
+    psMetrics->pdSufMin = malloc((ui32Count + 1) * sizeof(double));
+    if(!psMetrics->pdX || !psMetrics->pdSufMax || !psMetrics->pdSufMin)
+    {
+        MetricsFree(psMetrics);
+        return(false);
+    }
+
+    //
+    // Remove the mean, which none of the metrics depend on, to keep the
+    // running sums small.
+    //
+    dSum = 0.0;
+    for(ui32Idx = 0; ui32Idx < ui32Count; ui32Idx++)
+    {
+        dSum += pdX[ui32Idx];
+    }
+    psMetrics->dMean = ui32Count ? (dSum / (double)ui32Count) : 0.0;
+
+    for(ui32Idx = 0; ui32Idx < ui32Count; ui32Idx++)
+    {
+        psMetrics->pdX[ui32Idx] = pdX[ui32Idx] - psMetrics->dMean;
+    }
+
+    return(true);
+}
+
+//*****************************************************************************
+//
+// Release the storage held by a metrics context.
+//
+//*****************************************************************************
+void
+MetricsFree(tMetrics *psMetrics)
+{
+    free(psMetrics->pdX);
+    free(psMetrics->pdSufMax);
+    free(psMetrics->pdSufMin);
+    memset(psMetrics, 0, sizeof(tMetrics));
+}
+
+//*****************************************************************************
+//
+// Compute summary statistics of the time error.
+//
+//*****************************************************************************
+void
+MetricsTIE(const tMetrics *psMetrics, tMetricsTIE *psTIE)
+{
+    uint32_t ui32Idx;
+    double dX, dSumSq;
+
+    memset(psTIE, 0, sizeof(tMetricsTIE));
+    psTIE->ui32Count = psMetrics->ui32Count;
+    if(psMetrics->ui32Count == 0)
+    {
+        return;
+    }
+
+    dSumSq = 0.0;
+    psTIE->dMinNs = psMetrics->pdX[0];
+    psTIE->dMaxNs = psMetrics->pdX[0];
+    for(ui32Idx = 0; ui32Idx < psMetrics->ui32Count; ui32Idx++)
+    {
+        dX = psMetrics->pdX[ui32Idx];
+        dSumSq += dX * dX;
+        if(dX < psTIE->dMinNs)
+        {
+            psTIE->dMinNs = dX;
+        }
+        if(dX > psTIE->dMaxNs)
+        {
+            psTIE->dMaxNs = dX;
+        }
+    }
+
+    psTIE->dMeanNs = psMetrics->dMean;
+    psTIE->dStdDevNs = sqrt(dSumSq / (double)psMetrics->ui32Count);
+    psTIE->dRmsNs = sqrt((dSumSq / (double)psMetrics->ui32Count) +
+                         (psMetrics->dMean * psMetrics->dMean));
+    psTIE->dMinNs += psMetrics->dMean;
+    psTIE->dMaxNs += psMetrics->dMean;
+    psTIE->dPkPkNs = psTIE->dMaxNs - psTIE->dMinNs;
+    psTIE->dMaxAbsNs = fmax(fabs(psTIE->dMinNs), fabs(psTIE->dMaxNs));
+}
+
+//*****************************************************************************
+//
+// Maximum time interval error, in nanoseconds, over an observation interval
+// of ui32N samples.  Returns NAN if the series is too short.
+//
+// The sliding window extremes use the van Herk/Gil-Werman method: the series
+// is cut into blocks of one window length, so every window is a suffix of one
+// block followed by a prefix of the next.  Block suffix extremes are tabulated
+// and prefix extremes are accumulated on the fly, which is branch-free and
+// costs three comparisons per sample for each of max and min.
+//
+//*****************************************************************************
+double
+MetricsMTIE(tMetrics *psMetrics, uint32_t ui32N)
+{
+    const double *pdX, *pdNext;
+    double *pdSufMax, *pdSufMin;
+    uint32_t ui32Window, ui32Start, ui32Len, ui32Idx, ui32Count;
+    double dMax, dMin, dPreMax, dPreMin, dMTIE;
+
+    ui32Count = psMetrics->ui32Count;
+    if((ui32N == 0) || (ui32N >= ui32Count))
+    {
+        return(NAN);
+    }
+
+    pdX = psMetrics->pdX;
+    pdSufMax = psMetrics->pdSufMax;
+    pdSufMin = psMetrics->pdSufMin;
+    ui32Window = ui32N + 1;
+    dMTIE = 0.0;
+
+    for(ui32Start = 0; (ui32Start + ui32N) < ui32Count;
+        ui32Start += ui32Window)
+    {
+        //
+        // Suffix extremes of this block.
+        //
+        ui32Len = ui32Window;
+        if((ui32Start + ui32Len) > ui32Count)
+        {
+            ui32Len = ui32Count - ui32Start;
+        }
+        dMax = dMin = pdX[ui32Start + ui32Len - 1];
+        for(ui32Idx = ui32Len; ui32Idx > 0; ui32Idx--)
+        {
+            dMax = METRICS_MAX(dMax, pdX[ui32Start + ui32Idx - 1]);
+            dMin = METRICS_MIN(dMin, pdX[ui32Start + ui32Idx - 1]);
+            pdSufMax[ui32Idx - 1] = dMax;
+            pdSufMin[ui32Idx - 1] = dMin;
+        }
+
+        //
+        // The window starting at the block boundary is the whole block.
+        //
+        dMTIE = METRICS_MAX(dMTIE, pdSufMax[0] - pdSufMin[0]);
+
+        //
+        // The window starting ui32Idx into the block ends ui32Idx - 1 into
+        // the next one.
+        //
+        pdNext = pdX + ui32Start + ui32Window;
+        dPreMax = -INFINITY;
+        dPreMin = INFINITY;
+        for(ui32Idx = 1; (ui32Idx < ui32Window) &&
+                         ((ui32Start + ui32Idx + ui32N) < ui32Count); ui32Idx++)
+        {
+            dPreMax = METRICS_MAX(dPreMax, pdNext[ui32Idx - 1]);
+            dPreMin = METRICS_MIN(dPreMin, pdNext[ui32Idx - 1]);
+            dMTIE = METRICS_MAX(dMTIE, METRICS_MAX(pdSufMax[ui32Idx], dPreMax) -
+                                METRICS_MIN(pdSufMin[ui32Idx], dPreMin));
+        }
+    }
+
+    return(dMTIE);
+}
+
+//*****************************************************************************
+//
+// Time deviation, in nanoseconds, over an observation interval of ui32N
+// samples.  Returns NAN if the series is too short.
+//
+//*****************************************************************************
+double
+MetricsTDEV(const tMetrics *psMetrics, uint32_t ui32N)
+{
+    const double *pdX;
+    uint32_t ui32Idx, ui32Terms;
+    double dSum, dInner;
+
+    if((ui32N == 0) || (psMetrics->ui32Count < ((3 * ui32N) + 1)))
+    {
+        return(NAN);
+    }
+
+    pdX = psMetrics->pdX;
+    ui32Terms = psMetrics->ui32Count - (3 * ui32N) + 1;
+
+    //
+    // The inner sum over n second differences slides along the series, so
+    // each step adds the difference entering the window and drops the one
+    // leaving it.
+    //
+    dInner = 0.0;
+    for(ui32Idx = 0; ui32Idx < ui32N; ui32Idx++)
+    {
+        dInner += METRICS_D2(pdX, ui32Idx, ui32N);
+    }
+
+    dSum = dInner * dInner;
+    for(ui32Idx = 1; ui32Idx < ui32Terms; ui32Idx++)
+    {
+        dInner += METRICS_D2(pdX, ui32Idx + ui32N - 1, ui32N) -
+                  METRICS_D2(pdX, ui32Idx - 1, ui32N);
+        dSum += dInner * dInner;
+    }
+
+    return(sqrt(dSum / (6.0 * (double)ui32N * (double)ui32N *
+                        (double)ui32Terms)));
+}
+
+//*****************************************************************************
+//
+// Overlapping Allan deviation (dimensionless) over an observation interval of
+// ui32N samples.  Returns NAN if the series is too short.
+//
+//*****************************************************************************
+double
+MetricsADEV(const tMetrics *psMetrics, uint32_t ui32N)
+{
+    const double *pdX;
+    uint32_t ui32Idx, ui32Terms;
+    double dSum, dDiff, dTauNs;
+
+    if((ui32N == 0) || (psMetrics->ui32Count < ((2 * ui32N) + 1)))
+    {
+        return(NAN);
+    }
+
+    pdX = psMetrics->pdX;
+    ui32Terms = psMetrics->ui32Count - (2 * ui32N);
+    dSum = 0.0;
+    for(ui32Idx = 0; ui32Idx < ui32Terms; ui32Idx++)
+    {
+        dDiff = METRICS_D2(pdX, ui32Idx, ui32N);
+        dSum += dDiff * dDiff;
+    }
+
+    dTauNs = (double)ui32N * psMetrics->dTau0 * 1e9;
+
+    return(sqrt(dSum / (2.0 * dTauNs * dTauNs * (double)ui32Terms)));
+}
+
+//*****************************************************************************
+//
+// Fill pui32N with observation intervals, in samples, spaced 1, 2, 5, 10, 20,
+// 50 ... up to the length of a series of ui32Count samples.  Returns the
+// number of intervals written, at most ui32Max.
+//
+//*****************************************************************************
+uint32_t
+MetricsTauList(uint32_t ui32Count, uint32_t *pui32N, uint32_t ui32Max)
+{
+    static const uint32_t pui32Steps[3] = { 1, 2, 5 };
+    uint64_t ui64Decade, ui64N;
+    uint32_t ui32Num, ui32Step;
+
+    ui32Num = 0;
+    for(ui64Decade = 1; ui32Num < ui32Max; ui64Decade *= 10)
+    {
+        for(ui32Step = 0; (ui32Step < 3) && (ui32Num < ui32Max); ui32Step++)
+        {
+            ui64N = ui64Decade * pui32Steps[ui32Step];
+            if(ui64N >= ui32Count)
+            {
+                return(ui32Num);
+            }
+            pui32N[ui32Num++] = (uint32_t)ui64N;
+        }
+    }
+
+    return(ui32Num);
+}
+
+//*****************************************************************************
+//
+// Print the TIE statistics and the MTIE, TDEV and ADEV at every observation
+// interval from MetricsTauList(), one key=value record per line, each
+// starting with pcPrefix.  Metrics that are undefined for an interval are
+// left out of its line.
+//
+//*****************************************************************************
+void
+MetricsReport(FILE *pfOut, tMetrics *psMetrics, const char *pcPrefix)
+{
+    uint32_t pui32N[METRICS_MAX_TAUS], ui32Num, ui32Idx;
+    tMetricsTIE sTIE;
+    double dValue;
+
+    MetricsTIE(psMetrics, &sTIE);
+    fprintf(pfOut, "%smetric=tie count=%u tau0_s=%g mean_ns=%.1f rms_ns=%.1f "
+            "stddev_ns=%.1f min_ns=%.1f max_ns=%.1f pkpk_ns=%.1f "
+            "max_abs_ns=%.1f\n", pcPrefix, sTIE.ui32Count, psMetrics->dTau0,
+            sTIE.dMeanNs, sTIE.dRmsNs, sTIE.dStdDevNs, sTIE.dMinNs,
+            sTIE.dMaxNs, sTIE.dPkPkNs, sTIE.dMaxAbsNs);
+
+    ui32Num = MetricsTauList(psMetrics->ui32Count, pui32N, METRICS_MAX_TAUS);
+    for(ui32Idx = 0; ui32Idx < ui32Num; ui32Idx++)
+    {
+        fprintf(pfOut, "%smetric=stability tau_s=%g n=%u", pcPrefix,
+                (double)pui32N[ui32Idx] * psMetrics->dTau0, pui32N[ui32Idx]);
+
+        dValue = MetricsMTIE(psMetrics, pui32N[ui32Idx]);
+        if(!isnan(dValue))
+        {
+            fprintf(pfOut, " mtie_ns=%.1f", dValue);
+        }
+        dValue = MetricsTDEV(psMetrics, pui32N[ui32Idx]);
+        if(!isnan(dValue))
+        {
+            fprintf(pfOut, " tdev_ns=%.2f", dValue);
+        }
+        dValue = MetricsADEV(psMetrics, pui32N[ui32Idx]);
+        if(!isnan(dValue))
+        {
+            fprintf(pfOut, " adev=%.3e", dValue);
+        }
+        fprintf(pfOut, "\n");
+    }
+}
@@ -0,0 +1,106 @@
+//*****************************************************************************
+//
+// clock_metrics.h - Clock quality metrics (TIE, MTIE, TDEV and Allan
+// deviation) over a series of time offsets.
+//
+//*****************************************************************************
+
+#ifndef __CLOCK_METRICS_H__
+#define __CLOCK_METRICS_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+//*****************************************************************************
+//
+// The largest number of observation intervals MetricsTauList() returns.
+//
+//*****************************************************************************
+#define METRICS_MAX_TAUS        64
+
+//*****************************************************************************
+//
+// A series of time offsets (the time error, or TIE, of the clock under test)
+// in nanoseconds, sampled every dTau0 seconds, with the working storage the
+// metrics need.
+//
+//*****************************************************************************
+typedef struct
+{
+    //
+    // The time error samples in nanoseconds, with their mean removed.
+    //
+    double *pdX;
+    uint32_t ui32Count;
+    double dMean;
+
+    //
+    // The sampling interval in seconds.
+    //
+    double dTau0;
+
+    //
+    // Block suffix maxima and minima, for MTIE.
+    //
+    double *pdSufMax;
+    double *pdSufMin;
+}
+tMetrics;
+
+//*****************************************************************************
+//
+// Summary statistics of the time error itself.
+//
+//*****************************************************************************
+typedef struct
+{
+    uint32_t ui32Count;
+    double dMeanNs;
+    double dRmsNs;
+    double dStdDevNs;
+    double dMinNs;
+    double dMaxNs;
+    double dPkPkNs;
+    double dMaxAbsNs;
+}
+tMetricsTIE;
+
+//*****************************************************************************
+//
+// Prototypes.
+//
+//*****************************************************************************
+extern bool MetricsInit(tMetrics *psMetrics, const double *pdX,
+                        uint32_t ui32Count, double dTau0);
+extern void MetricsFree(tMetrics *psMetrics);
+extern void MetricsTIE(const tMetrics *psMetrics, tMetricsTIE *psTIE);
+extern double MetricsMTIE(tMetrics *psMetrics, uint32_t ui32N);
+extern double MetricsTDEV(const tMetrics *psMetrics, uint32_t ui32N);
+extern double MetricsADEV(const tMetrics *psMetrics, uint32_t ui32N);
+extern uint32_t MetricsTauList(uint32_t ui32Count, uint32_t *pui32N,
+                               uint32_t ui32Max);
+extern void MetricsReport(FILE *pfOut, tMetrics *psMetrics,
+                          const char *pcPrefix);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CLOCK_METRICS_H__
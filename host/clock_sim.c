@@ -0,0 +1,113 @@
+//*****************************************************************************
+//
+// clock_sim.c - Simulated PTP clock source for the host build.
+//
+// The clock read and steered is that of the host node selected by
+// HostNodeSelect().  It does not run by itself: the driver program advances
+// it with HostClockAdvance() in units of true time.
+//
+//*****************************************************************************
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "clock_ops.h"
+#include "ptpd_host.h"
+
+//*****************************************************************************
+//
+// Nothing to start; each node's clock is set up by HostClockInit().
+//
+//*****************************************************************************
+static void
+ClockSimInit(uint32_t ui32SysClock, uint32_t ui32TickHz)
+{
+}
+
+//*****************************************************************************
+//
+// There is no tick interrupt on the host.
+//
+//*****************************************************************************
+static bool
+ClockSimTick(void)
+{
+    return(false);
+}
+
+//*****************************************************************************
+//
+// Read the selected node's clock.  Both fields carry the sign of the reading,
+// as from HostClockToInternal(), so that a clock set before the epoch reads
+// back unchanged through getTime().
+//
+//*****************************************************************************
+static void
+ClockSimGetTime(uint32_t *pui32Seconds, uint32_t *pui32Nanoseconds)
+{
+    TimeInternal sTime;
+
+    HostClockToInternal(HostNodeCurrent()->sClock.i64Ns, &sTime);
+    *pui32Seconds = (uint32_t)sTime.seconds;
+    *pui32Nanoseconds = (uint32_t)sTime.nanoseconds;
+}
+
+//*****************************************************************************
+//
+// Set the selected node's clock.
+//
+//*****************************************************************************
+static void
+ClockSimSetTime(uint32_t ui32Seconds, uint32_t ui32Nanoseconds)
+{
+    TimeInternal sTime;
+    tHostClock *psClock;
+
+    sTime.seconds = (Integer32)ui32Seconds;
+    sTime.nanoseconds = (Integer32)ui32Nanoseconds;
+
+    psClock = &HostNodeCurrent()->sClock;
+    psClock->i64Ns = HostInternalToNs(&sTime);
+    psClock->ui32SetCount++;
+}
+
+//*****************************************************************************
+//
+// Trim the selected node's clock rate.
+//
+//*****************************************************************************
+static void
+ClockSimAdjFreq(int32_t i32Ppb)
+{
+    tHostClock *psClock;
+
+    psClock = &HostNodeCurrent()->sClock;
+    psClock->i32AdjPpb = i32Ppb;
+    psClock->ui32AdjCount++;
+}
+
+//*****************************************************************************
+//
+// The simulated clock reads in whole nanoseconds.
+//
+//*****************************************************************************
+static uint32_t
+ClockSimResolution(void)
+{
+    return(1);
+}
+
+//*****************************************************************************
+//
+// The simulated clock source.
+//
+//*****************************************************************************
+const tClockOps g_sClockSim =
+{
+    "sim",
+    ClockSimInit,
+    ClockSimTick,
+    ClockSimGetTime,
+    ClockSimSetTime,
+    ClockSimAdjFreq,
+    ClockSimResolution
+};
@@ -0,0 +1,277 @@
+//*****************************************************************************
+//
+// freqsweep.c - Check the realised rate of the SysTick frequency steering
+// against the adjFreq() request across the servo's range.
+//
+// For each requested adjustment from -ADJ_MAX to +ADJ_MAX, the SysTick period
+// sequence is generated for a number of ticks, both by the phase accumulator
+// in clock_freq.c that the SysTick clock source uses and by the reload
+// dithering it replaced.  Each tick advances the clock by the nominal tick
+// length, so the realised rate is the nominal cycle count over the cycles
+// actually spent.  The worst deviation of the accumulated period from the
+// ideal, at any tick, shows how evenly the correction is spread.
+//
+//     freqsweep [-c sysclk-hz] [-r tick-hz] [-n ticks] [-t tolerance-ppb]
+//
+// The program exits with status 1 if the phase accumulator misses any
+// requested rate by more than the tolerance.
+//
+//*****************************************************************************
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "clock_freq.h"
+#include "ptpd.h"
+
+//*****************************************************************************
+//
+// Defaults: the target's clocks, 10000 seconds of ticks, and a tolerance
+// well under a part per billion.
+//
+//*****************************************************************************
+#define DEFAULT_SYSCLK          120000000
+#define DEFAULT_TICK_HZ         10
+#define DEFAULT_TICKS           1000000
+#define DEFAULT_TOLERANCE_PPB   0.01
+
+//*****************************************************************************
+//
+// The adjustments tried: powers of ten up to ADJ_MAX, the old 2.5 ppm step,
+// and some values between the steps of the old scheme, with both signs.
+//
+//*****************************************************************************
+static const int32_t g_pi32Ppb[] =
+{
+    0, 1, 7, 10, 100, 1000, 2500, 10000, 12345, 100000, 1000000, 3333333,
+    ADJ_MAX
+};
+
+#define NUM_PPB                 (sizeof(g_pi32Ppb) / sizeof(g_pi32Ppb[0]))
+
+//*****************************************************************************
+//
+// The result of running one steering scheme for a number of ticks.
+//
+//*****************************************************************************
+typedef struct
+{
+    //
+    // The realised rate error, in ppb.
+    //
+    double dRealisedPpb;
+
+    //
+    // The worst difference, in nanoseconds of real time, between the
+    // accumulated periods and the ideal at any tick.
+    //
+    double dPhaseDevNs;
+}
+tSweepResult;
+
+//*****************************************************************************
+//
+// Collect the realised rate and phase deviation for a sequence of periods.
+//
+//*****************************************************************************
+typedef struct
+{
+    uint64_t ui64Cycles;
+    double dIdealCycles;
+    double dMaxDev;
+}
+tSweepAcc;
+
+static void
+SweepAdd(tSweepAcc *psAcc, uint32_t ui32Period, double dIdeal)
+{
+    double dDev;
+
+    psAcc->ui64Cycles += ui32Period;
+    psAcc->dIdealCycles += dIdeal;
+    dDev = fabs((double)psAcc->ui64Cycles - psAcc->dIdealCycles);
+    if(dDev > psAcc->dMaxDev)
+    {
+        psAcc->dMaxDev = dDev;
+    }
+}
+
+static void
+SweepResult(const tSweepAcc *psAcc, uint32_t ui32Nominal, uint32_t ui32Ticks,
+            uint32_t ui32SysClock, tSweepResult *psResult)
+{
+    psResult->dRealisedPpb = (((long double)ui32Nominal * ui32Ticks /
+                               (long double)psAcc->ui64Cycles) - 1.0L) * 1e9L;
+    psResult->dPhaseDevNs = psAcc->dMaxDev * 1e9 / ui32SysClock;
+}
+
+//*****************************************************************************
+//
+// Run the phase accumulator.
+//
+//*****************************************************************************
+static void
+SweepAccumulator(uint32_t ui32SysClock, uint32_t ui32TickHz,
+                 uint32_t ui32Ticks, int32_t i32Ppb, tSweepResult *psResult)
+{
+    tClockFreq sFreq;
+    tSweepAcc sAcc;
+    uint32_t ui32Nominal, ui32Phase, ui32Idx;
+    double dIdeal;
+
+    ui32Nominal = ui32SysClock / ui32TickHz;
+    dIdeal = (double)ui32Nominal * 1e9 / (1e9 + i32Ppb);
+
+    ClockFreqSet(&sFreq, ui32Nominal, i32Ppb);
+    memset(&sAcc, 0, sizeof(sAcc));
+    ui32Phase = 0;
+
+    for(ui32Idx = 0; ui32Idx < ui32Ticks; ui32Idx++)
+    {
+        SweepAdd(&sAcc, ClockFreqNext(&sFreq, &ui32Phase), dIdeal);
+    }
+
+    SweepResult(&sAcc, ui32Nominal, ui32Ticks, ui32SysClock, psResult);
+}
+
+//*****************************************************************************
+//
+// Run the reload dithering that adjFreq() and the SysTick handler used
+// before the phase accumulator: the adjustment is truncated to whole
+// nanoseconds per tick, and one tick in every whole number of nanoseconds
+// per processor clock is made one cycle longer for each nanosecond left
+// over.  This was only ever used at 40 MHz, where a clock is 25 ns.
+//
+//*****************************************************************************
+static void
+SweepDither(uint32_t ui32SysClock, uint32_t ui32TickHz, uint32_t ui32Ticks,
+            int32_t i32Ppb, tSweepResult *psResult)
+{
+    tSweepAcc sAcc;
+    uint32_t ui32TickNs, ui32Nominal, ui32Temp, ui32High, ui32Reload;
+    uint32_t ui32Idx;
+    double dIdeal;
+
+    ui32TickNs = 1000000000 / ui32SysClock;
+    ui32Nominal = ui32SysClock / ui32TickHz;
+    dIdeal = (double)ui32Nominal * 1e9 / (1e9 + i32Ppb);
+
+    ui32Temp = (ui32Nominal * ui32TickNs) - (i32Ppb / (int32_t)ui32TickHz);
+    ui32High = ui32Temp % ui32TickNs;
+    ui32Reload = ui32Temp / ui32TickNs;
+
+    memset(&sAcc, 0, sizeof(sAcc));
+    for(ui32Idx = 0; ui32Idx < ui32Ticks; ui32Idx++)
+    {
+        SweepAdd(&sAcc, ((ui32Idx % ui32TickNs) < ui32High) ?
+                        (ui32Reload + 1) : ui32Reload, dIdeal);
+    }
+
+    SweepResult(&sAcc, ui32Nominal, ui32Ticks, ui32SysClock, psResult);
+}
+
+//*****************************************************************************
+//
+// Sweep the adjustments and report.
+//
+//*****************************************************************************
+int
+main(int argc, char *argv[])
+{
+    uint32_t ui32SysClock, ui32TickHz, ui32Ticks, ui32Idx, ui32Points;
+    tSweepResult sAccum, sDither;
+    double dTolerance, dMaxErr, dMaxDitherErr, dErr, dDitherErr;
+    int32_t i32Ppb;
+    int iArg, iSign;
+
+    ui32SysClock = DEFAULT_SYSCLK;
+    ui32TickHz = DEFAULT_TICK_HZ;
+    ui32Ticks = DEFAULT_TICKS;
+    dTolerance = DEFAULT_TOLERANCE_PPB;
+
+    for(iArg = 1; iArg < argc; iArg++)
+    {
+        if(!strcmp(argv[iArg], "-c") && ((iArg + 1) < argc))
+        {
+            ui32SysClock = (uint32_t)strtoul(argv[++iArg], NULL, 0);
+        }
+        else if(!strcmp(argv[iArg], "-r") && ((iArg + 1) < argc))
+        {
+            ui32TickHz = (uint32_t)strtoul(argv[++iArg], NULL, 0);
+        }
+        else if(!strcmp(argv[iArg], "-n") && ((iArg + 1) < argc))
+        {
+            ui32Ticks = (uint32_t)strtoul(argv[++iArg], NULL, 0);
+        }
+        else if(!strcmp(argv[iArg], "-t") && ((iArg + 1) < argc))
+        {
+            dTolerance = strtod(argv[++iArg], NULL);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-c sysclk-hz] [-r tick-hz] "
+                    "[-n ticks] [-t tolerance-ppb]\n", argv[0]);
+            return(1);
+        }
+    }
+    if((ui32SysClock == 0) || (ui32TickHz == 0) || (ui32Ticks == 0) ||
+       (ui32SysClock > 1000000000) || ((ui32SysClock % ui32TickHz) != 0))
+    {
+        fprintf(stderr, "the system clock must be a multiple of the tick "
+                "rate, at most 1 GHz, and the tick count non-zero\n");
+        return(1);
+    }
+
+    dMaxErr = 0.0;
+    dMaxDitherErr = 0.0;
+    ui32Points = 0;
+
+    for(iSign = -1; iSign <= 1; iSign += 2)
+    {
+        for(ui32Idx = 0; ui32Idx < NUM_PPB; ui32Idx++)
+        {
+            //
+            // Zero is only tried once.
+            //
+            if((iSign > 0) && (g_pi32Ppb[ui32Idx] == 0))
+            {
+                continue;
+            }
+            i32Ppb = (iSign < 0) ? -g_pi32Ppb[NUM_PPB - 1 - ui32Idx] :
+                                   g_pi32Ppb[ui32Idx];
+
+            SweepAccumulator(ui32SysClock, ui32TickHz, ui32Ticks, i32Ppb,
+                             &sAccum);
+            SweepDither(ui32SysClock, ui32TickHz, ui32Ticks, i32Ppb,
+                        &sDither);
+
+            dErr = sAccum.dRealisedPpb - i32Ppb;
+            dDitherErr = sDither.dRealisedPpb - i32Ppb;
+            if(fabs(dErr) > dMaxErr)
+            {
+                dMaxErr = fabs(dErr);
+            }
+            if(fabs(dDitherErr) > dMaxDitherErr)
+            {
+                dMaxDitherErr = fabs(dDitherErr);
+            }
+            ui32Points++;
+
+            printf("ppb=%d realised_ppb=%.4f err_ppb=%.4f phase_dev_ns=%.1f "
+                   "dither_realised_ppb=%.4f dither_err_ppb=%.4f "
+                   "dither_phase_dev_ns=%.1f\n", i32Ppb, sAccum.dRealisedPpb,
+                   dErr, sAccum.dPhaseDevNs, sDither.dRealisedPpb, dDitherErr,
+                   sDither.dPhaseDevNs);
+        }
+    }
+
+    printf("# points=%u sysclk=%u tick_hz=%u ticks=%u max_err_ppb=%.4f "
+           "dither_max_err_ppb=%.4f tolerance_ppb=%g result=%s\n", ui32Points,
+           ui32SysClock, ui32TickHz, ui32Ticks, dMaxErr, dMaxDitherErr,
+           dTolerance, (dMaxErr <= dTolerance) ? "pass" : "fail");
+
+    return((dMaxErr <= dTolerance) ? 0 : 1);
+}
@@ -0,0 +1,934 @@
+//*****************************************************************************
+//
+// httpload.c - HTTP load generator for the web server.
+//
+// Each simulated client replays page loads the way a browser without a cache
+// does against httpserver_raw: the page itself and then each of the assets
+// it references (style sheets, scripts and images), one HTTP/1.0 request per
+// TCP connection.  The page and its assets are discovered by fetching the
+// page once at start-up, and further URLs, such as files under /sd/, can be
+// added to every page load with -u.
+//
+// The number of clients rises in steps, by default 1, 2, 4 ... up to
+// MEMP_NUM_TCP_PCB from the application's lwipopts.h, since every client
+// holds a TCP PCB on the server.  Each step reports throughput and request
+// and page-load latency percentiles.  When the server is websrv (the host
+// build of the web server) started with -s, the same statistics file is
+// given to -s here and each step also reports which lwIP pools ran out.
+//
+//     httpload [options]     (httpload -h lists them)
+//
+//*****************************************************************************
+
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "lwipopts.h"
+
+//*****************************************************************************
+//
+// Load generator limits.
+//
+//*****************************************************************************
+#define LOAD_MAX_CLIENTS        256
+#define LOAD_MAX_URLS           32
+#define LOAD_MAX_URL_LEN        128
+#define LOAD_MAX_POOLS          32
+#define LOAD_REQUEST_LEN        320
+
+//*****************************************************************************
+//
+// The states of a client's current request.
+//
+//*****************************************************************************
+enum
+{
+    CLIENT_IDLE,
+    CLIENT_CONNECTING,
+    CLIENT_SENDING,
+    CLIENT_RECEIVING
+};
+
+//*****************************************************************************
+//
+// One simulated browser.
+//
+//*****************************************************************************
+typedef struct
+{
+    int iFd;
+    int iState;
+
+    //
+    // The URL being fetched, as an index into the page's URL list.
+    //
+    uint32_t ui32Url;
+
+    //
+    // The request text and how much of it has been sent.
+    //
+    char pcRequest[LOAD_REQUEST_LEN];
+    uint32_t ui32RequestLen;
+    uint32_t ui32Sent;
+
+    //
+    // The start of the request and of the page load, in nanoseconds.
+    //
+    int64_t i64RequestNs;
+    int64_t i64PageNs;
+
+    //
+    // The start of the response, enough to hold the status code.
+    //
+    char pcStatus[16];
+    uint32_t ui32StatusLen;
+
+    //
+    // True if any request of this page load failed.
+    //
+    bool bPageFailed;
+}
+tClient;
+
+//*****************************************************************************
+//
+// A growable array of latency samples in nanoseconds.
+//
+//*****************************************************************************
+typedef struct
+{
+    double *pdNs;
+    uint32_t ui32Count;
+    uint32_t ui32Size;
+}
+tSamples;
+
+//*****************************************************************************
+//
+// The results of one load step.
+//
+//*****************************************************************************
+typedef struct
+{
+    uint32_t ui32Requests;
+    uint32_t ui32Pages;
+    uint32_t ui32Errors;
+    uint32_t ui32Timeouts;
+    uint64_t ui64Bytes;
+    tSamples sRequest;
+    tSamples sPage;
+}
+tStep;
+
+//*****************************************************************************
+//
+// One lwIP pool as read from the websrv statistics file.
+//
+//*****************************************************************************
+typedef struct
+{
+    char pcName[24];
+    uint32_t ui32Avail;
+    uint32_t ui32Max;
+    uint32_t ui32Err;
+}
+tPool;
+
+//*****************************************************************************
+//
+// Program state.
+//
+//*****************************************************************************
+static const char *g_pcHost = "192.168.7.2";
+static const char *g_pcPort = "80";
+static const char *g_pcPage = "/index.htm";
+static const char *g_pcStats;
+static uint32_t g_ui32MaxClients = MEMP_NUM_TCP_PCB;
+static double g_dStepS = 5.0;
+static int64_t g_i64TimeoutNs = 5000000000LL;
+static struct sockaddr_storage g_sAddr;
+static socklen_t g_iAddrLen;
+static char g_ppcUrl[LOAD_MAX_URLS][LOAD_MAX_URL_LEN];
+static uint32_t g_ui32Urls;
+static tClient g_psClient[LOAD_MAX_CLIENTS];
+static tStep g_sStep;
+
+//*****************************************************************************
+//
+// Return monotonic time in nanoseconds.
+//
+//*****************************************************************************
+static int64_t
+NowNs(void)
+{
+    struct timespec sNow;
+
+    clock_gettime(CLOCK_MONOTONIC, &sNow);
+
+    return(((int64_t)sNow.tv_sec * 1000000000LL) + sNow.tv_nsec);
+}
+
+//*****************************************************************************
+//
+// Add a sample to a sample set.
+//
+//*****************************************************************************
+static void
+SamplesAdd(tSamples *psSamples, double dNs)
+{
+    double *pdGrow;
+
+    if(psSamples->ui32Count == psSamples->ui32Size)
+    {
+        psSamples->ui32Size = psSamples->ui32Size ?
+                              (psSamples->ui32Size * 2) : 4096;
+        pdGrow = realloc(psSamples->pdNs,
+                         psSamples->ui32Size * sizeof(double));
+        if(pdGrow == NULL)
+        {
+            return;
+        }
+        psSamples->pdNs = pdGrow;
+    }
+    psSamples->pdNs[psSamples->ui32Count++] = dNs;
+}
+
+static int
+SamplesCompare(const void *pvA, const void *pvB)
+{
+    double dA = *(const double *)pvA, dB = *(const double *)pvB;
+
+    return((dA > dB) - (dA < dB));
+}
+
+//*****************************************************************************
+//
+// Return a percentile of a sample set in milliseconds.  The samples are
+// sorted by the first call.
+//
+//*****************************************************************************
+static double
+SamplesPercentileMs(tSamples *psSamples, double dPercent)
+{
+    uint32_t ui32Index;
+
+    if(psSamples->ui32Count == 0)
+    {
+        return(0.0);
+    }
+
+    qsort(psSamples->pdNs, psSamples->ui32Count, sizeof(double),
+          SamplesCompare);
+    ui32Index = (uint32_t)((dPercent / 100.0) * psSamples->ui32Count);
+    if(ui32Index >= psSamples->ui32Count)
+    {
+        ui32Index = psSamples->ui32Count - 1;
+    }
+
+    return(psSamples->pdNs[ui32Index] / 1e6);
+}
+
+//*****************************************************************************
+//
+// Add a URL to every page load, unless it is already there.
+//
+//*****************************************************************************
+static void
+UrlAdd(const char *pcUrl, uint32_t ui32Length)
+{
+    uint32_t ui32Url;
+    char *pcDest;
+
+    if((g_ui32Urls == LOAD_MAX_URLS) ||
+       ((ui32Length + 2) > LOAD_MAX_URL_LEN))
+    {
+        return;
+    }
+
+    pcDest = g_ppcUrl[g_ui32Urls];
+    if(pcUrl[0] != '/')
+    {
+        *pcDest++ = '/';
+    }
+    memcpy(pcDest, pcUrl, ui32Length);
+    pcDest[ui32Length] = '\0';
+
+    for(ui32Url = 0; ui32Url < g_ui32Urls; ui32Url++)
+    {
+        if(!strcmp(g_ppcUrl[ui32Url], g_ppcUrl[g_ui32Urls]))
+        {
+            return;
+        }
+    }
+    g_ui32Urls++;
+}
+
+//*****************************************************************************
+//
+// Add the assets a page references: every src= or href= attribute naming a
+// style sheet, script or image on the same server.  Links to other pages and
+// to other servers are not part of the page load.
+//
+//*****************************************************************************
+static void
+UrlParsePage(const char *pcPage)
+{
+    static const char *const ppcAsset[] =
+    {
+        ".css", ".js", ".jpg", ".jpeg", ".gif", ".png", ".ico"
+    };
+    const char *pcAttr, *pcEnd, *pcExt;
+    uint32_t ui32Length, ui32Asset;
+
+    for(pcAttr = pcPage; (pcAttr = strpbrk(pcAttr, "sh")) != NULL; pcAttr++)
+    {
+        if(!strncmp(pcAttr, "src=\"", 5))
+        {
+            pcAttr += 5;
+        }
+        else if(!strncmp(pcAttr, "href=\"", 6))
+        {
+            pcAttr += 6;
+        }
+        else
+        {
+            continue;
+        }
+
+        pcEnd = strchr(pcAttr, '"');
+        if(pcEnd == NULL)
+        {
+            break;
+        }
+        ui32Length = (uint32_t)(pcEnd - pcAttr);
+        if(strstr(pcAttr, "://") && (strstr(pcAttr, "://") < pcEnd))
+        {
+            continue;
+        }
+
+        pcExt = pcEnd;
+        while((pcExt > pcAttr) && (pcExt[-1] != '.') && (pcExt[-1] != '/'))
+        {
+            pcExt--;
+        }
+        if((pcExt == pcAttr) || (pcExt[-1] != '.'))
+        {
+            continue;
+        }
+        pcExt--;
+
+        for(ui32Asset = 0;
+            ui32Asset < (sizeof(ppcAsset) / sizeof(ppcAsset[0])); ui32Asset++)
+        {
+            if((strlen(ppcAsset[ui32Asset]) == (size_t)(pcEnd - pcExt)) &&
+               !strncasecmp(pcExt, ppcAsset[ui32Asset], pcEnd - pcExt))
+            {
+                UrlAdd(pcAttr, ui32Length);
+                break;
+            }
+        }
+    }
+}
+
+//*****************************************************************************
+//
+// Resolve the server address.
+//
+//*****************************************************************************
+static bool
+Resolve(void)
+{
+    struct addrinfo sHints, *psInfo;
+    int iErr;
+
+    memset(&sHints, 0, sizeof(sHints));
+    sHints.ai_family = AF_UNSPEC;
+    sHints.ai_socktype = SOCK_STREAM;
+    iErr = getaddrinfo(g_pcHost, g_pcPort, &sHints, &psInfo);
+    if(iErr != 0)
+    {
+        fprintf(stderr, "%s: %s\n", g_pcHost, gai_strerror(iErr));
+        return(false);
+    }
+
+    memcpy(&g_sAddr, psInfo->ai_addr, psInfo->ai_addrlen);
+    g_iAddrLen = psInfo->ai_addrlen;
+    freeaddrinfo(psInfo);
+
+    return(true);
+}
+
+//*****************************************************************************
+//
+// Fetch the page once, with a blocking connection, and add its assets to the
+// page load.  Returns false if the page cannot be fetched.
+//
+//*****************************************************************************
+static bool
+DiscoverPage(void)
+{
+    char pcRequest[LOAD_REQUEST_LEN], *pcBody, *pcGrow;
+    uint32_t ui32Length, ui32Size;
+    ssize_t iRead;
+    int iFd;
+
+    UrlAdd(g_pcPage, (uint32_t)strlen(g_pcPage));
+
+    iFd = socket(g_sAddr.ss_family, SOCK_STREAM, 0);
+    if((iFd < 0) ||
+       (connect(iFd, (struct sockaddr *)&g_sAddr, g_iAddrLen) < 0))
+    {
+        perror(g_pcHost);
+        if(iFd >= 0)
+        {
+            close(iFd);
+        }
+        return(false);
+    }
+
+    ui32Length = (uint32_t)snprintf(pcRequest, sizeof(pcRequest),
+                                    "GET %s HTTP/1.0\r\nHost: %s\r\n\r\n",
+                                    g_ppcUrl[0], g_pcHost);
+    if(write(iFd, pcRequest, ui32Length) != (ssize_t)ui32Length)
+    {
+        perror(g_pcHost);
+        close(iFd);
+        return(false);
+    }
+
+    ui32Length = 0;
+    ui32Size = 16384;
+    pcBody = malloc(ui32Size + 1);
+    while(pcBody &&
+          ((iRead = read(iFd, pcBody + ui32Length, ui32Size - ui32Length)) >
+           0))
+    {
+        ui32Length += (uint32_t)iRead;
+        if(ui32Length == ui32Size)
+        {
+            ui32Size *= 2;
+            pcGrow = realloc(pcBody, ui32Size + 1);
+            if(pcGrow == NULL)
+            {
+                break;
+            }
+            pcBody = pcGrow;
+        }
+    }
+    close(iFd);
+
+    if((pcBody == NULL) || (ui32Length < 12) ||
+       strncmp(pcBody + 8, " 200", 4))
+    {
+        fprintf(stderr, "%s: cannot fetch %s\n", g_pcHost, g_ppcUrl[0]);
+        free(pcBody);
+        return(false);
+    }
+    pcBody[ui32Length] = '\0';
+    UrlParsePage(pcBody);
+    free(pcBody);
+
+    return(true);
+}
+
+//*****************************************************************************
+//
+// Read the websrv pool statistics.  Returns the number of pools read.
+//
+//*****************************************************************************
+static uint32_t
+PoolsRead(tPool *psPool)
+{
+    char pcLine[160];
+    unsigned uAvail, uUsed, uMax, uErr;
+    uint32_t ui32Count;
+    FILE *pfIn;
+
+    pfIn = fopen(g_pcStats, "r");
+    if(pfIn == NULL)
+    {
+        return(0);
+    }
+
+    ui32Count = 0;
+    while((ui32Count < LOAD_MAX_POOLS) && fgets(pcLine, sizeof(pcLine), pfIn))
+    {
+        if(sscanf(pcLine, "pool=%23s avail=%u used=%u max=%u err=%u",
+                  psPool[ui32Count].pcName, &uAvail, &uUsed, &uMax,
+                  &uErr) == 5)
+        {
+            psPool[ui32Count].ui32Avail = uAvail;
+            psPool[ui32Count].ui32Max = uMax;
+            psPool[ui32Count].ui32Err = uErr;
+            ui32Count++;
+        }
+    }
+    fclose(pfIn);
+
+    return(ui32Count);
+}
+
+//*****************************************************************************
+//
+// Close a client's connection.
+//
+//*****************************************************************************
+static void
+ClientClose(tClient *psClient)
+{
+    if(psClient->iFd >= 0)
+    {
+        close(psClient->iFd);
+        psClient->iFd = -1;
+    }
+    psClient->iState = CLIENT_IDLE;
+}
+
+//*****************************************************************************
+//
+// Start a client's next request: the first URL of a new page load, or the
+// next asset of the current one.
+//
+//*****************************************************************************
+static void
+ClientStart(tClient *psClient, int64_t i64Now)
+{
+    if(psClient->ui32Url == 0)
+    {
+        psClient->i64PageNs = i64Now;
+        psClient->bPageFailed = false;
+    }
+
+    psClient->i64RequestNs = i64Now;
+    psClient->ui32Sent = 0;
+    psClient->ui32StatusLen = 0;
+    psClient->ui32RequestLen =
+        (uint32_t)snprintf(psClient->pcRequest, sizeof(psClient->pcRequest),
+                           "GET %s HTTP/1.0\r\nHost: %s\r\n"
+                           "User-Agent: httpload\r\n\r\n",
+                           g_ppcUrl[psClient->ui32Url], g_pcHost);
+
+    psClient->iFd = socket(g_sAddr.ss_family, SOCK_STREAM | SOCK_NONBLOCK,
+                           0);
+    if(psClient->iFd < 0)
+    {
+        psClient->iState = CLIENT_IDLE;
+        return;
+    }
+
+    psClient->iState = CLIENT_CONNECTING;
+    if(connect(psClient->iFd, (struct sockaddr *)&g_sAddr, g_iAddrLen) == 0)
+    {
+        psClient->iState = CLIENT_SENDING;
+    }
+    else if(errno != EINPROGRESS)
+    {
+        psClient->iState = CLIENT_SENDING;
+    }
+}
+
+//*****************************************************************************
+//
+// Finish a client's request, successfully or not, and move it on to the next
+// URL of its page load.
+//
+//*****************************************************************************
+static void
+ClientFinish(tClient *psClient, bool bOK, int64_t i64Now)
+{
+    ClientClose(psClient);
+
+    g_sStep.ui32Requests++;
+    if(bOK)
+    {
+        SamplesAdd(&g_sStep.sRequest,
+                   (double)(i64Now - psClient->i64RequestNs));
+    }
+    else
+    {
+        g_sStep.ui32Errors++;
+        psClient->bPageFailed = true;
+    }
+
+    psClient->ui32Url++;
+    if(psClient->ui32Url == g_ui32Urls)
+    {
+        psClient->ui32Url = 0;
+        if(!psClient->bPageFailed)
+        {
+            g_sStep.ui32Pages++;
+            SamplesAdd(&g_sStep.sPage, (double)(i64Now - psClient->i64PageNs));
+        }
+    }
+}
+
+//*****************************************************************************
+//
+// Move a client on when its socket is ready.
+//
+//*****************************************************************************
+static void
+ClientService(tClient *psClient, int64_t i64Now)
+{
+    char pcBuffer[4096];
+    uint32_t ui32Copy;
+    ssize_t iCount;
+    socklen_t iLen;
+    int iErr;
+
+    if(psClient->iState == CLIENT_CONNECTING)
+    {
+        iLen = sizeof(iErr);
+        if(getsockopt(psClient->iFd, SOL_SOCKET, SO_ERROR, &iErr, &iLen) ||
+           iErr)
+        {
+            ClientFinish(psClient, false, i64Now);
+            return;
+        }
+        psClient->iState = CLIENT_SENDING;
+    }
+
+    if(psClient->iState == CLIENT_SENDING)
+    {
+        iCount = send(psClient->iFd, psClient->pcRequest + psClient->ui32Sent,
+                      psClient->ui32RequestLen - psClient->ui32Sent,
+                      MSG_NOSIGNAL);
+        if(iCount < 0)
+        {
+            if((errno != EAGAIN) && (errno != EWOULDBLOCK))
+            {
+                ClientFinish(psClient, false, i64Now);
+            }
+            return;
+        }
+        psClient->ui32Sent += (uint32_t)iCount;
+        if(psClient->ui32Sent == psClient->ui32RequestLen)
+        {
+            psClient->iState = CLIENT_RECEIVING;
+        }
+        return;
+    }
+
+    if(psClient->iState == CLIENT_RECEIVING)
+    {
+        while((iCount = recv(psClient->iFd, pcBuffer, sizeof(pcBuffer),
+                             0)) > 0)
+        {
+            g_sStep.ui64Bytes += (uint64_t)iCount;
+            if(psClient->ui32StatusLen < sizeof(psClient->pcStatus))
+            {
+                ui32Copy = sizeof(psClient->pcStatus) -
+                           psClient->ui32StatusLen;
+                if(ui32Copy > (uint32_t)iCount)
+                {
+                    ui32Copy = (uint32_t)iCount;
+                }
+                memcpy(psClient->pcStatus + psClient->ui32StatusLen,
+                       pcBuffer, ui32Copy);
+                psClient->ui32StatusLen += ui32Copy;
+            }
+        }
+
+        //
+        // The server closes the connection at the end of the response.
+        //
+        if(iCount == 0)
+        {
+            ClientFinish(psClient,
+                         (psClient->ui32StatusLen >= 12) &&
+                         !strncmp(psClient->pcStatus, "HTTP/", 5) &&
+                         !strncmp(psClient->pcStatus + 8, " 200", 4),
+                         i64Now);
+        }
+        else if((errno != EAGAIN) && (errno != EWOULDBLOCK))
+        {
+            ClientFinish(psClient, false, i64Now);
+        }
+    }
+}
+
+//*****************************************************************************
+//
+// Run one load step with the given number of clients, and report it.
+// Returns the number of successful requests.
+//
+//*****************************************************************************
+static uint32_t
+RunStep(uint32_t ui32Clients)
+{
+    struct pollfd psPoll[LOAD_MAX_CLIENTS];
+    tPool psBefore[LOAD_MAX_POOLS], psAfter[LOAD_MAX_POOLS];
+    uint32_t ui32Client, ui32Pools, ui32Pool, ui32OK;
+    int64_t i64Start, i64End, i64Now;
+    tClient *psClient;
+    double dSeconds;
+    bool bFirst;
+
+    free(g_sStep.sRequest.pdNs);
+    free(g_sStep.sPage.pdNs);
+    memset(&g_sStep, 0, sizeof(g_sStep));
+    ui32Pools = g_pcStats ? PoolsRead(psBefore) : 0;
+
+    //
+    // Stagger the clients across their page loads so that they do not all
+    // ask for the same file at once.
+    //
+    i64Start = NowNs();
+    for(ui32Client = 0; ui32Client < ui32Clients; ui32Client++)
+    {
+        psClient = &g_psClient[ui32Client];
+        psClient->iFd = -1;
+        psClient->ui32Url = ui32Client % g_ui32Urls;
+        psClient->i64PageNs = i64Start;
+        psClient->bPageFailed = (psClient->ui32Url != 0);
+        ClientStart(psClient, i64Start);
+    }
+
+    i64End = i64Start + (int64_t)(g_dStepS * 1e9);
+    while((i64Now = NowNs()) < i64End)
+    {
+        for(ui32Client = 0; ui32Client < ui32Clients; ui32Client++)
+        {
+            psClient = &g_psClient[ui32Client];
+
+            //
+            // Give up on requests that have taken too long, and start the
+            // next request of any client that is idle.
+            //
+            if((psClient->iState != CLIENT_IDLE) &&
+               ((i64Now - psClient->i64RequestNs) > g_i64TimeoutNs))
+            {
+                g_sStep.ui32Timeouts++;
+                ClientFinish(psClient, false, i64Now);
+            }
+            if(psClient->iState == CLIENT_IDLE)
+            {
+                ClientStart(psClient, i64Now);
+            }
+
+            psPoll[ui32Client].fd = psClient->iFd;
+            psPoll[ui32Client].events =
+                (psClient->iState == CLIENT_RECEIVING) ? POLLIN : POLLOUT;
+            psPoll[ui32Client].revents = 0;
+        }
+
+        if(poll(psPoll, ui32Clients, 10) <= 0)
+        {
+            continue;
+        }
+
+        i64Now = NowNs();
+        for(ui32Client = 0; ui32Client < ui32Clients; ui32Client++)
+        {
+            if(psPoll[ui32Client].revents)
+            {
+                ClientService(&g_psClient[ui32Client], i64Now);
+            }
+        }
+    }
+
+    //
+    // Requests still in flight at the end of the step are not counted.
+    //
+    for(ui32Client = 0; ui32Client < ui32Clients; ui32Client++)
+    {
+        ClientClose(&g_psClient[ui32Client]);
+    }
+    dSeconds = (double)(NowNs() - i64Start) / 1e9;
+    ui32OK = g_sStep.ui32Requests - g_sStep.ui32Errors;
+
+    printf("clients=%u requests=%u errors=%u timeouts=%u pages=%u "
+           "req_per_s=%.1f pages_per_s=%.1f kbytes_per_s=%.1f "
+           "req_p50_ms=%.2f req_p99_ms=%.2f page_p50_ms=%.2f "
+           "page_p99_ms=%.2f", ui32Clients, g_sStep.ui32Requests,
+           g_sStep.ui32Errors, g_sStep.ui32Timeouts, g_sStep.ui32Pages,
+           (double)ui32OK / dSeconds, (double)g_sStep.ui32Pages / dSeconds,
+           (double)g_sStep.ui64Bytes / (1024.0 * dSeconds),
+           SamplesPercentileMs(&g_sStep.sRequest, 50.0),
+           SamplesPercentileMs(&g_sStep.sRequest, 99.0),
+           SamplesPercentileMs(&g_sStep.sPage, 50.0),
+           SamplesPercentileMs(&g_sStep.sPage, 99.0));
+
+    //
+    // Report the pools that failed an allocation during the step, with how
+    // many times, and those whose high-water mark has reached their size.
+    //
+    if(ui32Pools && (PoolsRead(psAfter) == ui32Pools))
+    {
+        printf(" pool_errors=");
+        bFirst = true;
+        for(ui32Pool = 0; ui32Pool < ui32Pools; ui32Pool++)
+        {
+            if(psAfter[ui32Pool].ui32Err != psBefore[ui32Pool].ui32Err)
+            {
+                printf("%s%s:%u", bFirst ? "" : ",", psAfter[ui32Pool].pcName,
+                       psAfter[ui32Pool].ui32Err - psBefore[ui32Pool].ui32Err);
+                bFirst = false;
+            }
+        }
+        printf("%s pools_full=", bFirst ? "none" : "");
+        bFirst = true;
+        for(ui32Pool = 0; ui32Pool < ui32Pools; ui32Pool++)
+        {
+            if(psAfter[ui32Pool].ui32Avail &&
+               (psAfter[ui32Pool].ui32Max >= psAfter[ui32Pool].ui32Avail))
+            {
+                printf("%s%s", bFirst ? "" : ",", psAfter[ui32Pool].pcName);
+                bFirst = false;
+            }
+        }
+        printf("%s", bFirst ? "none" : "");
+    }
+    printf("\n");
+    fflush(stdout);
+
+    return(ui32OK);
+}
+
+//*****************************************************************************
+//
+// Command line handling.
+//
+//*****************************************************************************
+static void
+Usage(const char *pcName)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -a host       server address (default 192.168.7.2)\n"
+        "  -p port       server port (default 80)\n"
+        "  -i path       page to load (default /index.htm)\n"
+        "  -u path       also fetch path on every page load (repeatable)\n"
+        "  -c clients    largest number of clients (default %d, the\n"
+        "                MEMP_NUM_TCP_PCB of lwipopts.h)\n"
+        "  -t seconds    duration of each step (default 5)\n"
+        "  -T ms         request timeout (default 5000)\n"
+        "  -s file       websrv pool statistics file\n",
+        pcName, MEMP_NUM_TCP_PCB);
+}
+
+static bool
+ParseArgs(int argc, char *argv[])
+{
+    int iArg;
+
+    for(iArg = 1; iArg < argc; iArg++)
+    {
+        if((argv[iArg][0] != '-') || ((iArg + 1) >= argc))
+        {
+            return(false);
+        }
+
+        if(!strcmp(argv[iArg], "-a"))
+        {
+            g_pcHost = argv[++iArg];
+        }
+        else if(!strcmp(argv[iArg], "-p"))
+        {
+            g_pcPort = argv[++iArg];
+        }
+        else if(!strcmp(argv[iArg], "-i"))
+        {
+            g_pcPage = argv[++iArg];
+        }
+        else if(!strcmp(argv[iArg], "-u"))
+        {
+            iArg++;
+        }
+        else if(!strcmp(argv[iArg], "-c"))
+        {
+            g_ui32MaxClients = (uint32_t)strtoul(argv[++iArg], NULL, 0);
+        }
+        else if(!strcmp(argv[iArg], "-t"))
+        {
+            g_dStepS = atof(argv[++iArg]);
+        }
+        else if(!strcmp(argv[iArg], "-T"))
+        {
+            g_i64TimeoutNs = (int64_t)(atof(argv[++iArg]) * 1e6);
+        }
+        else if(!strcmp(argv[iArg], "-s"))
+        {
+            g_pcStats = argv[++iArg];
+        }
+        else
+        {
+            return(false);
+        }
+    }
+
+    return((g_ui32MaxClients >= 1) &&
+           (g_ui32MaxClients <= LOAD_MAX_CLIENTS) && (g_dStepS > 0.0));
+}
+
+//*****************************************************************************
+//
+// Load generator entry point.
+//
+//*****************************************************************************
+int
+main(int argc, char *argv[])
+{
+    uint32_t ui32Clients, ui32OK, ui32Url;
+    int iArg;
+
+    if(!ParseArgs(argc, argv))
+    {
+        Usage(argv[0]);
+        return(1);
+    }
+    if(!Resolve() || !DiscoverPage())
+    {
+        return(1);
+    }
+
+    //
+    // URLs given with -u follow the page's own assets.
+    //
+    for(iArg = 1; iArg < (argc - 1); iArg++)
+    {
+        if(!strcmp(argv[iArg], "-u"))
+        {
+            iArg++;
+            UrlAdd(argv[iArg], (uint32_t)strlen(argv[iArg]));
+        }
+    }
+
+    printf("# page=%s urls=%u", g_ppcUrl[0], g_ui32Urls);
+    for(ui32Url = 1; ui32Url < g_ui32Urls; ui32Url++)
+    {
+        printf("%s%s", (ui32Url == 1) ? " assets=" : ",", g_ppcUrl[ui32Url]);
+    }
+    printf("\n");
+
+    //
+    // Double the number of clients at each step, finishing at the largest.
+    //
+    ui32OK = 0;
+    ui32Clients = 1;
+    while(1)
+    {
+        ui32OK += RunStep(ui32Clients);
+        if(ui32Clients == g_ui32MaxClients)
+        {
+            break;
+        }
+        ui32Clients *= 2;
+        if(ui32Clients > g_ui32MaxClients)
+        {
+            ui32Clients = g_ui32MaxClients;
+        }
+    }
+
+    return(ui32OK ? 0 : 1);
+}
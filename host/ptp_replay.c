@@ -0,0 +1,532 @@
+//*****************************************************************************
+//
+// ptp_replay.c - Replay captured PTPv1 traffic through the PTPd engine.
+//
+// A pcap or pcapng capture taken on a mirror port holds the master's Sync,
+// Follow_Up and Delay_Resp messages and the slave's Delay_Req messages.  The
+// replay node takes on the captured slave's identity and is fed every PTPv1
+// message through its NetPath event/general queues, so that protocol.c's
+// handle() and the servo see exactly what the slave saw, as fast as the file
+// can be read.
+//
+// The capture host's clock stands in for the slave's oscillator.  By default
+// the node's clock is derived from the capture time and steered by the
+// servo, so setTime() and adjFreq() take effect just as they would on the
+// board (closed loop).  With --open-loop the raw capture time is used as the
+// RX timestamp and the servo output is only recorded.
+//
+// The slave does not originate Delay_Reqs of its own; the captured ones are
+// injected as its own transmissions instead, so the Delay_Resp messages in
+// the capture match them.
+//
+// Every servo update is written as a CSV row of the offset_from_master,
+// one_way_delay and observed_drift trajectory.  With -m the offsets measured
+// after the last step are also reduced to TIE/MTIE/TDEV/ADEV (clock_metrics.c)
+// at the end of the run.  These are the slave's own view of its error, so
+// they show the servo's noise rather than the true time error.
+//
+//     ptp_replay [options] capture.pcap
+//
+//*****************************************************************************
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "capture.h"
+#include "clock_metrics.h"
+#include "ptpd_host.h"
+
+//*****************************************************************************
+//
+// Offsets of the fields that identify the sender in a PTPv1 message, and of
+// the requester in a Delay_Resp.
+//
+//*****************************************************************************
+#define MSG_SOURCE_TECHNOLOGY   21
+#define MSG_SOURCE_UUID         22
+#define MSG_SOURCE_PORT         28
+#define MSG_SEQUENCE            30
+#define MSG_CONTROL             32
+#define RESP_REQ_TECHNOLOGY     49
+#define RESP_REQ_UUID           50
+#define RESP_REQ_PORT           56
+
+//*****************************************************************************
+//
+// Replay configuration and state.
+//
+//*****************************************************************************
+static const char *g_pcCapture;
+static const char *g_pcOutput;
+static bool g_bOpenLoop;
+static bool g_bHaveSlave;
+static uint8_t g_pui8Slave[PTP_UUID_LENGTH];
+static int32_t g_i32LatencyNs;
+static tHostNode g_sNode;
+static FILE *g_pfOut;
+static bool g_bStarted;
+static int64_t g_i64FirstNs;
+static int64_t g_i64LastNs;
+static uint32_t g_ui32TickRemNs;
+static uint32_t g_pui32Control[PTP_MANAGEMENT_MESSAGE + 1];
+static uint32_t g_ui32Injected;
+static uint32_t g_ui32Skipped;
+static uint32_t g_ui32Updates;
+static bool g_bMetrics;
+static double *g_pdOffset;
+static uint32_t g_ui32Offsets;
+static uint32_t g_ui32OffsetSize;
+static int64_t g_i64OffsetFirstNs;
+static int64_t g_i64OffsetLastNs;
+
+//*****************************************************************************
+//
+// Parse a UUID written as six colon separated hex bytes.
+//
+//*****************************************************************************
+static bool
+ParseUUID(const char *pcText, uint8_t *pui8UUID)
+{
+    unsigned int puiByte[PTP_UUID_LENGTH];
+    int iIdx;
+
+    if(sscanf(pcText, "%x:%x:%x:%x:%x:%x", &puiByte[0], &puiByte[1],
+              &puiByte[2], &puiByte[3], &puiByte[4], &puiByte[5]) !=
+       PTP_UUID_LENGTH)
+    {
+        return(false);
+    }
+
+    for(iIdx = 0; iIdx < PTP_UUID_LENGTH; iIdx++)
+    {
+        pui8UUID[iIdx] = (uint8_t)puiByte[iIdx];
+    }
+
+    return(true);
+}
+
+//*****************************************************************************
+//
+// Return true if a captured frame is a PTPv1 message.
+//
+//*****************************************************************************
+static bool
+IsPTPv1(const tCapturePTP *psPTP)
+{
+    return((psPTP->ui32Length >= HEADER_LENGTH) &&
+           (psPTP->ui32Length <= PACKET_SIZE) &&
+           (psPTP->pui8Data[0] == 0) && (psPTP->pui8Data[1] == 1));
+}
+
+//*****************************************************************************
+//
+// Find the slave to impersonate: the sender of the first Delay_Req.
+//
+//*****************************************************************************
+static bool
+FindSlave(void)
+{
+    tCapture sCapture;
+    tCapturePTP sPTP;
+
+    if(!CaptureOpen(&sCapture, g_pcCapture))
+    {
+        return(false);
+    }
+
+    while(CaptureNextPTP(&sCapture, &sPTP))
+    {
+        if(IsPTPv1(&sPTP) && sPTP.bEvent &&
+           (sPTP.pui8Data[MSG_CONTROL] == PTP_DELAY_REQ_MESSAGE))
+        {
+            memcpy(g_pui8Slave, sPTP.pui8Data + MSG_SOURCE_UUID,
+                   PTP_UUID_LENGTH);
+            g_bHaveSlave = true;
+            break;
+        }
+    }
+
+    CaptureClose(&sCapture);
+
+    return(true);
+}
+
+//*****************************************************************************
+//
+// Bring the node's clock and timers up to a capture time.
+//
+//*****************************************************************************
+static void
+AdvanceTo(int64_t i64TimeNs)
+{
+    int64_t i64Delta;
+    uint64_t ui64Ns;
+
+    i64Delta = i64TimeNs - g_i64LastNs;
+    if(i64Delta <= 0)
+    {
+        return;
+    }
+    g_i64LastNs = i64TimeNs;
+
+    if(g_bOpenLoop)
+    {
+        g_sNode.sClock.i64Ns = i64TimeNs;
+    }
+    else
+    {
+        HostClockAdvance(&g_sNode.sClock, i64Delta);
+    }
+
+    ui64Ns = (uint64_t)i64Delta + g_ui32TickRemNs;
+    HostNodeTick(&g_sNode, (uint32_t)(ui64Ns / 1000000));
+    g_ui32TickRemNs = (uint32_t)(ui64Ns % 1000000);
+}
+
+//*****************************************************************************
+//
+// Record the offset from master of a servo update for the metrics.  A step
+// restarts the series, since the metrics only describe the steered clock.
+//
+//*****************************************************************************
+static void
+RecordOffset(int64_t i64TimeNs, bool bStep)
+{
+    const PtpClock *psClock;
+    double *pdGrow;
+
+    if(bStep)
+    {
+        g_ui32Offsets = 0;
+        return;
+    }
+
+    if(g_ui32Offsets == g_ui32OffsetSize)
+    {
+        g_ui32OffsetSize = g_ui32OffsetSize ? (g_ui32OffsetSize * 2) : 4096;
+        pdGrow = realloc(g_pdOffset, g_ui32OffsetSize * sizeof(double));
+        if(pdGrow == NULL)
+        {
+            g_bMetrics = false;
+            return;
+        }
+        g_pdOffset = pdGrow;
+    }
+
+    psClock = &g_sNode.sPTPClock;
+    if(g_ui32Offsets == 0)
+    {
+        g_i64OffsetFirstNs = i64TimeNs;
+    }
+    g_i64OffsetLastNs = i64TimeNs;
+    g_pdOffset[g_ui32Offsets++] =
+        ((double)psClock->offset_from_master.seconds * 1e9) +
+        (double)psClock->offset_from_master.nanoseconds;
+}
+
+//*****************************************************************************
+//
+// Run the engine until the node's queues are empty, recording any servo
+// update it makes.
+//
+//*****************************************************************************
+static void
+RunNode(int64_t i64TimeNs)
+{
+    NetPath *psNetPath;
+    PtpClock *psClock;
+    uint32_t ui32Adj, ui32Set;
+    int iPass;
+
+    psNetPath = &g_sNode.sPTPClock.netPath;
+    psClock = &g_sNode.sPTPClock;
+
+    for(iPass = 0; iPass < (2 * PBUF_QUEUE_SIZE); iPass++)
+    {
+        //
+        // Keep the Delay_Req countdown from ever reaching zero so that the
+        // node never sends a Delay_Req of its own.
+        //
+        psClock->R = 0xffff;
+
+        ui32Adj = g_sNode.sClock.ui32AdjCount;
+        ui32Set = g_sNode.sClock.ui32SetCount;
+        HostNodeRun(&g_sNode);
+
+        if((g_sNode.sClock.ui32AdjCount != ui32Adj) ||
+           (g_sNode.sClock.ui32SetCount != ui32Set))
+        {
+            g_ui32Updates++;
+            fprintf(g_pfOut, "%.9f,%u,%d,%d,%d,%d,%d,%d,%d\n",
+                    (double)(i64TimeNs - g_i64FirstNs) / 1e9,
+                    psClock->parent_last_sync_sequence_number,
+                    psClock->offset_from_master.seconds,
+                    psClock->offset_from_master.nanoseconds,
+                    psClock->one_way_delay.nanoseconds,
+                    psClock->observed_drift, g_sNode.sClock.i32AdjPpb,
+                    g_sNode.sClock.ui32SetCount != ui32Set,
+                    psClock->port_state);
+            if(g_bMetrics)
+            {
+                RecordOffset(i64TimeNs,
+                             g_sNode.sClock.ui32SetCount != ui32Set);
+            }
+        }
+
+        if((psNetPath->eventQ.count + psNetPath->generalQ.count) == 0)
+        {
+            break;
+        }
+    }
+}
+
+//*****************************************************************************
+//
+// Feed one captured message to the node.
+//
+//*****************************************************************************
+static void
+Replay(const tCapturePTP *psPTP)
+{
+    Octet pcBuf[PACKET_SIZE];
+    TimeInternal sRxTime;
+    uint8_t ui8Control;
+    bool bFromSlave;
+
+    memcpy(pcBuf, psPTP->pui8Data, psPTP->ui32Length);
+    ui8Control = pcBuf[MSG_CONTROL];
+    if(ui8Control <= PTP_MANAGEMENT_MESSAGE)
+    {
+        g_pui32Control[ui8Control]++;
+    }
+    bFromSlave = g_bHaveSlave && !memcmp(pcBuf + MSG_SOURCE_UUID, g_pui8Slave,
+                                         PTP_UUID_LENGTH);
+
+    if(bFromSlave)
+    {
+        //
+        // Only the slave's Delay_Reqs are of interest.  They become the
+        // node's own transmissions, as looped back on the target.
+        //
+        if(!psPTP->bEvent || (ui8Control != PTP_DELAY_REQ_MESSAGE))
+        {
+            g_ui32Skipped++;
+            return;
+        }
+        pcBuf[MSG_SOURCE_TECHNOLOGY] =
+            g_sNode.sPTPClock.port_communication_technology;
+        pcBuf[MSG_SOURCE_PORT] = g_sNode.sPTPClock.port_id_field >> 8;
+        pcBuf[MSG_SOURCE_PORT + 1] = g_sNode.sPTPClock.port_id_field & 0xff;
+        g_sNode.sPTPClock.sentDelayReq = TRUE;
+        g_sNode.sPTPClock.sentDelayReqSequenceId =
+            (UInteger16)((pcBuf[MSG_SEQUENCE] << 8) | pcBuf[MSG_SEQUENCE + 1]);
+        g_ui32Injected++;
+    }
+    else if(g_bHaveSlave && !psPTP->bEvent &&
+            (ui8Control == PTP_DELAY_RESP_MESSAGE) &&
+            (psPTP->ui32Length >= DELAY_RESP_PACKET_LENGTH) &&
+            !memcmp(pcBuf + RESP_REQ_UUID, g_pui8Slave, PTP_UUID_LENGTH))
+    {
+        //
+        // Point the slave's Delay_Resps at the node's port.
+        //
+        pcBuf[RESP_REQ_TECHNOLOGY] =
+            g_sNode.sPTPClock.port_communication_technology;
+        pcBuf[RESP_REQ_PORT] = g_sNode.sPTPClock.port_id_field >> 8;
+        pcBuf[RESP_REQ_PORT + 1] = g_sNode.sPTPClock.port_id_field & 0xff;
+    }
+
+    HostClockToInternal(g_sNode.sClock.i64Ns + g_i32LatencyNs, &sRxTime);
+    HostNodeDeliver(&g_sNode, psPTP->bEvent, pcBuf, psPTP->ui32Length,
+                    &sRxTime);
+}
+
+//*****************************************************************************
+//
+// Command line handling.
+//
+//*****************************************************************************
+static void
+Usage(const char *pcName)
+{
+    fprintf(stderr,
+        "usage: %s [options] capture\n"
+        "  -s uuid           slave to impersonate (aa:bb:cc:dd:ee:ff); by\n"
+        "                    default the sender of the first Delay_Req\n"
+        "  -o file           write the trajectory CSV to file (default\n"
+        "                    stdout)\n"
+        "  -m                report TIE/MTIE/TDEV/ADEV of the offsets\n"
+        "  --open-loop       timestamp with the raw capture time\n"
+        "  --latency ns      stack latency: added to RX timestamps and used\n"
+        "                    as the inbound/outbound latency (default 0,\n"
+        "                    since capture timestamps are taken on the wire)\n",
+        pcName);
+}
+
+static bool
+ParseArgs(int argc, char *argv[])
+{
+    int iArg;
+
+    for(iArg = 1; iArg < argc; iArg++)
+    {
+        if(!strcmp(argv[iArg], "-s") && ((iArg + 1) < argc))
+        {
+            if(!ParseUUID(argv[++iArg], g_pui8Slave))
+            {
+                return(false);
+            }
+            g_bHaveSlave = true;
+        }
+        else if(!strcmp(argv[iArg], "-o") && ((iArg + 1) < argc))
+        {
+            g_pcOutput = argv[++iArg];
+        }
+        else if(!strcmp(argv[iArg], "-m"))
+        {
+            g_bMetrics = true;
+        }
+        else if(!strcmp(argv[iArg], "--open-loop"))
+        {
+            g_bOpenLoop = true;
+        }
+        else if(!strcmp(argv[iArg], "--latency") && ((iArg + 1) < argc))
+        {
+            g_i32LatencyNs = atoi(argv[++iArg]);
+        }
+        else if((argv[iArg][0] != '-') && !g_pcCapture)
+        {
+            g_pcCapture = argv[iArg];
+        }
+        else
+        {
+            return(false);
+        }
+    }
+
+    return(g_pcCapture != NULL);
+}
+
+//*****************************************************************************
+//
+// Replay entry point.
+//
+//*****************************************************************************
+int
+main(int argc, char *argv[])
+{
+    static const uint8_t pui8DefaultUUID[PTP_UUID_LENGTH] =
+        { 0x00, 0x1a, 0xb6, 0xff, 0xff, 0xff };
+    tCapture sCapture;
+    tCapturePTP sPTP;
+    tMetrics sMetrics;
+
+    if(!ParseArgs(argc, argv))
+    {
+        Usage(argv[0]);
+        return(1);
+    }
+
+    if(!g_bHaveSlave && !FindSlave())
+    {
+        fprintf(stderr, "%s: cannot read capture\n", g_pcCapture);
+        return(1);
+    }
+    if(!g_bHaveSlave)
+    {
+        fprintf(stderr, "warning: no Delay_Req in capture, path delay will "
+                "not be measured\n");
+    }
+
+    if(!CaptureOpen(&sCapture, g_pcCapture))
+    {
+        fprintf(stderr, "%s: cannot read capture\n", g_pcCapture);
+        return(1);
+    }
+
+    g_pfOut = stdout;
+    if(g_pcOutput)
+    {
+        g_pfOut = fopen(g_pcOutput, "w");
+        if(g_pfOut == NULL)
+        {
+            perror(g_pcOutput);
+            return(1);
+        }
+    }
+    fprintf(g_pfOut, "t_s,sync_seq,ofm_s,ofm_ns,owd_ns,observed_drift,"
+                     "adj_ppb,step,state\n");
+
+    //
+    // The node is slave-only, like the boards the captures come from, and
+    // its latency compensation matches the timestamps it will be given.
+    //
+    HostNodeInit(&g_sNode, g_bHaveSlave ? g_pui8Slave : pui8DefaultUUID,
+                 true);
+    g_sNode.pfnTx = NULL;
+    g_sNode.bLoopback = false;
+    g_sNode.sRtOpts.inboundLatency.nanoseconds = g_i32LatencyNs;
+    g_sNode.sRtOpts.outboundLatency.nanoseconds = g_i32LatencyNs;
+
+    while(CaptureNextPTP(&sCapture, &sPTP))
+    {
+        if(!IsPTPv1(&sPTP))
+        {
+            continue;
+        }
+
+        //
+        // Start the node's clock at the first message's capture time.
+        //
+        if(!g_bStarted)
+        {
+            g_bStarted = true;
+            g_i64FirstNs = sPTP.i64TimeNs;
+            g_i64LastNs = sPTP.i64TimeNs;
+            HostClockInit(&g_sNode.sClock, sPTP.i64TimeNs, 0.0);
+            HostNodeStart(&g_sNode);
+        }
+
+        AdvanceTo(sPTP.i64TimeNs);
+        Replay(&sPTP);
+        RunNode(sPTP.i64TimeNs);
+    }
+
+    printf("# frames=%u ptp=%u sync=%u delay_req=%u followup=%u "
+           "delay_resp=%u management=%u injected=%u skipped=%u dropped=%u "
+           "updates=%u steps=%u duration_s=%.3f observed_drift=%d "
+           "state=%d\n", sCapture.ui32Frames, sCapture.ui32PTPFrames,
+           g_pui32Control[PTP_SYNC_MESSAGE],
+           g_pui32Control[PTP_DELAY_REQ_MESSAGE],
+           g_pui32Control[PTP_FOLLOWUP_MESSAGE],
+           g_pui32Control[PTP_DELAY_RESP_MESSAGE],
+           g_pui32Control[PTP_MANAGEMENT_MESSAGE], g_ui32Injected,
+           g_ui32Skipped, g_sNode.ui32RxDropped, g_ui32Updates,
+           g_sNode.sClock.ui32SetCount,
+           (double)(g_i64LastNs - g_i64FirstNs) / 1e9,
+           g_sNode.sPTPClock.observed_drift, g_sNode.sPTPClock.port_state);
+
+    //
+    // The updates follow the Syncs, so their mean spacing is used as the
+    // sampling interval; lost Syncs make this an approximation.
+    //
+    if(g_bMetrics && (g_ui32Offsets > 1) &&
+       MetricsInit(&sMetrics, g_pdOffset, g_ui32Offsets,
+                   (double)(g_i64OffsetLastNs - g_i64OffsetFirstNs) /
+                   (1e9 * (double)(g_ui32Offsets - 1))))
+    {
+        MetricsReport(stdout, &sMetrics, "# ");
+        MetricsFree(&sMetrics);
+    }
+    free(g_pdOffset);
+
+    CaptureClose(&sCapture);
+    if(g_pfOut != stdout)
+    {
+        fclose(g_pfOut);
+    }
+
+    return(0);
+}
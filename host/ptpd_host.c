@@ -0,0 +1,643 @@
+//*****************************************************************************
+//
+// ptpd_host.c - POSIX shim that runs the PTPd engine on a Linux host.
+//
+//*****************************************************************************
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "hotpath.h"
+#include "ptpd_host.h"
+#include "telemetry.h"
+
+//*****************************************************************************
+//
+// The node whose clock is used by getTime(), setTime() and adjFreq().  The
+// PTPd engine calls these without any context, so the driver program selects
+// a node before running its protocol engine.
+//
+//*****************************************************************************
+static tHostNode *g_psHostNode;
+
+//*****************************************************************************
+//
+// Recover the node that owns a NetPath.
+//
+//*****************************************************************************
+static tHostNode *
+HostNodeFromNetPath(NetPath *psNetPath)
+{
+    return((tHostNode *)((char *)psNetPath -
+                         offsetof(tHostNode, sPTPClock.netPath)));
+}
+
+//*****************************************************************************
+//
+// Return a packet to the pool of its owning node.
+//
+//*****************************************************************************
+static void
+HostPacketFree(tHostNode *psNode, tHostPacket *psPacket)
+{
+    psPacket->psNext = psNode->psFree;
+    psNode->psFree = psPacket;
+}
+
+//*****************************************************************************
+//
+// Remove the oldest packet from a NetPath queue, or return NULL if the queue
+// is empty.
+//
+//*****************************************************************************
+static tHostPacket *
+HostQueueGet(BufQueue *psQueue)
+{
+    tHostPacket *psPacket;
+
+    if(psQueue->count == 0)
+    {
+        return(NULL);
+    }
+
+    psPacket = psQueue->pbuf[psQueue->get];
+    psQueue->get = (psQueue->get + 1) % PBUF_QUEUE_SIZE;
+    psQueue->count--;
+
+    return(psPacket);
+}
+
+//*****************************************************************************
+//
+// Append a packet to a NetPath queue.  Returns false if the queue is full.
+//
+//*****************************************************************************
+static bool
+HostQueuePut(BufQueue *psQueue, tHostPacket *psPacket)
+{
+    if(psQueue->count >= PBUF_QUEUE_SIZE)
+    {
+        return(false);
+    }
+
+    psQueue->pbuf[psQueue->put] = psPacket;
+    psQueue->put = (psQueue->put + 1) % PBUF_QUEUE_SIZE;
+    psQueue->count++;
+
+    return(true);
+}
+
+//*****************************************************************************
+//
+// Discard everything waiting in a NetPath queue.
+//
+//*****************************************************************************
+static void
+HostQueueFlush(tHostNode *psNode, BufQueue *psQueue)
+{
+    tHostPacket *psPacket;
+
+    while((psPacket = HostQueueGet(psQueue)) != NULL)
+    {
+        HostPacketFree(psNode, psPacket);
+    }
+
+    psQueue->get = 0;
+    psQueue->put = 0;
+}
+
+//*****************************************************************************
+//
+// Convert a nanosecond count into PTPd internal time.  Both fields carry the
+// sign of the input, matching the convention used by normalizeTime().
+//
+//*****************************************************************************
+void
+HostClockToInternal(int64_t i64Ns, TimeInternal *psTime)
+{
+    psTime->seconds = (Integer32)(i64Ns / 1000000000);
+    psTime->nanoseconds = (Integer32)(i64Ns % 1000000000);
+}
+
+//*****************************************************************************
+//
+// Convert PTPd internal time into a nanosecond count.
+//
+//*****************************************************************************
+int64_t
+HostInternalToNs(const TimeInternal *psTime)
+{
+    return(((int64_t)psTime->seconds * 1000000000) + psTime->nanoseconds);
+}
+
+//*****************************************************************************
+//
+// Initialize a host clock to a given reading and oscillator error.
+//
+//*****************************************************************************
+void
+HostClockInit(tHostClock *psClock, int64_t i64Ns, double dOscPpb)
+{
+    memset(psClock, 0, sizeof(*psClock));
+    psClock->i64Ns = i64Ns;
+    psClock->dOscPpb = dOscPpb;
+}
+
+//*****************************************************************************
+//
+// Advance a host clock by an interval of true time.  The clock moves by that
+// interval scaled by its oscillator error plus the current adjFreq() request.
+//
+//*****************************************************************************
+void
+HostClockAdvance(tHostClock *psClock, int64_t i64TrueNs)
+{
+    double dNs;
+    int64_t i64Whole;
+
+    dNs = ((double)i64TrueNs *
+           (1.0 + ((psClock->dOscPpb + psClock->i32AdjPpb) / 1e9))) +
+          psClock->dFracNs;
+    i64Whole = (int64_t)dNs;
+    if((double)i64Whole > dNs)
+    {
+        i64Whole--;
+    }
+
+    psClock->dFracNs = dNs - (double)i64Whole;
+    psClock->i64Ns += i64Whole;
+}
+
+//*****************************************************************************
+//
+// Return the timer tick time of the selected node, which is the time its
+// timer wheel runs on.
+//
+//*****************************************************************************
+static uint32_t
+HostNodeNow(void)
+{
+    return(g_psHostNode->ui32TimerMs);
+}
+
+//*****************************************************************************
+//
+// Return the timer wheel of the selected node (the host equivalent of the
+// one in enet_lwip.c).
+//
+//*****************************************************************************
+tWheel *
+timerWheel(void)
+{
+    return(&g_psHostNode->sWheel);
+}
+
+//*****************************************************************************
+//
+// Note that one of the selected node's interval timers has expired, so that
+// the driver program runs its protocol engine (the host equivalent of the
+// one in enet_lwip.c).
+//
+//*****************************************************************************
+void
+timerWake(void)
+{
+    g_psHostNode->bWake = true;
+}
+
+//*****************************************************************************
+//
+// Initialize a host node with the same run-time options that ptpd_init() in
+// enet_lwip.c uses on the target.
+//
+//*****************************************************************************
+void
+HostNodeInit(tHostNode *psNode, const uint8_t *pui8UUID, bool bSlaveOnly)
+{
+    RunTimeOpts *psRtOpts;
+    tHostNode *psPrev;
+    int iIdx;
+
+    memset(psNode, 0, sizeof(*psNode));
+    psRtOpts = &psNode->sRtOpts;
+
+    //
+    // The wheel reads the node's time as it starts, so the node must be
+    // selected while it does.
+    //
+    psPrev = g_psHostNode;
+    g_psHostNode = psNode;
+    WheelInit(&psNode->sWheel, HostNodeNow);
+    g_psHostNode = psPrev;
+
+    psRtOpts->syncInterval = DEFAULT_SYNC_INTERVAL;
+    memcpy(psRtOpts->subdomainName, DEFAULT_PTP_DOMAIN_NAME,
+           PTP_SUBDOMAIN_NAME_LENGTH);
+    memcpy(psRtOpts->clockIdentifier, IDENTIFIER_DFLT, PTP_CODE_STRING_LENGTH);
+    psRtOpts->clockVariance = (UInteger32)DEFAULT_CLOCK_VARIANCE;
+    psRtOpts->clockStratum = DEFAULT_CLOCK_STRATUM;
+    psRtOpts->clockPreferred = FALSE;
+    psRtOpts->currentUtcOffset = DEFAULT_UTC_OFFSET;
+    psRtOpts->epochNumber = 0;
+    memcpy(psRtOpts->ifaceName, "LMI", strlen("LMI"));
+    psRtOpts->noResetClock = DEFAULT_NO_RESET_CLOCK;
+    psRtOpts->noAdjust = FALSE;
+    psRtOpts->displayStats = FALSE;
+    psRtOpts->csvStats = FALSE;
+    psRtOpts->unicastAddress[0] = 0;
+    psRtOpts->ap = SCHEDULED_GAIN;
+    psRtOpts->ai = SCHEDULED_GAIN;
+    psRtOpts->s = DEFAULT_DELAY_S;
+    psRtOpts->stepThreshold = DEFAULT_STEP_THRESHOLD;
+    psRtOpts->slewThreshold = DEFAULT_SLEW_THRESHOLD;
+    psRtOpts->slewWindow = DEFAULT_SLEW_WINDOW;
+    psRtOpts->slewMax = DEFAULT_SLEW_MAX;
+    psRtOpts->holdoverWindow = DEFAULT_HOLDOVER_WINDOW;
+    psRtOpts->holdoverDriftRate = DEFAULT_HOLDOVER_DRIFT_RATE;
+    psRtOpts->servo = DEFAULT_SERVO;
+    psRtOpts->freqFirst = DEFAULT_FREQ_FIRST;
+    psRtOpts->pdvFilter = DEFAULT_PDV_FILTER;
+    psRtOpts->pdvGate = DEFAULT_PDV_GATE;
+    psRtOpts->delayReqAdapt = DEFAULT_DELAY_REQ_ADAPT;
+    psRtOpts->delayReqMin = DEFAULT_DELAY_REQ_MIN;
+    psRtOpts->delayReqMax = DEFAULT_DELAY_REQ_MAX;
+    psRtOpts->delayReqNoise = DEFAULT_DELAY_REQ_NOISE;
+    psRtOpts->delayReqLimit = DEFAULT_DELAY_REQ_LIMIT;
+    psRtOpts->ptpVersion = DEFAULT_PTP_VERSION;
+    psRtOpts->domainNumber = DEFAULT_DOMAIN_NUMBER;
+    psRtOpts->priority1 = DEFAULT_PRIORITY1;
+    psRtOpts->priority2 = DEFAULT_PRIORITY2;
+    psRtOpts->announceInterval = DEFAULT_ANNOUNCE_INTERVAL;
+    psRtOpts->announceReceiptTimeout = DEFAULT_ANNOUNCE_RECEIPT_TIMEOUT;
+    psRtOpts->delayReqInterval = DEFAULT_DELAY_REQ_INTERVAL;
+    psRtOpts->twoStep = FALSE;
+    psRtOpts->inboundLatency.seconds = 0;
+    psRtOpts->inboundLatency.nanoseconds = DEFAULT_INBOUND_LATENCY;
+    psRtOpts->outboundLatency.seconds = 0;
+    psRtOpts->outboundLatency.nanoseconds = DEFAULT_OUTBOUND_LATENCY;
+    psRtOpts->max_foreign_records = DEFAULT_MAX_FOREIGN_RECORDS;
+    psRtOpts->slaveOnly = bSlaveOnly ? TRUE : FALSE;
+    psRtOpts->probe = FALSE;
+    psRtOpts->probe_management_key = 0;
+    psRtOpts->probe_record_key = 0;
+    psRtOpts->halfEpoch = FALSE;
+
+    psNode->sPTPClock.foreign = &psNode->psForeignMasterRec[0];
+    psNode->sPTPClock.port_communication_technology = PTP_ETHER;
+    memcpy(psNode->sPTPClock.port_uuid_field, pui8UUID, PTP_UUID_LENGTH);
+
+    psNode->bLoopback = true;
+
+    for(iIdx = 0; iIdx < HOST_PACKET_POOL_SIZE; iIdx++)
+    {
+        HostPacketFree(psNode, &psNode->psPacket[iIdx]);
+    }
+}
+
+//*****************************************************************************
+//
+// Make a node the target of subsequent getTime(), setTime() and adjFreq()
+// calls.
+//
+//*****************************************************************************
+void
+HostNodeSelect(tHostNode *psNode)
+{
+    g_psHostNode = psNode;
+}
+
+//*****************************************************************************
+//
+// Return the currently selected node.
+//
+//*****************************************************************************
+tHostNode *
+HostNodeCurrent(void)
+{
+    return(g_psHostNode);
+}
+
+//*****************************************************************************
+//
+// Run the protocol engine for the first time to initialize the state machines
+// (the host equivalent of the tail of ptpd_init()).
+//
+//*****************************************************************************
+void
+HostNodeStart(tHostNode *psNode)
+{
+    HostNodeSelect(psNode);
+    protocol_first(&psNode->sRtOpts, &psNode->sPTPClock);
+}
+
+//*****************************************************************************
+//
+// Account for timer ticks on a node, running the node's interval timers that
+// come due.  On the target this is the timer job.  A driver program runs the
+// node's protocol engine when this leaves bWake set.
+//
+//*****************************************************************************
+void
+HostNodeTick(tHostNode *psNode, uint32_t ui32Ms)
+{
+    tHostNode *psPrev;
+
+    psPrev = g_psHostNode;
+    g_psHostNode = psNode;
+    psNode->ui32TimerMs += ui32Ms;
+    WheelAdvance(&psNode->sWheel, psNode->ui32TimerMs);
+    g_psHostNode = psPrev;
+}
+
+//*****************************************************************************
+//
+// Run one pass of the protocol engine for a node (the host equivalent of
+// ptpd_tick()).
+//
+//*****************************************************************************
+void
+HostNodeRun(tHostNode *psNode)
+{
+    HostNodeSelect(psNode);
+    psNode->bWake = false;
+
+    HOTPATH_ENTER(HOTPATH_PROTOCOL_LOOP);
+    protocol_loop(&psNode->sRtOpts, &psNode->sPTPClock);
+    HOTPATH_EXIT(HOTPATH_PROTOCOL_LOOP);
+}
+
+//*****************************************************************************
+//
+// Place a received message into a node's event or general queue.  Returns
+// false if the message was dropped because the queue or pool was exhausted.
+//
+//*****************************************************************************
+bool
+HostNodeDeliver(tHostNode *psNode, bool bEvent, const Octet *pcData,
+                uint32_t ui32Length, const TimeInternal *psRxTime)
+{
+    tHostPacket *psPacket;
+    BufQueue *psQueue;
+
+    psQueue = bEvent ? &psNode->sPTPClock.netPath.eventQ :
+                       &psNode->sPTPClock.netPath.generalQ;
+    psPacket = psNode->psFree;
+    if((psPacket == NULL) || (psQueue->count >= PBUF_QUEUE_SIZE) ||
+       (ui32Length > PACKET_SIZE))
+    {
+        psNode->ui32RxDropped++;
+        return(false);
+    }
+    psNode->psFree = psPacket->psNext;
+
+    memcpy(psPacket->pcData, pcData, ui32Length);
+    psPacket->ui32Length = ui32Length;
+    if(psRxTime)
+    {
+        psPacket->sRxTime = *psRxTime;
+    }
+    else
+    {
+        psPacket->sRxTime.seconds = 0;
+        psPacket->sRxTime.nanoseconds = 0;
+    }
+
+    HostQueuePut(psQueue, psPacket);
+
+    return(true);
+}
+
+//*****************************************************************************
+//
+// Transmit a message from a node: timestamp it, hand it to the driver and
+// loop it back into the node's own queue if enabled.
+//
+//*****************************************************************************
+static size_t
+HostNodeSend(tHostNode *psNode, bool bEvent, Octet *pcBuf,
+             UInteger16 ui16Length)
+{
+    TimeInternal sTxTime;
+
+    HostClockToInternal(psNode->sClock.i64Ns, &sTxTime);
+
+    if(bEvent)
+    {
+        psNode->ui32TxEvent++;
+    }
+    else
+    {
+        psNode->ui32TxGeneral++;
+    }
+
+    if(psNode->pfnTx)
+    {
+        psNode->pfnTx(psNode, bEvent, pcBuf, ui16Length, &sTxTime);
+    }
+
+    if(psNode->bLoopback)
+    {
+        HostNodeDeliver(psNode, bEvent, pcBuf, ui16Length, &sTxTime);
+    }
+
+    return(ui16Length);
+}
+
+//*****************************************************************************
+//
+// PTPd network hooks, normally provided by utils/ptpdlib.c on top of lwIP.
+//
+//*****************************************************************************
+Boolean
+netInit(NetPath *psNetPath, RunTimeOpts *psRtOpts, PtpClock *psPTPClock)
+{
+    tHostNode *psNode;
+
+    psNode = HostNodeFromNetPath(psNetPath);
+    HostQueueFlush(psNode, &psNetPath->eventQ);
+    HostQueueFlush(psNode, &psNetPath->generalQ);
+
+    return(TRUE);
+}
+
+Boolean
+netShutdown(NetPath *psNetPath)
+{
+    tHostNode *psNode;
+
+    psNode = HostNodeFromNetPath(psNetPath);
+    HostQueueFlush(psNode, &psNetPath->eventQ);
+    HostQueueFlush(psNode, &psNetPath->generalQ);
+
+    return(TRUE);
+}
+
+int
+netSelect(TimeInternal *psTimeout, NetPath *psNetPath)
+{
+    return((psNetPath->eventQ.count + psNetPath->generalQ.count) ? 1 : 0);
+}
+
+size_t
+netRecvEvent(Octet *pcBuf, TimeInternal *psTime, NetPath *psNetPath)
+{
+    tHostNode *psNode;
+    tHostPacket *psPacket;
+    uint32_t ui32Length;
+
+    psPacket = HostQueueGet(&psNetPath->eventQ);
+    if(psPacket == NULL)
+    {
+        return(0);
+    }
+
+    psNode = HostNodeFromNetPath(psNetPath);
+    ui32Length = psPacket->ui32Length;
+    memcpy(pcBuf, psPacket->pcData, ui32Length);
+    *psTime = psPacket->sRxTime;
+    HostPacketFree(psNode, psPacket);
+    psNode->ui32RxEvent++;
+
+    return(ui32Length);
+}
+
+size_t
+netRecvGeneral(Octet *pcBuf, NetPath *psNetPath)
+{
+    tHostNode *psNode;
+    tHostPacket *psPacket;
+    uint32_t ui32Length;
+
+    psPacket = HostQueueGet(&psNetPath->generalQ);
+    if(psPacket == NULL)
+    {
+        return(0);
+    }
+
+    psNode = HostNodeFromNetPath(psNetPath);
+    ui32Length = psPacket->ui32Length;
+    memcpy(pcBuf, psPacket->pcData, ui32Length);
+    HostPacketFree(psNode, psPacket);
+    psNode->ui32RxGeneral++;
+
+    return(ui32Length);
+}
+
+size_t
+netSendEvent(Octet *pcBuf, UInteger16 ui16Length, NetPath *psNetPath)
+{
+    return(HostNodeSend(HostNodeFromNetPath(psNetPath), true, pcBuf,
+                        ui16Length));
+}
+
+size_t
+netSendGeneral(Octet *pcBuf, UInteger16 ui16Length, NetPath *psNetPath)
+{
+    return(HostNodeSend(HostNodeFromNetPath(psNetPath), false, pcBuf,
+                        ui16Length));
+}
+
+//*****************************************************************************
+//
+// PTPd system hooks, provided by enet_lwip.c on the target.
+//
+//*****************************************************************************
+void
+getTime(TimeInternal *psTime)
+{
+    uint32_t ui32Seconds;
+    uint32_t ui32Nanoseconds;
+
+    HOTPATH_ENTER(HOTPATH_GETTIME);
+    g_sClockSim.pfnGetTime(&ui32Seconds, &ui32Nanoseconds);
+    psTime->seconds = (Integer32)ui32Seconds;
+    psTime->nanoseconds = (Integer32)ui32Nanoseconds;
+    HOTPATH_EXIT(HOTPATH_GETTIME);
+}
+
+void
+setTime(TimeInternal *psTime)
+{
+    g_sClockSim.pfnSetTime(psTime->seconds, psTime->nanoseconds);
+}
+
+Boolean
+adjFreq(Integer32 i32Adj)
+{
+    //
+    // Apply the same limits as the target implementation.
+    //
+    if(i32Adj > ADJ_MAX)
+    {
+        i32Adj = ADJ_MAX;
+    }
+    else if(i32Adj < -ADJ_MAX)
+    {
+        i32Adj = -ADJ_MAX;
+    }
+
+    g_sClockSim.pfnAdjFreq(i32Adj);
+
+    return(TRUE);
+}
+
+Boolean
+loadSnapshot(ServoSnapshot *psSnapshot)
+{
+    if(!g_psHostNode->bSnapshot)
+    {
+        return(FALSE);
+    }
+
+    *psSnapshot = g_psHostNode->sSnapshot;
+
+    return(TRUE);
+}
+
+void
+saveSnapshot(ServoSnapshot *psSnapshot)
+{
+    g_psHostNode->sSnapshot = *psSnapshot;
+    g_psHostNode->bSnapshot = true;
+    g_psHostNode->ui32SnapshotSaves++;
+}
+
+UInteger16
+getRand(UInteger32 *pui32Seed)
+{
+    //
+    // The same generator as getRand() on the target, kept in the caller's
+    // seed, so that runs are reproducible.
+    //
+    *pui32Seed = (*pui32Seed * 1664525) + 1013904223;
+
+    return((UInteger16)(*pui32Seed >> 16));
+}
+
+//
+// As on the target, one telemetry sample per call; the simulations leave
+// displayStats off, and bench_telemetry times it.
+//
+void
+displayStats(RunTimeOpts *psRtOpts, PtpClock *psPTPClock)
+{
+    volatile tTelemetrySample *psSample;
+    TimeInternal sSent;
+
+    subTime(&sSent, &psPTPClock->sync_receive_time,
+            &psPTPClock->master_to_slave_delay);
+
+    psSample = TelemetryClaim();
+    psSample->ui32T1Sec = sSent.seconds;
+    psSample->ui32T1NSec = sSent.nanoseconds;
+    psSample->ui32T2Sec = psPTPClock->sync_receive_time.seconds;
+    psSample->ui32T2NSec = psPTPClock->sync_receive_time.nanoseconds;
+    psSample->i32Offset = psPTPClock->offset_from_master.nanoseconds;
+    psSample->i32Delay = psPTPClock->one_way_delay.nanoseconds;
+    psSample->i32Adj = psPTPClock->rate.adj;
+    psSample->i32Drift = psPTPClock->observed_drift;
+    psSample->ui16SyncSeq = psPTPClock->parent_last_sync_sequence_number;
+    psSample->ui8State = psPTPClock->port_state;
+    TelemetryCommit(psSample);
+}
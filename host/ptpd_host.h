@@ -0,0 +1,220 @@
+//*****************************************************************************
+//
+// ptpd_host.h - POSIX shim that runs the PTPd engine on a Linux host.
+//
+// The PTPd sources under third_party/ptpd-1.1.0/src are compiled unmodified.
+// This module supplies the platform hooks that enet_lwip.c and the TivaWare
+// ptpdlib normally provide on the target: getTime(), setTime(), adjFreq(),
+// getRand(), displayStats(), the warm-start snapshot store and the net*()
+// packet I/O functions.
+//
+//*****************************************************************************
+
+#ifndef __PTPD_HOST_H__
+#define __PTPD_HOST_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "ptpd.h"
+#include "clock_ops.h"
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+//*****************************************************************************
+//
+// The number of packet buffers owned by each host node.  Each NetPath queue
+// holds at most PBUF_QUEUE_SIZE packets, so this covers both queues.
+//
+//*****************************************************************************
+#define HOST_PACKET_POOL_SIZE   (2 * PBUF_QUEUE_SIZE)
+
+//*****************************************************************************
+//
+// A received packet waiting in one of the NetPath event/general queues.  The
+// queues hold pointers to these in place of the lwIP pbufs used on target.
+//
+//*****************************************************************************
+typedef struct tHostPacket
+{
+    //
+    // The raw PTP message.
+    //
+    Octet pcData[PACKET_SIZE];
+
+    //
+    // The number of valid bytes in pcData.
+    //
+    uint32_t ui32Length;
+
+    //
+    // The receive timestamp (event messages only).
+    //
+    TimeInternal sRxTime;
+
+    //
+    // Link to the next free packet in the owning node's pool.
+    //
+    struct tHostPacket *psNext;
+}
+tHostPacket;
+
+//*****************************************************************************
+//
+// The local clock of a host node.  The clock is advanced explicitly by the
+// driver program in units of true (reference) time and runs fast or slow by
+// the sum of the oscillator error and the last adjFreq() request.
+//
+//*****************************************************************************
+typedef struct
+{
+    //
+    // The current reading of the clock in nanoseconds.
+    //
+    int64_t i64Ns;
+
+    //
+    // Fraction of a nanosecond carried between calls to HostClockAdvance().
+    //
+    double dFracNs;
+
+    //
+    // The free-running frequency error of the oscillator in ppb.
+    //
+    double dOscPpb;
+
+    //
+    // The frequency adjustment last requested through adjFreq(), in ppb.
+    //
+    Integer32 i32AdjPpb;
+
+    //
+    // The number of setTime() and adjFreq() calls made against this clock.
+    //
+    uint32_t ui32SetCount;
+    uint32_t ui32AdjCount;
+}
+tHostClock;
+
+//*****************************************************************************
+//
+// The prototype for the function called whenever a node transmits a message.
+// bEvent is true for the event (319) port and false for the general (320)
+// port.  psTxTime is the transmit timestamp taken from the node's clock.
+//
+//*****************************************************************************
+struct tHostNode;
+typedef void (*tHostTxHandler)(struct tHostNode *psNode, bool bEvent,
+                               const Octet *pcData, uint32_t ui32Length,
+                               const TimeInternal *psTxTime);
+
+//*****************************************************************************
+//
+// One PTP port running on the host, with everything enet_lwip.c allocates
+// statically on the target.
+//
+//*****************************************************************************
+typedef struct tHostNode
+{
+    //
+    // The PTPd protocol state and run-time options for this node.
+    //
+    PtpClock sPTPClock;
+    RunTimeOpts sRtOpts;
+    ForeignMasterRecord psForeignMasterRec[DEFAULT_MAX_FOREIGN_RECORDS];
+
+    //
+    // The clock read and steered by getTime(), setTime() and adjFreq().
+    //
+    tHostClock sClock;
+
+    //
+    // Transmit hook, application data for it, and whether transmitted
+    // messages are looped back into the node's own receive queues the way
+    // multicast loopback delivers them on the target.
+    //
+    tHostTxHandler pfnTx;
+    void *pvTxData;
+    bool bLoopback;
+
+    //
+    // The timer wheel that this node's PTPd interval timers run on, the
+    // node's time in milliseconds of timer ticks, and whether an interval
+    // timer has expired since the protocol engine last ran.
+    //
+    tWheel sWheel;
+    uint32_t ui32TimerMs;
+    bool bWake;
+
+    //
+    // The node's warm-start snapshot store, in place of the EEPROM, whether
+    // it holds a snapshot, and the number saved.  A driver that restarts a
+    // node carries these over HostNodeInit() to model a reboot.
+    //
+    ServoSnapshot sSnapshot;
+    bool bSnapshot;
+    uint32_t ui32SnapshotSaves;
+
+    //
+    // The packet pool backing the NetPath queues.
+    //
+    tHostPacket *psFree;
+    tHostPacket psPacket[HOST_PACKET_POOL_SIZE];
+
+    //
+    // Packet counters.
+    //
+    uint32_t ui32TxEvent;
+    uint32_t ui32TxGeneral;
+    uint32_t ui32RxEvent;
+    uint32_t ui32RxGeneral;
+    uint32_t ui32RxDropped;
+}
+tHostNode;
+
+//*****************************************************************************
+//
+// The clock source used by getTime(), setTime() and adjFreq() on the host,
+// which operates on the clock of the selected node.
+//
+//*****************************************************************************
+extern const tClockOps g_sClockSim;
+
+//*****************************************************************************
+//
+// Prototypes.
+//
+//*****************************************************************************
+extern void HostNodeInit(tHostNode *psNode, const uint8_t *pui8UUID,
+                         bool bSlaveOnly);
+extern void HostNodeSelect(tHostNode *psNode);
+extern tHostNode *HostNodeCurrent(void);
+extern void HostNodeStart(tHostNode *psNode);
+extern void HostNodeRun(tHostNode *psNode);
+extern void HostNodeTick(tHostNode *psNode, uint32_t ui32Ms);
+extern bool HostNodeDeliver(tHostNode *psNode, bool bEvent,
+                            const Octet *pcData, uint32_t ui32Length,
+                            const TimeInternal *psRxTime);
+extern void HostClockInit(tHostClock *psClock, int64_t i64Ns, double dOscPpb);
+extern void HostClockAdvance(tHostClock *psClock, int64_t i64TrueNs);
+extern void HostClockToInternal(int64_t i64Ns, TimeInternal *psTime);
+extern int64_t HostInternalToNs(const TimeInternal *psTime);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __PTPD_HOST_H__
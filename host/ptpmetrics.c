@@ -0,0 +1,197 @@
+//*****************************************************************************
+//
+// ptpmetrics.c - Compute TIE, MTIE, TDEV and Allan deviation for an offset
+// series.
+//
+// The input is text with one sample per line, either a bare number or a
+// comma or whitespace separated record from which one column is taken (such
+// as the CSV traces written by ptpsim and ptp_replay).  Blank lines, comment
+// lines starting with '#' and lines whose column does not parse as a number,
+// such as CSV headers, are skipped.  Samples are time errors in nanoseconds,
+// spaced tau0 seconds apart.
+//
+//     ptpmetrics [-t tau0] [-c column] [-s skip] [-k scale] [file]
+//
+//*****************************************************************************
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "clock_metrics.h"
+
+//*****************************************************************************
+//
+// Return the text of column iColumn (0 based) of a record, or NULL.
+//
+//*****************************************************************************
+static char *
+FindColumn(char *pcLine, int iColumn)
+{
+    while(iColumn--)
+    {
+        pcLine = strpbrk(pcLine, ", \t");
+        if(pcLine == NULL)
+        {
+            return(NULL);
+        }
+        pcLine += strspn(pcLine, ", \t");
+    }
+
+    return(pcLine);
+}
+
+//*****************************************************************************
+//
+// Read the samples from a file.  Returns the number read, with *ppdX set to
+// a malloc()ed array of them, or 0 on error.
+//
+//*****************************************************************************
+static uint32_t
+ReadSamples(FILE *pfIn, int iColumn, double dScale, double **ppdX)
+{
+    char pcLine[1024], *pcField, *pcEnd;
+    double *pdX, *pdGrow, dValue;
+    uint32_t ui32Count, ui32Size;
+
+    ui32Count = 0;
+    ui32Size = 1 << 20;
+    pdX = malloc(ui32Size * sizeof(double));
+    if(pdX == NULL)
+    {
+        return(0);
+    }
+
+    while(fgets(pcLine, sizeof(pcLine), pfIn))
+    {
+        pcField = pcLine + strspn(pcLine, " \t");
+        if((*pcField == '#') || (*pcField == '\n') || (*pcField == '\0'))
+        {
+            continue;
+        }
+        pcField = FindColumn(pcField, iColumn);
+        if(pcField == NULL)
+        {
+            continue;
+        }
+        dValue = strtod(pcField, &pcEnd);
+        if(pcEnd == pcField)
+        {
+            continue;
+        }
+
+        if(ui32Count == ui32Size)
+        {
+            ui32Size *= 2;
+            pdGrow = realloc(pdX, ui32Size * sizeof(double));
+            if(pdGrow == NULL)
+            {
+                free(pdX);
+                return(0);
+            }
+            pdX = pdGrow;
+        }
+        pdX[ui32Count++] = dValue * dScale;
+    }
+
+    *ppdX = pdX;
+
+    return(ui32Count);
+}
+
+//*****************************************************************************
+//
+// Entry point.
+//
+//*****************************************************************************
+int
+main(int argc, char *argv[])
+{
+    const char *pcFile;
+    FILE *pfIn;
+    tMetrics sMetrics;
+    double *pdX, dTau0, dScale;
+    uint32_t ui32Count, ui32Skip;
+    int iArg, iColumn;
+
+    dTau0 = 1.0;
+    dScale = 1.0;
+    iColumn = 0;
+    ui32Skip = 0;
+    pcFile = NULL;
+
+    for(iArg = 1; iArg < argc; iArg++)
+    {
+        if(!strcmp(argv[iArg], "-t") && ((iArg + 1) < argc))
+        {
+            dTau0 = atof(argv[++iArg]);
+        }
+        else if(!strcmp(argv[iArg], "-c") && ((iArg + 1) < argc))
+        {
+            iColumn = atoi(argv[++iArg]);
+        }
+        else if(!strcmp(argv[iArg], "-s") && ((iArg + 1) < argc))
+        {
+            ui32Skip = (uint32_t)strtoul(argv[++iArg], NULL, 0);
+        }
+        else if(!strcmp(argv[iArg], "-k") && ((iArg + 1) < argc))
+        {
+            dScale = atof(argv[++iArg]);
+        }
+        else if((argv[iArg][0] != '-') && !pcFile)
+        {
+            pcFile = argv[iArg];
+        }
+        else
+        {
+            fprintf(stderr,
+                "usage: %s [-t tau0] [-c column] [-s skip] [-k scale] [file]\n"
+                "  -t tau0    sample spacing in seconds (default 1)\n"
+                "  -c column  0 based column to read (default 0)\n"
+                "  -s skip    ignore this many leading samples\n"
+                "  -k scale   multiply samples by this to get nanoseconds\n",
+                argv[0]);
+            return(1);
+        }
+    }
+    if((dTau0 <= 0.0) || (iColumn < 0))
+    {
+        fprintf(stderr, "tau0 must be positive and column non-negative\n");
+        return(1);
+    }
+
+    pfIn = stdin;
+    if(pcFile)
+    {
+        pfIn = fopen(pcFile, "r");
+        if(pfIn == NULL)
+        {
+            perror(pcFile);
+            return(1);
+        }
+    }
+
+    ui32Count = ReadSamples(pfIn, iColumn, dScale, &pdX);
+    if(pfIn != stdin)
+    {
+        fclose(pfIn);
+    }
+    if(ui32Count <= ui32Skip)
+    {
+        fprintf(stderr, "not enough samples\n");
+        return(1);
+    }
+
+    if(!MetricsInit(&sMetrics, pdX + ui32Skip, ui32Count - ui32Skip, dTau0))
+    {
+        fprintf(stderr, "out of memory\n");
+        return(1);
+    }
+    free(pdX);
+
+    MetricsReport(stdout, &sMetrics, "");
+    MetricsFree(&sMetrics);
+
+    return(0);
+}
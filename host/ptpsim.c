@@ -0,0 +1,1856 @@
+//*****************************************************************************
+//
+// ptpsim.c - Discrete-event network and clock simulator for the PTPd servo.
+//
+// One master and N slaves run the real protocol.c/ptpd_servo.c code through
+// the host shim.  Each node has a simulated oscillator with an initial
+// offset, a fixed frequency error and a random-walk wander, and each
+// master/slave link has its own delay, queueing jitter, asymmetry and packet
+// loss.  The protocol engines are driven from a time-ordered event queue, so
+// an hour of network time runs in well under a second per slave.
+//
+// At the end of the run each slave's true offset from the master (sampled
+// once a second) is reduced to time-to-lock, steady-state RMS/percentiles and
+// the largest transient after lock, and optionally (-m) to the clock quality
+// metrics of clock_metrics.c over the same steady-state window.  The number
+// of clock steps and of phase slews, and the time spent slewing, show how
+// the slave got there.
+//
+// With --outage the master falls silent part way through the run, and the
+// rest of the run measures each slave in holdover: how far its time has
+// moved since the outage, the bound on that the servo reports, and whether
+// it stayed within the bound.  The steady-state figures then stop at the
+// outage.
+//
+// With --reboot every slave restarts part way through the run, as if power
+// cycled: the protocol engine starts again from nothing and the clock from
+// its initial offset, but the oscillator carries on and so does the
+// warm-start snapshot store, unless --cold clears it.  The time from the
+// restart to lock is then reported for each slave.  The steady-state figures
+// stop at the restart.
+//
+// With --servo the slaves run another of the servo engines in
+// ptpd_servo.c.  The traffic depends only on the seed, so runs with the same
+// seed and options compare the engines on identical network conditions.
+//
+// With --burst each link also carries bursts of cross traffic, such as a web
+// server on the same switch, which delay runs of consecutive messages by
+// tens of microseconds, and --pdv selects the packet delay variation filter
+// the slaves compute their offset and delay through.  The sd_ns figure,
+// the RMS of the offset about its mean, compares them without the steady
+// offset left by software timestamping.
+//
+// From a cold start the slaves measure their frequency error over the first
+// few syncs and start the servo engine from it; --no-freq-first leaves it to
+// the engine to learn, as before.  The freq_lock_s figure, the time until
+// the frequency correction stays within SIM_FREQ_LOCK_PPB of the
+// oscillator's error, compares them.
+//
+// The slaves send Delay_Reqs as often as their delay estimate needs, faster
+// while it settles or on a noisy path; --no-delay-req-adapt sends one every
+// 2 to 29 syncs at random, as before.  Each slave reports the Delay_Reqs it
+// sent per hour, the time for its delay estimate to settle within
+// SIM_DELAY_LOCK_NS of the path's mean delay, and the RMS error of the
+// estimate after lock.  The delay variation filters estimate the delay of
+// the packets that queued least, so with --pdv the error is mostly the mean
+// queueing they leave out.
+//
+// Timestamps are taken in software on the target, so by default the model
+// puts DEFAULT_INBOUND_LATENCY between the wire and the timestamp at each end.
+// Without Follow_Up the Sync origin timestamp is not corrected for the
+// outbound latency, which shows up as a steady offset of about half of it,
+// and in the delay the slaves measure.  --two-step has the master send
+// Follow_Ups, which correct it, so that neither is left; a PTPv2 slave then
+// takes its first offsets from them while it is still uncalibrated.
+//
+//     ptpsim [options]     (ptpsim -h lists them)
+//
+//*****************************************************************************
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "capture.h"
+#include "clock_metrics.h"
+#include "ptpd_host.h"
+
+//*****************************************************************************
+//
+// Simulator limits and defaults.
+//
+//*****************************************************************************
+#define SIM_MAX_SLAVES          64
+#define SIM_TICK_MS             100         // lwIP HOST_TMR_INTERVAL
+#define SIM_SAMPLE_MS           1000
+#define SIM_EPOCH_NS            (1000000000LL * 1000000)
+#define SIM_FREQ_LOCK_PPB       100.0
+#define SIM_DELAY_LOCK_NS       500.0
+
+//*****************************************************************************
+//
+// The kinds of event in the simulation queue.
+//
+//*****************************************************************************
+enum
+{
+    EVENT_TICK,
+    EVENT_TIMER,
+    EVENT_PACKET,
+    EVENT_SAMPLE,
+    EVENT_REBOOT
+};
+
+//*****************************************************************************
+//
+// One scheduled event.
+//
+//*****************************************************************************
+typedef struct
+{
+    int64_t i64Time;
+    uint64_t ui64Seq;
+    int iType;
+    int iNode;
+    bool bEvent;
+    uint32_t ui32Length;
+    Octet pcData[PACKET_SIZE];
+}
+tSimEvent;
+
+//*****************************************************************************
+//
+// Parameters of one direction of a link.
+//
+//*****************************************************************************
+typedef struct
+{
+    double dDelayNs;
+    double dJitterNs;
+    double dLoss;
+
+    //
+    // Bursts of cross traffic: the mean extra queueing delay of a message
+    // sent during one, whether one is in progress, and when it, or the gap
+    // before the next, ends.
+    //
+    double dBurstNs;
+    bool bBurst;
+    int64_t i64BurstEnd;
+
+    //
+    // When the last message sent over the path arrives.  The path is first
+    // in, first out, so nothing sent after it arrives before it.
+    //
+    int64_t i64LastArrival;
+}
+tSimPath;
+
+//*****************************************************************************
+//
+// A simulated node: the PTPd instance, its oscillator and the link that
+// connects it to the master.
+//
+//*****************************************************************************
+typedef struct
+{
+    tHostNode sHost;
+
+    //
+    // True time up to which the node's clock has been advanced.
+    //
+    int64_t i64TrueNs;
+
+    //
+    // True time up to which the node's timer wheel has been advanced, and
+    // the time of the timer event scheduled for its next interval timer, or
+    // -1 if there is none.
+    //
+    int64_t i64TimerNs;
+    int64_t i64WakeNs;
+
+    //
+    // Random-walk frequency wander in ppb per square-root second.
+    //
+    double dWanderPpb;
+
+    //
+    // Master to slave and slave to master paths.
+    //
+    tSimPath sToSlave;
+    tSimPath sToMaster;
+
+    //
+    // The true offset from the master, sampled once a second.
+    //
+    double *pdOffset;
+    uint32_t ui32Samples;
+
+    //
+    // The servo's frequency estimate less the oscillator's true frequency
+    // error, sampled with the offset.
+    //
+    double *pdFreqErr;
+
+    //
+    // The one-way delay estimate less the path's true mean one-way delay,
+    // sampled with the offset.
+    //
+    double *pdDelayErr;
+
+    //
+    // Statistics.
+    //
+    uint32_t ui32Lost;
+    uint32_t ui32DelayReqs;
+    uint32_t ui32Steps;
+    uint32_t ui32Slews;
+    uint32_t ui32SlewSamples;
+    bool bSlewing;
+    double dDriftPpb;
+
+    //
+    // Holdover: the offset when the master was lost, seconds since then, the
+    // largest time error since and the last, the last bound reported (-1 if
+    // not in holdover), and whether the error ever exceeded the bound.
+    //
+    double dHoldRefNs;
+    uint32_t ui32HoldSamples;
+    double dHoldMaxNs;
+    double dHoldEndNs;
+    Integer32 i32HoldBoundNs;
+    bool bHoldExceeded;
+
+    //
+    // Whether the slave restarted with a warm-start snapshot.
+    //
+    bool bWarm;
+}
+tSimNode;
+
+//*****************************************************************************
+//
+// Simulation configuration, set from the command line.
+//
+//*****************************************************************************
+typedef struct
+{
+    uint32_t ui32Slaves;
+    double dDurationS;
+    uint64_t ui64Seed;
+    double dOffsetNs;
+    double dOffsetSpreadNs;
+    double dDriftPpb;
+    double dDriftSpreadPpb;
+    double dWanderPpb;
+    double dAgingPpb;
+    double dDelayNs;
+    double dJitterNs;
+    double dBurstNs;
+    double dBurstP;
+    double dBurstLenS;
+    double dAsymNs;
+    double dLoss;
+    double dTsResNs;
+    double dStackNs;
+    double dLockNs;
+    Integer8 i8SyncInterval;
+    Integer16 i16Ap;
+    Integer16 i16Ai;
+    Integer16 i16S;
+    Integer32 i32StepNs;
+    Integer32 i32SlewNs;
+    Integer32 i32SlewWindow;
+    Integer32 i32SlewMax;
+    double dOutageS;
+    Integer32 i32HoldoverWindow;
+    bool bHoldoverRate;
+    double dRebootS;
+    bool bCold;
+    bool bNoFreqFirst;
+    bool bNoDelayReqAdapt;
+    UInteger8 ui8DelayReqMin;
+    UInteger8 ui8DelayReqMax;
+    UInteger8 ui8DelayReqLimit;
+    UInteger8 ui8PtpVersion;
+    bool bTwoStep;
+    UInteger8 ui8Servo;
+    UInteger8 ui8Pdv;
+    UInteger8 ui8PdvGate;
+    const char *pcTrace;
+    const char *pcCapture;
+    bool bMetrics;
+}
+tSimConfig;
+
+//*****************************************************************************
+//
+// Simulator state.
+//
+//*****************************************************************************
+static tSimConfig g_sConfig;
+static tSimNode g_psNode[SIM_MAX_SLAVES + 1];
+static uint32_t g_ui32Nodes;
+static tSimEvent *g_psHeap;
+static uint32_t g_ui32HeapCount;
+static uint32_t g_ui32HeapSize;
+static uint64_t g_ui64EventSeq;
+static int64_t g_i64Now;
+static int64_t g_i64FirstSync = -1;
+static uint64_t g_ui64Rng;
+static FILE *g_pfTrace;
+static FILE *g_pfCapture;
+
+//*****************************************************************************
+//
+// The servo engines, by SERVO_*, for --servo and the report.
+//
+//*****************************************************************************
+static const ServoOps *const g_ppsServo[SERVO_COUNT] =
+{
+    &servoPI, &servoLinreg, &servoKalman
+};
+
+//*****************************************************************************
+//
+// The packet delay variation filters, by PDV_*, for --pdv and the report.
+//
+//*****************************************************************************
+static const char *const g_ppcPdv[PDV_COUNT] =
+{
+    "none", "min", "median"
+};
+
+//*****************************************************************************
+//
+// The address each node is given in a recorded capture: 10.0.0.(node + 1).
+//
+//*****************************************************************************
+#define SIM_NODE_ADDR(n)        (0x0a000001 + (n))
+
+//*****************************************************************************
+//
+// Random numbers (xorshift64*), uniform in [0, 1) and normally distributed.
+//
+//*****************************************************************************
+static double
+SimRandUniform(void)
+{
+    g_ui64Rng ^= g_ui64Rng >> 12;
+    g_ui64Rng ^= g_ui64Rng << 25;
+    g_ui64Rng ^= g_ui64Rng >> 27;
+
+    return((double)((g_ui64Rng * 2685821657736338717ULL) >> 11) *
+           (1.0 / 9007199254740992.0));
+}
+
+static double
+SimRandGauss(void)
+{
+    double dU1, dU2;
+
+    do
+    {
+        dU1 = SimRandUniform();
+    }
+    while(dU1 <= 0.0);
+    dU2 = SimRandUniform();
+
+    return(sqrt(-2.0 * log(dU1)) * cos(2.0 * M_PI * dU2));
+}
+
+//*****************************************************************************
+//
+// Event queue (binary min-heap ordered by time, then by insertion order).
+//
+//*****************************************************************************
+static bool
+SimEventBefore(const tSimEvent *psA, const tSimEvent *psB)
+{
+    if(psA->i64Time != psB->i64Time)
+    {
+        return(psA->i64Time < psB->i64Time);
+    }
+
+    return(psA->ui64Seq < psB->ui64Seq);
+}
+
+static tSimEvent *
+SimEventAlloc(int64_t i64Time, int iType, int iNode)
+{
+    tSimEvent *psEvent;
+
+    if(g_ui32HeapCount == g_ui32HeapSize)
+    {
+        g_ui32HeapSize = g_ui32HeapSize ? (g_ui32HeapSize * 2) : 256;
+        g_psHeap = realloc(g_psHeap, g_ui32HeapSize * sizeof(tSimEvent));
+        if(g_psHeap == NULL)
+        {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+
+    psEvent = &g_psHeap[g_ui32HeapCount];
+    psEvent->i64Time = i64Time;
+    psEvent->ui64Seq = g_ui64EventSeq++;
+    psEvent->iType = iType;
+    psEvent->iNode = iNode;
+    psEvent->ui32Length = 0;
+
+    return(psEvent);
+}
+
+static void
+SimEventPush(void)
+{
+    uint32_t ui32Idx, ui32Parent;
+    tSimEvent sTmp;
+
+    ui32Idx = g_ui32HeapCount++;
+    while(ui32Idx)
+    {
+        ui32Parent = (ui32Idx - 1) / 2;
+        if(!SimEventBefore(&g_psHeap[ui32Idx], &g_psHeap[ui32Parent]))
+        {
+            break;
+        }
+        sTmp = g_psHeap[ui32Idx];
+        g_psHeap[ui32Idx] = g_psHeap[ui32Parent];
+        g_psHeap[ui32Parent] = sTmp;
+        ui32Idx = ui32Parent;
+    }
+}
+
+static void
+SimEventPop(tSimEvent *psEvent)
+{
+    uint32_t ui32Idx, ui32Child;
+    tSimEvent sTmp;
+
+    *psEvent = g_psHeap[0];
+    g_psHeap[0] = g_psHeap[--g_ui32HeapCount];
+
+    ui32Idx = 0;
+    for(;;)
+    {
+        ui32Child = (2 * ui32Idx) + 1;
+        if(ui32Child >= g_ui32HeapCount)
+        {
+            break;
+        }
+        if(((ui32Child + 1) < g_ui32HeapCount) &&
+           SimEventBefore(&g_psHeap[ui32Child + 1], &g_psHeap[ui32Child]))
+        {
+            ui32Child++;
+        }
+        if(!SimEventBefore(&g_psHeap[ui32Child], &g_psHeap[ui32Idx]))
+        {
+            break;
+        }
+        sTmp = g_psHeap[ui32Idx];
+        g_psHeap[ui32Idx] = g_psHeap[ui32Child];
+        g_psHeap[ui32Child] = sTmp;
+        ui32Idx = ui32Child;
+    }
+}
+
+//*****************************************************************************
+//
+// Bring a node's clock up to the current simulation time, applying the
+// oscillator wander accumulated over the interval.
+//
+//*****************************************************************************
+static void
+SimNodeAdvance(tSimNode *psNode)
+{
+    int64_t i64Delta;
+
+    i64Delta = g_i64Now - psNode->i64TrueNs;
+    if(i64Delta <= 0)
+    {
+        return;
+    }
+
+    if(psNode->dWanderPpb > 0.0)
+    {
+        psNode->sHost.sClock.dOscPpb += psNode->dWanderPpb *
+                                        sqrt((double)i64Delta / 1e9) *
+                                        SimRandGauss();
+    }
+
+    //
+    // Linear aging, in ppb per hour.
+    //
+    psNode->sHost.sClock.dOscPpb += g_sConfig.dAgingPpb *
+                                    ((double)i64Delta / 3.6e12);
+
+    HostClockAdvance(&psNode->sHost.sClock, i64Delta);
+    psNode->i64TrueNs = g_i64Now;
+}
+
+//*****************************************************************************
+//
+// Bring a node's timer wheel up to the current simulation time in whole
+// milliseconds, running the interval timers that come due.
+//
+//*****************************************************************************
+static void
+SimNodeTimers(tSimNode *psNode)
+{
+    uint32_t ui32Ms;
+
+    ui32Ms = (uint32_t)((g_i64Now - psNode->i64TimerNs) / 1000000);
+    psNode->i64TimerNs += (int64_t)ui32Ms * 1000000;
+    HostNodeTick(&psNode->sHost, ui32Ms);
+}
+
+//*****************************************************************************
+//
+// Schedule a timer event for when the next of a node's interval timers
+// expires, as the wakeup timer is set on the target, unless it expires on a
+// host timer tick, which will run it.  A timer event scheduled before that
+// is no longer the node's next is ignored when it comes.
+//
+//*****************************************************************************
+static void
+SimNodeWake(int iNode)
+{
+    tSimNode *psNode;
+    uint32_t ui32Ms;
+    int64_t i64Wake;
+
+    psNode = &g_psNode[iNode];
+    if(!WheelNextExpiry(&psNode->sHost.sWheel, &ui32Ms) ||
+       ((ui32Ms % SIM_TICK_MS) == 0))
+    {
+        psNode->i64WakeNs = -1;
+        return;
+    }
+
+    i64Wake = psNode->i64TimerNs +
+              ((int64_t)(int32_t)(ui32Ms - psNode->sHost.ui32TimerMs) *
+               1000000);
+    if(i64Wake < g_i64Now)
+    {
+        i64Wake = g_i64Now;
+    }
+
+    if(i64Wake != psNode->i64WakeNs)
+    {
+        psNode->i64WakeNs = i64Wake;
+        SimEventAlloc(i64Wake, EVENT_TIMER, iNode);
+        SimEventPush();
+    }
+}
+
+//*****************************************************************************
+//
+// Run a node's protocol engine until its receive queues are empty, so that
+// looped-back transmissions are processed straight away.
+//
+//*****************************************************************************
+static void
+SimNodeRun(tSimNode *psNode)
+{
+    NetPath *psNetPath;
+    uint32_t ui32SetCount;
+    int iPass;
+
+    SimNodeAdvance(psNode);
+    psNetPath = &psNode->sHost.sPTPClock.netPath;
+    ui32SetCount = psNode->sHost.sClock.ui32SetCount;
+
+    for(iPass = 0; iPass < (2 * PBUF_QUEUE_SIZE); iPass++)
+    {
+        HostNodeRun(&psNode->sHost);
+
+        if((psNetPath->eventQ.count + psNetPath->generalQ.count) == 0)
+        {
+            break;
+        }
+    }
+
+    psNode->ui32Steps += psNode->sHost.sClock.ui32SetCount - ui32SetCount;
+}
+
+//*****************************************************************************
+//
+// Quantize a receive timestamp to the configured timestamp resolution.
+//
+//*****************************************************************************
+static void
+SimTimestamp(tSimNode *psNode, TimeInternal *psTime)
+{
+    int64_t i64Ns, i64Res;
+
+    i64Ns = psNode->sHost.sClock.i64Ns;
+    i64Res = (int64_t)g_sConfig.dTsResNs;
+    if(i64Res > 1)
+    {
+        i64Ns -= i64Ns % i64Res;
+    }
+
+    HostClockToInternal(i64Ns, psTime);
+}
+
+//*****************************************************************************
+//
+// Schedule delivery of a message over one path, unless the path loses it.
+//
+//*****************************************************************************
+static void
+SimSend(tSimNode *psFrom, int iTo, tSimPath *psPath, bool bEvent,
+        const Octet *pcData, uint32_t ui32Length)
+{
+    tSimEvent *psEvent;
+    double dDelay;
+
+    if((psPath->dLoss > 0.0) && (SimRandUniform() < psPath->dLoss))
+    {
+        //
+        // Losses are charged to the slave end of the link.
+        //
+        if(iTo == 0)
+        {
+            psFrom->ui32Lost++;
+        }
+        else
+        {
+            g_psNode[iTo].ui32Lost++;
+        }
+        return;
+    }
+
+    //
+    // The message leaves the sender's stack dStackNs after it was
+    // timestamped and is timestamped dStackNs after it reaches the
+    // receiver, which is the latency DEFAULT_INBOUND_LATENCY and
+    // DEFAULT_OUTBOUND_LATENCY compensate for on the target.  Queueing
+    // jitter is modelled as an exponentially distributed extra
+    // delay, which is always positive like real switch queueing.
+    //
+    dDelay = psPath->dDelayNs + (2.0 * g_sConfig.dStackNs);
+    if(psPath->dJitterNs > 0.0)
+    {
+        dDelay -= psPath->dJitterNs * log(1.0 - SimRandUniform());
+    }
+
+    //
+    // Bursts of cross traffic, such as web pages being served, come and go
+    // with exponentially distributed lengths, busy for a fraction dBurstP
+    // of the time.  A message sent during one queues behind it for an
+    // exponentially distributed time too, so a run of consecutive messages
+    // is delayed far more than the queueing jitter.
+    //
+    if(psPath->dBurstNs > 0.0)
+    {
+        while(psPath->i64BurstEnd <= g_i64Now)
+        {
+            psPath->bBurst = !psPath->bBurst;
+            psPath->i64BurstEnd -= (int64_t)(1e9 * g_sConfig.dBurstLenS *
+                                             (psPath->bBurst ? 1.0 :
+                                              ((1.0 - g_sConfig.dBurstP) /
+                                               g_sConfig.dBurstP)) *
+                                             log(1.0 - SimRandUniform()));
+        }
+        if(psPath->bBurst)
+        {
+            dDelay -= psPath->dBurstNs * log(1.0 - SimRandUniform());
+        }
+    }
+
+    //
+    // A message queues behind the one before it on the path, as a Follow_Up
+    // does behind its Sync, which the master sent in the same instant.
+    //
+    if((g_i64Now + (int64_t)dDelay) <= psPath->i64LastArrival)
+    {
+        dDelay = (double)(psPath->i64LastArrival + 1 - g_i64Now);
+    }
+    psPath->i64LastArrival = g_i64Now + (int64_t)dDelay;
+
+    psEvent = SimEventAlloc(g_i64Now + (int64_t)dDelay, EVENT_PACKET, iTo);
+    psEvent->bEvent = bEvent;
+    psEvent->ui32Length = ui32Length;
+    memcpy(psEvent->pcData, pcData, ui32Length);
+    SimEventPush();
+}
+
+//*****************************************************************************
+//
+// Transmit hook shared by every node.  The master multicasts to all slaves;
+// slaves only need to reach the master.
+//
+//*****************************************************************************
+static void
+SimTx(tHostNode *psHost, bool bEvent, const Octet *pcData,
+      uint32_t ui32Length, const TimeInternal *psTxTime)
+{
+    tSimNode *psFrom;
+    uint32_t ui32Idx;
+
+    psFrom = (tSimNode *)psHost->pvTxData;
+    if(psFrom == &g_psNode[0])
+    {
+        //
+        // After the outage starts, nothing the master sends arrives.
+        //
+        if((g_sConfig.dOutageS > 0.0) &&
+           (g_i64Now >= (int64_t)(g_sConfig.dOutageS * 1e9)))
+        {
+            return;
+        }
+
+        //
+        // The control field is at the same offset, with the same values for
+        // Sync and Delay_Req, in PTPv1 and PTPv2.
+        //
+        if(bEvent && (pcData[32] == PTP_SYNC_MESSAGE) && (g_i64FirstSync < 0))
+        {
+            g_i64FirstSync = g_i64Now;
+        }
+
+        for(ui32Idx = 1; ui32Idx < g_ui32Nodes; ui32Idx++)
+        {
+            SimSend(psFrom, ui32Idx, &g_psNode[ui32Idx].sToSlave, bEvent,
+                    pcData, ui32Length);
+        }
+    }
+    else
+    {
+        //
+        // Slave 1's transmissions are recorded as they reach the wire, with
+        // the master's clock (true time) as the capture clock.
+        //
+        if(g_pfCapture && (psFrom == &g_psNode[1]))
+        {
+            CaptureWrite(g_pfCapture, SIM_EPOCH_NS + g_i64Now +
+                         (int64_t)g_sConfig.dStackNs, bEvent,
+                         SIM_NODE_ADDR(1), (const uint8_t *)pcData,
+                         ui32Length);
+        }
+
+        if(bEvent && (pcData[32] == PTP_DELAY_REQ_MESSAGE))
+        {
+            psFrom->ui32DelayReqs++;
+        }
+
+        SimSend(psFrom, 0, &psFrom->sToMaster, bEvent, pcData, ui32Length);
+    }
+}
+
+//*****************************************************************************
+//
+// Return the one-way delay a slave should measure: the mean of the two
+// paths' mean delays, including the queueing, and the stack latency at each
+// end less the latency compensated for.  The slave's outbound latency is
+// compensated for on the Delay_Req; the master's is only compensated for
+// with --two-step, in the Follow_Up, and without it does not cancel out.
+//
+//*****************************************************************************
+static double
+SimDelayTrue(const tSimNode *psNode)
+{
+    double dDelay;
+
+    dDelay = (psNode->sToSlave.dDelayNs + psNode->sToMaster.dDelayNs +
+              psNode->sToSlave.dJitterNs + psNode->sToMaster.dJitterNs +
+              (g_sConfig.dBurstP * (psNode->sToSlave.dBurstNs +
+                                    psNode->sToMaster.dBurstNs))) / 2.0;
+    dDelay += (2.0 * g_sConfig.dStackNs) -
+              psNode->sHost.sRtOpts.inboundLatency.nanoseconds -
+              (psNode->sHost.sRtOpts.outboundLatency.nanoseconds /
+               (g_sConfig.bTwoStep ? 1.0 : 2.0));
+
+    return(dDelay);
+}
+
+//*****************************************************************************
+//
+// Record every slave's true offset from the master.
+//
+//*****************************************************************************
+static void
+SimSample(void)
+{
+    tSimNode *psMaster, *psSlave;
+    uint32_t ui32Idx;
+    double dOffset;
+
+    psMaster = &g_psNode[0];
+    SimNodeAdvance(psMaster);
+
+    for(ui32Idx = 1; ui32Idx < g_ui32Nodes; ui32Idx++)
+    {
+        psSlave = &g_psNode[ui32Idx];
+        SimNodeAdvance(psSlave);
+        dOffset = (double)(psSlave->sHost.sClock.i64Ns -
+                           psMaster->sHost.sClock.i64Ns);
+        psSlave->pdFreqErr[psSlave->ui32Samples] =
+            (double)psSlave->sHost.sPTPClock.observed_drift -
+            psSlave->sHost.sClock.dOscPpb;
+        psSlave->pdDelayErr[psSlave->ui32Samples] =
+            (double)psSlave->sHost.sPTPClock.one_way_delay.nanoseconds -
+            SimDelayTrue(psSlave);
+        psSlave->pdOffset[psSlave->ui32Samples++] = dOffset;
+
+        if(psSlave->sHost.sPTPClock.slewing)
+        {
+            psSlave->ui32Slews += psSlave->bSlewing ? 0 : 1;
+            psSlave->ui32SlewSamples++;
+        }
+        psSlave->bSlewing = psSlave->sHost.sPTPClock.slewing ? true : false;
+
+        //
+        // The time error in holdover is the drift from the offset the slave
+        // had when the master was lost (averaged over about a minute, to
+        // leave out the queueing jitter), which the slave cannot see.
+        //
+        if((g_sConfig.dOutageS <= 0.0) ||
+           (g_i64Now < (int64_t)(g_sConfig.dOutageS * 1e9)))
+        {
+            psSlave->dHoldRefNs += (dOffset - psSlave->dHoldRefNs) / 64.0;
+        }
+        else
+        {
+            psSlave->ui32HoldSamples++;
+            psSlave->dHoldEndNs = fabs(dOffset - psSlave->dHoldRefNs);
+            if(psSlave->dHoldEndNs > psSlave->dHoldMaxNs)
+            {
+                psSlave->dHoldMaxNs = psSlave->dHoldEndNs;
+            }
+
+            if(psSlave->sHost.sPTPClock.hold.active)
+            {
+                psSlave->i32HoldBoundNs = psSlave->sHost.sPTPClock.hold.bound;
+                if(psSlave->dHoldEndNs > (double)psSlave->i32HoldBoundNs)
+                {
+                    psSlave->bHoldExceeded = true;
+                }
+            }
+            else
+            {
+                psSlave->i32HoldBoundNs = -1;
+            }
+        }
+
+        if(g_pfTrace)
+        {
+            fprintf(g_pfTrace, "%.3f,%u,%.0f,%d,%d,%d,%d,%d,%d,%d\n",
+                    (double)g_i64Now / 1e9, ui32Idx, dOffset,
+                    psSlave->sHost.sPTPClock.offset_from_master.seconds,
+                    psSlave->sHost.sPTPClock.offset_from_master.nanoseconds,
+                    psSlave->sHost.sPTPClock.one_way_delay.nanoseconds,
+                    psSlave->sHost.sPTPClock.observed_drift,
+                    psSlave->sHost.sClock.i32AdjPpb,
+                    psSlave->sHost.sPTPClock.slew_residual,
+                    psSlave->sHost.sPTPClock.hold.active ?
+                    psSlave->sHost.sPTPClock.hold.bound : -1);
+        }
+    }
+}
+
+//*****************************************************************************
+//
+// Sort helper for percentiles.
+//
+//*****************************************************************************
+static int
+SimCompareDouble(const void *pvA, const void *pvB)
+{
+    double dA = *(const double *)pvA, dB = *(const double *)pvB;
+
+    return((dA > dB) - (dA < dB));
+}
+
+static double
+SimPercentile(const double *pdSorted, uint32_t ui32Count, double dPct)
+{
+    uint32_t ui32Idx;
+
+    if(ui32Count == 0)
+    {
+        return(0.0);
+    }
+
+    ui32Idx = (uint32_t)((dPct / 100.0) * (double)(ui32Count - 1) + 0.5);
+
+    return(pdSorted[ui32Idx]);
+}
+
+//*****************************************************************************
+//
+// Return the index of a slave's first sample at or after a time in seconds,
+// or the number of samples if the time is not set or not reached.  Sample k
+// is taken k + 1 sample periods into the run, so a sample taken at the time
+// of a reboot or an outage falls after it.
+//
+//*****************************************************************************
+static uint32_t
+SimSampleAt(const tSimNode *psSlave, double dS)
+{
+    double dSample;
+
+    dSample = ceil(dS * 1000.0 / SIM_SAMPLE_MS) - 1.0;
+    if((dS <= 0.0) || (dSample >= psSlave->ui32Samples))
+    {
+        return(psSlave->ui32Samples);
+    }
+
+    return((uint32_t)dSample);
+}
+
+//*****************************************************************************
+//
+// Return the sample from which a series stays within a threshold up to the
+// end sample, which is the sample after the last one outside it, or the end
+// sample if the series never settles.
+//
+//*****************************************************************************
+static uint32_t
+SimLockSample(const double *pdSamples, uint32_t ui32Start, uint32_t ui32End,
+              double dThreshold)
+{
+    uint32_t ui32Lock, ui32Sample;
+
+    ui32Lock = ui32End;
+    for(ui32Sample = ui32End; ui32Sample > ui32Start; ui32Sample--)
+    {
+        if(fabs(pdSamples[ui32Sample - 1]) > dThreshold)
+        {
+            break;
+        }
+        ui32Lock = ui32Sample - 1;
+    }
+
+    return(ui32Lock);
+}
+
+//*****************************************************************************
+//
+// Reduce a slave's offset samples to lock and accuracy figures and print
+// them.  Returns true if the slave locked.
+//
+//*****************************************************************************
+static bool
+SimReport(uint32_t ui32Idx)
+{
+    tSimNode *psSlave;
+    uint32_t ui32First, ui32End, ui32Lock, ui32Freq, ui32Delay, ui32Count;
+    uint32_t ui32Sample;
+    double *pdAbs, dSum, dSumSq, dMax, dLockS, dFreqS, dMean, dDelayS;
+    double dDelaySq, dHours;
+    tMetrics sMetrics;
+    char pcPrefix[16];
+    bool bLocked;
+
+    psSlave = &g_psNode[ui32Idx];
+
+    //
+    // Locking starts when the master sends its first Sync.
+    //
+    ui32First = (g_i64FirstSync < 0) ? psSlave->ui32Samples :
+                (uint32_t)(g_i64FirstSync / (SIM_SAMPLE_MS * 1000000LL));
+
+    //
+    // Everything from an outage or a restart on is reported separately.
+    //
+    ui32End = SimSampleAt(psSlave, g_sConfig.dOutageS);
+    if(SimSampleAt(psSlave, g_sConfig.dRebootS) < ui32End)
+    {
+        ui32End = SimSampleAt(psSlave, g_sConfig.dRebootS);
+    }
+    if(ui32First > ui32End)
+    {
+        ui32First = ui32End;
+    }
+
+    ui32Lock = SimLockSample(psSlave->pdOffset, ui32First, ui32End,
+                             g_sConfig.dLockNs);
+    bLocked = (ui32Lock < ui32End);
+    dLockS = bLocked ? ((double)(ui32Lock - ui32First) * SIM_SAMPLE_MS /
+                        1000.0) : -1.0;
+
+    //
+    // The time for the frequency estimate to settle, which the fixed offset
+    // left by timestamping in software does not affect.
+    //
+    ui32Freq = SimLockSample(psSlave->pdFreqErr, ui32First, ui32End,
+                             SIM_FREQ_LOCK_PPB);
+    dFreqS = (ui32Freq < ui32End) ?
+             ((double)(ui32Freq - ui32First) * SIM_SAMPLE_MS / 1000.0) : -1.0;
+
+    //
+    // And for the one-way delay estimate to settle, which is how soon the
+    // Delay_Req messages measure it.
+    //
+    ui32Delay = SimLockSample(psSlave->pdDelayErr, ui32First, ui32End,
+                              SIM_DELAY_LOCK_NS);
+    dDelayS = (ui32Delay < ui32End) ?
+              ((double)(ui32Delay - ui32First) * SIM_SAMPLE_MS / 1000.0) :
+              -1.0;
+
+    //
+    // Steady-state statistics cover everything after lock, or the second
+    // half of the run if the slave never locked.
+    //
+    if(!bLocked)
+    {
+        ui32Lock = ui32First + ((ui32End - ui32First) / 2);
+    }
+    ui32Count = ui32End - ui32Lock;
+    pdAbs = malloc((ui32Count + 1) * sizeof(double));
+    dSum = 0.0;
+    dSumSq = 0.0;
+    dDelaySq = 0.0;
+    dMax = 0.0;
+    for(ui32Sample = 0; ui32Sample < ui32Count; ui32Sample++)
+    {
+        dDelaySq += psSlave->pdDelayErr[ui32Lock + ui32Sample] *
+                    psSlave->pdDelayErr[ui32Lock + ui32Sample];
+        dSum += psSlave->pdOffset[ui32Lock + ui32Sample];
+        pdAbs[ui32Sample] = fabs(psSlave->pdOffset[ui32Lock + ui32Sample]);
+        dSumSq += pdAbs[ui32Sample] * pdAbs[ui32Sample];
+        if(pdAbs[ui32Sample] > dMax)
+        {
+            dMax = pdAbs[ui32Sample];
+        }
+    }
+    qsort(pdAbs, ui32Count, sizeof(double), SimCompareDouble);
+    dMean = ui32Count ? (dSum / (double)ui32Count) : 0.0;
+
+    //
+    // Delay_Reqs are counted over the whole run from the first Sync.
+    //
+    dHours = (g_i64FirstSync < 0) ? 0.0 :
+             ((g_sConfig.dDurationS - ((double)g_i64FirstSync / 1e9)) /
+              3600.0);
+
+    printf("slave=%u drift_ppb=%.0f locked=%d time_to_lock_s=%.0f "
+           "rms_ns=%.1f p50_ns=%.0f p95_ns=%.0f p99_ns=%.0f max_ns=%.0f "
+           "steps=%u slews=%u slew_s=%.0f lost=%u state=%d "
+           "freq_lock_s=%.0f sd_ns=%.1f servo_spread_ns=%d servo_state=%s "
+           "servo_transitions=%u pdv_m2s_range_ns=%d pdv_s2m_range_ns=%d "
+           "pdv_rejected=%d delay_reqs_per_hour=%.0f delay_settle_s=%.0f "
+           "delay_err_ns=%.1f\n", ui32Idx,
+           psSlave->dDriftPpb,
+           bLocked, dLockS,
+           ui32Count ? sqrt(dSumSq / (double)ui32Count) : 0.0,
+           SimPercentile(pdAbs, ui32Count, 50.0),
+           SimPercentile(pdAbs, ui32Count, 95.0),
+           SimPercentile(pdAbs, ui32Count, 99.0), dMax, psSlave->ui32Steps,
+           psSlave->ui32Slews,
+           (double)psSlave->ui32SlewSamples * SIM_SAMPLE_MS / 1000.0,
+           psSlave->ui32Lost,
+           psSlave->sHost.sPTPClock.port_state, dFreqS,
+           ui32Count ? sqrt(fmax(dSumSq / (double)ui32Count - dMean * dMean,
+                                 0.0)) : 0.0,
+           psSlave->sHost.sPTPClock.servo_stats.spread,
+           (psSlave->sHost.sPTPClock.servo_stats.state == SERVO_TRACK) ?
+           "track" : "acquire",
+           psSlave->sHost.sPTPClock.servo_stats.transitions,
+           psSlave->sHost.sPTPClock.pdv_filt.m2s.max -
+           psSlave->sHost.sPTPClock.pdv_filt.m2s.min,
+           psSlave->sHost.sPTPClock.pdv_filt.s2m.max -
+           psSlave->sHost.sPTPClock.pdv_filt.s2m.min,
+           psSlave->sHost.sPTPClock.pdv_filt.m2s.rejected +
+           psSlave->sHost.sPTPClock.pdv_filt.s2m.rejected,
+           (dHours > 0.0) ? ((double)psSlave->ui32DelayReqs / dHours) : 0.0,
+           dDelayS,
+           ui32Count ? sqrt(dDelaySq / (double)ui32Count) : 0.0);
+
+    free(pdAbs);
+
+    //
+    // The clock quality metrics use the signed offsets over the same window.
+    //
+    if(g_sConfig.bMetrics && (ui32Count > 1))
+    {
+        if(MetricsInit(&sMetrics, psSlave->pdOffset + ui32Lock, ui32Count,
+                       SIM_SAMPLE_MS / 1000.0))
+        {
+            snprintf(pcPrefix, sizeof(pcPrefix), "slave=%u ", ui32Idx);
+            MetricsReport(stdout, &sMetrics, pcPrefix);
+            MetricsFree(&sMetrics);
+        }
+    }
+
+    return(bLocked);
+}
+
+//*****************************************************************************
+//
+// Print a slave's holdover figures.  Returns true if the true time error
+// stayed within the reported bound throughout.
+//
+//*****************************************************************************
+static bool
+SimReportHoldover(uint32_t ui32Idx)
+{
+    tSimNode *psSlave;
+
+    psSlave = &g_psNode[ui32Idx];
+
+    printf("slave=%u holdover_s=%.0f te_ns=%.0f max_te_ns=%.0f "
+           "bound_ns=%d within_bound=%d\n", ui32Idx,
+           (double)psSlave->ui32HoldSamples * SIM_SAMPLE_MS / 1000.0,
+           psSlave->dHoldEndNs, psSlave->dHoldMaxNs,
+           psSlave->i32HoldBoundNs,
+           ((psSlave->i32HoldBoundNs >= 0) && !psSlave->bHoldExceeded) ?
+           1 : 0);
+
+    return((psSlave->i32HoldBoundNs >= 0) && !psSlave->bHoldExceeded);
+}
+
+//*****************************************************************************
+//
+// Print a slave's time from the restart to lock, and to its frequency
+// estimate settling within SIM_FREQ_LOCK_PPB, up to the outage if there is
+// one after the restart.  Returns the time to lock, or -1 if the slave did
+// not lock again.
+//
+//*****************************************************************************
+static double
+SimReportReboot(uint32_t ui32Idx)
+{
+    tSimNode *psSlave;
+    uint32_t ui32Start, ui32End, ui32Lock, ui32Freq;
+    double dLockS;
+
+    psSlave = &g_psNode[ui32Idx];
+
+    ui32Start = SimSampleAt(psSlave, g_sConfig.dRebootS);
+    ui32End = psSlave->ui32Samples;
+    if(g_sConfig.dOutageS > g_sConfig.dRebootS)
+    {
+        ui32End = SimSampleAt(psSlave, g_sConfig.dOutageS);
+    }
+
+    ui32Lock = SimLockSample(psSlave->pdOffset, ui32Start, ui32End,
+                             g_sConfig.dLockNs);
+    ui32Freq = SimLockSample(psSlave->pdFreqErr, ui32Start, ui32End,
+                             SIM_FREQ_LOCK_PPB);
+    dLockS = (ui32Lock < ui32End) ?
+             ((double)(ui32Lock - ui32Start) * SIM_SAMPLE_MS / 1000.0) : -1.0;
+
+    printf("slave=%u warm=%d reboot_to_lock_s=%.0f reboot_to_freq_s=%.0f "
+           "snapshots=%u\n", ui32Idx, psSlave->bWarm ? 1 : 0, dLockS,
+           (ui32Freq < ui32End) ?
+           ((double)(ui32Freq - ui32Start) * SIM_SAMPLE_MS / 1000.0) : -1.0,
+           psSlave->sHost.ui32SnapshotSaves);
+
+    return(dLockS);
+}
+
+//*****************************************************************************
+//
+// Command line handling.
+//
+//*****************************************************************************
+static void
+SimUsage(const char *pcName)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -n slaves         number of slaves (1..%d, default 1)\n"
+        "  -t seconds        simulated duration (default 3600)\n"
+        "  -S seed           random seed (default 1)\n"
+        "  -o file           write a per-second CSV trace\n"
+        "  -w file           record slave 1's traffic as a pcap capture\n"
+        "  -m                report TIE/MTIE/TDEV/ADEV for each slave\n"
+        "  --offset ns       initial slave offset (default 100000)\n"
+        "  --offset-spread ns  random +/- spread of the initial offset\n"
+        "  --drift ppb       slave oscillator frequency error (default 20000)\n"
+        "  --drift-spread ppb  random +/- spread of the frequency error\n"
+        "  --wander ppb      random-walk wander per sqrt(second)\n"
+        "  --aging ppb       linear frequency aging per hour\n"
+        "  --delay ns        one-way link delay (default 50000)\n"
+        "  --jitter ns       mean exponential queueing delay (default 0)\n"
+        "  --burst ns        mean queueing delay in a cross-traffic burst\n"
+        "  --burst-p p       fraction of the time in a burst (default 0.2)\n"
+        "  --burst-len s     mean length of a burst (default 5)\n"
+        "  --asym ns         master-to-slave minus slave-to-master delay\n"
+        "  --loss p          packet loss probability (0..1)\n"
+        "  --ts-res ns       receive timestamp resolution (default 25)\n"
+        "  --stack ns        software timestamping latency at each end\n"
+        "                    (default %d)\n"
+        "  --lock ns         lock threshold (default 10000)\n"
+        "  --sync-interval n log2 sync interval, -7 to 16 (default %d)\n"
+        "  --ap n, --ai n    fix the PI servo gains, off the schedule\n"
+        "  --s n             override the delay filter stiffness\n"
+        "  --step ns         step offsets of at least this (default %d,\n"
+        "                    0 steps every offset that would be slewed)\n"
+        "  --slew ns         slew offsets of at least this (default %d)\n"
+        "  --slew-window s   time over which to slew an offset (default %d)\n"
+        "  --slew-max ppb    maximum slew rate (default %d)\n"
+        "  --outage s        the master falls silent after this long\n"
+        "  --holdover-window s  holdover averaging block (default %d,\n"
+        "                    0 free-runs after the master is lost)\n"
+        "  --holdover-rate   extrapolate the drift rate in holdover\n"
+        "  --reboot s        restart the slaves after this long\n"
+        "  --cold            restart without the warm-start snapshot\n"
+        "  --no-freq-first   leave the frequency to the servo engine on a\n"
+        "                    cold start, rather than measure it first\n"
+        "  --servo name      servo engine: pi, linreg or kalman (default pi)\n"
+        "  --pdv name        delay variation filter: none, min or median\n"
+        "                    (default none)\n"
+        "  --pdv-gate pct    percentile the median is taken below (default %d)\n"
+        "  --no-delay-req-adapt  send a Delay_Req every 2 to %d syncs at\n"
+        "                    random, rather than as often as the delay needs\n"
+        "  --delay-req-min n, --delay-req-max n  syncs between Delay_Reqs,\n"
+        "                    at most and least often (default %d, %d)\n"
+        "  --delay-req-limit n  most Delay_Reqs a minute to the master\n"
+        "                    (default %d, 0 for no limit)\n"
+        "  --ptp-version n   protocol engine, 1 or 2 (default %d)\n"
+        "  --two-step        the master sends Follow_Ups\n",
+        pcName, SIM_MAX_SLAVES, DEFAULT_INBOUND_LATENCY,
+        DEFAULT_SYNC_INTERVAL, DEFAULT_STEP_THRESHOLD,
+        DEFAULT_SLEW_THRESHOLD, DEFAULT_SLEW_WINDOW, DEFAULT_SLEW_MAX,
+        DEFAULT_HOLDOVER_WINDOW, DEFAULT_PDV_GATE, PTP_DELAY_REQ_INTERVAL - 1,
+        DEFAULT_DELAY_REQ_MIN, DEFAULT_DELAY_REQ_MAX, DEFAULT_DELAY_REQ_LIMIT,
+        DEFAULT_PTP_VERSION);
+}
+
+static bool
+SimParseArgs(int argc, char *argv[])
+{
+    int iArg;
+    const char *pcOpt, *pcVal;
+    UInteger8 ui8Servo, ui8Pdv;
+
+    g_sConfig.ui32Slaves = 1;
+    g_sConfig.dDurationS = 3600.0;
+    g_sConfig.ui64Seed = 1;
+    g_sConfig.dOffsetNs = 100000.0;
+    g_sConfig.dDriftPpb = 20000.0;
+    g_sConfig.dDelayNs = 50000.0;
+    g_sConfig.dTsResNs = 25.0;
+    g_sConfig.dStackNs = DEFAULT_INBOUND_LATENCY;
+    g_sConfig.dLockNs = 10000.0;
+    g_sConfig.i8SyncInterval = DEFAULT_SYNC_INTERVAL;
+    g_sConfig.i32StepNs = DEFAULT_STEP_THRESHOLD;
+    g_sConfig.i32SlewNs = DEFAULT_SLEW_THRESHOLD;
+    g_sConfig.i32SlewWindow = DEFAULT_SLEW_WINDOW;
+    g_sConfig.i32SlewMax = DEFAULT_SLEW_MAX;
+    g_sConfig.i32HoldoverWindow = DEFAULT_HOLDOVER_WINDOW;
+    g_sConfig.bHoldoverRate = DEFAULT_HOLDOVER_DRIFT_RATE;
+    g_sConfig.ui8Servo = DEFAULT_SERVO;
+    g_sConfig.ui8Pdv = DEFAULT_PDV_FILTER;
+    g_sConfig.ui8PdvGate = DEFAULT_PDV_GATE;
+    g_sConfig.ui8DelayReqMin = DEFAULT_DELAY_REQ_MIN;
+    g_sConfig.ui8DelayReqMax = DEFAULT_DELAY_REQ_MAX;
+    g_sConfig.ui8DelayReqLimit = DEFAULT_DELAY_REQ_LIMIT;
+    g_sConfig.ui8PtpVersion = DEFAULT_PTP_VERSION;
+    g_sConfig.dBurstP = 0.2;
+    g_sConfig.dBurstLenS = 5.0;
+
+    for(iArg = 1; iArg < argc; iArg++)
+    {
+        pcOpt = argv[iArg];
+        if(!strcmp(pcOpt, "-m"))
+        {
+            g_sConfig.bMetrics = true;
+            continue;
+        }
+        if(!strcmp(pcOpt, "--holdover-rate"))
+        {
+            g_sConfig.bHoldoverRate = true;
+            continue;
+        }
+        if(!strcmp(pcOpt, "--cold"))
+        {
+            g_sConfig.bCold = true;
+            continue;
+        }
+        if(!strcmp(pcOpt, "--no-freq-first"))
+        {
+            g_sConfig.bNoFreqFirst = true;
+            continue;
+        }
+        if(!strcmp(pcOpt, "--no-delay-req-adapt"))
+        {
+            g_sConfig.bNoDelayReqAdapt = true;
+            continue;
+        }
+        if(!strcmp(pcOpt, "--two-step"))
+        {
+            g_sConfig.bTwoStep = true;
+            continue;
+        }
+        if(!strcmp(pcOpt, "-h") || ((iArg + 1) >= argc))
+        {
+            return(false);
+        }
+        pcVal = argv[++iArg];
+
+        if(!strcmp(pcOpt, "-n"))
+        {
+            g_sConfig.ui32Slaves = (uint32_t)strtoul(pcVal, NULL, 0);
+        }
+        else if(!strcmp(pcOpt, "-t"))
+        {
+            g_sConfig.dDurationS = atof(pcVal);
+        }
+        else if(!strcmp(pcOpt, "-S"))
+        {
+            g_sConfig.ui64Seed = strtoull(pcVal, NULL, 0);
+        }
+        else if(!strcmp(pcOpt, "-o"))
+        {
+            g_sConfig.pcTrace = pcVal;
+        }
+        else if(!strcmp(pcOpt, "-w"))
+        {
+            g_sConfig.pcCapture = pcVal;
+        }
+        else if(!strcmp(pcOpt, "--offset"))
+        {
+            g_sConfig.dOffsetNs = atof(pcVal);
+        }
+        else if(!strcmp(pcOpt, "--offset-spread"))
+        {
+            g_sConfig.dOffsetSpreadNs = atof(pcVal);
+        }
+        else if(!strcmp(pcOpt, "--drift"))
+        {
+            g_sConfig.dDriftPpb = atof(pcVal);
+        }
+        else if(!strcmp(pcOpt, "--drift-spread"))
+        {
+            g_sConfig.dDriftSpreadPpb = atof(pcVal);
+        }
+        else if(!strcmp(pcOpt, "--wander"))
+        {
+            g_sConfig.dWanderPpb = atof(pcVal);
+        }
+        else if(!strcmp(pcOpt, "--aging"))
+        {
+            g_sConfig.dAgingPpb = atof(pcVal);
+        }
+        else if(!strcmp(pcOpt, "--delay"))
+        {
+            g_sConfig.dDelayNs = atof(pcVal);
+        }
+        else if(!strcmp(pcOpt, "--jitter"))
+        {
+            g_sConfig.dJitterNs = atof(pcVal);
+        }
+        else if(!strcmp(pcOpt, "--burst"))
+        {
+            g_sConfig.dBurstNs = atof(pcVal);
+        }
+        else if(!strcmp(pcOpt, "--burst-p"))
+        {
+            g_sConfig.dBurstP = atof(pcVal);
+        }
+        else if(!strcmp(pcOpt, "--burst-len"))
+        {
+            g_sConfig.dBurstLenS = atof(pcVal);
+        }
+        else if(!strcmp(pcOpt, "--asym"))
+        {
+            g_sConfig.dAsymNs = atof(pcVal);
+        }
+        else if(!strcmp(pcOpt, "--loss"))
+        {
+            g_sConfig.dLoss = atof(pcVal);
+        }
+        else if(!strcmp(pcOpt, "--ts-res"))
+        {
+            g_sConfig.dTsResNs = atof(pcVal);
+        }
+        else if(!strcmp(pcOpt, "--stack"))
+        {
+            g_sConfig.dStackNs = atof(pcVal);
+        }
+        else if(!strcmp(pcOpt, "--lock"))
+        {
+            g_sConfig.dLockNs = atof(pcVal);
+        }
+        else if(!strcmp(pcOpt, "--sync-interval"))
+        {
+            g_sConfig.i8SyncInterval = (Integer8)atoi(pcVal);
+        }
+        else if(!strcmp(pcOpt, "--ap"))
+        {
+            g_sConfig.i16Ap = (Integer16)atoi(pcVal);
+        }
+        else if(!strcmp(pcOpt, "--ai"))
+        {
+            g_sConfig.i16Ai = (Integer16)atoi(pcVal);
+        }
+        else if(!strcmp(pcOpt, "--s"))
+        {
+            g_sConfig.i16S = (Integer16)atoi(pcVal);
+        }
+        else if(!strcmp(pcOpt, "--step"))
+        {
+            g_sConfig.i32StepNs = (Integer32)strtol(pcVal, NULL, 0);
+        }
+        else if(!strcmp(pcOpt, "--slew"))
+        {
+            g_sConfig.i32SlewNs = (Integer32)strtol(pcVal, NULL, 0);
+        }
+        else if(!strcmp(pcOpt, "--slew-window"))
+        {
+            g_sConfig.i32SlewWindow = (Integer32)strtol(pcVal, NULL, 0);
+        }
+        else if(!strcmp(pcOpt, "--slew-max"))
+        {
+            g_sConfig.i32SlewMax = (Integer32)strtol(pcVal, NULL, 0);
+        }
+        else if(!strcmp(pcOpt, "--outage"))
+        {
+            g_sConfig.dOutageS = atof(pcVal);
+        }
+        else if(!strcmp(pcOpt, "--holdover-window"))
+        {
+            g_sConfig.i32HoldoverWindow = (Integer32)strtol(pcVal, NULL, 0);
+        }
+        else if(!strcmp(pcOpt, "--reboot"))
+        {
+            g_sConfig.dRebootS = atof(pcVal);
+        }
+        else if(!strcmp(pcOpt, "--servo"))
+        {
+            for(ui8Servo = 0; ui8Servo < SERVO_COUNT; ui8Servo++)
+            {
+                if(!strcmp(pcVal, g_ppsServo[ui8Servo]->name))
+                {
+                    break;
+                }
+            }
+            if(ui8Servo == SERVO_COUNT)
+            {
+                return(false);
+            }
+            g_sConfig.ui8Servo = ui8Servo;
+        }
+        else if(!strcmp(pcOpt, "--pdv"))
+        {
+            for(ui8Pdv = 0; ui8Pdv < PDV_COUNT; ui8Pdv++)
+            {
+                if(!strcmp(pcVal, g_ppcPdv[ui8Pdv]))
+                {
+                    break;
+                }
+            }
+            if(ui8Pdv == PDV_COUNT)
+            {
+                return(false);
+            }
+            g_sConfig.ui8Pdv = ui8Pdv;
+        }
+        else if(!strcmp(pcOpt, "--pdv-gate"))
+        {
+            g_sConfig.ui8PdvGate = (UInteger8)atoi(pcVal);
+        }
+        else if(!strcmp(pcOpt, "--delay-req-min"))
+        {
+            g_sConfig.ui8DelayReqMin = (UInteger8)atoi(pcVal);
+        }
+        else if(!strcmp(pcOpt, "--delay-req-max"))
+        {
+            g_sConfig.ui8DelayReqMax = (UInteger8)atoi(pcVal);
+        }
+        else if(!strcmp(pcOpt, "--delay-req-limit"))
+        {
+            g_sConfig.ui8DelayReqLimit = (UInteger8)atoi(pcVal);
+        }
+        else if(!strcmp(pcOpt, "--ptp-version"))
+        {
+            g_sConfig.ui8PtpVersion = (UInteger8)atoi(pcVal);
+        }
+        else
+        {
+            return(false);
+        }
+    }
+
+    return((g_sConfig.ui32Slaves >= 1) &&
+           (g_sConfig.ui32Slaves <= SIM_MAX_SLAVES) &&
+           (g_sConfig.dDurationS > 0.0) &&
+           (g_sConfig.dBurstP > 0.0) && (g_sConfig.dBurstP < 1.0) &&
+           (g_sConfig.dBurstLenS > 0.0) &&
+           (g_sConfig.ui8PdvGate >= 1) && (g_sConfig.ui8PdvGate <= 100) &&
+           (g_sConfig.i8SyncInterval >= PTP_MIN_LOG_INTERVAL) &&
+           (g_sConfig.i8SyncInterval <= PTP_MAX_LOG_INTERVAL) &&
+           ((g_sConfig.ui8PtpVersion == VERSION_PTP) ||
+            (g_sConfig.ui8PtpVersion == VERSION_PTP_V2)));
+}
+
+//*****************************************************************************
+//
+// Start a node's protocol engine with the configured run-time options.
+//
+//*****************************************************************************
+static void
+SimNodeInit(tSimNode *psNode, const uint8_t *pui8UUID, bool bSlaveOnly)
+{
+    HostNodeInit(&psNode->sHost, pui8UUID, bSlaveOnly);
+    psNode->sHost.pfnTx = SimTx;
+    psNode->sHost.pvTxData = psNode;
+    psNode->sHost.sRtOpts.syncInterval = g_sConfig.i8SyncInterval;
+    psNode->sHost.sRtOpts.ap = g_sConfig.i16Ap;
+    psNode->sHost.sRtOpts.ai = g_sConfig.i16Ai;
+    if(g_sConfig.i16S)
+    {
+        psNode->sHost.sRtOpts.s = g_sConfig.i16S;
+    }
+    psNode->sHost.sRtOpts.stepThreshold = g_sConfig.i32StepNs;
+    psNode->sHost.sRtOpts.slewThreshold = g_sConfig.i32SlewNs;
+    psNode->sHost.sRtOpts.slewWindow = g_sConfig.i32SlewWindow;
+    psNode->sHost.sRtOpts.slewMax = g_sConfig.i32SlewMax;
+    psNode->sHost.sRtOpts.holdoverWindow = g_sConfig.i32HoldoverWindow;
+    psNode->sHost.sRtOpts.holdoverDriftRate =
+        g_sConfig.bHoldoverRate ? TRUE : FALSE;
+    psNode->sHost.sRtOpts.servo = g_sConfig.ui8Servo;
+    if(g_sConfig.bNoFreqFirst)
+    {
+        psNode->sHost.sRtOpts.freqFirst = FALSE;
+    }
+    psNode->sHost.sRtOpts.pdvFilter = g_sConfig.ui8Pdv;
+    psNode->sHost.sRtOpts.pdvGate = g_sConfig.ui8PdvGate;
+    if(g_sConfig.bNoDelayReqAdapt)
+    {
+        psNode->sHost.sRtOpts.delayReqAdapt = FALSE;
+    }
+    psNode->sHost.sRtOpts.delayReqMin = g_sConfig.ui8DelayReqMin;
+    psNode->sHost.sRtOpts.delayReqMax = g_sConfig.ui8DelayReqMax;
+    psNode->sHost.sRtOpts.delayReqLimit = g_sConfig.ui8DelayReqLimit;
+    psNode->sHost.sRtOpts.ptpVersion = g_sConfig.ui8PtpVersion;
+    psNode->sHost.sRtOpts.twoStep = g_sConfig.bTwoStep ? TRUE : FALSE;
+}
+
+//*****************************************************************************
+//
+// Restart every slave.  The protocol engine starts again from nothing and
+// the clock from a fresh initial offset, while the oscillator carries on
+// with the error it has wandered to, and the snapshot store is kept unless
+// this is a cold start.
+//
+//*****************************************************************************
+static void
+SimReboot(void)
+{
+    tSimNode *psNode;
+    uint8_t pui8UUID[PTP_UUID_LENGTH];
+    ServoSnapshot sSnapshot;
+    uint32_t ui32Idx, ui32Saves;
+    double dOffset, dOscPpb;
+    bool bSnapshot;
+
+    for(ui32Idx = 1; ui32Idx < g_ui32Nodes; ui32Idx++)
+    {
+        psNode = &g_psNode[ui32Idx];
+        SimNodeAdvance(psNode);
+
+        memcpy(pui8UUID, psNode->sHost.sPTPClock.port_uuid_field,
+               PTP_UUID_LENGTH);
+        sSnapshot = psNode->sHost.sSnapshot;
+        bSnapshot = psNode->sHost.bSnapshot && !g_sConfig.bCold;
+        ui32Saves = psNode->sHost.ui32SnapshotSaves;
+        dOscPpb = psNode->sHost.sClock.dOscPpb;
+
+        SimNodeInit(psNode, pui8UUID, true);
+        psNode->sHost.sSnapshot = sSnapshot;
+        psNode->sHost.bSnapshot = bSnapshot;
+        psNode->sHost.ui32SnapshotSaves = ui32Saves;
+        psNode->bWarm = bSnapshot;
+
+        dOffset = g_sConfig.dOffsetNs + (g_sConfig.dOffsetSpreadNs *
+                                         ((2.0 * SimRandUniform()) - 1.0));
+        HostClockInit(&psNode->sHost.sClock,
+                      SIM_EPOCH_NS + g_i64Now + (int64_t)dOffset, dOscPpb);
+
+        HostNodeStart(&psNode->sHost);
+        SimNodeWake((int)ui32Idx);
+    }
+}
+
+//*****************************************************************************
+//
+// Create the master and slaves and schedule their first events.
+//
+//*****************************************************************************
+static void
+SimSetup(void)
+{
+    tSimNode *psNode;
+    uint8_t pui8UUID[PTP_UUID_LENGTH] = { 0x00, 0x1a, 0xb6, 0x00, 0x00, 0x00 };
+    uint32_t ui32Idx, ui32Samples;
+    double dOffset;
+
+    g_ui32Nodes = g_sConfig.ui32Slaves + 1;
+    ui32Samples = (uint32_t)(g_sConfig.dDurationS * 1000.0 / SIM_SAMPLE_MS) +
+                  2;
+
+    for(ui32Idx = 0; ui32Idx < g_ui32Nodes; ui32Idx++)
+    {
+        psNode = &g_psNode[ui32Idx];
+        pui8UUID[PTP_UUID_LENGTH - 1] = (uint8_t)(ui32Idx + 1);
+
+        SimNodeInit(psNode, pui8UUID, ui32Idx != 0);
+        psNode->i64TrueNs = 0;
+
+        if(ui32Idx == 0)
+        {
+            //
+            // The master is the reference clock.
+            //
+            HostClockInit(&psNode->sHost.sClock, SIM_EPOCH_NS, 0.0);
+        }
+        else
+        {
+            dOffset = g_sConfig.dOffsetNs + (g_sConfig.dOffsetSpreadNs *
+                                             ((2.0 * SimRandUniform()) - 1.0));
+            psNode->dDriftPpb = g_sConfig.dDriftPpb +
+                                (g_sConfig.dDriftSpreadPpb *
+                                 ((2.0 * SimRandUniform()) - 1.0));
+            psNode->dWanderPpb = g_sConfig.dWanderPpb;
+            HostClockInit(&psNode->sHost.sClock,
+                          SIM_EPOCH_NS + (int64_t)dOffset, psNode->dDriftPpb);
+
+            psNode->sToSlave.dDelayNs = g_sConfig.dDelayNs +
+                                        (g_sConfig.dAsymNs / 2.0);
+            psNode->sToMaster.dDelayNs = g_sConfig.dDelayNs -
+                                         (g_sConfig.dAsymNs / 2.0);
+            psNode->sToSlave.dJitterNs = g_sConfig.dJitterNs;
+            psNode->sToMaster.dJitterNs = g_sConfig.dJitterNs;
+            psNode->sToSlave.dBurstNs = g_sConfig.dBurstNs;
+            psNode->sToMaster.dBurstNs = g_sConfig.dBurstNs;
+            psNode->sToSlave.dLoss = g_sConfig.dLoss;
+            psNode->sToMaster.dLoss = g_sConfig.dLoss;
+
+            psNode->pdOffset = malloc(ui32Samples * sizeof(double));
+            psNode->pdFreqErr = malloc(ui32Samples * sizeof(double));
+            psNode->pdDelayErr = malloc(ui32Samples * sizeof(double));
+            if((psNode->pdOffset == NULL) || (psNode->pdFreqErr == NULL) ||
+               (psNode->pdDelayErr == NULL))
+            {
+                fprintf(stderr, "out of memory\n");
+                exit(1);
+            }
+        }
+
+        HostNodeStart(&psNode->sHost);
+
+        //
+        // Stagger the nodes' host timer ticks across the tick period.  The
+        // timer wheel starts a tick before the first.
+        //
+        psNode->i64TimerNs = (int64_t)(SimRandUniform() * SIM_TICK_MS * 1e6);
+        SimEventAlloc(psNode->i64TimerNs, EVENT_TICK, (int)ui32Idx);
+        SimEventPush();
+        psNode->i64TimerNs -= SIM_TICK_MS * 1000000LL;
+        psNode->i64WakeNs = -1;
+        SimNodeWake((int)ui32Idx);
+    }
+
+    SimEventAlloc(SIM_SAMPLE_MS * 1000000LL, EVENT_SAMPLE, 0);
+    SimEventPush();
+
+    if(g_sConfig.dRebootS > 0.0)
+    {
+        SimEventAlloc((int64_t)(g_sConfig.dRebootS * 1e9), EVENT_REBOOT, 0);
+        SimEventPush();
+    }
+}
+
+//*****************************************************************************
+//
+// Simulator entry point.
+//
+//*****************************************************************************
+int
+main(int argc, char *argv[])
+{
+    tSimEvent sEvent;
+    tSimNode *psNode;
+    int64_t i64End;
+    uint32_t ui32Idx, ui32Locked, ui32Within;
+    double dLockS, dSlaveLockS;
+    TimeInternal sRxTime;
+
+    if(!SimParseArgs(argc, argv))
+    {
+        SimUsage(argv[0]);
+        return(1);
+    }
+
+    g_ui64Rng = g_sConfig.ui64Seed ? g_sConfig.ui64Seed : 1;
+    if(g_sConfig.pcTrace)
+    {
+        g_pfTrace = fopen(g_sConfig.pcTrace, "w");
+        if(g_pfTrace == NULL)
+        {
+            perror(g_sConfig.pcTrace);
+            return(1);
+        }
+        fprintf(g_pfTrace, "t_s,slave,true_offset_ns,ofm_s,ofm_ns,"
+                           "owd_ns,observed_drift,adj_ppb,slew_residual_ns,"
+                           "holdover_bound_ns\n");
+    }
+
+    if(g_sConfig.pcCapture)
+    {
+        g_pfCapture = CaptureWriteOpen(g_sConfig.pcCapture);
+        if(g_pfCapture == NULL)
+        {
+            perror(g_sConfig.pcCapture);
+            return(1);
+        }
+    }
+
+    SimSetup();
+
+    //
+    // Run the event loop.
+    //
+    i64End = (int64_t)(g_sConfig.dDurationS * 1e9);
+    while(g_ui32HeapCount && (g_psHeap[0].i64Time <= i64End))
+    {
+        SimEventPop(&sEvent);
+        g_i64Now = sEvent.i64Time;
+        psNode = &g_psNode[sEvent.iNode];
+
+        switch(sEvent.iType)
+        {
+            case EVENT_TICK:
+            {
+                SimNodeTimers(psNode);
+                SimNodeRun(psNode);
+                SimNodeWake(sEvent.iNode);
+                SimEventAlloc(g_i64Now + (SIM_TICK_MS * 1000000LL),
+                              EVENT_TICK, sEvent.iNode);
+                SimEventPush();
+                break;
+            }
+
+            case EVENT_TIMER:
+            {
+                //
+                // The timer job, and the Ethernet job it wakes to run the
+                // protocol engine.
+                //
+                if(g_i64Now != psNode->i64WakeNs)
+                {
+                    break;
+                }
+                psNode->i64WakeNs = -1;
+                SimNodeTimers(psNode);
+                if(psNode->sHost.bWake)
+                {
+                    SimNodeRun(psNode);
+                }
+                SimNodeWake(sEvent.iNode);
+                break;
+            }
+
+            case EVENT_PACKET:
+            {
+                if(g_pfCapture && (sEvent.iNode == 1))
+                {
+                    CaptureWrite(g_pfCapture, SIM_EPOCH_NS + g_i64Now -
+                                 (int64_t)g_sConfig.dStackNs, sEvent.bEvent,
+                                 SIM_NODE_ADDR(0),
+                                 (const uint8_t *)sEvent.pcData,
+                                 sEvent.ui32Length);
+                }
+
+                SimNodeAdvance(psNode);
+                SimTimestamp(psNode, &sRxTime);
+                HostNodeDeliver(&psNode->sHost, sEvent.bEvent, sEvent.pcData,
+                                sEvent.ui32Length, &sRxTime);
+                SimNodeRun(psNode);
+                SimNodeWake(sEvent.iNode);
+                break;
+            }
+
+            case EVENT_SAMPLE:
+            {
+                SimSample();
+                SimEventAlloc(g_i64Now + (SIM_SAMPLE_MS * 1000000LL),
+                              EVENT_SAMPLE, 0);
+                SimEventPush();
+                break;
+            }
+
+            case EVENT_REBOOT:
+            {
+                SimReboot();
+                break;
+            }
+        }
+    }
+
+    //
+    // Report per-slave results and a summary line.
+    //
+    ui32Locked = 0;
+    for(ui32Idx = 1; ui32Idx < g_ui32Nodes; ui32Idx++)
+    {
+        ui32Locked += SimReport(ui32Idx) ? 1 : 0;
+    }
+    printf("# slaves=%u locked=%u duration_s=%.0f first_sync_s=%.1f "
+           "seed=%llu servo=%s pdv=%s pdv_gate=%u freq_first=%d "
+           "delay_req=%s ptp_version=%u two_step=%d\n",
+           g_sConfig.ui32Slaves, ui32Locked, g_sConfig.dDurationS,
+           (double)g_i64FirstSync / 1e9,
+           (unsigned long long)g_sConfig.ui64Seed,
+           g_ppsServo[g_sConfig.ui8Servo]->name, g_ppcPdv[g_sConfig.ui8Pdv],
+           g_sConfig.ui8PdvGate, g_sConfig.bNoFreqFirst ? 0 : 1,
+           g_sConfig.bNoDelayReqAdapt ? "fixed" : "adapt",
+           g_sConfig.ui8PtpVersion, g_sConfig.bTwoStep ? 1 : 0);
+
+    //
+    // The time to lock again, if the slaves were restarted.
+    //
+    if(g_sConfig.dRebootS > 0.0)
+    {
+        ui32Locked = 0;
+        dLockS = 0.0;
+        for(ui32Idx = 1; ui32Idx < g_ui32Nodes; ui32Idx++)
+        {
+            dSlaveLockS = SimReportReboot(ui32Idx);
+            if(dSlaveLockS >= 0.0)
+            {
+                ui32Locked++;
+                dLockS += dSlaveLockS;
+            }
+        }
+        printf("# reboot at_s=%.0f start=%s locked=%u mean_lock_s=%.1f\n",
+               g_sConfig.dRebootS, g_sConfig.bCold ? "cold" : "warm",
+               ui32Locked, ui32Locked ? (dLockS / ui32Locked) : -1.0);
+    }
+
+    //
+    // And the holdover figures, if the master was lost.
+    //
+    if(g_sConfig.dOutageS > 0.0)
+    {
+        ui32Within = 0;
+        for(ui32Idx = 1; ui32Idx < g_ui32Nodes; ui32Idx++)
+        {
+            ui32Within += SimReportHoldover(ui32Idx) ? 1 : 0;
+        }
+        printf("# holdover outage_s=%.0f holdover_min=%.1f within_bound=%u "
+               "result=%s\n", g_sConfig.dOutageS,
+               (g_sConfig.dDurationS - g_sConfig.dOutageS) / 60.0, ui32Within,
+               (ui32Within == g_sConfig.ui32Slaves) ? "pass" : "fail");
+    }
+
+    if(g_pfTrace)
+    {
+        fclose(g_pfTrace);
+    }
+    if(g_pfCapture)
+    {
+        fclose(g_pfCapture);
+    }
+
+    return(0);
+}
@@ -0,0 +1,91 @@
+//*****************************************************************************
+//
+// cc.h - lwIP compiler and platform definitions for the Linux host build.
+//
+// This stands in for ports/tiva-tm4c129/include/arch/cc.h so that the lwIP
+// 1.4.1 core can be compiled with the host compiler.
+//
+//*****************************************************************************
+
+#ifndef __ARCH_CC_H__
+#define __ARCH_CC_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+//*****************************************************************************
+//
+// The host is little endian, like the target.
+//
+//*****************************************************************************
+#ifndef BYTE_ORDER
+#define BYTE_ORDER              LITTLE_ENDIAN
+#endif
+
+//*****************************************************************************
+//
+// Basic types used by lwIP.
+//
+//*****************************************************************************
+typedef uint8_t u8_t;
+typedef int8_t s8_t;
+typedef uint16_t u16_t;
+typedef int16_t s16_t;
+typedef uint32_t u32_t;
+typedef int32_t s32_t;
+typedef uintptr_t mem_ptr_t;
+
+//*****************************************************************************
+//
+// The type returned by sys_arch_protect().  The host build is single
+// threaded, so it is unused.
+//
+//*****************************************************************************
+typedef u32_t sys_prot_t;
+
+//*****************************************************************************
+//
+// printf() formats for the lwIP types.
+//
+//*****************************************************************************
+#define U16_F                   "hu"
+#define S16_F                   "hd"
+#define X16_F                   "hx"
+#define U32_F                   "u"
+#define S32_F                   "d"
+#define X32_F                   "x"
+#define SZT_F                   "zu"
+
+//*****************************************************************************
+//
+// Structure packing.
+//
+//*****************************************************************************
+#define PACK_STRUCT_BEGIN
+#define PACK_STRUCT_STRUCT      __attribute__((packed))
+#define PACK_STRUCT_END
+#define PACK_STRUCT_FIELD(x)    x
+
+//*****************************************************************************
+//
+// Diagnostics and assertions.
+//
+//*****************************************************************************
+#define LWIP_PLATFORM_DIAG(x)                                                 \
+    do                                                                        \
+    {                                                                         \
+        printf x;                                                             \
+    }                                                                         \
+    while(0)
+
+#define LWIP_PLATFORM_ASSERT(x)                                               \
+    do                                                                        \
+    {                                                                         \
+        fprintf(stderr, "lwIP assertion \"%s\" failed at %s:%d\n", x,         \
+                __FILE__, __LINE__);                                          \
+        abort();                                                              \
+    }                                                                         \
+    while(0)
+
+#endif // __ARCH_CC_H__
@@ -0,0 +1,13 @@
+//*****************************************************************************
+//
+// perf.h - lwIP performance measurement hooks for the Linux host build.
+//
+//*****************************************************************************
+
+#ifndef __ARCH_PERF_H__
+#define __ARCH_PERF_H__
+
+#define PERF_START
+#define PERF_STOP(x)
+
+#endif // __ARCH_PERF_H__
@@ -0,0 +1,63 @@
+//*****************************************************************************
+//
+// lwipopts.h - lwIP configuration for the Linux host build of the web server.
+//
+// The application's own lwipopts.h is used unchanged, so the pool and heap
+// sizes under test are the ones the target is built with.  Only the options
+// that depend on the Tiva EMAC are overridden here: the tap device does no
+// checksum offload, and the host build does not run DHCP or AutoIP.
+//
+//*****************************************************************************
+
+#ifndef __HOST_LWIPOPTS_H__
+#define __HOST_LWIPOPTS_H__
+
+#include "../../lwipopts.h"
+
+//*****************************************************************************
+//
+// Checksums are generated and checked in software.
+//
+//*****************************************************************************
+#undef CHECKSUM_GEN_IP
+#undef CHECKSUM_GEN_ICMP
+#undef CHECKSUM_GEN_UDP
+#undef CHECKSUM_GEN_TCP
+#undef CHECKSUM_CHECK_IP
+#undef CHECKSUM_CHECK_UDP
+#undef CHECKSUM_CHECK_TCP
+#define CHECKSUM_GEN_IP                 1
+#define CHECKSUM_GEN_ICMP               1
+#define CHECKSUM_GEN_UDP                1
+#define CHECKSUM_GEN_TCP                1
+#define CHECKSUM_CHECK_IP               1
+#define CHECKSUM_CHECK_UDP              1
+#define CHECKSUM_CHECK_TCP              1
+
+//*****************************************************************************
+//
+// The tap interface is given a static address.
+//
+//*****************************************************************************
+#undef LWIP_DHCP
+#undef LWIP_AUTOIP
+#undef LWIP_DHCP_AUTOIP_COOP
+#define LWIP_DHCP                       0
+#define LWIP_AUTOIP                     0
+#define LWIP_DHCP_AUTOIP_COOP           0
+
+//*****************************************************************************
+//
+// Keep the pool statistics that websrv publishes to the load generator.
+//
+//*****************************************************************************
+#undef LWIP_STATS
+#undef MEM_STATS
+#undef MEMP_STATS
+#undef LINK_STATS
+#define LWIP_STATS                      1
+#define MEM_STATS                       1
+#define MEMP_STATS                      1
+#define LINK_STATS                      1
+
+#endif // __HOST_LWIPOPTS_H__
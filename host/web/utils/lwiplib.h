@@ -0,0 +1,21 @@
+//*****************************************************************************
+//
+// lwiplib.h - Host replacement for the TivaWare lwIP wrapper header.
+//
+// The TivaWare utils/lwiplib.h also declares the Tiva EMAC glue, which has no
+// meaning on the host.  enet_fs.c only needs the lwIP headers it pulls in.
+//
+//*****************************************************************************
+
+#ifndef __LWIPLIB_H__
+#define __LWIPLIB_H__
+
+#include "lwip/opt.h"
+#include "lwip/def.h"
+#include "lwip/mem.h"
+#include "lwip/memp.h"
+#include "lwip/pbuf.h"
+#include "lwip/stats.h"
+#include "lwip/tcp.h"
+
+#endif // __LWIPLIB_H__
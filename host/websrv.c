@@ -0,0 +1,572 @@
+//*****************************************************************************
+//
+// websrv.c - Linux host build of the lwIP web server on a tap interface.
+//
+// httpserver_raw and the application's enet_fs.c run unmodified on the lwIP
+// 1.4.1 core, configured by the application's lwipopts.h, in the same NO_SYS
+// polled arrangement as on the target.  The Ethernet driver is a Linux tap
+// device, and the SD card behind /sd/ is a FAT image file.  This gives the
+// same TCP and HTTP code paths, with the same pool sizes, a network that can
+// be loaded from the host (see httpload.c).
+//
+// lwIP, httpserver_raw and FatFs come from the TivaWare tree named by SW_ROOT
+// in the Makefile.  The tap device is created by the program, but must be
+// configured from the host side, for example:
+//
+//     sudo ip tuntap add dev tap0 mode tap user $USER
+//     sudo ip addr add 192.168.7.1/24 dev tap0
+//     sudo ip link set tap0 up
+//     websrv -i tap0 -a 192.168.7.2 -s websrv.stats
+//     httpload -a 192.168.7.2 -s websrv.stats
+//
+// With -s the lwIP pool statistics are written to a file whenever they
+// change, so that the load generator can report pool exhaustion alongside
+// its own figures.
+//
+//*****************************************************************************
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/if.h>
+#include <linux/if_tun.h>
+#include <sys/ioctl.h>
+#include "lwip/init.h"
+#include "lwip/ip_addr.h"
+#include "lwip/mem.h"
+#include "lwip/memp.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include "lwip/stats.h"
+#include "lwip/timers.h"
+#include "netif/etharp.h"
+#include "httpserver_raw/httpd.h"
+#include "fatfs/src/ff.h"
+#include "fatfs/src/diskio.h"
+#include "enet_fs.h"
+
+//*****************************************************************************
+//
+// The size of the largest Ethernet frame read from the tap device.
+//
+//*****************************************************************************
+#define WEB_FRAME_SIZE          1536
+
+//*****************************************************************************
+//
+// How often the pool statistics file is brought up to date, in milliseconds.
+//
+//*****************************************************************************
+#define WEB_STATS_MS            100
+
+//*****************************************************************************
+//
+// The sector size of the SD card image.
+//
+//*****************************************************************************
+#define WEB_SECTOR_SIZE         512
+
+//*****************************************************************************
+//
+// The names of the memp pools, in MEMP_t order.
+//
+//*****************************************************************************
+static const char *const g_ppcPoolName[MEMP_MAX] =
+{
+#define LWIP_MEMPOOL(name, num, size, desc) #name,
+#include "lwip/memp_std.h"
+};
+
+//*****************************************************************************
+//
+// Program state.
+//
+//*****************************************************************************
+static int g_iTap = -1;
+static int g_iDisk = -1;
+static struct netif g_sNetif;
+static const char *g_pcStats;
+static uint32_t g_ui32StatsHash;
+
+//*****************************************************************************
+//
+// The lwIP time base: milliseconds of monotonic time.
+//
+//*****************************************************************************
+u32_t
+sys_now(void)
+{
+    struct timespec sNow;
+
+    clock_gettime(CLOCK_MONOTONIC, &sNow);
+
+    return((u32_t)((sNow.tv_sec * 1000) + (sNow.tv_nsec / 1000000)));
+}
+
+//*****************************************************************************
+//
+// lwIP critical sections.  Everything runs from the one polling loop, as it
+// does from the Ethernet interrupt on the target, so there is nothing to
+// protect against.
+//
+//*****************************************************************************
+sys_prot_t
+sys_arch_protect(void)
+{
+    return(0);
+}
+
+void
+sys_arch_unprotect(sys_prot_t ui32Level)
+{
+    (void)ui32Level;
+}
+
+//*****************************************************************************
+//
+// The FatFs disk driver, backed by an image file in place of the SPI SD card.
+//
+//*****************************************************************************
+DSTATUS
+disk_initialize(BYTE ui8Drive)
+{
+    return(((ui8Drive == 0) && (g_iDisk >= 0)) ? 0 : STA_NOINIT);
+}
+
+DSTATUS
+disk_status(BYTE ui8Drive)
+{
+    return(((ui8Drive == 0) && (g_iDisk >= 0)) ? 0 : STA_NOINIT);
+}
+
+DRESULT
+disk_read(BYTE ui8Drive, BYTE *pui8Buffer, DWORD ui32Sector, BYTE ui8Count)
+{
+    size_t sSize;
+
+    if((ui8Drive != 0) || (g_iDisk < 0))
+    {
+        return(RES_NOTRDY);
+    }
+
+    sSize = (size_t)ui8Count * WEB_SECTOR_SIZE;
+    if(pread(g_iDisk, pui8Buffer, sSize,
+             (off_t)ui32Sector * WEB_SECTOR_SIZE) != (ssize_t)sSize)
+    {
+        return(RES_ERROR);
+    }
+
+    return(RES_OK);
+}
+
+DRESULT
+disk_write(BYTE ui8Drive, const BYTE *pui8Buffer, DWORD ui32Sector,
+           BYTE ui8Count)
+{
+    size_t sSize;
+
+    if((ui8Drive != 0) || (g_iDisk < 0))
+    {
+        return(RES_NOTRDY);
+    }
+
+    sSize = (size_t)ui8Count * WEB_SECTOR_SIZE;
+    if(pwrite(g_iDisk, pui8Buffer, sSize,
+              (off_t)ui32Sector * WEB_SECTOR_SIZE) != (ssize_t)sSize)
+    {
+        return(RES_ERROR);
+    }
+
+    return(RES_OK);
+}
+
+DRESULT
+disk_ioctl(BYTE ui8Drive, BYTE ui8Control, void *pvBuffer)
+{
+    off_t iSize;
+
+    if((ui8Drive != 0) || (g_iDisk < 0))
+    {
+        return(RES_NOTRDY);
+    }
+
+    switch(ui8Control)
+    {
+        case CTRL_SYNC:
+        {
+            return(RES_OK);
+        }
+
+        case GET_SECTOR_COUNT:
+        {
+            iSize = lseek(g_iDisk, 0, SEEK_END);
+            if(iSize < 0)
+            {
+                return(RES_ERROR);
+            }
+            *(DWORD *)pvBuffer = (DWORD)(iSize / WEB_SECTOR_SIZE);
+            return(RES_OK);
+        }
+
+        case GET_SECTOR_SIZE:
+        {
+            *(WORD *)pvBuffer = WEB_SECTOR_SIZE;
+            return(RES_OK);
+        }
+
+        case GET_BLOCK_SIZE:
+        {
+            *(DWORD *)pvBuffer = 1;
+            return(RES_OK);
+        }
+
+        default:
+        {
+            return(RES_PARERR);
+        }
+    }
+}
+
+void
+disk_timerproc(void)
+{
+}
+
+DWORD
+get_fattime(void)
+{
+    time_t iNow;
+    struct tm *psNow;
+
+    iNow = time(NULL);
+    psNow = localtime(&iNow);
+
+    return(((DWORD)(psNow->tm_year - 80) << 25) |
+           ((DWORD)(psNow->tm_mon + 1) << 21) |
+           ((DWORD)psNow->tm_mday << 16) | ((DWORD)psNow->tm_hour << 11) |
+           ((DWORD)psNow->tm_min << 5) | ((DWORD)psNow->tm_sec >> 1));
+}
+
+//*****************************************************************************
+//
+// Send a frame on the tap device.
+//
+//*****************************************************************************
+static err_t
+TapLinkOutput(struct netif *psNetif, struct pbuf *psBuf)
+{
+    uint8_t pui8Frame[WEB_FRAME_SIZE];
+    u16_t ui16Length;
+
+    (void)psNetif;
+
+    ui16Length = pbuf_copy_partial(psBuf, pui8Frame, sizeof(pui8Frame), 0);
+    if(write(g_iTap, pui8Frame, ui16Length) != ui16Length)
+    {
+        LINK_STATS_INC(link.drop);
+        return(ERR_IF);
+    }
+    LINK_STATS_INC(link.xmit);
+
+    return(ERR_OK);
+}
+
+//*****************************************************************************
+//
+// Read every frame waiting on the tap device into a pool pbuf and pass it to
+// lwIP, as the Ethernet interrupt handler does on the target.  When the pbuf
+// pool is exhausted the frame is dropped, again as on the target.
+//
+//*****************************************************************************
+static void
+TapInput(void)
+{
+    uint8_t pui8Frame[WEB_FRAME_SIZE];
+    struct pbuf *psBuf;
+    ssize_t iLength;
+
+    while((iLength = read(g_iTap, pui8Frame, sizeof(pui8Frame))) > 0)
+    {
+        LINK_STATS_INC(link.recv);
+        psBuf = pbuf_alloc(PBUF_RAW, (u16_t)iLength, PBUF_POOL);
+        if(psBuf == NULL)
+        {
+            LINK_STATS_INC(link.memerr);
+            LINK_STATS_INC(link.drop);
+            continue;
+        }
+        pbuf_take(psBuf, pui8Frame, (u16_t)iLength);
+        if(g_sNetif.input(psBuf, &g_sNetif) != ERR_OK)
+        {
+            pbuf_free(psBuf);
+        }
+    }
+}
+
+//*****************************************************************************
+//
+// Initialize the tap network interface.
+//
+//*****************************************************************************
+static err_t
+TapNetifInit(struct netif *psNetif)
+{
+    static const uint8_t pui8MAC[6] = { 0x02, 0x1a, 0xb6, 0x00, 0x00, 0x01 };
+
+    psNetif->name[0] = 't';
+    psNetif->name[1] = 'p';
+    psNetif->output = etharp_output;
+    psNetif->linkoutput = TapLinkOutput;
+    psNetif->mtu = 1500;
+    psNetif->hwaddr_len = ETHARP_HWADDR_LEN;
+    memcpy(psNetif->hwaddr, pui8MAC, ETHARP_HWADDR_LEN);
+    psNetif->flags = (NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP |
+                      NETIF_FLAG_LINK_UP);
+
+    return(ERR_OK);
+}
+
+//*****************************************************************************
+//
+// Attach to the named tap device.  Returns the file descriptor, or -1.
+//
+//*****************************************************************************
+static int
+TapOpen(const char *pcName)
+{
+    struct ifreq sReq;
+    int iFd;
+
+    iFd = open("/dev/net/tun", O_RDWR | O_NONBLOCK);
+    if(iFd < 0)
+    {
+        perror("/dev/net/tun");
+        return(-1);
+    }
+
+    memset(&sReq, 0, sizeof(sReq));
+    sReq.ifr_flags = IFF_TAP | IFF_NO_PI;
+    strncpy(sReq.ifr_name, pcName, IFNAMSIZ - 1);
+    if(ioctl(iFd, TUNSETIFF, &sReq) < 0)
+    {
+        perror(pcName);
+        close(iFd);
+        return(-1);
+    }
+
+    return(iFd);
+}
+
+//*****************************************************************************
+//
+// Write the lwIP heap and pool statistics to the statistics file, one line
+// per pool, if they have changed since the last write.  The file is replaced
+// atomically so that a reader never sees a partial update.
+//
+//*****************************************************************************
+static void
+StatsWrite(void)
+{
+    char pcTemp[256];
+    struct stats_mem *psMem;
+    uint32_t ui32Hash, ui32Pool;
+    FILE *pfOut;
+
+    //
+    // Skip the write if nothing has changed.
+    //
+    ui32Hash = 2166136261u;
+    for(ui32Pool = 0; ui32Pool <= MEMP_MAX; ui32Pool++)
+    {
+        psMem = (ui32Pool < MEMP_MAX) ? &lwip_stats.memp[ui32Pool] :
+                &lwip_stats.mem;
+        ui32Hash = (ui32Hash ^ psMem->used) * 16777619u;
+        ui32Hash = (ui32Hash ^ psMem->max) * 16777619u;
+        ui32Hash = (ui32Hash ^ psMem->err) * 16777619u;
+    }
+    ui32Hash = (ui32Hash ^ lwip_stats.link.drop) * 16777619u;
+    if(ui32Hash == g_ui32StatsHash)
+    {
+        return;
+    }
+    g_ui32StatsHash = ui32Hash;
+
+    snprintf(pcTemp, sizeof(pcTemp), "%s.tmp", g_pcStats);
+    pfOut = fopen(pcTemp, "w");
+    if(pfOut == NULL)
+    {
+        return;
+    }
+
+    fprintf(pfOut, "pool=HEAP avail=%u used=%u max=%u err=%u\n",
+            (unsigned)lwip_stats.mem.avail, (unsigned)lwip_stats.mem.used,
+            (unsigned)lwip_stats.mem.max, (unsigned)lwip_stats.mem.err);
+    for(ui32Pool = 0; ui32Pool < MEMP_MAX; ui32Pool++)
+    {
+        psMem = &lwip_stats.memp[ui32Pool];
+        fprintf(pfOut, "pool=%s avail=%u used=%u max=%u err=%u\n",
+                g_ppcPoolName[ui32Pool], (unsigned)psMem->avail,
+                (unsigned)psMem->used, (unsigned)psMem->max,
+                (unsigned)psMem->err);
+    }
+    fprintf(pfOut, "pool=LINK avail=0 used=0 max=0 err=%u\n",
+            (unsigned)lwip_stats.link.drop);
+    fclose(pfOut);
+
+    rename(pcTemp, g_pcStats);
+}
+
+//*****************************************************************************
+//
+// Command line handling.
+//
+//*****************************************************************************
+static void
+Usage(const char *pcName)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -i tap        tap device to attach to (default tap0)\n"
+        "  -a addr       IPv4 address (default 192.168.7.2)\n"
+        "  -m mask       netmask (default 255.255.255.0)\n"
+        "  -g addr       gateway (default 192.168.7.1)\n"
+        "  -d image      FAT image to serve as /sd/\n"
+        "  -s file       write lwIP pool statistics to file\n", pcName);
+}
+
+//*****************************************************************************
+//
+// Web server entry point.
+//
+//*****************************************************************************
+int
+main(int argc, char *argv[])
+{
+    const char *pcTap, *pcAddr, *pcMask, *pcGw, *pcDisk;
+    ip_addr_t sAddr, sMask, sGw;
+    struct pollfd sPoll;
+    uint32_t ui32Last, ui32Now, ui32LastStats;
+    int iArg;
+
+    pcTap = "tap0";
+    pcAddr = "192.168.7.2";
+    pcMask = "255.255.255.0";
+    pcGw = "192.168.7.1";
+    pcDisk = NULL;
+
+    for(iArg = 1; iArg < argc; iArg++)
+    {
+        if(!strcmp(argv[iArg], "-i") && ((iArg + 1) < argc))
+        {
+            pcTap = argv[++iArg];
+        }
+        else if(!strcmp(argv[iArg], "-a") && ((iArg + 1) < argc))
+        {
+            pcAddr = argv[++iArg];
+        }
+        else if(!strcmp(argv[iArg], "-m") && ((iArg + 1) < argc))
+        {
+            pcMask = argv[++iArg];
+        }
+        else if(!strcmp(argv[iArg], "-g") && ((iArg + 1) < argc))
+        {
+            pcGw = argv[++iArg];
+        }
+        else if(!strcmp(argv[iArg], "-d") && ((iArg + 1) < argc))
+        {
+            pcDisk = argv[++iArg];
+        }
+        else if(!strcmp(argv[iArg], "-s") && ((iArg + 1) < argc))
+        {
+            g_pcStats = argv[++iArg];
+        }
+        else
+        {
+            Usage(argv[0]);
+            return(1);
+        }
+    }
+
+    if(!ipaddr_aton(pcAddr, &sAddr) || !ipaddr_aton(pcMask, &sMask) ||
+       !ipaddr_aton(pcGw, &sGw))
+    {
+        fprintf(stderr, "bad IPv4 address\n");
+        return(1);
+    }
+
+    if(pcDisk)
+    {
+        g_iDisk = open(pcDisk, O_RDWR);
+        if(g_iDisk < 0)
+        {
+            perror(pcDisk);
+            return(1);
+        }
+    }
+
+    g_iTap = TapOpen(pcTap);
+    if(g_iTap < 0)
+    {
+        return(1);
+    }
+
+    //
+    // Bring up lwIP, the file system and the web server in the order
+    // enet_lwip.c uses on the target.
+    //
+    lwip_init();
+    netif_add(&g_sNetif, &sAddr, &sMask, &sGw, NULL, TapNetifInit,
+              ethernet_input);
+    netif_set_default(&g_sNetif);
+    netif_set_up(&g_sNetif);
+    fs_init();
+    httpd_init();
+
+    printf("# websrv on %s at %s, MEMP_NUM_TCP_PCB=%d PBUF_POOL_SIZE=%d "
+           "MEM_SIZE=%d\n", pcTap, pcAddr, MEMP_NUM_TCP_PCB, PBUF_POOL_SIZE,
+           MEM_SIZE);
+    fflush(stdout);
+
+    sPoll.fd = g_iTap;
+    sPoll.events = POLLIN;
+    ui32Last = sys_now();
+    ui32LastStats = ui32Last;
+
+    while(1)
+    {
+        if((poll(&sPoll, 1, 10) < 0) && (errno != EINTR))
+        {
+            perror("poll");
+            return(1);
+        }
+        if(sPoll.revents & POLLIN)
+        {
+            TapInput();
+        }
+
+        sys_check_timeouts();
+
+        //
+        // The FatFs timer runs from the system tick on the target.
+        //
+        ui32Now = sys_now();
+        if(ui32Now != ui32Last)
+        {
+            fs_tick(ui32Now - ui32Last);
+            ui32Last = ui32Now;
+        }
+
+        if(g_pcStats && ((ui32Now - ui32LastStats) >= WEB_STATS_MS))
+        {
+            ui32LastStats = ui32Now;
+            StatsWrite();
+        }
+    }
+}
@@ -0,0 +1,586 @@
+//*****************************************************************************
+//
+// hotpath.c - Cycle-count instrumentation of the interrupt handlers and PTPd
+// entry points.
+//
+//*****************************************************************************
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#ifdef HOTPATH_HOST
+#include <stdio.h>
+#include <time.h>
+#else
+#include "inc/hw_types.h"
+#include "driverlib/cpu.h"
+#include "utils/uartstdio.h"
+#include "utils/ustdlib.h"
+#endif
+#include "hotpath.h"
+
+//*****************************************************************************
+//
+// Platform hooks: the cycle counter, its rate, a critical section, count
+// leading zeros and formatted output.
+//
+//*****************************************************************************
+#ifdef HOTPATH_HOST
+#define HOTPATH_UNIT            "ns"
+#define HOTPATH_HZ              1000000000
+#define HOTPATH_SNPRINTF        snprintf
+#define HOTPATH_CLZ(x)          __builtin_clz(x)
+#else
+#define HOTPATH_UNIT            "cycles"
+#define HOTPATH_HZ              g_ui32SysClock
+#define HOTPATH_SNPRINTF        usnprintf
+#if defined(ccs)
+#define HOTPATH_CLZ(x)          _norm(x)
+#else
+#define HOTPATH_CLZ(x)          __builtin_clz(x)
+#endif
+
+//
+// The Cortex-M debug registers used to run the DWT cycle counter.
+//
+#define HOTPATH_DEMCR           0xE000EDFC
+#define HOTPATH_DEMCR_TRCENA    0x01000000
+#define HOTPATH_DWT_CTRL        0xE0001000
+#define HOTPATH_DWT_CYCCNTENA   0x00000001
+#define HOTPATH_DWT_CYCCNT      0xE0001004
+
+extern uint32_t g_ui32SysClock;
+#endif
+
+#ifdef HOTPATH_ENABLE
+
+//*****************************************************************************
+//
+// A histogram of 32-bit cycle counts with its summary figures.
+//
+//*****************************************************************************
+typedef struct
+{
+    uint32_t ui32Count;
+    uint32_t ui32Min;
+    uint32_t ui32Max;
+    uint64_t ui64Total;
+    uint32_t pui32Bucket[HOTPATH_BUCKETS];
+}
+tHotpathHist;
+
+//*****************************************************************************
+//
+// The figures kept for one entry point.
+//
+//*****************************************************************************
+typedef struct
+{
+    //
+    // The duration of each run, less time spent in preempting entry points.
+    //
+    tHotpathHist sRun;
+
+    //
+    // The entry latency, for interrupt handlers that can measure it.
+    //
+    tHotpathHist sLatency;
+
+    //
+    // The number of runs that were preempted by another entry point.
+    //
+    uint32_t ui32Preempted;
+
+    //
+    // The number of runs entered at each preemption nesting depth; depth 0
+    // means that no other entry point was running.
+    //
+    uint32_t pui32Depth[HOTPATH_MAX_DEPTH];
+}
+tHotpathPoint;
+
+//*****************************************************************************
+//
+// The names of the entry points, in HOTPATH_* order.
+//
+//*****************************************************************************
+static const char *const g_ppcHotpathName[HOTPATH_NUM_POINTS] =
+{
+    "systick",
+    "ethernet",
+    "getTime",
+    "host_timer",
+    "protocol_loop",
+    "work_ethernet",
+    "work_timers",
+    "work_second",
+    "work_snapshot"
+};
+
+//*****************************************************************************
+//
+// The figures for each entry point, plus one more used to measure the cost
+// of the instrumentation itself.
+//
+//*****************************************************************************
+static tHotpathPoint g_psHotpath[HOTPATH_NUM_POINTS + 1];
+
+//*****************************************************************************
+//
+// The stack of running entry points: the cycle count at which each started
+// and the time spent in entry points that preempted it.
+//
+//*****************************************************************************
+static uint32_t g_ui32HotpathDepth;
+static uint32_t g_pui32HotpathStart[HOTPATH_MAX_DEPTH];
+static uint32_t g_pui32HotpathChild[HOTPATH_MAX_DEPTH];
+
+//*****************************************************************************
+//
+// The cost of an empty HotpathEnter()/HotpathExit() pair, which is removed
+// from every run.
+//
+//*****************************************************************************
+static uint32_t g_ui32HotpathOverhead;
+
+//*****************************************************************************
+//
+// A snapshot of one entry point and the report text, for HotpathFormat() and
+// HotpathPrint().
+//
+//*****************************************************************************
+static tHotpathPoint g_sHotpathSnap;
+static char g_pcHotpathText[HOTPATH_TEXT_SIZE];
+
+//*****************************************************************************
+//
+// Read the cycle counter.
+//
+//*****************************************************************************
+static uint32_t
+HotpathCycles(void)
+{
+#ifdef HOTPATH_HOST
+    struct timespec sNow;
+
+    clock_gettime(CLOCK_MONOTONIC, &sNow);
+
+    return((uint32_t)(((uint64_t)sNow.tv_sec * 1000000000) + sNow.tv_nsec));
+#else
+    return(HWREG(HOTPATH_DWT_CYCCNT));
+#endif
+}
+
+//*****************************************************************************
+//
+// Enter and leave a critical section.  The bookkeeping is a few dozen cycles
+// and must not be torn by a preempting entry point.
+//
+//*****************************************************************************
+static uint32_t
+HotpathLock(void)
+{
+#ifdef HOTPATH_HOST
+    return(0);
+#else
+    return(CPUcpsid());
+#endif
+}
+
+static void
+HotpathUnlock(uint32_t ui32Prot)
+{
+#ifndef HOTPATH_HOST
+    if(!ui32Prot)
+    {
+        CPUcpsie();
+    }
+#else
+    (void)ui32Prot;
+#endif
+}
+
+//*****************************************************************************
+//
+// Map a count to its histogram bucket, and a bucket to the largest count it
+// holds.
+//
+//*****************************************************************************
+static uint32_t
+HotpathBucket(uint32_t ui32Value)
+{
+    uint32_t ui32Msb;
+
+    if(ui32Value < 4)
+    {
+        return(ui32Value);
+    }
+
+    ui32Msb = 31 - HOTPATH_CLZ(ui32Value);
+
+    return(((ui32Msb - 1) * 4) + ((ui32Value >> (ui32Msb - 2)) & 3));
+}
+
+static uint32_t
+HotpathBucketTop(uint32_t ui32Bucket)
+{
+    uint32_t ui32Shift;
+
+    if(ui32Bucket < 4)
+    {
+        return(ui32Bucket);
+    }
+
+    ui32Shift = (ui32Bucket / 4) - 1;
+
+    return((((4 + (ui32Bucket % 4)) << ui32Shift) - 1) + (1 << ui32Shift));
+}
+
+//*****************************************************************************
+//
+// Add a count to a histogram.
+//
+//*****************************************************************************
+static void
+HotpathHistAdd(tHotpathHist *psHist, uint32_t ui32Value)
+{
+    if((psHist->ui32Count == 0) || (ui32Value < psHist->ui32Min))
+    {
+        psHist->ui32Min = ui32Value;
+    }
+    if(ui32Value > psHist->ui32Max)
+    {
+        psHist->ui32Max = ui32Value;
+    }
+    psHist->ui32Count++;
+    psHist->ui64Total += ui32Value;
+    psHist->pui32Bucket[HotpathBucket(ui32Value)]++;
+}
+
+//*****************************************************************************
+//
+// Return a percentile of a histogram, as the top of the bucket it falls in
+// (but no more than the largest count seen).
+//
+//*****************************************************************************
+static uint32_t
+HotpathHistPercentile(const tHotpathHist *psHist, uint32_t ui32Percent)
+{
+    uint32_t ui32Bucket, ui32Target, ui32Seen, ui32Top;
+
+    //
+    // The rank of the sample wanted, rounded up.
+    //
+    ui32Target = (uint32_t)((((uint64_t)psHist->ui32Count * ui32Percent) +
+                             99) / 100);
+    ui32Seen = 0;
+    for(ui32Bucket = 0; ui32Bucket < HOTPATH_BUCKETS; ui32Bucket++)
+    {
+        ui32Seen += psHist->pui32Bucket[ui32Bucket];
+        if(ui32Seen >= ui32Target)
+        {
+            break;
+        }
+    }
+
+    ui32Top = HotpathBucketTop(ui32Bucket);
+
+    return((ui32Top < psHist->ui32Max) ? ui32Top : psHist->ui32Max);
+}
+
+//*****************************************************************************
+//
+// Mark the start of a run of an entry point.
+//
+//*****************************************************************************
+void
+HotpathEnter(uint32_t ui32Point)
+{
+    uint32_t ui32Prot, ui32Depth;
+
+    ui32Prot = HotpathLock();
+
+    ui32Depth = g_ui32HotpathDepth++;
+    if(ui32Depth < HOTPATH_MAX_DEPTH)
+    {
+        g_psHotpath[ui32Point].pui32Depth[ui32Depth]++;
+        g_pui32HotpathChild[ui32Depth] = 0;
+        g_pui32HotpathStart[ui32Depth] = HotpathCycles();
+    }
+
+    HotpathUnlock(ui32Prot);
+}
+
+//*****************************************************************************
+//
+// Mark the end of a run of an entry point, and record its duration.
+//
+//*****************************************************************************
+void
+HotpathExit(uint32_t ui32Point)
+{
+    uint32_t ui32Now, ui32Prot, ui32Depth, ui32Run, ui32Own;
+    tHotpathPoint *psPoint;
+
+    ui32Now = HotpathCycles();
+    ui32Prot = HotpathLock();
+
+    ui32Depth = --g_ui32HotpathDepth;
+    if(ui32Depth < HOTPATH_MAX_DEPTH)
+    {
+        psPoint = &g_psHotpath[ui32Point];
+
+        //
+        // The run's own time excludes the entry points that preempted it.
+        // Its whole time counts against whatever it preempted.
+        //
+        ui32Run = ui32Now - g_pui32HotpathStart[ui32Depth];
+        ui32Own = ui32Run - g_pui32HotpathChild[ui32Depth];
+        if(g_pui32HotpathChild[ui32Depth])
+        {
+            psPoint->ui32Preempted++;
+        }
+        if(ui32Depth)
+        {
+            g_pui32HotpathChild[ui32Depth - 1] += ui32Run;
+        }
+
+        ui32Own = (ui32Own > g_ui32HotpathOverhead) ?
+                  (ui32Own - g_ui32HotpathOverhead) : 0;
+        HotpathHistAdd(&psPoint->sRun, ui32Own);
+    }
+
+    HotpathUnlock(ui32Prot);
+}
+
+//*****************************************************************************
+//
+// Record the entry latency of an interrupt handler, or the time a job waited
+// in the work queue.
+//
+//*****************************************************************************
+void
+HotpathLatency(uint32_t ui32Point, uint32_t ui32Cycles)
+{
+    uint32_t ui32Prot;
+
+    ui32Prot = HotpathLock();
+    HotpathHistAdd(&g_psHotpath[ui32Point].sLatency, ui32Cycles);
+    HotpathUnlock(ui32Prot);
+}
+
+//*****************************************************************************
+//
+// Read the cycle counter, for latencies measured outside this file.
+//
+//*****************************************************************************
+uint32_t
+HotpathNow(void)
+{
+    return(HotpathCycles());
+}
+
+//*****************************************************************************
+//
+// Clear all of the figures.
+//
+//*****************************************************************************
+void
+HotpathReset(void)
+{
+    uint32_t ui32Prot;
+
+    ui32Prot = HotpathLock();
+    memset(g_psHotpath, 0, sizeof(g_psHotpath));
+    HotpathUnlock(ui32Prot);
+}
+
+//*****************************************************************************
+//
+// Start the cycle counter and measure the cost of the instrumentation.
+//
+//*****************************************************************************
+void
+HotpathInit(void)
+{
+    uint32_t ui32Pass;
+
+#ifndef HOTPATH_HOST
+    if(!(HWREG(HOTPATH_DWT_CTRL) & HOTPATH_DWT_CYCCNTENA))
+    {
+        HWREG(HOTPATH_DEMCR) |= HOTPATH_DEMCR_TRCENA;
+        HWREG(HOTPATH_DWT_CYCCNT) = 0;
+        HWREG(HOTPATH_DWT_CTRL) |= HOTPATH_DWT_CYCCNTENA;
+    }
+#endif
+
+    //
+    // The overhead is the shortest time recorded for an empty run.
+    //
+    g_ui32HotpathOverhead = 0;
+    HotpathReset();
+    for(ui32Pass = 0; ui32Pass < 64; ui32Pass++)
+    {
+        HotpathEnter(HOTPATH_NUM_POINTS);
+        HotpathExit(HOTPATH_NUM_POINTS);
+    }
+    g_ui32HotpathOverhead = g_psHotpath[HOTPATH_NUM_POINTS].sRun.ui32Min;
+    HotpathReset();
+}
+
+//*****************************************************************************
+//
+// Append the summary of a histogram to the report.
+//
+//*****************************************************************************
+static uint32_t
+HotpathFormatHist(char *pcBuf, uint32_t ui32Size, const tHotpathHist *psHist)
+{
+    return(HOTPATH_SNPRINTF(pcBuf, ui32Size,
+                            " count=%u min=%u p50=%u p99=%u max=%u mean=%u",
+                            (unsigned)psHist->ui32Count,
+                            (unsigned)psHist->ui32Min,
+                            (unsigned)HotpathHistPercentile(psHist, 50),
+                            (unsigned)HotpathHistPercentile(psHist, 99),
+                            (unsigned)psHist->ui32Max,
+                            (unsigned)(psHist->ui32Count ?
+                                       (psHist->ui64Total /
+                                        psHist->ui32Count) : 0)));
+}
+
+//*****************************************************************************
+//
+// Write the report into a buffer: one line for each entry point that has
+// run, and one for each entry latency recorded.  Returns the length of the
+// report, which is truncated to fit.
+//
+//*****************************************************************************
+uint32_t
+HotpathFormat(char *pcBuf, uint32_t ui32Size)
+{
+    uint32_t ui32Len, ui32Point, ui32Depth, ui32Prot;
+    const char *pcSep;
+
+    if(ui32Size == 0)
+    {
+        return(0);
+    }
+
+#define HOTPATH_APPEND(x)                                                     \
+    do                                                                        \
+    {                                                                         \
+        ui32Len += (x);                                                       \
+        if(ui32Len >= ui32Size)                                               \
+        {                                                                     \
+            return(ui32Size - 1);                                             \
+        }                                                                     \
+    }                                                                         \
+    while(0)
+
+    ui32Len = 0;
+    HOTPATH_APPEND(HOTPATH_SNPRINTF(pcBuf, ui32Size,
+                                    "hotpath unit=%s hz=%u overhead=%u\n",
+                                    HOTPATH_UNIT, (unsigned)HOTPATH_HZ,
+                                    (unsigned)g_ui32HotpathOverhead));
+
+    for(ui32Point = 0; ui32Point < HOTPATH_NUM_POINTS; ui32Point++)
+    {
+        //
+        // Work from a consistent copy of the entry point's figures.
+        //
+        ui32Prot = HotpathLock();
+        memcpy(&g_sHotpathSnap, &g_psHotpath[ui32Point],
+               sizeof(g_sHotpathSnap));
+        HotpathUnlock(ui32Prot);
+
+        if(g_sHotpathSnap.sRun.ui32Count)
+        {
+            HOTPATH_APPEND(HOTPATH_SNPRINTF(pcBuf + ui32Len,
+                                            ui32Size - ui32Len, "point=%s",
+                                            g_ppcHotpathName[ui32Point]));
+            HOTPATH_APPEND(HotpathFormatHist(pcBuf + ui32Len,
+                                             ui32Size - ui32Len,
+                                             &g_sHotpathSnap.sRun));
+            HOTPATH_APPEND(HOTPATH_SNPRINTF(pcBuf + ui32Len,
+                                            ui32Size - ui32Len,
+                                            " preempted=%u depth=",
+                                            (unsigned)
+                                            g_sHotpathSnap.ui32Preempted));
+            pcSep = "";
+            for(ui32Depth = 0; ui32Depth < HOTPATH_MAX_DEPTH; ui32Depth++)
+            {
+                if(g_sHotpathSnap.pui32Depth[ui32Depth])
+                {
+                    HOTPATH_APPEND(HOTPATH_SNPRINTF(pcBuf + ui32Len,
+                                                    ui32Size - ui32Len,
+                                                    "%s%u:%u", pcSep,
+                                                    (unsigned)ui32Depth,
+                                                    (unsigned)g_sHotpathSnap.
+                                                    pui32Depth[ui32Depth]));
+                    pcSep = ",";
+                }
+            }
+            HOTPATH_APPEND(HOTPATH_SNPRINTF(pcBuf + ui32Len,
+                                            ui32Size - ui32Len, "\n"));
+        }
+
+        if(g_sHotpathSnap.sLatency.ui32Count)
+        {
+            HOTPATH_APPEND(HOTPATH_SNPRINTF(pcBuf + ui32Len,
+                                            ui32Size - ui32Len,
+                                            "latency=%s",
+                                            g_ppcHotpathName[ui32Point]));
+            HOTPATH_APPEND(HotpathFormatHist(pcBuf + ui32Len,
+                                             ui32Size - ui32Len,
+                                             &g_sHotpathSnap.sLatency));
+            HOTPATH_APPEND(HOTPATH_SNPRINTF(pcBuf + ui32Len,
+                                            ui32Size - ui32Len, "\n"));
+        }
+    }
+
+#undef HOTPATH_APPEND
+
+    return(ui32Len);
+}
+
+//*****************************************************************************
+//
+// Print the report on the UART (or standard output on the host).  This must
+// be called from the main loop, not from an interrupt handler.
+//
+//*****************************************************************************
+void
+HotpathPrint(void)
+{
+    HotpathFormat(g_pcHotpathText, sizeof(g_pcHotpathText));
+
+#ifdef HOTPATH_HOST
+    fputs(g_pcHotpathText, stdout);
+#else
+    UARTprintf("\n%s", g_pcHotpathText);
+#endif
+}
+
+#else // HOTPATH_ENABLE
+
+//*****************************************************************************
+//
+// Without HOTPATH_ENABLE there is nothing to report.
+//
+//*****************************************************************************
+uint32_t
+HotpathFormat(char *pcBuf, uint32_t ui32Size)
+{
+    uint32_t ui32Len;
+
+    if(ui32Size == 0)
+    {
+        return(0);
+    }
+
+    ui32Len = HOTPATH_SNPRINTF(pcBuf, ui32Size, "hotpath disabled\n");
+
+    return((ui32Len < ui32Size) ? ui32Len : (ui32Size - 1));
+}
+
+#endif // HOTPATH_ENABLE
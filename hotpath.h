@@ -0,0 +1,130 @@
+//*****************************************************************************
+//
+// hotpath.h - Cycle-count instrumentation of the interrupt handlers and PTPd
+// entry points.
+//
+// Each instrumented entry point records how long every run takes, excluding
+// time spent in entry points that preempted it, in a fixed-bucket histogram,
+// together with the preemption nesting depth at which it was entered.  The
+// SysTick handler also records its entry latency: the time from the SysTick
+// wrap to the first instruction of the handler, and each job run from the
+// work queue in workq.c records the time from being posted to starting.
+//
+// Time is taken from the Cortex-M DWT cycle counter.  Building with
+// HOTPATH_HOST defined takes it from clock_gettime() instead, in
+// nanoseconds, so that the same code can run in the host tools.
+//
+// The instrumentation is compiled in only when HOTPATH_ENABLE is defined.
+// Otherwise the HOTPATH_*() macros expand to nothing and the report says
+// that it is disabled.
+//
+//*****************************************************************************
+
+#ifndef __HOTPATH_H__
+#define __HOTPATH_H__
+
+#include <stdint.h>
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+//*****************************************************************************
+//
+// The instrumented entry points.
+//
+//*****************************************************************************
+#define HOTPATH_SYSTICK         0           // SysTickIntHandler()
+#define HOTPATH_ETHERNET        1           // EthernetIntHandler()
+#define HOTPATH_GETTIME         2           // getTime()
+#define HOTPATH_HOST_TIMER      3           // lwIPHostTimerHandler()
+#define HOTPATH_PROTOCOL_LOOP   4           // protocol_loop()
+#define HOTPATH_WORK_ETHERNET   5           // The Ethernet job
+#define HOTPATH_WORK_TIMERS     6           // The timer wheel job
+#define HOTPATH_WORK_SECOND     7           // The once-a-second job
+#define HOTPATH_WORK_SNAPSHOT   8           // The snapshot save job
+#define HOTPATH_NUM_POINTS      9
+
+//*****************************************************************************
+//
+// The histogram has four buckets per power of two, so each bucket is within
+// 25% of its neighbours, covering the whole 32-bit range.
+//
+//*****************************************************************************
+#define HOTPATH_BUCKETS         124
+
+//*****************************************************************************
+//
+// The deepest preemption nesting that is tracked.
+//
+//*****************************************************************************
+#define HOTPATH_MAX_DEPTH       8
+
+//*****************************************************************************
+//
+// The size of the buffer needed by HotpathFormat() for the full report.
+//
+//*****************************************************************************
+#define HOTPATH_TEXT_SIZE       2560
+
+//*****************************************************************************
+//
+// How often, in seconds, the application prints the report on the UART.
+//
+//*****************************************************************************
+#ifndef HOTPATH_REPORT_S
+#define HOTPATH_REPORT_S        60
+#endif
+
+//*****************************************************************************
+//
+// The instrumentation hooks.
+//
+//*****************************************************************************
+#ifdef HOTPATH_ENABLE
+#define HOTPATH_INIT()          HotpathInit()
+#define HOTPATH_ENTER(ui32Point)                                              \
+                                HotpathEnter(ui32Point)
+#define HOTPATH_EXIT(ui32Point) HotpathExit(ui32Point)
+#define HOTPATH_LATENCY(ui32Point, ui32Cycles)                                \
+                                HotpathLatency(ui32Point, ui32Cycles)
+#define HOTPATH_NOW()           HotpathNow()
+#else
+#define HOTPATH_INIT()
+#define HOTPATH_ENTER(ui32Point)
+#define HOTPATH_EXIT(ui32Point)
+#define HOTPATH_LATENCY(ui32Point, ui32Cycles)
+#define HOTPATH_NOW()           0
+#endif
+
+//*****************************************************************************
+//
+// Prototypes.
+//
+//*****************************************************************************
+extern void HotpathInit(void);
+extern void HotpathReset(void);
+extern void HotpathEnter(uint32_t ui32Point);
+extern void HotpathExit(uint32_t ui32Point);
+extern void HotpathLatency(uint32_t ui32Point, uint32_t ui32Cycles);
+extern uint32_t HotpathNow(void);
+extern uint32_t HotpathFormat(char *pcBuf, uint32_t ui32Size);
+extern void HotpathPrint(void);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __HOTPATH_H__
@@ -0,0 +1,212 @@
+//*****************************************************************************
+//
+// snapshot.c - A small record kept in the on-chip EEPROM across restarts.
+//
+// The record is written to each of SNAPSHOT_SLOTS EEPROM blocks in turn,
+// with a sequence number and a CRC, so the words of any one block are
+// programmed at most once every SNAPSHOT_SLOTS saves.  On start up the valid
+// slot with the latest sequence number is the one loaded.  A save that is
+// cut short by a reset leaves a slot that fails its CRC, and the one saved
+// before it is loaded instead.
+//
+// Programming a block takes a few milliseconds, so SnapshotSave() is meant
+// to be called from a low priority job rather than from the protocol code
+// directly.
+//
+//*****************************************************************************
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "driverlib/eeprom.h"
+#include "driverlib/rom.h"
+#include "driverlib/rom_map.h"
+#include "driverlib/sw_crc.h"
+#include "driverlib/sysctl.h"
+#include "snapshot.h"
+
+//*****************************************************************************
+//
+// Where the slots are in the EEPROM, and how many there are.  Each slot is
+// one 64-byte EEPROM block.
+//
+//*****************************************************************************
+#define SNAPSHOT_BASE           0
+#define SNAPSHOT_SLOTS          16
+#define SNAPSHOT_SLOT_WORDS     16
+#define SNAPSHOT_DATA_WORDS     (SNAPSHOT_SLOT_WORDS - 3)
+
+//*****************************************************************************
+//
+// A slot as it is kept in the EEPROM.
+//
+//*****************************************************************************
+typedef struct
+{
+    //
+    // The number of saves made before this one, the size of the record in
+    // bytes, and the CRC of everything except itself.
+    //
+    uint32_t ui32Sequence;
+    uint32_t ui32Size;
+    uint32_t ui32Check;
+
+    //
+    // The record.
+    //
+    uint32_t pui32Data[SNAPSHOT_DATA_WORDS];
+}
+tSnapshotSlot;
+
+//*****************************************************************************
+//
+// The slot holding the latest record, or -1 if there is none, and its
+// sequence number.
+//
+//*****************************************************************************
+static int32_t g_i32SnapshotSlot = -1;
+static uint32_t g_ui32SnapshotSequence;
+
+//*****************************************************************************
+//
+// Return the CRC of a slot.
+//
+//*****************************************************************************
+static uint32_t
+SnapshotCheck(const tSnapshotSlot *psSlot)
+{
+    uint32_t ui32Crc;
+
+    ui32Crc = Crc32(0xFFFFFFFF, (const uint8_t *)&psSlot->ui32Sequence,
+                    2 * sizeof(uint32_t));
+    ui32Crc = Crc32(ui32Crc, (const uint8_t *)psSlot->pui32Data,
+                    psSlot->ui32Size);
+
+    return(ui32Crc);
+}
+
+//*****************************************************************************
+//
+// Read a slot.  Returns false if it does not hold a valid record.
+//
+//*****************************************************************************
+static bool
+SnapshotRead(uint32_t ui32Slot, tSnapshotSlot *psSlot)
+{
+    MAP_EEPROMRead((uint32_t *)psSlot,
+                   SNAPSHOT_BASE + (ui32Slot * sizeof(tSnapshotSlot)),
+                   sizeof(tSnapshotSlot));
+
+    if(psSlot->ui32Size > SNAPSHOT_MAX_SIZE)
+    {
+        return(false);
+    }
+
+    return(psSlot->ui32Check == SnapshotCheck(psSlot));
+}
+
+//*****************************************************************************
+//
+// Start the EEPROM and find the latest record.  Returns false if the EEPROM
+// cannot be used, in which case nothing is loaded or saved.
+//
+//*****************************************************************************
+bool
+SnapshotInit(void)
+{
+    tSnapshotSlot sSlot;
+    uint32_t ui32Slot;
+
+    g_i32SnapshotSlot = -1;
+
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_EEPROM0);
+    while(!MAP_SysCtlPeripheralReady(SYSCTL_PERIPH_EEPROM0))
+    {
+    }
+
+    if((MAP_EEPROMInit() != EEPROM_INIT_OK) ||
+       (MAP_EEPROMSizeGet() <
+        (SNAPSHOT_BASE + (SNAPSHOT_SLOTS * sizeof(tSnapshotSlot)))))
+    {
+        return(false);
+    }
+
+    //
+    // The latest record has the highest sequence number, counting across a
+    // wrap of the sequence.
+    //
+    for(ui32Slot = 0; ui32Slot < SNAPSHOT_SLOTS; ui32Slot++)
+    {
+        if(SnapshotRead(ui32Slot, &sSlot) &&
+           ((g_i32SnapshotSlot < 0) ||
+            ((int32_t)(sSlot.ui32Sequence - g_ui32SnapshotSequence) > 0)))
+        {
+            g_i32SnapshotSlot = (int32_t)ui32Slot;
+            g_ui32SnapshotSequence = sSlot.ui32Sequence;
+        }
+    }
+
+    return(true);
+}
+
+//*****************************************************************************
+//
+// Copy the latest record into pvData.  Returns false, and copies nothing, if
+// there is no record of the given size.
+//
+//*****************************************************************************
+bool
+SnapshotLoad(void *pvData, uint32_t ui32Size)
+{
+    tSnapshotSlot sSlot;
+
+    if((g_i32SnapshotSlot < 0) ||
+       !SnapshotRead((uint32_t)g_i32SnapshotSlot, &sSlot) ||
+       (sSlot.ui32Size != ui32Size))
+    {
+        return(false);
+    }
+
+    memcpy(pvData, sSlot.pui32Data, ui32Size);
+
+    return(true);
+}
+
+//*****************************************************************************
+//
+// Save a record in the slot after the latest one.  Returns false if the
+// record is too large or could not be programmed.
+//
+//*****************************************************************************
+bool
+SnapshotSave(const void *pvData, uint32_t ui32Size)
+{
+    tSnapshotSlot sSlot;
+    uint32_t ui32Slot;
+
+    if(ui32Size > SNAPSHOT_MAX_SIZE)
+    {
+        return(false);
+    }
+
+    memset(&sSlot, 0, sizeof(sSlot));
+    sSlot.ui32Sequence = (g_i32SnapshotSlot < 0) ? 0 :
+                         (g_ui32SnapshotSequence + 1);
+    sSlot.ui32Size = ui32Size;
+    memcpy(sSlot.pui32Data, pvData, ui32Size);
+    sSlot.ui32Check = SnapshotCheck(&sSlot);
+
+    ui32Slot = (g_i32SnapshotSlot < 0) ? 0 :
+               (((uint32_t)g_i32SnapshotSlot + 1) % SNAPSHOT_SLOTS);
+    if(MAP_EEPROMProgram((uint32_t *)&sSlot,
+                         SNAPSHOT_BASE + (ui32Slot * sizeof(tSnapshotSlot)),
+                         sizeof(tSnapshotSlot)) != 0)
+    {
+        return(false);
+    }
+
+    g_i32SnapshotSlot = (int32_t)ui32Slot;
+    g_ui32SnapshotSequence = sSlot.ui32Sequence;
+
+    return(true);
+}
@@ -0,0 +1,49 @@
+//*****************************************************************************
+//
+// snapshot.h - A small record kept in the on-chip EEPROM across restarts.
+//
+//*****************************************************************************
+
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+//*****************************************************************************
+//
+// The largest record that can be kept, in bytes.
+//
+//*****************************************************************************
+#define SNAPSHOT_MAX_SIZE       52
+
+//*****************************************************************************
+//
+// Prototypes.
+//
+//*****************************************************************************
+extern bool SnapshotInit(void);
+extern bool SnapshotLoad(void *pvData, uint32_t ui32Size);
+extern bool SnapshotSave(const void *pvData, uint32_t ui32Size);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SNAPSHOT_H__
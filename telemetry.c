@@ -0,0 +1,259 @@
+//*****************************************************************************
+//
+// telemetry.c - A RAM ring of servo samples, read over HTTP.
+//
+//*****************************************************************************
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#ifdef TELEMETRY_HOST
+#include <stdio.h>
+#else
+#include "utils/ustdlib.h"
+#endif
+#include "telemetry.h"
+
+//*****************************************************************************
+//
+// Formatted output.
+//
+//*****************************************************************************
+#ifdef TELEMETRY_HOST
+#define TELEMETRY_SNPRINTF      snprintf
+#else
+#define TELEMETRY_SNPRINTF      usnprintf
+#endif
+
+#if (TELEMETRY_DEPTH & (TELEMETRY_DEPTH - 1)) != 0
+#error "TELEMETRY_DEPTH must be a power of two"
+#endif
+
+//*****************************************************************************
+//
+// The ring, and the sequence number the next sample will be given.  A slot
+// holds the sequence number of the sample in it, or TELEMETRY_INVALID while
+// the writer is filling it, so a reader that finds the number it expected
+// both before and after copying a slot has a whole sample.
+//
+//*****************************************************************************
+static volatile tTelemetrySample g_psTelemetryRing[TELEMETRY_DEPTH];
+static volatile uint32_t g_ui32TelemetryNext;
+
+//*****************************************************************************
+//
+// The header line of a CSV fetch, which is written last, once the cursor is
+// known, and so is padded to a fixed width.
+//
+//*****************************************************************************
+#define TELEMETRY_CSV_HEAD      "# next=%10u dropped=%10u\n"
+#define TELEMETRY_CSV_HEAD_LEN  37
+#define TELEMETRY_CSV_COLUMNS                                                 \
+    "seq,t1,t2,offset_ns,delay_ns,adj_ppb,drift_ppb,sync_seq,state\n"
+
+//*****************************************************************************
+//
+// Returns the slot for the next sample, which the caller fills and then
+// passes to TelemetryCommit().  Only one sample may be claimed at a time.
+//
+//*****************************************************************************
+volatile tTelemetrySample *
+TelemetryClaim(void)
+{
+    volatile tTelemetrySample *psSample;
+
+    psSample = &g_psTelemetryRing[g_ui32TelemetryNext &
+                                  (TELEMETRY_DEPTH - 1)];
+    psSample->ui32Seq = TELEMETRY_INVALID;
+
+    return(psSample);
+}
+
+//*****************************************************************************
+//
+// Publishes the sample claimed by TelemetryClaim().
+//
+//*****************************************************************************
+void
+TelemetryCommit(volatile tTelemetrySample *psSample)
+{
+    uint32_t ui32Seq;
+
+    ui32Seq = g_ui32TelemetryNext;
+    psSample->ui32Seq = ui32Seq;
+    g_ui32TelemetryNext = ui32Seq + 1;
+}
+
+//*****************************************************************************
+//
+// Returns the sequence number the next sample will be given.
+//
+//*****************************************************************************
+uint32_t
+TelemetryNext(void)
+{
+    return(g_ui32TelemetryNext);
+}
+
+//*****************************************************************************
+//
+// Copies up to ui32Max samples, starting at the one numbered *pui32Cursor,
+// and advances the cursor past them.  A cursor older than the oldest sample
+// kept is moved up to it and the samples skipped are added to *pui32Dropped,
+// as is any sample overwritten while it was being copied.  A cursor ahead of
+// the writer, as one kept by a client across a restart, starts again from
+// the oldest sample.  Returns the number of samples copied.
+//
+//*****************************************************************************
+uint32_t
+TelemetryRead(uint32_t *pui32Cursor, tTelemetrySample *psSamples,
+              uint32_t ui32Max, uint32_t *pui32Dropped)
+{
+    volatile tTelemetrySample *psSlot;
+    const volatile uint32_t *pui32Src;
+    uint32_t *pui32Dst;
+    uint32_t ui32Cursor, ui32Next, ui32Oldest, ui32Count, ui32Idx;
+
+    ui32Cursor = *pui32Cursor;
+    ui32Count = 0;
+
+    while(ui32Count < ui32Max)
+    {
+        ui32Next = g_ui32TelemetryNext;
+        ui32Oldest = (ui32Next > TELEMETRY_DEPTH) ?
+                     (ui32Next - TELEMETRY_DEPTH) : 0;
+
+        if((int32_t)(ui32Cursor - ui32Next) > 0)
+        {
+            ui32Cursor = ui32Oldest;
+        }
+        else if((int32_t)(ui32Cursor - ui32Oldest) < 0)
+        {
+            *pui32Dropped += ui32Oldest - ui32Cursor;
+            ui32Cursor = ui32Oldest;
+        }
+
+        if(ui32Cursor == ui32Next)
+        {
+            break;
+        }
+
+        //
+        // Copy the slot a word at a time, and keep it only if the writer did
+        // not start on it meanwhile.
+        //
+        psSlot = &g_psTelemetryRing[ui32Cursor & (TELEMETRY_DEPTH - 1)];
+        if(psSlot->ui32Seq == ui32Cursor)
+        {
+            pui32Src = (const volatile uint32_t *)psSlot;
+            pui32Dst = (uint32_t *)&psSamples[ui32Count];
+            for(ui32Idx = 0; ui32Idx < (sizeof(tTelemetrySample) / 4);
+                ui32Idx++)
+            {
+                pui32Dst[ui32Idx] = pui32Src[ui32Idx];
+            }
+
+            if(psSlot->ui32Seq == ui32Cursor)
+            {
+                ui32Count++;
+                ui32Cursor++;
+                continue;
+            }
+        }
+
+        //
+        // The writer has lapped the cursor, so this sample is gone.
+        //
+        (*pui32Dropped)++;
+        ui32Cursor++;
+    }
+
+    *pui32Cursor = ui32Cursor;
+
+    return(ui32Count);
+}
+
+//*****************************************************************************
+//
+// Formats the samples from a cursor as CSV, as many as fit in the buffer.
+// The first line gives the cursor to fetch from next and the samples
+// dropped before those returned.  Returns the length of the text.
+//
+//*****************************************************************************
+uint32_t
+TelemetryFormatCsv(char *pcBuf, uint32_t ui32Size, uint32_t ui32Cursor)
+{
+    tTelemetrySample sSample;
+    uint32_t ui32Len, ui32Dropped;
+    char pcHead[TELEMETRY_CSV_HEAD_LEN + 1];
+
+    if(ui32Size < (TELEMETRY_CSV_HEAD_LEN + sizeof(TELEMETRY_CSV_COLUMNS)))
+    {
+        return(0);
+    }
+
+    ui32Len = TELEMETRY_CSV_HEAD_LEN;
+    memcpy(pcBuf + ui32Len, TELEMETRY_CSV_COLUMNS,
+           sizeof(TELEMETRY_CSV_COLUMNS) - 1);
+    ui32Len += sizeof(TELEMETRY_CSV_COLUMNS) - 1;
+    ui32Dropped = 0;
+
+    while(((ui32Size - ui32Len) >= TELEMETRY_CSV_ROW) &&
+          TelemetryRead(&ui32Cursor, &sSample, 1, &ui32Dropped))
+    {
+        ui32Len += TELEMETRY_SNPRINTF(pcBuf + ui32Len, ui32Size - ui32Len,
+                                      "%u,%u.%09u,%u.%09u,%d,%d,%d,%d,%u,%u\n",
+                                      sSample.ui32Seq, sSample.ui32T1Sec,
+                                      sSample.ui32T1NSec, sSample.ui32T2Sec,
+                                      sSample.ui32T2NSec, sSample.i32Offset,
+                                      sSample.i32Delay, sSample.i32Adj,
+                                      sSample.i32Drift, sSample.ui16SyncSeq,
+                                      sSample.ui8State);
+    }
+
+    //
+    // Fill in the header, which ends with the newline already reserved for
+    // it.
+    //
+    TELEMETRY_SNPRINTF(pcHead, sizeof(pcHead), TELEMETRY_CSV_HEAD, ui32Cursor,
+                       ui32Dropped);
+    memcpy(pcBuf, pcHead, TELEMETRY_CSV_HEAD_LEN);
+
+    return(ui32Len);
+}
+
+//*****************************************************************************
+//
+// Formats the samples from a cursor as a tTelemetryHeader followed by the
+// samples themselves, as many as fit in the buffer.  Returns the length of
+// the data.
+//
+//*****************************************************************************
+uint32_t
+TelemetryFormatBin(char *pcBuf, uint32_t ui32Size, uint32_t ui32Cursor)
+{
+    tTelemetryHeader sHeader;
+    tTelemetrySample *psSamples;
+    uint32_t ui32Max;
+
+    if(ui32Size < sizeof(tTelemetryHeader))
+    {
+        return(0);
+    }
+
+    psSamples = (tTelemetrySample *)(pcBuf + sizeof(tTelemetryHeader));
+    ui32Max = (ui32Size - sizeof(tTelemetryHeader)) / sizeof(tTelemetrySample);
+
+    sHeader.ui32Magic = TELEMETRY_MAGIC;
+    sHeader.ui16Version = TELEMETRY_VERSION;
+    sHeader.ui16SampleSize = sizeof(tTelemetrySample);
+    sHeader.ui32Dropped = 0;
+    sHeader.ui32Count = TelemetryRead(&ui32Cursor, psSamples, ui32Max,
+                                      &sHeader.ui32Dropped);
+    sHeader.ui32Next = ui32Cursor;
+    sHeader.ui32First = sHeader.ui32Count ? psSamples[0].ui32Seq : ui32Cursor;
+    memcpy(pcBuf, &sHeader, sizeof(tTelemetryHeader));
+
+    return(sizeof(tTelemetryHeader) +
+           (sHeader.ui32Count * sizeof(tTelemetrySample)));
+}
@@ -0,0 +1,132 @@
+//*****************************************************************************
+//
+// telemetry.h - A RAM ring of servo samples, read over HTTP.
+//
+// Every servo update writes one fixed-size sample into the ring, lock-free:
+// the writer never waits, and a reader that is overtaken by it sees the
+// samples it lost counted as dropped instead of a torn one.  A reader keeps
+// a cursor, the sequence number of the next sample it wants, so that each
+// fetch returns only the samples recorded since the last.
+//
+// There is one writer, the PTPd task.  Readers may run in any context, and
+// only copy out of the ring.
+//
+//*****************************************************************************
+
+#ifndef __TELEMETRY_H__
+#define __TELEMETRY_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+//*****************************************************************************
+//
+// The number of samples kept, which must be a power of two.  Each takes
+// sizeof(tTelemetrySample) bytes of RAM.
+//
+//*****************************************************************************
+#ifndef TELEMETRY_DEPTH
+#define TELEMETRY_DEPTH         256
+#endif
+
+//*****************************************************************************
+//
+// One servo update.  The times are those of the last Sync: t1 when the master
+// sent it and t2 when it was received, in seconds and nanoseconds.  The
+// offset and one-way delay are in nanoseconds, the frequency adjustment and
+// the drift in parts per billion.
+//
+//*****************************************************************************
+typedef struct
+{
+    uint32_t ui32Seq;
+    uint32_t ui32T1Sec;
+    uint32_t ui32T1NSec;
+    uint32_t ui32T2Sec;
+    uint32_t ui32T2NSec;
+    int32_t i32Offset;
+    int32_t i32Delay;
+    int32_t i32Adj;
+    int32_t i32Drift;
+    uint16_t ui16SyncSeq;
+    uint8_t ui8State;
+    uint8_t ui8Reserved;
+}
+tTelemetrySample;
+
+//*****************************************************************************
+//
+// The header that starts a binary fetch, followed by ui32Count samples.  All
+// fields are little-endian.
+//
+//*****************************************************************************
+typedef struct
+{
+    uint32_t ui32Magic;
+    uint16_t ui16Version;
+    uint16_t ui16SampleSize;
+    uint32_t ui32First;
+    uint32_t ui32Next;
+    uint32_t ui32Count;
+    uint32_t ui32Dropped;
+}
+tTelemetryHeader;
+
+#define TELEMETRY_MAGIC         0x54505450  // "PTPT"
+#define TELEMETRY_VERSION       1
+
+//*****************************************************************************
+//
+// The sequence number held by a slot while it is being written.
+//
+//*****************************************************************************
+#define TELEMETRY_INVALID       0xFFFFFFFF
+
+//*****************************************************************************
+//
+// The buffer sizes for one fetch, which bound the samples it returns.  They
+// are allocated from the lwIP heap for each request.
+//
+//*****************************************************************************
+#define TELEMETRY_CSV_ROW       128
+#define TELEMETRY_CSV_SIZE      4096
+#define TELEMETRY_BIN_SIZE      (sizeof(tTelemetryHeader) +                  \
+                                 (64 * sizeof(tTelemetrySample)))
+
+//*****************************************************************************
+//
+// Prototypes.
+//
+//*****************************************************************************
+extern volatile tTelemetrySample *TelemetryClaim(void);
+extern void TelemetryCommit(volatile tTelemetrySample *psSample);
+extern uint32_t TelemetryNext(void);
+extern uint32_t TelemetryRead(uint32_t *pui32Cursor,
+                              tTelemetrySample *psSamples, uint32_t ui32Max,
+                              uint32_t *pui32Dropped);
+extern uint32_t TelemetryFormatCsv(char *pcBuf, uint32_t ui32Size,
+                                   uint32_t ui32Cursor);
+extern uint32_t TelemetryFormatBin(char *pcBuf, uint32_t ui32Size,
+                                   uint32_t ui32Cursor);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __TELEMETRY_H__
@@ -82,8 +82,15 @@ toInternalTime(TimeInternal * internal, TimeRepresentation * external, Boolean *
 void 
 normalizeTime(TimeInternal * r)
 {
-	r->seconds += r->nanoseconds / 1000000000;
-	r->nanoseconds -= r->nanoseconds / 1000000000 * 1000000000;
+	/*
+	 * The sum or difference of two normalized times is less than two
+	 * seconds from being normalized, so skip the division unless the
+	 * nanoseconds field holds a whole second or more.
+	 */
+	if (r->nanoseconds >= 1000000000 || r->nanoseconds <= -1000000000) {
+		r->seconds += r->nanoseconds / 1000000000;
+		r->nanoseconds -= r->nanoseconds / 1000000000 * 1000000000;
+	}
 
 	if (r->seconds > 0 && r->nanoseconds < 0) {
 		r->seconds -= 1;
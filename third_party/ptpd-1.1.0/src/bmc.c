@@ -33,7 +33,7 @@ initData(RunTimeOpts * rtOpts, PtpClock * ptpClock)
 	ptpClock->sync_interval = rtOpts->syncInterval;
 
 	ptpClock->clock_variance = rtOpts->clockVariance;	/* see spec 7.7 */
-	ptpClock->clock_followup_capable = CLOCK_FOLLOWUP;
+	ptpClock->clock_followup_capable = CLOCK_FOLLOWUP || rtOpts->twoStep;
 	ptpClock->preferred = rtOpts->clockPreferred;
 	ptpClock->initializable = INITIALIZABLE;
 	ptpClock->external_timing = EXTERNAL_TIMING;
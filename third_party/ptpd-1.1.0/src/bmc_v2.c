@@ -0,0 +1,214 @@
+/**
+ * @file   bmc_v2.c
+ * @date   Sat Oct 17 2026
+ *
+ * @brief  Best master clock selection code for PTPv2.
+ *
+ * The data set comparison and state decision of IEEE 1588-2008 9.3,
+ * for the one port this clock has, over the foreign masters heard
+ * from by their Announce messages.
+ */
+
+#include "ptpd.h"
+
+/* the v1 uuid a clock identity was made from, which the v1 parent data
+   set, and what keys on it, are kept in */
+static void
+identityToUuid(Octet * uuid, Octet * identity)
+{
+	memcpy(uuid, identity, 3);
+	memcpy(uuid + 3, identity + 5, 3);
+}
+
+/* after initData(), which the v1 data sets it shares come from */
+void
+initDataV2(RunTimeOpts * rtOpts, PtpClock * ptpClock)
+{
+	DBG("initDataV2\n");
+
+	/* the clock identity is the EUI-64 of the port's EUI-48 */
+	memcpy(ptpClock->port_identity.clockIdentity, ptpClock->port_uuid_field, 3);
+	ptpClock->port_identity.clockIdentity[3] = 0xFF;
+	ptpClock->port_identity.clockIdentity[4] = 0xFE;
+	memcpy(ptpClock->port_identity.clockIdentity + 5, ptpClock->port_uuid_field + 3, 3);
+	ptpClock->port_identity.portNumber = ptpClock->port_id_field;
+
+	/* Default data set */
+	ptpClock->domain_number = rtOpts->domainNumber;
+	ptpClock->priority1 = rtOpts->priority1;
+	ptpClock->priority2 = rtOpts->priority2;
+	ptpClock->clock_quality.clockClass = rtOpts->slaveOnly ?
+	    PTP_V2_SLAVE_ONLY_CLOCK_CLASS : DEFAULT_CLOCK_CLASS;
+	ptpClock->clock_quality.clockAccuracy = DEFAULT_CLOCK_ACCURACY;
+	/* the v1 variance is on the same scale, but not offset */
+	ptpClock->clock_quality.offsetScaledLogVariance = (UInteger16)(ptpClock->clock_variance + 0x8000);
+	ptpClock->time_source = PTP_V2_INTERNAL_OSCILLATOR;
+
+	/* Port data set */
+	ptpClock->log_announce_interval = rtOpts->announceInterval;
+	ptpClock->announce_receipt_timeout = rtOpts->announceReceiptTimeout;
+	ptpClock->log_min_delay_req_interval = rtOpts->delayReqInterval;
+	ptpClock->sent_announce_sequence_id = 0;
+	ptpClock->sent_sync_sequence_id = 0;
+}
+
+/* see 1588-2008 table 13 */
+void
+m1V2(PtpClock * ptpClock)
+{
+	m1(ptpClock);
+
+	/* Parent data set */
+	ptpClock->parent_port_identity = ptpClock->port_identity;
+	memcpy(ptpClock->grandmaster_identity, ptpClock->port_identity.clockIdentity,
+	    PTP_V2_CLOCK_IDENTITY_LENGTH);
+	ptpClock->grandmaster_clock_quality = ptpClock->clock_quality;
+	ptpClock->grandmaster_priority1 = ptpClock->priority1;
+	ptpClock->grandmaster_priority2 = ptpClock->priority2;
+}
+
+/* see 1588-2008 table 16 */
+void
+s1V2(MsgHeaderV2 * header, MsgAnnounce * announce, PtpClock * ptpClock)
+{
+	/* Current data set */
+	ptpClock->steps_removed = announce->stepsRemoved + 1;
+
+	/* Parent data set */
+	ptpClock->parent_port_identity = header->sourcePortIdentity;
+	memcpy(ptpClock->grandmaster_identity, announce->grandmasterIdentity,
+	    PTP_V2_CLOCK_IDENTITY_LENGTH);
+	ptpClock->grandmaster_clock_quality = announce->grandmasterClockQuality;
+	ptpClock->grandmaster_priority1 = announce->grandmasterPriority1;
+	ptpClock->grandmaster_priority2 = announce->grandmasterPriority2;
+
+	/* and the v1 one, for the warm start and the Delay_Req credit */
+	ptpClock->parent_communication_technology = ptpClock->port_communication_technology;
+	identityToUuid(ptpClock->parent_uuid, header->sourcePortIdentity.clockIdentity);
+	ptpClock->parent_port_id = header->sourcePortIdentity.portNumber;
+	ptpClock->grandmaster_communication_technology = ptpClock->port_communication_technology;
+	identityToUuid(ptpClock->grandmaster_uuid_field, announce->grandmasterIdentity);
+
+	/* Time properties data set */
+	ptpClock->current_utc_offset = announce->currentUtcOffset;
+	ptpClock->leap_59 = !!(header->flagField[1] & PTP_V2_LI_59);
+	ptpClock->leap_61 = !!(header->flagField[1] & PTP_V2_LI_61);
+}
+
+/* this clock's own data set, as an Announce to compare the others with */
+void
+copyD0V2(MsgHeaderV2 * header, MsgAnnounce * announce, PtpClock * ptpClock)
+{
+	header->sourcePortIdentity = ptpClock->port_identity;
+	announce->grandmasterPriority1 = ptpClock->priority1;
+	announce->grandmasterClockQuality = ptpClock->clock_quality;
+	announce->grandmasterPriority2 = ptpClock->priority2;
+	memcpy(announce->grandmasterIdentity, ptpClock->port_identity.clockIdentity,
+	    PTP_V2_CLOCK_IDENTITY_LENGTH);
+	announce->stepsRemoved = 0;
+}
+
+/* return similar to memcmp()s, positive when A is the better, 1 or -1
+   on the grandmasters and 2 or -2 on the path to the same one;
+   see 1588-2008 figures 27 and 28 */
+Integer8
+bmcDataSetComparisonV2(MsgHeaderV2 * headerA, MsgAnnounce * announceA,
+    MsgHeaderV2 * headerB, MsgAnnounce * announceB, PtpClock * ptpClock)
+{
+	ClockQuality *qualityA = &announceA->grandmasterClockQuality;
+	ClockQuality *qualityB = &announceB->grandmasterClockQuality;
+	int comp;
+
+	DBGV("bmcDataSetComparisonV2: start\n");
+	comp = memcmp(announceA->grandmasterIdentity, announceB->grandmasterIdentity,
+	    PTP_V2_CLOCK_IDENTITY_LENGTH);
+	if (comp) {
+		if (announceA->grandmasterPriority1 != announceB->grandmasterPriority1)
+			return announceA->grandmasterPriority1 < announceB->grandmasterPriority1 ? 1 : -1;
+		if (qualityA->clockClass != qualityB->clockClass)
+			return qualityA->clockClass < qualityB->clockClass ? 1 : -1;
+		if (qualityA->clockAccuracy != qualityB->clockAccuracy)
+			return qualityA->clockAccuracy < qualityB->clockAccuracy ? 1 : -1;
+		if (qualityA->offsetScaledLogVariance != qualityB->offsetScaledLogVariance)
+			return qualityA->offsetScaledLogVariance < qualityB->offsetScaledLogVariance ? 1 : -1;
+		if (announceA->grandmasterPriority2 != announceB->grandmasterPriority2)
+			return announceA->grandmasterPriority2 < announceB->grandmasterPriority2 ? 1 : -1;
+
+		/* grandmasters alike but for their identities */
+		return comp < 0 ? 1 : -1;
+	}
+
+	/* the same grandmaster, by the shorter path */
+	DBGV("bmcDataSetComparisonV2: X\n");
+	if (announceA->stepsRemoved > announceB->stepsRemoved + 1)
+		return -1;
+	if (announceA->stepsRemoved + 1 < announceB->stepsRemoved)
+		return 1;
+
+	/* stepsRemoved within 1, which a single port decides by topology */
+	if (announceA->stepsRemoved > announceB->stepsRemoved)
+		return -2;
+	if (announceA->stepsRemoved < announceB->stepsRemoved)
+		return 2;
+
+	/* stepsRemoved same */
+	comp = memcmp(headerA->sourcePortIdentity.clockIdentity,
+	    headerB->sourcePortIdentity.clockIdentity, PTP_V2_CLOCK_IDENTITY_LENGTH);
+	if (comp)
+		return comp < 0 ? 2 : -2;
+	if (headerA->sourcePortIdentity.portNumber != headerB->sourcePortIdentity.portNumber)
+		return headerA->sourcePortIdentity.portNumber < headerB->sourcePortIdentity.portNumber ? 2 : -2;
+
+	/* the same port */
+	return 0;
+}
+
+/* see 1588-2008 figure 26 */
+UInteger8
+bmcStateDecisionV2(MsgHeaderV2 * header, MsgAnnounce * announce, RunTimeOpts * rtOpts, PtpClock * ptpClock)
+{
+	if (rtOpts->slaveOnly || ptpClock->clock_quality.clockClass == PTP_V2_SLAVE_ONLY_CLOCK_CLASS) {
+		s1V2(header, announce, ptpClock);
+		return PTP_SLAVE;
+	}
+	copyD0V2(&ptpClock->msgTmpHeaderV2, &ptpClock->msgTmp.announce, ptpClock);
+
+	if (bmcDataSetComparisonV2(&ptpClock->msgTmpHeaderV2, &ptpClock->msgTmp.announce,
+	    header, announce, ptpClock) > 0) {
+		m1V2(ptpClock);
+		return PTP_MASTER;
+	}
+	/* a clock of class 1 to 127 never slaves to another */
+	if (ptpClock->clock_quality.clockClass < 128)
+		return PTP_PASSIVE;
+
+	s1V2(header, announce, ptpClock);
+	return PTP_SLAVE;
+}
+
+/* the best of the foreign masters that have sent enough Announces to be
+   qualified, and the state it puts the port in */
+UInteger8
+bmcV2(ForeignMasterRecord * foreign, RunTimeOpts * rtOpts, PtpClock * ptpClock)
+{
+	Integer16 i, best;
+
+	for (i = 0, best = -1; i < ptpClock->number_foreign_records; ++i) {
+		if (foreign[i].foreign_master_syncs < PTP_FOREIGN_MASTER_THRESHOLD)
+			continue;
+		if (best < 0 || bmcDataSetComparisonV2(&foreign[i].header_v2, &foreign[i].announce,
+		    &foreign[best].header_v2, &foreign[best].announce, ptpClock) > 0)
+			best = i;
+	}
+
+	if (best < 0) {
+		if (ptpClock->port_state == PTP_MASTER)
+			m1V2(ptpClock);
+		return ptpClock->port_state;	/* no change */
+	}
+
+	DBGV("bmcV2: best record %d\n", best);
+	ptpClock->foreign_record_best = best;
+
+	return bmcStateDecisionV2(&foreign[best].header_v2, &foreign[best].announce, rtOpts, ptpClock);
+}
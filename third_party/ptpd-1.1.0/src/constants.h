@@ -24,7 +24,33 @@
 #define DEFAULT_AP                   10
 #define DEFAULT_AI                   1000
 #define DEFAULT_DELAY_S              6
+#define DEFAULT_STEP_THRESHOLD       1000000000	/* in nsec */
+#define DEFAULT_SLEW_THRESHOLD       1000000	/* in nsec */
+#define DEFAULT_SLEW_WINDOW          60	/* in sec */
+#define DEFAULT_SLEW_MAX             5000000	/* in ppb */
+#define DEFAULT_HOLDOVER_WINDOW      300	/* in sec */
+#define DEFAULT_HOLDOVER_DRIFT_RATE  FALSE
+#define DEFAULT_SERVO                SERVO_PI
+#define DEFAULT_FREQ_FIRST           TRUE
+#define DEFAULT_PDV_FILTER           PDV_NONE
+#define DEFAULT_PDV_GATE             50	/* in percent */
+#define DEFAULT_DELAY_REQ_ADAPT      TRUE
+#define DEFAULT_DELAY_REQ_MIN        2	/* in syncs */
+#define DEFAULT_DELAY_REQ_MAX        PTP_DELAY_REQ_INTERVAL	/* in syncs */
+#define DEFAULT_DELAY_REQ_NOISE      1000	/* in nsec */
+#define DEFAULT_DELAY_REQ_LIMIT      30	/* per minute */
 #define DEFAULT_MAX_FOREIGN_RECORDS  5
+#ifndef DEFAULT_PTP_VERSION
+#define DEFAULT_PTP_VERSION          1	/* 1 or 2, the engine to run */
+#endif
+#define DEFAULT_DOMAIN_NUMBER        0	/* PTPv2 */
+#define DEFAULT_PRIORITY1            128	/* PTPv2 */
+#define DEFAULT_PRIORITY2            128	/* PTPv2 */
+#define DEFAULT_CLOCK_CLASS          248	/* PTPv2 */
+#define DEFAULT_CLOCK_ACCURACY       0xFE	/* PTPv2, unknown */
+#define DEFAULT_ANNOUNCE_INTERVAL    1	/* PTPv2, log2 sec */
+#define DEFAULT_ANNOUNCE_RECEIPT_TIMEOUT 3	/* PTPv2, in announce intervals */
+#define DEFAULT_DELAY_REQ_INTERVAL   0	/* PTPv2, log2 sec */
 
 /* features, only change to refelect changes in implementation */
 #define CLOCK_FOLLOWUP    TRUE
@@ -35,6 +61,7 @@
 #define NUMBER_PORTS      1
 #define VERSION_PTP       1
 #define VERSION_NETWORK   1
+#define VERSION_PTP_V2    2
 
 /* spec defined constants  */
 #define DEFAULT_PTP_DOMAIN_NAME      "_DFLT\0\0\0\0\0\0\0\0\0\0\0"
@@ -54,9 +81,18 @@
 #define PTP_CODE_STRING_LENGTH              4
 #define PTP_SUBDOMAIN_NAME_LENGTH           16
 #define PTP_MAX_MANAGEMENT_PAYLOAD_SIZE     90
-/* no support for intervals less than one */
-#define PTP_SYNC_INTERVAL_TIMEOUT(x)        (1<<((x)<0?1:(x)))
-#define PTP_SYNC_RECEIPT_TIMEOUT(x)         (10*(1<<((x)<0?0:(x))))
+/* intervals are log2 seconds, in msec for the timers, which is as short
+   as PTP_MIN_LOG_INTERVAL comes to; any outside the range are taken as
+   the nearest in it, and sub-second ones are rounded to the nearest msec */
+#define PTP_MIN_LOG_INTERVAL                (-7)
+#define PTP_MAX_LOG_INTERVAL                16
+#define PTP_LOG_INTERVAL_MS_SUB(x)          ((1000 + (1 << (-(x) - 1))) >> -(x))
+#define PTP_LOG_INTERVAL_MS(x) \
+  ((x) < PTP_MIN_LOG_INTERVAL ? PTP_LOG_INTERVAL_MS_SUB(PTP_MIN_LOG_INTERVAL) : \
+   (x) < 0 ? PTP_LOG_INTERVAL_MS_SUB(x) : \
+   (x) > PTP_MAX_LOG_INTERVAL ? 1000 << PTP_MAX_LOG_INTERVAL : 1000 << (x))
+#define PTP_SYNC_INTERVAL_TIMEOUT(x)        PTP_LOG_INTERVAL_MS(x)
+#define PTP_SYNC_RECEIPT_TIMEOUT(x)         (10*PTP_LOG_INTERVAL_MS(x))
 #define PTP_DELAY_REQ_INTERVAL              30
 #define PTP_FOREIGN_MASTER_THRESHOLD        2
 #define PTP_FOREIGN_MASTER_TIME_WINDOW(x)   (4*(1<<((x)<0?0:(x))))
@@ -66,6 +102,13 @@
 /* used in spec but not named */
 #define MANUFACTURER_ID_LENGTH              48
 
+/* PTPv2 constants; intervals are log2 seconds, as above */
+#define PTP_V2_CLOCK_IDENTITY_LENGTH        8
+#define PTP_V2_LOG_INTERVAL_TIMEOUT(x)      PTP_LOG_INTERVAL_MS(x)
+#define PTP_V2_LOG_INTERVAL_UNUSED          0x7F
+#define PTP_V2_SLAVE_ONLY_CLOCK_CLASS       255
+#define PTP_V2_FOREIGN_MASTER_TIME_WINDOW   4
+
 /* ptp data enums */
 enum {
 	PTP_CLOSED = 0, PTP_ETHER, PTP_FFBUS = 4,
@@ -89,6 +132,33 @@ enum {
 	PTP_SYNC_MESSAGE_BURST, PTP_DELAY_REQ_MESSAGE_BURST
 };
 
+/* PTPv2 messageType */
+enum {
+	PTP_V2_SYNC = 0, PTP_V2_DELAY_REQ, PTP_V2_PDELAY_REQ,
+	PTP_V2_PDELAY_RESP, PTP_V2_FOLLOW_UP = 8, PTP_V2_DELAY_RESP,
+	PTP_V2_PDELAY_RESP_FOLLOW_UP, PTP_V2_ANNOUNCE, PTP_V2_SIGNALING,
+	PTP_V2_MANAGEMENT
+};
+
+/* PTPv2 controlField, the v1 control values and this for the others */
+#define PTP_V2_CONTROL_OTHER  5
+
+/* PTPv2 flagField, octet 0 */
+#define PTP_V2_ALTERNATE_MASTER   0x01
+#define PTP_V2_TWO_STEP           0x02
+#define PTP_V2_UNICAST            0x04
+
+/* PTPv2 flagField, octet 1 */
+#define PTP_V2_LI_61              0x01
+#define PTP_V2_LI_59              0x02
+#define PTP_V2_UTC_OFFSET_VALID   0x04
+#define PTP_V2_TIMESCALE          0x08
+#define PTP_V2_TIME_TRACEABLE     0x10
+#define PTP_V2_FREQUENCY_TRACEABLE 0x20
+
+/* PTPv2 timeSource */
+#define PTP_V2_INTERNAL_OSCILLATOR 0xA0
+
 enum {
 	PTP_LI_61 = 0, PTP_LI_59, PTP_BOUNDARY_CLOCK,
 	PTP_ASSIST, PTP_EXT_SYNC, PARENT_STATS, PTP_SYNC_BURST
@@ -114,7 +184,22 @@ enum {
 /* enum used by this implementation */
 enum {
 	SYNC_RECEIPT_TIMER = 0, SYNC_INTERVAL_TIMER, QUALIFICATION_TIMER,
+	ANNOUNCE_RECEIPT_TIMER, ANNOUNCE_INTERVAL_TIMER, FOREIGN_MASTER_TIMER,	/* PTPv2 */
 	TIMER_ARRAY_SIZE		/* these two are non-spec */
 };
 
+enum {
+	SERVO_PI = 0, SERVO_LINREG, SERVO_KALMAN,
+	SERVO_COUNT
+};
+
+enum {
+	SERVO_ACQUIRE = 0, SERVO_TRACK
+};
+
+enum {
+	PDV_NONE = 0, PDV_MIN, PDV_MEDIAN,
+	PDV_COUNT
+};
+
 #endif
@@ -27,11 +27,149 @@ typedef struct {
 }    TimeInternal;
 
 typedef struct {
-    Integer32 interval;
-    Integer32 left;
+    Integer32 interval;       /* msec */
     Boolean    expire;
+    tWheelTimer wheel;
 }    IntervalTimer;
 
+/* the frequency learned while slave, for holdover; frequencies and rates
+   are fixed point with HOLDOVER_FRAC_BITS fraction bits */
+typedef struct {
+    Boolean    active;        /* steering on it now, with no master */
+    Integer32 blocks;         /* averaging blocks completed */
+    Integer64 freq;           /* mean observed_drift over the last block, ppb */
+    Integer64 means[HOLDOVER_BLOCKS]; /* the last block means, ppb */
+    Integer64 rate;           /* their slope, ppb per second */
+    Integer32 freq_dev;       /* mean |observed_drift - freq| over the block, ppb */
+    Integer32 te;             /* largest |offset| over the block, nsec */
+    Integer64 sum_freq;       /* the block in progress, weighted by msec */
+    Integer64 sum_dev;
+    Integer32 max_te;
+    Integer32 sum_ms;
+    TimeInternal last;        /* sync receive time of the last update averaged */
+    Integer32 adj;            /* frequency applied in holdover, ppb */
+    Integer32 bound;          /* bound on the time error in holdover, nsec */
+}    HoldoverModel;
+
+/* the oscillator's frequency error, measured from the master to slave
+   delays of a block of syncs; times are msec from the block's first sync */
+typedef struct {
+    Boolean    valid;         /* freq holds a measurement */
+    Boolean    applied;       /* the servo has been started from one */
+    Boolean    delayed;       /* and a delay measured on it since */
+    Integer32 n;              /* syncs in the block so far */
+    TimeInternal first;       /* sync receive time of its first sync */
+    Integer32 y0;             /* master to slave delay of its first sync, nsec */
+    Integer64 st, sy, stt, sty; /* sums of time and delay, msec and nsec */
+    Integer64 sum_adj;        /* correction applied over the block, ppb*msec */
+    Integer32 last_ms;        /* time of the block's last sync */
+    Integer32 adj;            /* correction applied now, ppb */
+    Integer32 freq;           /* the oscillator's frequency error, ppb */
+}    RateEstimator;
+
+/* the servo state kept across a restart, to start warm when the same
+   master is found again */
+typedef struct {
+    Integer32 drift;          /* frequency correction, ppb */
+    Integer32 delay;          /* one-way delay, nsec */
+    UInteger8 servo_state;    /* SERVO_ACQUIRE or SERVO_TRACK */
+    UInteger16 parent_port_id;
+    UInteger8 parent_communication_technology;
+    Octet    parent_uuid[PTP_UUID_LENGTH];
+}    ServoSnapshot;
+
+/* what a servo engine reports after each sample */
+typedef struct {
+    UInteger32 samples;       /* samples taken since the engine was reset */
+    Integer32 offset;         /* the last offset sampled, nsec */
+    Integer32 freq;           /* its frequency estimate, ppb */
+    Integer32 adj;            /* the correction it asked for, ppb */
+    Integer32 spread;         /* its estimate of the offset noise, nsec */
+    UInteger8 state;          /* SERVO_ACQUIRE or SERVO_TRACK */
+    UInteger32 transitions;   /* changes of state since the reset */
+}    ServoStats;
+
+/* the PI engine; its frequency is observed_drift, and its gains are the
+   ones scheduled for the state it is in unless RunTimeOpts fixes them */
+typedef struct {
+    UInteger8 state;          /* SERVO_ACQUIRE or SERVO_TRACK */
+    Integer16 sched_ap, sched_ai; /* gains scheduled for the state */
+    Integer16 ap, ai;         /* gains in use */
+    UInteger32 transitions;   /* changes of state since the reset */
+    Integer32 count;          /* offsets taken in this state */
+    Integer32 mean;           /* moving mean of the offset, nsec */
+    Integer64 var;            /* moving variance about it, nsec^2 */
+    Integer32 residue;        /* what error/ai left over, nsec */
+    Integer32 spread;         /* mean |offset|, nsec, with SERVO_SPREAD_SHIFT */
+}    PiServo;
+
+/* the least-squares engine: a sliding window of the phase the clock would
+   have had without the corrections applied, fitted to a line */
+typedef struct {
+    TimeInternal t[LINREG_WINDOW]; /* sync receive times */
+    Integer64 y[LINREG_WINDOW];   /* offset plus correction applied, nsec */
+    Boolean    primed;          /* the first offset after the reset is past */
+    Integer32 n;              /* points in the window */
+    Integer32 head;           /* where the next point goes */
+    Integer64 applied;        /* correction applied since the reset, nsec */
+    Integer32 adj;            /* the last correction asked for, ppb */
+    Integer32 spread;         /* mean |residual| of the last fit, nsec */
+}    LinregServo;
+
+/* the Kalman engine: phase and frequency, with the correction as a control
+   input; in single precision, which the FPU does in hardware */
+typedef struct {
+    Integer32 n;              /* offsets taken since the reset */
+    float    x;               /* offset, nsec */
+    float    f;               /* frequency error, ppb */
+    float    p00, p01, p11;   /* covariance */
+    float    r;               /* measurement noise variance, nsec^2 */
+    float    adj;             /* the last correction asked for, ppb */
+    float    spread;          /* mean |innovation|, nsec */
+    TimeInternal last;        /* sync receive time of the last sample */
+}    KalmanServo;
+
+/* a sliding window of one direction's path delay, with the statistics of
+   the last estimate taken from it */
+typedef struct {
+    Integer64 v[PDV_WINDOW];   /* delays, less the phase moved when taken, nsec */
+    Integer32 n;              /* samples in the window */
+    Integer32 head;           /* where the next sample goes */
+    Integer32 min, median, max; /* of the window projected to now, nsec */
+    Integer32 selected;       /* the estimate, nsec */
+    Integer32 rejected;       /* samples above the gate percentile */
+}    PdvWindow;
+
+/* the packet delay variation filter of both directions, and the phase the
+   clock has been moved by the servo, which the windows are projected by */
+typedef struct {
+    PdvWindow m2s, s2m;
+    Integer64 moved;          /* offset change the servo made, nsec */
+    Integer32 rate;           /* correction on top of observed_drift, ppb */
+    TimeInternal last;        /* time moved was brought up to */
+}    PdvFilter;
+
+/* the Delay_Reqs one master may still be sent */
+typedef struct {
+    UInteger16 parent_port_id; /* the master the credit is for */
+    Octet    parent_uuid[PTP_UUID_LENGTH];
+    Integer32 credit;         /* msec of Delay_Reqs the master may be sent */
+    TimeInternal last;        /* sync receive time credit was added up to */
+    UInteger32 sent;          /* Delay_Reqs sent to it */
+    UInteger32 deferred;      /* syncs a Delay_Req waited for credit */
+}    DelayReqCredit;
+
+/* when to send the next Delay_Req: the moving mean and variance of the
+   one-way delay measured, which set how often, and the Delay_Reqs each
+   of the masters slaved to lately may still be sent, which bound it */
+typedef struct {
+    Integer32 mean;           /* one-way delay, nsec */
+    Integer64 var;            /* its variance, nsec^2 */
+    Integer32 samples;        /* delays since the path last changed */
+    Integer32 interval;       /* mean syncs between Delay_Reqs */
+    DelayReqCredit master[DELAY_REQ_MASTERS];
+}    DelayReqSched;
+
 /* Message header */
 typedef struct {
     UInteger16 versionPTP;
@@ -199,14 +337,77 @@ typedef struct {
     MsgManagementPayload payload;
 }    MsgManagement;
 
+/* PTPv2 port identity */
+typedef struct {
+    Octet    clockIdentity[PTP_V2_CLOCK_IDENTITY_LENGTH];
+    UInteger16 portNumber;
+}    PortIdentity;
+
+/* PTPv2 clock quality */
+typedef struct {
+    UInteger8 clockClass;
+    UInteger8 clockAccuracy;
+    UInteger16 offsetScaledLogVariance;
+}    ClockQuality;
+
+/* PTPv2 message header */
+typedef struct {
+    UInteger8 transportSpecific;
+    UInteger8 messageType;
+    UInteger8 versionPTP;
+    UInteger16 messageLength;
+    UInteger8 domainNumber;
+    Octet    flagField[2];
+    Integer64 correctionField;    /* nsec, with 16 fraction bits */
+    PortIdentity sourcePortIdentity;
+    UInteger16 sequenceId;
+    UInteger8 controlField;
+    Integer8 logMessageInterval;
+}    MsgHeaderV2;
+
+/* PTPv2 Announce message */
+typedef struct {
+    TimeRepresentation originTimestamp;
+    Integer16 currentUtcOffset;
+    UInteger8 grandmasterPriority1;
+    ClockQuality grandmasterClockQuality;
+    UInteger8 grandmasterPriority2;
+    Octet    grandmasterIdentity[PTP_V2_CLOCK_IDENTITY_LENGTH];
+    UInteger16 stepsRemoved;
+    UInteger8 timeSource;
+}    MsgAnnounce;
+
+/* PTPv2 Sync, Delay_Req or Follow_Up message, which carry only a time */
+typedef struct {
+    TimeRepresentation originTimestamp;
+}    MsgSyncV2;
+
+typedef MsgSyncV2 MsgDelayReqV2;
+
+typedef struct {
+    TimeRepresentation preciseOriginTimestamp;
+}    MsgFollowUpV2;
+
+/* PTPv2 Delay_Resp message */
+typedef struct {
+    TimeRepresentation receiveTimestamp;
+    PortIdentity requestingPortIdentity;
+}    MsgDelayRespV2;
+
+/* a foreign master; PTPv2 ones are kept from their Announces, which
+   foreign_master_syncs then counts over the foreign master time window */
 typedef struct {
     UInteger8 foreign_master_communication_technology;
     Octet    foreign_master_uuid[PTP_UUID_LENGTH];
     UInteger16 foreign_master_port_id;
     UInteger16 foreign_master_syncs;
+    UInteger16 foreign_master_window[PTP_V2_FOREIGN_MASTER_TIME_WINDOW]; /* PTPv2 Announces by announce interval */
 
     MsgHeader header;
     MsgSync    sync;
+
+    MsgHeaderV2 header_v2;
+    MsgAnnounce announce;
 }    ForeignMasterRecord;
 
 /* main program data structure */
@@ -276,16 +477,64 @@ typedef struct {
     /* Foreign master data set */
     ForeignMasterRecord *foreign;
 
+    /* PTPv2 data sets, kept alongside the v1 ones above, which the engine
+       also fills in where they have an equivalent */
+    PortIdentity port_identity;
+    UInteger8 domain_number;
+    UInteger8 priority1;
+    UInteger8 priority2;
+    ClockQuality clock_quality;
+    PortIdentity parent_port_identity;
+    Octet    grandmaster_identity[PTP_V2_CLOCK_IDENTITY_LENGTH];
+    ClockQuality grandmaster_clock_quality;
+    UInteger8 grandmaster_priority1;
+    UInteger8 grandmaster_priority2;
+    UInteger8 time_source;
+    Integer8 log_announce_interval;
+    UInteger8 announce_receipt_timeout;
+    Integer8 log_min_delay_req_interval;
+    UInteger16 sent_announce_sequence_id;
+    UInteger16 sent_sync_sequence_id;
+    TimeInternal sync_correction;  /* correctionField of the Sync waited on */
+
     /* Other things we need for the protocol */
     Boolean    halfEpoch;
 
+    /* Phase slew in progress */
+    Boolean    slewing;
+    Integer32 slew_total;    /* offset being slewed out, in nsec */
+    Integer32 slew_residual; /* part of it not slewed out yet, in nsec */
+    Integer32 slew_rate;     /* in ppb */
+    TimeInternal slew_last;  /* sync receive time of the last update */
+
+    /* Holdover */
+    HoldoverModel hold;
+
+    /* Frequency measured from sync to sync */
+    RateEstimator rate;
+
+    /* Warm start */
+    ServoSnapshot snap;
+    Boolean    snap_valid;
+
+    /* Servo engine */
+    UInteger8 servo;          /* the engine the state below belongs to */
+    union {
+        PiServo    pi;
+        LinregServo linreg;
+        KalmanServo kalman;
+    }    servo_state;
+    ServoStats servo_stats;
+
     Integer16 max_foreign_records;
     Integer16 foreign_record_i;
     Integer16 foreign_record_best;
+    UInteger8 foreign_window_i; /* PTPv2 announce interval of the window now */
     Boolean    record_update;
     UInteger32 random_seed;
 
     MsgHeader msgTmpHeader;
+    MsgHeaderV2 msgTmpHeaderV2;
 
     union {
         MsgSync    sync;
@@ -293,6 +542,10 @@ typedef struct {
         MsgDelayReq req;
         MsgDelayResp resp;
         MsgManagement manage;
+        MsgAnnounce announce;
+        MsgSyncV2  sync_v2;
+        MsgFollowUpV2 follow_v2;
+        MsgDelayRespV2 resp_v2;
     }    msgTmp;
 
     Octet    msgObuf[PACKET_SIZE];
@@ -314,6 +567,8 @@ typedef struct {
 
     offset_from_master_filter ofm_filt;
     one_way_delay_filter owd_filt;
+    PdvFilter  pdv_filt;
+    DelayReqSched delay_req;
 
     Boolean    message_activity;
 
@@ -337,11 +592,32 @@ typedef struct {
     Boolean    noResetClock;
     Integer32 maxReset; /* Maximum number of nanoseconds to reset */
     Integer32 maxDelay; /* Maximum number of nanoseconds of delay */
+    Integer32 stepThreshold; /* Step offsets of at least this many nanoseconds */
+    Integer32 slewThreshold; /* Slew offsets of at least this many nanoseconds */
+    Integer32 slewWindow; /* Seconds over which to slew an offset out */
+    Integer32 slewMax; /* Maximum slew rate in ppb */
+    Integer32 holdoverWindow; /* Seconds per holdover averaging block, 0 for none */
+    Boolean    holdoverDriftRate; /* Extrapolate the frequency drift in holdover */
+    UInteger8 servo; /* Servo engine, one of SERVO_* */
+    Boolean    freqFirst; /* Measure the frequency before a cold start locks */
+    UInteger8 pdvFilter; /* Path delay estimator, one of PDV_* */
+    UInteger8 pdvGate; /* Percentile of the window the median is taken below */
+    Boolean    delayReqAdapt; /* Send Delay_Reqs as often as the delay needs */
+    UInteger8 delayReqMin, delayReqMax; /* Syncs between Delay_Reqs, at most and least often */
+    Integer32 delayReqNoise; /* Delay deviation the least often is enough for, nsec */
+    UInteger8 delayReqLimit; /* Most Delay_Reqs a minute to any one master */
+    UInteger8 ptpVersion; /* Protocol engine, 1 or 2 */
+    UInteger8 domainNumber; /* PTPv2 domain */
+    UInteger8 priority1, priority2; /* PTPv2 best master priorities */
+    Integer8 announceInterval; /* PTPv2 log2 seconds between Announces */
+    UInteger8 announceReceiptTimeout; /* PTPv2 Announce intervals until the master is lost */
+    Integer8 delayReqInterval; /* PTPv2 log2 seconds a master asks between Delay_Reqs */
+    Boolean    twoStep; /* Master sends Follow_Ups even if CLOCK_FOLLOWUP is FALSE */
     Boolean    noAdjust;
     Boolean    displayStats;
     Boolean    csvStats;
     Octet    unicastAddress[NET_ADDRESS_LENGTH];
-    Integer16 ap, ai;
+    Integer16 ap, ai; /* fixed PI gains, or SCHEDULED_GAIN */
     Integer16 s;
     TimeInternal inboundLatency, outboundLatency;
     Integer16 max_foreign_records;
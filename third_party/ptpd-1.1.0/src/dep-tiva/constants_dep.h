@@ -23,6 +23,76 @@
 
 #define ADJ_MAX  10000000
 
+/* holdover fixed point fraction bits, the block means the drift rate is
+   fitted to, the sync intervals without a sync that start it, the longest
+   gap between servo updates that is averaged, and the longest time its
+   error bound is projected over */
+#define HOLDOVER_FRAC_BITS  16
+#define HOLDOVER_ONE        ((Integer64)1 << HOLDOVER_FRAC_BITS)
+#define HOLDOVER_BLOCKS     4
+#define HOLDOVER_LATE_SYNCS 2
+#define HOLDOVER_MAX_GAP_S  60
+#define HOLDOVER_MAX_S      100000
+
+/* frequency measurement: the syncs in a block, the longest a block may
+   span, and the largest change of the master to slave delay over it, in
+   nsec, beyond which it is started again */
+#define RATE_WINDOW         8
+#define RATE_MAX_SPAN_S     64
+#define RATE_MAX_NS         100000000
+
+/* the largest offset over a holdover block for its frequency to be saved
+   for a warm start, in nsec */
+#define SNAPSHOT_MAX_TE     100000
+
+/* servo engines: the shift of the PI engine's mean |offset|, the points the
+   least-squares engine fits, the sync intervals over which the least-squares
+   and Kalman engines take an offset out, the Kalman process noise in phase
+   (nsec^2/sec) and frequency (ppb^2/sec), the measurement noise it starts
+   from and the range it learns it in (nsec^2), and how far off it takes the
+   frequency to be at first, with and without a frequency to start from (ppb) */
+#define SERVO_SPREAD_SHIFT  4
+#define LINREG_WINDOW       32
+#define LINREG_TAU          8
+#define KALMAN_TAU          4
+#define KALMAN_QX           100.0f
+#define KALMAN_QF           0.01f
+#define KALMAN_R_INIT       1000000.0f
+#define KALMAN_R_MIN        100.0f
+#define KALMAN_R_MAX        100000000.0f
+#define KALMAN_GATE         3.0f
+#define KALMAN_F_WARM       1000.0f
+#define KALMAN_F_COLD       100000.0f
+
+/* PI lock detection: the shift of the moving mean and variance of the
+   offset, the offsets to take in a state before leaving it, the bias that
+   counts as locked, as a fraction of the deviation or in nsec, and the
+   largest deviation that can be locked, in nsec; out of lock is PI_UNLOCK
+   times the bias */
+#define PI_LOCK_SHIFT       3
+#define PI_LOCK_SAMPLES     16
+#define PI_LOCK_DIV         2
+#define PI_LOCK_MIN         200
+#define PI_LOCK_MAX         50000
+#define PI_UNLOCK           4
+
+/* packet delay variation filter: the path delay samples kept in each
+   direction's window, and the longest gap between them that the window is
+   projected across */
+#define PDV_WINDOW          16
+#define PDV_MAX_GAP_S       30
+
+/* Delay_Req scheduling: the shift of the moving mean and variance of the
+   one-way delay, the delays to take at the fastest rate after the path
+   changes, the deviations off the mean that count as a change, the
+   Delay_Reqs that may be sent back to back once credit has built up, and
+   the masters credit is kept for */
+#define DELAY_REQ_SHIFT     3
+#define DELAY_REQ_SETTLE    16
+#define DELAY_REQ_STEP      4
+#define DELAY_REQ_BURST     4
+#define DELAY_REQ_MASTERS   4
+
 /* UDP/IPv4 dependent */
 
 #define SUBDOMAIN_ADDRESS_LENGTH  4
@@ -45,6 +115,13 @@
 #define DELAY_RESP_PACKET_LENGTH  60
 #define MANAGEMENT_PACKET_LENGTH  136
 
+#define V2_HEADER_LENGTH              34
+#define V2_ANNOUNCE_PACKET_LENGTH     64
+#define V2_SYNC_PACKET_LENGTH         44
+#define V2_DELAY_REQ_PACKET_LENGTH    44
+#define V2_FOLLOW_UP_PACKET_LENGTH    44
+#define V2_DELAY_RESP_PACKET_LENGTH   54
+
 #define MM_STARTING_BOUNDARY_HOPS  0x7fff
 
 /* others */
@@ -54,20 +131,25 @@
 
 #define PBUF_QUEUE_SIZE 16
 
-/* override default values */
+/* override default values; the PI servo acquires with the default gains
+   and tracks with the maximum ones */
 #ifdef      DEFAULT_AP
 #   undef   DEFAULT_AP
-#   define  DEFAULT_AP  2
+#   define  DEFAULT_AP  4
 #endif
 
 #ifdef      DEFAULT_AI
 #   undef   DEFAULT_AI
-#   define  DEFAULT_AI  200
+#   define  DEFAULT_AI  40
 #endif
 
 #define     MAX_AP      10
 #define     MAX_AI      1000
 
+/* RunTimeOpts ap and ai left at this follow the schedule; any other value
+   fixes that gain and stops the schedule */
+#define     SCHEDULED_GAIN  0
+
 #ifdef      DEFAULT_INBOUND_LATENCY
 #   undef   DEFAULT_INBOUND_LATENCY
 #   define  DEFAULT_INBOUND_LATENCY     16500
@@ -3,6 +3,8 @@
 #ifndef DATATYPES_DEP_H
 #define DATATYPES_DEP_H
 
+#include "wheel.h"
+
 typedef enum {FALSE=0, TRUE} Boolean;
 typedef char Octet;
 typedef signed char Integer8;
@@ -11,6 +13,7 @@ typedef signed int Integer32;
 typedef unsigned char UInteger8;
 typedef unsigned short UInteger16;
 typedef unsigned int UInteger32;
+typedef signed long long Integer64;
 
 typedef struct {
   Integer32  nsec_prev, y;
@@ -0,0 +1,198 @@
+/* ptpd_delayreq.c */
+
+#include "../ptpd.h"
+
+/*
+ * Delay_Req scheduling.  Each one-way delay measured updates a moving mean
+ * and variance of it.  Until DELAY_REQ_SETTLE delays have been taken since
+ * the path last changed, which is also after a reset or a delay far off
+ * the mean, Delay_Reqs go out every rtOpts->delayReqMin syncs.  After that
+ * the interval doubles with each delay up to rtOpts->delayReqMax syncs,
+ * scaled down by how far the variance is over rtOpts->delayReqNoise
+ * squared, so a noisy path is sampled faster than a quiet one.
+ *
+ * However often the delay asks for, a master is sent at most
+ * rtOpts->delayReqLimit Delay_Reqs a minute, with up to DELAY_REQ_BURST
+ * back to back once the credit for them has built up.  A Delay_Req that
+ * is due without credit waits for the next sync.  Credit is kept for the
+ * last DELAY_REQ_MASTERS masters, so that a slave that flaps between
+ * them does not get a fresh burst for each on every change.
+ */
+
+/* start the statistics afresh, as after a step or a change of master */
+void initDelayReq(PtpClock *ptpClock)
+{
+  DelayReqSched *d = &ptpClock->delay_req;
+
+  d->mean = 0;
+  d->var = 0;
+  d->samples = 0;
+  d->interval = 0;
+}
+
+/* the interval bounds asked for, made sane */
+static void delayReqBounds(Integer32 *min, Integer32 *max, RunTimeOpts *rtOpts)
+{
+  *min = rtOpts->delayReqMin > 0 ? rtOpts->delayReqMin : 1;
+  *max = rtOpts->delayReqMax > *min ? rtOpts->delayReqMax : *min;
+}
+
+/* take the delay just measured, and set the interval from it */
+void delayReqSample(RunTimeOpts *rtOpts, PtpClock *ptpClock)
+{
+  DelayReqSched *d = &ptpClock->delay_req;
+  Integer32 delay, dev, n, min, max;
+  Integer64 noise, target;
+
+  if(ptpClock->master_to_slave_delay.seconds || ptpClock->slave_to_master_delay.seconds)
+  {
+    initDelayReq(ptpClock);
+    return;
+  }
+
+  delay = ptpClock->master_to_slave_delay.nanoseconds/2 +
+    ptpClock->slave_to_master_delay.nanoseconds/2 +
+    rateDrift(&ptpClock->sync_receive_time, &ptpClock->delay_req_send_time, ptpClock)/2;
+  dev = delay - d->mean;
+  noise = (Integer64)rtOpts->delayReqNoise*rtOpts->delayReqNoise;
+
+  /* a delay far off the others is taken as the path changing */
+  if(d->samples >= DELAY_REQ_SETTLE && (Integer64)dev*dev > noise &&
+    (Integer64)dev*dev > (Integer64)DELAY_REQ_STEP*DELAY_REQ_STEP*d->var)
+  {
+    DBG("delay step %dns, %d samples\n", dev, d->samples);
+    d->samples = 0;
+  }
+
+  if(!d->samples)
+  {
+    d->mean = delay;
+    dev = 0;
+  }
+
+  /* a running mean until the shift's worth of delays, then a moving one */
+  n = d->samples < (1 << DELAY_REQ_SHIFT) ? d->samples + 1 : (1 << DELAY_REQ_SHIFT);
+  d->mean += dev/n;
+  d->var += ((Integer64)dev*dev - d->var)/n;
+  if(d->samples < DELAY_REQ_SETTLE)
+    d->samples++;
+
+  delayReqBounds(&min, &max, rtOpts);
+  if(d->samples < DELAY_REQ_SETTLE)
+    target = min;
+  else if(d->var <= noise)
+    target = max;
+  else
+  {
+    target = max*noise/d->var;
+    if(target < min)
+      target = min;
+  }
+
+  /* faster at once, slower a step at a time */
+  if(target < d->interval)
+    d->interval = (Integer32)target;
+  else if(d->interval*2 < target)
+    d->interval = d->interval > 0 ? d->interval*2 : min;
+  else
+    d->interval = (Integer32)target;
+
+  DBGV("delay mean %dns, interval %d\n", d->mean, d->interval);
+}
+
+/*
+ * The credit kept for the current master, or if there is none, the entry
+ * for the master that has gone longest without a Delay_Req, taken over.
+ */
+static DelayReqCredit *delayReqCredit(PtpClock *ptpClock, Boolean *found)
+{
+  DelayReqCredit *c, *oldest;
+  TimeInternal age;
+
+  oldest = ptpClock->delay_req.master;
+  for(c = ptpClock->delay_req.master; c < ptpClock->delay_req.master + DELAY_REQ_MASTERS; c++)
+  {
+    if(c->parent_port_id == ptpClock->parent_port_id &&
+      !memcmp(c->parent_uuid, ptpClock->parent_uuid, PTP_UUID_LENGTH))
+    {
+      *found = TRUE;
+      return c;
+    }
+    subTime(&age, &c->last, &oldest->last);
+    if(age.seconds < 0 || age.nanoseconds < 0)
+      oldest = c;
+  }
+
+  *found = FALSE;
+  oldest->parent_port_id = ptpClock->parent_port_id;
+  memcpy(oldest->parent_uuid, ptpClock->parent_uuid, PTP_UUID_LENGTH);
+  return oldest;
+}
+
+/*
+ * Whether a Delay_Req that is due may be sent to the current master now,
+ * which takes its cost from the master's credit.
+ */
+Boolean delayReqAllowed(RunTimeOpts *rtOpts, PtpClock *ptpClock)
+{
+  DelayReqCredit *d;
+  TimeInternal elapsed;
+  Integer32 cost;
+  Boolean found;
+
+  d = delayReqCredit(ptpClock, &found);
+  if(!found)
+    d->sent = d->deferred = 0;
+  if(!rtOpts->delayReqLimit)
+  {
+    d->sent++;
+    return TRUE;
+  }
+  cost = 60000/rtOpts->delayReqLimit;
+
+  /* a master not slaved to lately starts with a full burst of credit */
+  if(!found)
+    d->credit = DELAY_REQ_BURST*cost;
+  else
+  {
+    /* credit for the time since the last, unless the clock was stepped back */
+    subTime(&elapsed, &ptpClock->sync_receive_time, &d->last);
+    if(elapsed.seconds >= 60*DELAY_REQ_BURST)
+      d->credit = DELAY_REQ_BURST*cost;
+    else if(elapsed.seconds >= 0 && elapsed.nanoseconds >= 0)
+      d->credit += elapsed.seconds*1000 + elapsed.nanoseconds/1000000;
+    if(d->credit > DELAY_REQ_BURST*cost)
+      d->credit = DELAY_REQ_BURST*cost;
+  }
+  d->last = ptpClock->sync_receive_time;
+
+  if(d->credit < cost)
+  {
+    d->deferred++;
+    return FALSE;
+  }
+
+  d->credit -= cost;
+  d->sent++;
+  return TRUE;
+}
+
+/* syncs until the next Delay_Req, spread over a quarter of the interval
+   either side so that slaves that started together do not send together */
+UInteger16 delayReqInterval(RunTimeOpts *rtOpts, PtpClock *ptpClock)
+{
+  DelayReqSched *d = &ptpClock->delay_req;
+  Integer32 interval, min, max;
+
+  if(!rtOpts->delayReqAdapt)
+    return getRand(&ptpClock->random_seed) % (PTP_DELAY_REQ_INTERVAL - 2) + 2;
+
+  delayReqBounds(&min, &max, rtOpts);
+  interval = d->interval;
+  if(interval < min)
+    interval = min;
+  else if(interval > max)
+    interval = max;
+
+  return interval - interval/4 + getRand(&ptpClock->random_seed) % (interval/2 + 1);
+}
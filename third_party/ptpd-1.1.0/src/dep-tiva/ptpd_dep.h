@@ -100,6 +100,19 @@ void msgPackDelayResp(char*,MsgHeader*,TimeRepresentation*,PtpClock*);
 UInteger16 msgPackManagement(char*,MsgManagement*,PtpClock*);
 UInteger16 msgPackManagementResponse(char*,MsgHeader*,MsgManagement*,PtpClock*);
 
+/* msg_v2.c */
+void msgUnpackHeaderV2(char*,MsgHeaderV2*);
+void msgUnpackAnnounce(char*,MsgAnnounce*);
+void msgUnpackSyncV2(char*,MsgSyncV2*);
+void msgUnpackFollowUpV2(char*,MsgFollowUpV2*);
+void msgUnpackDelayRespV2(char*,MsgDelayRespV2*);
+void msgPackHeaderV2(char*,UInteger8,UInteger8,UInteger16,UInteger16,Integer8,PtpClock*);
+void msgPackAnnounce(char*,TimeRepresentation*,PtpClock*);
+void msgPackSyncV2(char*,TimeRepresentation*,PtpClock*);
+void msgPackFollowUpV2(char*,TimeRepresentation*,PtpClock*);
+void msgPackDelayReqV2(char*,TimeRepresentation*,PtpClock*);
+void msgPackDelayRespV2(char*,MsgHeaderV2*,TimeRepresentation*,PtpClock*);
+
 /* net.c */
 Boolean netInit(NetPath*,RunTimeOpts*,PtpClock*);
 Boolean netShutdown(NetPath*);
@@ -110,12 +123,46 @@ size_t netSendEvent(Octet*,UInteger16,NetPath*);
 size_t netSendGeneral(Octet*,UInteger16,NetPath*);
 
 /* servo.c */
+typedef struct {
+  const char *name;
+  void (*reset)(UInteger8,RunTimeOpts*,PtpClock*); /* start in a state, from observed_drift */
+  Integer32 (*sample)(Integer32,RunTimeOpts*,PtpClock*); /* offset in, ppb out */
+  void (*stats)(PtpClock*,ServoStats*);      /* fill in freq and spread */
+} ServoOps;
+
+extern const ServoOps servoPI;
+extern const ServoOps servoLinreg;
+extern const ServoOps servoKalman;
+
 void initClock(RunTimeOpts*,PtpClock*);
 void updateDelay(TimeInternal*,TimeInternal*,
   one_way_delay_filter*,RunTimeOpts*,PtpClock*);
 void updateOffset(TimeInternal*,TimeInternal*,
   offset_from_master_filter*,RunTimeOpts*,PtpClock*);
 void updateClock(RunTimeOpts*,PtpClock*);
+void initHoldover(PtpClock*);
+void startHoldover(RunTimeOpts*,PtpClock*);
+void updateHoldover(RunTimeOpts*,PtpClock*);
+void initSnapshot(PtpClock*);
+Integer32 saturate64(Integer64);
+
+/* rate.c */
+void initRate(Boolean,PtpClock*);
+Boolean rateSample(RunTimeOpts*,PtpClock*);
+Integer32 rateDrift(TimeInternal*,TimeInternal*,PtpClock*);
+void rateSteer(Integer32,RunTimeOpts*,PtpClock*);
+
+/* pdv.c */
+void initPdv(PtpClock*);
+Boolean pdvOffset(RunTimeOpts*,PtpClock*);
+Boolean pdvDelay(RunTimeOpts*,PtpClock*);
+void pdvSteer(Integer32,RunTimeOpts*,PtpClock*);
+
+/* delayreq.c */
+void initDelayReq(PtpClock*);
+void delayReqSample(RunTimeOpts*,PtpClock*);
+Boolean delayReqAllowed(RunTimeOpts*,PtpClock*);
+UInteger16 delayReqInterval(RunTimeOpts*,PtpClock*);
 
 /* sys.c */
 void displayStats(RunTimeOpts*,PtpClock*);
@@ -124,13 +171,15 @@ void getTime(TimeInternal*);
 void setTime(TimeInternal*);
 UInteger16 getRand(UInteger32*);
 Boolean adjFreq(Integer32);
+Boolean loadSnapshot(ServoSnapshot*);
+void saveSnapshot(ServoSnapshot*);
 
 /* timer.c */
+tWheel *timerWheel(void);
+void timerWake(void);
 void initTimer(void);
-void timerTick(int);
-void timerUpdate(IntervalTimer*);
 void timerStop(UInteger16,IntervalTimer*);
-void timerStart(UInteger16,UInteger16,IntervalTimer*);
+void timerStart(UInteger16,UInteger32,IntervalTimer*);
 Boolean timerExpired(UInteger16,IntervalTimer*);
 
 
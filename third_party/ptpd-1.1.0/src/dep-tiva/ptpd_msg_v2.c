@@ -0,0 +1,189 @@
+/* ptpd_msg_v2.c */
+/* see IEEE 1588-2008 clause 13 */
+
+#include "../ptpd.h"
+
+/* a Timestamp: 48 bits of seconds, of which only the low 32 are kept, and
+   32 of nanoseconds */
+static void unpackTimestampV2(char *buf, TimeRepresentation *time)
+{
+  time->seconds = flip32(*(UInteger32*)(buf + 2));
+  time->nanoseconds = flip32(*(Integer32*)(buf + 6));
+}
+
+static void packTimestampV2(char *buf, TimeRepresentation *time)
+{
+  *(UInteger16*)(buf + 0) = 0;
+  *(UInteger32*)(buf + 2) = flip32(time->seconds);
+  *(Integer32*)(buf + 6) = flip32(time->nanoseconds);
+}
+
+static void unpackPortIdentity(char *buf, PortIdentity *port)
+{
+  memcpy(port->clockIdentity, buf, PTP_V2_CLOCK_IDENTITY_LENGTH);
+  port->portNumber = flip16(*(UInteger16*)(buf + 8));
+}
+
+static void packPortIdentity(char *buf, PortIdentity *port)
+{
+  memcpy(buf, port->clockIdentity, PTP_V2_CLOCK_IDENTITY_LENGTH);
+  *(UInteger16*)(buf + 8) = flip16(port->portNumber);
+}
+
+void msgUnpackHeaderV2(char *buf, MsgHeaderV2 *header)
+{
+  header->transportSpecific = (*(UInteger8*)(buf + 0) >> 4) & 0x0F;
+  header->messageType = *(UInteger8*)(buf + 0) & 0x0F;
+  header->versionPTP = *(UInteger8*)(buf + 1) & 0x0F;
+  DBGV("msgUnpackHeaderV2: messageType %d\n", header->messageType);
+  DBGV("msgUnpackHeaderV2: versionPTP %d\n", header->versionPTP);
+
+  header->messageLength = flip16(*(UInteger16*)(buf + 2));
+  header->domainNumber = *(UInteger8*)(buf + 4);
+  DBGV("msgUnpackHeaderV2: messageLength %d\n", header->messageLength);
+  DBGV("msgUnpackHeaderV2: domainNumber %d\n", header->domainNumber);
+
+  memcpy(header->flagField, (buf + 6), 2);
+  DBGV("msgUnpackHeaderV2: flagField %02x %02x\n", header->flagField[0], header->flagField[1]);
+
+  header->correctionField = (Integer64)(Integer32)flip32(*(UInteger32*)(buf + 8)) << 32 |
+    flip32(*(UInteger32*)(buf + 12));
+
+  unpackPortIdentity(buf + 20, &header->sourcePortIdentity);
+  DBGV("msgUnpackHeaderV2: sourcePortIdentity %02x%02x%02x%02x%02x%02x%02x%02x/%d\n",
+    header->sourcePortIdentity.clockIdentity[0], header->sourcePortIdentity.clockIdentity[1],
+    header->sourcePortIdentity.clockIdentity[2], header->sourcePortIdentity.clockIdentity[3],
+    header->sourcePortIdentity.clockIdentity[4], header->sourcePortIdentity.clockIdentity[5],
+    header->sourcePortIdentity.clockIdentity[6], header->sourcePortIdentity.clockIdentity[7],
+    header->sourcePortIdentity.portNumber);
+
+  header->sequenceId = flip16(*(UInteger16*)(buf + 30));
+  header->controlField = *(UInteger8*)(buf + 32);
+  header->logMessageInterval = *(Integer8*)(buf + 33);
+  DBGV("msgUnpackHeaderV2: sequenceId %d\n", header->sequenceId);
+  DBGV("msgUnpackHeaderV2: logMessageInterval %d\n", header->logMessageInterval);
+}
+
+void msgUnpackAnnounce(char *buf, MsgAnnounce *announce)
+{
+  unpackTimestampV2(buf + 34, &announce->originTimestamp);
+  announce->currentUtcOffset = flip16(*(Integer16*)(buf + 44));
+  DBGV("msgUnpackAnnounce: currentUtcOffset %d\n", announce->currentUtcOffset);
+  announce->grandmasterPriority1 = *(UInteger8*)(buf + 47);
+  announce->grandmasterClockQuality.clockClass = *(UInteger8*)(buf + 48);
+  announce->grandmasterClockQuality.clockAccuracy = *(UInteger8*)(buf + 49);
+  announce->grandmasterClockQuality.offsetScaledLogVariance = flip16(*(UInteger16*)(buf + 50));
+  announce->grandmasterPriority2 = *(UInteger8*)(buf + 52);
+  DBGV("msgUnpackAnnounce: grandmaster priority1 %d class %d accuracy %02x variance %04x priority2 %d\n",
+    announce->grandmasterPriority1, announce->grandmasterClockQuality.clockClass,
+    announce->grandmasterClockQuality.clockAccuracy,
+    announce->grandmasterClockQuality.offsetScaledLogVariance, announce->grandmasterPriority2);
+  memcpy(announce->grandmasterIdentity, (buf + 53), PTP_V2_CLOCK_IDENTITY_LENGTH);
+  /* stepsRemoved is the one field at an odd offset */
+  announce->stepsRemoved = *(UInteger8*)(buf + 61) << 8 | *(UInteger8*)(buf + 62);
+  announce->timeSource = *(UInteger8*)(buf + 63);
+  DBGV("msgUnpackAnnounce: stepsRemoved %d\n", announce->stepsRemoved);
+}
+
+void msgUnpackSyncV2(char *buf, MsgSyncV2 *sync)
+{
+  unpackTimestampV2(buf + 34, &sync->originTimestamp);
+  DBG("msgUnpackSyncV2: originTimestamp.seconds %u\n", sync->originTimestamp.seconds);
+  DBG("msgUnpackSyncV2: originTimestamp.nanoseconds %d\n", sync->originTimestamp.nanoseconds);
+}
+
+void msgUnpackFollowUpV2(char *buf, MsgFollowUpV2 *follow)
+{
+  unpackTimestampV2(buf + 34, &follow->preciseOriginTimestamp);
+  DBG("msgUnpackFollowUpV2: preciseOriginTimestamp.seconds %u\n", follow->preciseOriginTimestamp.seconds);
+  DBG("msgUnpackFollowUpV2: preciseOriginTimestamp.nanoseconds %d\n", follow->preciseOriginTimestamp.nanoseconds);
+}
+
+void msgUnpackDelayRespV2(char *buf, MsgDelayRespV2 *resp)
+{
+  unpackTimestampV2(buf + 34, &resp->receiveTimestamp);
+  DBGV("msgUnpackDelayRespV2: receiveTimestamp.seconds %u\n", resp->receiveTimestamp.seconds);
+  DBGV("msgUnpackDelayRespV2: receiveTimestamp.nanoseconds %d\n", resp->receiveTimestamp.nanoseconds);
+  unpackPortIdentity(buf + 44, &resp->requestingPortIdentity);
+}
+
+/* the whole header, as each message differs in most of it */
+void msgPackHeaderV2(char *buf, UInteger8 messageType, UInteger8 control,
+  UInteger16 length, UInteger16 sequenceId, Integer8 logMessageInterval,
+  PtpClock *ptpClock)
+{
+  memset(buf, 0, V2_HEADER_LENGTH);
+
+  *(UInteger8*)(buf + 0) = messageType & 0x0F;
+  *(UInteger8*)(buf + 1) = VERSION_PTP_V2;
+  *(UInteger16*)(buf + 2) = flip16(length);
+  *(UInteger8*)(buf + 4) = ptpClock->domain_number;
+  packPortIdentity(buf + 20, &ptpClock->port_identity);
+  *(UInteger16*)(buf + 30) = flip16(sequenceId);
+  *(UInteger8*)(buf + 32) = control;
+  *(Integer8*)(buf + 33) = logMessageInterval;
+}
+
+void msgPackAnnounce(char *buf, TimeRepresentation *originTimestamp, PtpClock *ptpClock)
+{
+  msgPackHeaderV2(buf, PTP_V2_ANNOUNCE, PTP_V2_CONTROL_OTHER,
+    V2_ANNOUNCE_PACKET_LENGTH, ptpClock->sent_announce_sequence_id,
+    ptpClock->log_announce_interval, ptpClock);
+  if(ptpClock->leap_61)
+    *(UInteger8*)(buf + 7) |= PTP_V2_LI_61;
+  if(ptpClock->leap_59)
+    *(UInteger8*)(buf + 7) |= PTP_V2_LI_59;
+
+  packTimestampV2(buf + 34, originTimestamp);
+  *(Integer16*)(buf + 44) = flip16(ptpClock->current_utc_offset);
+  *(UInteger8*)(buf + 46) = 0;
+  *(UInteger8*)(buf + 47) = ptpClock->grandmaster_priority1;
+  *(UInteger8*)(buf + 48) = ptpClock->grandmaster_clock_quality.clockClass;
+  *(UInteger8*)(buf + 49) = ptpClock->grandmaster_clock_quality.clockAccuracy;
+  *(UInteger16*)(buf + 50) = flip16(ptpClock->grandmaster_clock_quality.offsetScaledLogVariance);
+  *(UInteger8*)(buf + 52) = ptpClock->grandmaster_priority2;
+  memcpy((buf + 53), ptpClock->grandmaster_identity, PTP_V2_CLOCK_IDENTITY_LENGTH);
+  *(UInteger8*)(buf + 61) = ptpClock->steps_removed >> 8;
+  *(UInteger8*)(buf + 62) = ptpClock->steps_removed;
+  *(UInteger8*)(buf + 63) = ptpClock->time_source;
+}
+
+void msgPackSyncV2(char *buf, TimeRepresentation *originTimestamp, PtpClock *ptpClock)
+{
+  msgPackHeaderV2(buf, PTP_V2_SYNC, PTP_SYNC_MESSAGE, V2_SYNC_PACKET_LENGTH,
+    ptpClock->sent_sync_sequence_id, ptpClock->sync_interval, ptpClock);
+  if(ptpClock->clock_followup_capable)
+    *(UInteger8*)(buf + 6) |= PTP_V2_TWO_STEP;
+
+  packTimestampV2(buf + 34, originTimestamp);
+}
+
+void msgPackFollowUpV2(char *buf, TimeRepresentation *preciseOriginTimestamp, PtpClock *ptpClock)
+{
+  msgPackHeaderV2(buf, PTP_V2_FOLLOW_UP, PTP_FOLLOWUP_MESSAGE, V2_FOLLOW_UP_PACKET_LENGTH,
+    ptpClock->sent_sync_sequence_id, ptpClock->sync_interval, ptpClock);
+
+  packTimestampV2(buf + 34, preciseOriginTimestamp);
+}
+
+void msgPackDelayReqV2(char *buf, TimeRepresentation *originTimestamp, PtpClock *ptpClock)
+{
+  msgPackHeaderV2(buf, PTP_V2_DELAY_REQ, PTP_DELAY_REQ_MESSAGE, V2_DELAY_REQ_PACKET_LENGTH,
+    ptpClock->sentDelayReqSequenceId, PTP_V2_LOG_INTERVAL_UNUSED, ptpClock);
+
+  packTimestampV2(buf + 34, originTimestamp);
+}
+
+/* the Delay_Req's correction and sequence are returned with the time it
+   was received */
+void msgPackDelayRespV2(char *buf, MsgHeaderV2 *header,
+  TimeRepresentation *receiveTimestamp, PtpClock *ptpClock)
+{
+  msgPackHeaderV2(buf, PTP_V2_DELAY_RESP, PTP_DELAY_RESP_MESSAGE, V2_DELAY_RESP_PACKET_LENGTH,
+    header->sequenceId, ptpClock->log_min_delay_req_interval, ptpClock);
+  *(UInteger32*)(buf + 8) = flip32((UInteger32)(header->correctionField >> 32));
+  *(UInteger32*)(buf + 12) = flip32((UInteger32)header->correctionField);
+
+  packTimestampV2(buf + 34, receiveTimestamp);
+  packPortIdentity(buf + 44, &header->sourcePortIdentity);
+}
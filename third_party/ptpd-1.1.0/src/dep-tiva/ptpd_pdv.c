@@ -0,0 +1,166 @@
+/* ptpd_pdv.c */
+
+#include "../ptpd.h"
+
+/*
+ * Packet delay variation filters.  Queueing in the switches only ever adds
+ * to the path delay, so over a window of the last PDV_WINDOW delays in each
+ * direction the smallest is the packet that queued least, and the offset
+ * and one-way delay are computed from the delays this selects rather than
+ * from the latest ones.  PDV_MIN takes the smallest (the lucky packet);
+ * PDV_MEDIAN takes the median of the delays up to the rtOpts->pdvGate
+ * percentile of the window, and counts those above it as rejected.
+ *
+ * The servo steers the clock between samples, which moves the delays
+ * measured against it.  The clock is taken to run at observed_drift, so the
+ * offset moves by the rest of the correction applied; each delay is kept
+ * less the phase moved when it was taken, and the window is projected to
+ * now by adding back the phase moved since.  Until the servo is tracking
+ * its frequency is too far off for that, so the filter is only used once
+ * the servo engine reports SERVO_TRACK, and the windows are cleared
+ * whenever it does not.
+ */
+
+/* clear the windows, as after a step */
+void initPdv(PtpClock *ptpClock)
+{
+  memset(&ptpClock->pdv_filt, 0, sizeof(ptpClock->pdv_filt));
+}
+
+/* the phase moved up to a time, or FALSE if the windows are too old to
+   project to it */
+static Boolean pdvMovedAt(TimeInternal *time, Integer64 *moved, PtpClock *ptpClock)
+{
+  PdvFilter *pdv = &ptpClock->pdv_filt;
+  TimeInternal elapsed;
+
+  subTime(&elapsed, time, &pdv->last);
+  if(ptpClock->hold.active || elapsed.seconds >= PDV_MAX_GAP_S ||
+    elapsed.seconds < 0 || elapsed.nanoseconds < 0)
+    return FALSE;
+
+  *moved = pdv->moved - (Integer64)pdv->rate *
+    ((Integer64)elapsed.seconds*1000000000 + elapsed.nanoseconds) / 1000000000;
+  return TRUE;
+}
+
+/*
+ * Add a delay to a window and take the estimate from it.  The sign is how
+ * the delay moves with the offset: +1 master to slave, -1 slave to master.
+ */
+static Integer32 pdvSample(PdvWindow *w, Integer32 delay, Integer32 sign,
+  Integer64 moved, RunTimeOpts *rtOpts)
+{
+  Integer64 s[PDV_WINDOW], v;
+  Integer32 i, j, kept;
+
+  w->v[w->head] = delay - sign*moved;
+  w->head = (w->head + 1) % PDV_WINDOW;
+  if(w->n < PDV_WINDOW)
+    w->n++;
+
+  /* the window projected to now, sorted; it is small enough to insert */
+  for(i = 0; i < w->n; i++)
+  {
+    v = w->v[i] + sign*moved;
+    for(j = i; j > 0 && s[j-1] > v; j--)
+      s[j] = s[j-1];
+    s[j] = v;
+  }
+
+  kept = w->n*rtOpts->pdvGate/100;
+  if(kept < 1)
+    kept = 1;
+  else if(kept > w->n)
+    kept = w->n;
+
+  w->min = saturate64(s[0]);
+  w->median = saturate64(s[(w->n - 1)/2]);
+  w->max = saturate64(s[w->n - 1]);
+  w->rejected = w->n - kept;
+  w->selected = rtOpts->pdvFilter == PDV_MIN ? w->min : saturate64(s[(kept - 1)/2]);
+
+  return w->selected;
+}
+
+/*
+ * Set offset_from_master from the master to slave delay just measured.
+ * Returns FALSE, having cleared the windows, if the delay cannot be
+ * filtered, and the caller takes it as it is.
+ */
+Boolean pdvOffset(RunTimeOpts *rtOpts, PtpClock *ptpClock)
+{
+  PdvFilter *pdv = &ptpClock->pdv_filt;
+  TimeInternal selected;
+  Integer64 moved;
+
+  if(ptpClock->master_to_slave_delay.seconds ||
+    ptpClock->servo_stats.state != SERVO_TRACK)
+  {
+    initPdv(ptpClock);
+    return FALSE;
+  }
+
+  if(!pdvMovedAt(&ptpClock->sync_receive_time, &moved, ptpClock))
+  {
+    initPdv(ptpClock);
+    pdv->last = ptpClock->sync_receive_time;
+    moved = 0;
+  }
+
+  selected.seconds = 0;
+  selected.nanoseconds = pdvSample(&pdv->m2s,
+    ptpClock->master_to_slave_delay.nanoseconds, 1, moved, rtOpts);
+  subTime(&ptpClock->offset_from_master, &selected, &ptpClock->one_way_delay);
+
+  DBGV("pdv offset %d, m2s %d..%d\n", ptpClock->offset_from_master.nanoseconds,
+    pdv->m2s.min, pdv->m2s.max);
+  return TRUE;
+}
+
+/*
+ * Set one_way_delay from the slave to master delay just measured and the
+ * master to slave window.  Returns FALSE if the delay cannot be filtered,
+ * and the caller takes it as it is.
+ */
+Boolean pdvDelay(RunTimeOpts *rtOpts, PtpClock *ptpClock)
+{
+  PdvFilter *pdv = &ptpClock->pdv_filt;
+  Integer64 moved;
+  Integer32 s2m, m2s;
+
+  if(ptpClock->slave_to_master_delay.seconds || !pdv->m2s.n ||
+    !pdvMovedAt(&ptpClock->delay_req_send_time, &moved, ptpClock))
+    return FALSE;
+
+  s2m = pdvSample(&pdv->s2m, ptpClock->slave_to_master_delay.nanoseconds, -1,
+    moved, rtOpts);
+
+  /* the master to slave window, projected to the same time */
+  m2s = pdv->m2s.selected + saturate64(moved - pdv->moved);
+
+  ptpClock->one_way_delay.seconds = 0;
+  ptpClock->one_way_delay.nanoseconds = m2s/2 + s2m/2;
+
+  DBG("pdv delay %d, s2m %d..%d, %d rejected\n",
+    ptpClock->one_way_delay.nanoseconds, pdv->s2m.min, pdv->s2m.max,
+    pdv->s2m.rejected);
+  return TRUE;
+}
+
+/* bring the windows up to the last sync, and keep the part of the servo's
+   correction there, adj ppb, that is not frequency, which moves the delays */
+void pdvSteer(Integer32 adj, RunTimeOpts *rtOpts, PtpClock *ptpClock)
+{
+  PdvFilter *pdv = &ptpClock->pdv_filt;
+
+  if(!pdvMovedAt(&ptpClock->sync_receive_time, &pdv->moved, ptpClock))
+    initPdv(ptpClock);
+  pdv->last = ptpClock->sync_receive_time;
+
+  if(adj > ADJ_MAX)
+    adj = ADJ_MAX;
+  else if(adj < -ADJ_MAX)
+    adj = -ADJ_MAX;
+  pdv->rate = rtOpts->noAdjust ? 0 : adj - ptpClock->observed_drift;
+}
@@ -0,0 +1,127 @@
+/* ptpd_rate.c */
+
+#include "../ptpd.h"
+
+/*
+ * The oscillator's frequency error, measured directly from sync to sync.
+ * The master to slave delay of each sync is the path delay plus the offset,
+ * so over a block of RATE_WINDOW syncs its least-squares slope against the
+ * receive time is the frequency error less the correction applied, and the
+ * correction averaged over the block adds back to give the error itself.
+ *
+ * After a cold start the servo engine is held off until the first block is
+ * measured, and is then started from it, rather than have the I term learn
+ * the frequency one offset at a time.  The one-way delay measured before
+ * then was thrown off by the frequency error, so the engine waits for the
+ * next one too.  The measurement carries on after that for updateDelay(),
+ * which uses it for how far the offset moved between the Sync and the
+ * Delay_Req.
+ */
+
+/* start measuring afresh; applied is TRUE if the servo is already starting
+   from a frequency, and need not wait for one */
+void initRate(Boolean applied, PtpClock *ptpClock)
+{
+  memset(&ptpClock->rate, 0, sizeof(ptpClock->rate));
+  ptpClock->rate.applied = ptpClock->rate.delayed = applied;
+}
+
+/* start a block at the last sync */
+static void rateStart(PtpClock *ptpClock)
+{
+  RateEstimator *rate = &ptpClock->rate;
+
+  rate->n = 1;
+  rate->first = ptpClock->sync_receive_time;
+  rate->y0 = ptpClock->master_to_slave_delay.nanoseconds;
+  rate->st = rate->sy = rate->stt = rate->sty = 0;
+  rate->sum_adj = 0;
+  rate->last_ms = 0;
+}
+
+/*
+ * Add the last sync to the block.  Returns TRUE if this measured the
+ * frequency for the first time since a cold start, and observed_drift has
+ * been set to it, so the servo engine must be reset.
+ */
+Boolean rateSample(RunTimeOpts *rtOpts, PtpClock *ptpClock)
+{
+  RateEstimator *rate = &ptpClock->rate;
+  TimeInternal elapsed;
+  Integer64 t, y, num, den, freq;
+
+  subTime(&elapsed, &ptpClock->sync_receive_time, &rate->first);
+  t = (Integer64)elapsed.seconds*1000 + elapsed.nanoseconds/1000000;
+  y = (Integer64)ptpClock->master_to_slave_delay.nanoseconds - rate->y0;
+
+  /* a block spanning a holdover, a large step or a long gap is no use */
+  if(!rate->n || ptpClock->hold.active || ptpClock->master_to_slave_delay.seconds ||
+    elapsed.seconds >= RATE_MAX_SPAN_S || t <= rate->last_ms ||
+    y >= RATE_MAX_NS || y <= -RATE_MAX_NS)
+  {
+    rateStart(ptpClock);
+    return FALSE;
+  }
+
+  rate->sum_adj += (Integer64)rate->adj*(t - rate->last_ms);
+  rate->last_ms = t;
+  rate->st += t;
+  rate->sy += y;
+  rate->stt += t*t;
+  rate->sty += t*y;
+
+  if(++rate->n < RATE_WINDOW)
+    return FALSE;
+
+  /* nsec per msec is a thousand ppb; the first sync is at t = y = 0 */
+  num = rate->n*rate->sty - rate->st*rate->sy;
+  den = rate->n*rate->stt - rate->st*rate->st;
+  freq = num*1000/den + rate->sum_adj/t;
+  if(freq > ADJ_MAX)
+    freq = ADJ_MAX;
+  else if(freq < -ADJ_MAX)
+    freq = -ADJ_MAX;
+
+  rate->freq = (Integer32)freq;
+  rate->valid = TRUE;
+  rateStart(ptpClock);
+
+  DBG("rate %dppb\n", rate->freq);
+
+  if(rate->applied)
+    return FALSE;
+
+  rate->applied = TRUE;
+  ptpClock->observed_drift = rate->freq;
+  return TRUE;
+}
+
+/* how far the offset has moved from one time to another, on the frequency
+   measured, in nsec */
+Integer32 rateDrift(TimeInternal *from, TimeInternal *to, PtpClock *ptpClock)
+{
+  RateEstimator *rate = &ptpClock->rate;
+  TimeInternal elapsed;
+  Integer32 ms;
+
+  if(!rate->valid)
+    return 0;
+
+  subTime(&elapsed, to, from);
+  if(elapsed.seconds >= RATE_MAX_SPAN_S || elapsed.seconds <= -RATE_MAX_SPAN_S)
+    return 0;
+  ms = elapsed.seconds*1000 + elapsed.nanoseconds/1000000;
+
+  return (Integer32)((Integer64)(rate->freq - rate->adj)*ms/1000);
+}
+
+/* keep the servo's correction at the last sync, adj ppb, to take back out
+   of the frequency measured */
+void rateSteer(Integer32 adj, RunTimeOpts *rtOpts, PtpClock *ptpClock)
+{
+  if(adj > ADJ_MAX)
+    adj = ADJ_MAX;
+  else if(adj < -ADJ_MAX)
+    adj = -ADJ_MAX;
+  ptpClock->rate.adj = rtOpts->noAdjust ? 0 : adj;
+}
@@ -2,25 +2,93 @@
 
 #include "../ptpd.h"
 
+/* the servo engines, by SERVO_* */
+static const ServoOps *const servoOps[SERVO_COUNT] = {
+  &servoPI, &servoLinreg, &servoKalman
+};
+
+/* the engine asked for, or the PI engine if there is no such engine */
+static UInteger8 servoSelected(RunTimeOpts *rtOpts)
+{
+  return rtOpts->servo < SERVO_COUNT ? rtOpts->servo : SERVO_PI;
+}
+
+/* start the engine asked for afresh, in the state given, from
+   observed_drift */
+static void resetServo(UInteger8 state, RunTimeOpts *rtOpts, PtpClock *ptpClock)
+{
+  ptpClock->servo = servoSelected(rtOpts);
+  memset(&ptpClock->servo_stats, 0, sizeof(ptpClock->servo_stats));
+  servoOps[ptpClock->servo]->reset(state, rtOpts, ptpClock);
+
+  DBG("servo %s\n", servoOps[ptpClock->servo]->name);
+}
+
+/* whether the snapshot was saved while slave to the current parent */
+static Boolean matchSnapshot(PtpClock *ptpClock)
+{
+  return ptpClock->snap_valid
+    && ptpClock->snap.parent_communication_technology == ptpClock->parent_communication_technology
+    && ptpClock->snap.parent_port_id == ptpClock->parent_port_id
+    && !memcmp(ptpClock->snap.parent_uuid, ptpClock->parent_uuid, PTP_UUID_LENGTH);
+}
+
 void initClock(RunTimeOpts *rtOpts, PtpClock *ptpClock)
 {
+  Boolean warm, cold;
+
   DBG("initClock\n");
 
+  warm = matchSnapshot(ptpClock);
+  cold = !warm && !ptpClock->hold.active;
+
   /* clear vars */
   ptpClock->master_to_slave_delay.seconds = ptpClock->master_to_slave_delay.nanoseconds = 0;
   ptpClock->slave_to_master_delay.seconds = ptpClock->slave_to_master_delay.nanoseconds = 0;
   ptpClock->observed_variance = 0;
-  ptpClock->observed_drift = 0;  /* clears clock servo accumulator (the I term) */
+  /* clears clock servo accumulator (the I term), or starts it from the
+     frequency held since the master was lost, or from the one saved with
+     this master before a restart */
+  if(ptpClock->hold.active)
+    ptpClock->observed_drift = ptpClock->hold.adj;
+  else if(warm)
+    ptpClock->observed_drift = ptpClock->snap.drift;
+  else
+    ptpClock->observed_drift = 0;
+  ptpClock->hold.active = FALSE;
+  ptpClock->hold.sum_freq = ptpClock->hold.sum_dev = 0;
+  ptpClock->hold.max_te = ptpClock->hold.sum_ms = 0;
   ptpClock->owd_filt.s_exp = 0;  /* clears one-way delay filter */
+  ptpClock->ofm_filt.nsec_prev = 0;  /* clears offset filter */
+  initPdv(ptpClock);  /* clears delay variation windows */
+  initDelayReq(ptpClock);  /* samples the delay afresh */
+  ptpClock->slewing = FALSE;
+  ptpClock->slew_total = ptpClock->slew_residual = ptpClock->slew_rate = 0;
   ptpClock->halfEpoch = ptpClock->halfEpoch || rtOpts->halfEpoch;
   rtOpts->halfEpoch = 0;
 
-  rtOpts->ai = DEFAULT_AI;
-  rtOpts->ap = DEFAULT_AP;
+  /* a warm start also takes the saved delay until one has been measured,
+     and the servo starts in the state it was saved in */
+  if(warm)
+  {
+    DBG("warm start, %dppb, %dns\n", ptpClock->snap.drift, ptpClock->snap.delay);
+
+    if(!ptpClock->one_way_delay.seconds && !ptpClock->one_way_delay.nanoseconds)
+    {
+      ptpClock->one_way_delay.nanoseconds = ptpClock->snap.delay;
+      ptpClock->owd_filt.y = ptpClock->owd_filt.nsec_prev = ptpClock->snap.delay;
+    }
+  }
+
+  resetServo(warm ? ptpClock->snap.servo_state : SERVO_ACQUIRE, rtOpts, ptpClock);
+
+  /* a cold start measures the frequency before the servo engine runs */
+  initRate(!rtOpts->freqFirst || !cold, ptpClock);
+  rateSteer(ptpClock->observed_drift, rtOpts, ptpClock);
 
   /* level clock */
   if(!rtOpts->noAdjust)
-    adjFreq(0);
+    adjFreq(-ptpClock->observed_drift);
 }
 
 void updateDelay(TimeInternal *send_time, TimeInternal *recv_time,
@@ -33,8 +101,25 @@ void updateDelay(TimeInternal *send_time, TimeInternal *recv_time,
   /* calc 'slave_to_master_delay' */
   subTime(&ptpClock->slave_to_master_delay, recv_time, send_time);
 
-  /* update 'one_way_delay' */
+  /* a delay measured on the frequency the servo engine starts from */
+  ptpClock->rate.delayed = ptpClock->rate.applied;
+
+  /* how often to measure it */
+  delayReqSample(rtOpts, ptpClock);
+
+  /* or take 'one_way_delay' from the delays selected over a window, which
+     the filter below carries on from if the window is given up */
+  if(rtOpts->pdvFilter != PDV_NONE && pdvDelay(rtOpts, ptpClock))
+  {
+    owd_filt->y = owd_filt->nsec_prev = ptpClock->one_way_delay.nanoseconds;
+    return;
+  }
+
+  /* update 'one_way_delay', with the offset the Sync was received at moved
+     on to the one the Delay_Req was sent at */
   addTime(&ptpClock->one_way_delay, &ptpClock->master_to_slave_delay, &ptpClock->slave_to_master_delay);
+  ptpClock->one_way_delay.nanoseconds +=
+    rateDrift(&ptpClock->sync_receive_time, send_time, ptpClock);
 
   //
   // TODO: This looks wrong. If seconds is odd, surely we need to add half
@@ -82,6 +167,13 @@ void updateOffset(TimeInternal *send_time, TimeInternal *recv_time,
   /* calc 'master_to_slave_delay' */
   subTime(&ptpClock->master_to_slave_delay, recv_time, send_time);
 
+  /* or take 'offset_from_master' from the delays selected over a window */
+  if(rtOpts->pdvFilter != PDV_NONE && pdvOffset(rtOpts, ptpClock))
+  {
+    ofm_filt->nsec_prev = ptpClock->offset_from_master.nanoseconds;
+    return;
+  }
+
   /* update 'offset_from_master' */
   subTime(&ptpClock->offset_from_master, &ptpClock->master_to_slave_delay, &ptpClock->one_way_delay);
 
@@ -92,6 +184,13 @@ void updateOffset(TimeInternal *send_time, TimeInternal *recv_time,
     return;
   }
 
+  if(ptpClock->slewing)
+  {
+    /* the filter would lag the slew by half a step, so pass the offset through */
+    ofm_filt->nsec_prev = ptpClock->offset_from_master.nanoseconds;
+    return;
+  }
+
   /* filter 'offset_from_master' */
   ofm_filt->y = ptpClock->offset_from_master.nanoseconds/2 + ofm_filt->nsec_prev/2;
   ofm_filt->nsec_prev = ptpClock->offset_from_master.nanoseconds;
@@ -100,67 +199,293 @@ void updateOffset(TimeInternal *send_time, TimeInternal *recv_time,
   DBGV("offset filter %d\n", ofm_filt->y);
 }
 
+/* a time in nanoseconds, saturated at +/-2^31 */
+static Integer32 saturateNs(TimeInternal *time)
+{
+  if(time->seconds >= 2)
+    return 0x7FFFFFFF;
+  else if(time->seconds <= -2)
+    return -0x7FFFFFFF;
+  else
+    return time->seconds*1000000000 + time->nanoseconds;
+}
+
+/* start slewing an offset out at a rate that takes rtOpts->slewWindow */
+static void startSlew(Integer32 offset, RunTimeOpts *rtOpts, PtpClock *ptpClock)
+{
+  Integer32 rate;
+
+  rate = labs(offset) / (rtOpts->slewWindow > 0 ? rtOpts->slewWindow : 1);
+  if(rate > rtOpts->slewMax)
+    rate = rtOpts->slewMax;
+  if(rate < 1)
+    rate = 1;
+
+  ptpClock->slewing = TRUE;
+  ptpClock->slew_total = ptpClock->slew_residual = offset;
+  ptpClock->slew_rate = rate;
+  ptpClock->slew_last = ptpClock->sync_receive_time;
+
+  DBG("slew %dns at %dppb\n", offset, rate);
+}
+
+/* take the part of the offset slewed out since the last update off the residual */
+static void advanceSlew(PtpClock *ptpClock)
+{
+  TimeInternal elapsed;
+  Integer32 ms, done, left;
+
+  subTime(&elapsed, &ptpClock->sync_receive_time, &ptpClock->slew_last);
+  ptpClock->slew_last = ptpClock->sync_receive_time;
+
+  /* whole milliseconds, up to 100s, keep the product in 32 bits */
+  if(elapsed.seconds >= 100)
+    ms = 100000;
+  else if(elapsed.seconds < 0 || elapsed.nanoseconds < 0)
+    ms = 0;
+  else
+    ms = elapsed.seconds*1000 + elapsed.nanoseconds/1000000;
+
+  done = (ptpClock->slew_rate/1000)*ms + ((ptpClock->slew_rate%1000)*ms)/1000;
+
+  if(done >= labs(ptpClock->slew_residual))
+  {
+    ptpClock->slew_residual = 0;
+    ptpClock->slewing = FALSE;
+  }
+  else
+  {
+    if(ptpClock->slew_residual > 0)
+      ptpClock->slew_residual -= done;
+    else
+      ptpClock->slew_residual += done;
+
+    /* if less than another interval is left, slow down so as not to
+       overshoot, but not so far that a short interval slews out nothing */
+    left = labs(ptpClock->slew_residual);
+    if(left < done)
+    {
+      ptpClock->slew_rate = (left/ms)*1000 + ((left%ms)*1000 + ms - 1)/ms;
+      if(ptpClock->slew_rate < 1)
+        ptpClock->slew_rate = 1;
+    }
+  }
+
+  DBG("slew %d of %dns left\n", ptpClock->slew_residual, ptpClock->slew_total);
+}
+
+/* how far the clock is off the slew: the offset less the part not slewed out yet */
+static Integer32 slewError(PtpClock *ptpClock)
+{
+  TimeInternal error;
+
+  error.seconds = 0;
+  error.nanoseconds = ptpClock->slew_residual;
+  subTime(&error, &ptpClock->offset_from_master, &error);
+
+  return saturateNs(&error);
+}
+
+/* the magnitude of a 64-bit value */
+static Integer64 abs64(Integer64 x)
+{
+  return x < 0 ? -x : x;
+}
+
+/* a 64-bit value, saturated at +/-2^31 */
+Integer32 saturate64(Integer64 x)
+{
+  if(x > 0x7FFFFFFF)
+    return 0x7FFFFFFF;
+  else if(x < -0x7FFFFFFF)
+    return -0x7FFFFFFF;
+  else
+    return (Integer32)x;
+}
+
+/*
+ * Average observed_drift for holdover, in blocks of rtOpts->holdoverWindow
+ * seconds.  Each update is weighted by the time since the one before, and
+ * the mean of the last complete block is the frequency held when the master
+ * is lost.  The drift rate is the least-squares slope of the last
+ * HOLDOVER_BLOCKS block means, which keeps the settling of the servo after
+ * it locks out of the rate once a few blocks have passed.
+ */
+static void averageHoldover(Integer32 error, RunTimeOpts *rtOpts, PtpClock *ptpClock)
+{
+  HoldoverModel *hold = &ptpClock->hold;
+  TimeInternal elapsed;
+  Integer64 ref, mean, num;
+  Integer32 ms, n, i, c, den;
+
+  subTime(&elapsed, &ptpClock->sync_receive_time, &hold->last);
+  hold->last = ptpClock->sync_receive_time;
+
+  if(rtOpts->holdoverWindow <= 0)
+    return;
+
+  /* the first update after a gap only starts the clock */
+  if(elapsed.seconds >= HOLDOVER_MAX_GAP_S || elapsed.seconds < 0 ||
+    elapsed.nanoseconds < 0)
+    return;
+  ms = elapsed.seconds*1000 + elapsed.nanoseconds/1000000;
+
+  /* deviations are taken from the last block's mean, or this one's so far */
+  if(hold->blocks)
+    ref = hold->freq >> HOLDOVER_FRAC_BITS;
+  else if(hold->sum_ms)
+    ref = hold->sum_freq / hold->sum_ms;
+  else
+    ref = ptpClock->observed_drift;
+
+  hold->sum_freq += (Integer64)ptpClock->observed_drift*ms;
+  hold->sum_dev += abs64(ptpClock->observed_drift - ref)*ms;
+  if(labs(error) > hold->max_te)
+    hold->max_te = labs(error);
+  hold->sum_ms += ms;
+
+  if(hold->sum_ms < rtOpts->holdoverWindow*1000)
+    return;
+
+  /* the block is complete */
+  mean = (hold->sum_freq / hold->sum_ms)*HOLDOVER_ONE +
+    (hold->sum_freq % hold->sum_ms)*HOLDOVER_ONE / hold->sum_ms;
+
+  hold->means[hold->blocks % HOLDOVER_BLOCKS] = mean;
+  hold->blocks++;
+
+  /* the slope, oldest block first, with the block numbers centred as c/2 */
+  n = hold->blocks < HOLDOVER_BLOCKS ? hold->blocks : HOLDOVER_BLOCKS;
+  num = 0;
+  den = 0;
+  for(i = 0; i < n; i++)
+  {
+    c = 2*i - (n - 1);
+    num += c*hold->means[(hold->blocks - n + i) % HOLDOVER_BLOCKS];
+    den += c*c;
+  }
+  hold->rate = den ? 2*num / den / rtOpts->holdoverWindow : 0;
+
+  hold->freq = mean;
+  hold->freq_dev = saturate64(hold->sum_dev / hold->sum_ms);
+  hold->te = hold->max_te;
+  hold->sum_freq = hold->sum_dev = 0;
+  hold->max_te = hold->sum_ms = 0;
+
+  DBG("holdover block %d: %dppb +/-%dppb\n", hold->blocks,
+    (Integer32)(hold->freq >> HOLDOVER_FRAC_BITS), hold->freq_dev);
+
+  /* a block that stayed close to the master is kept for a warm start */
+  if(ptpClock->port_state == PTP_SLAVE && hold->te < SNAPSHOT_MAX_TE &&
+    !ptpClock->one_way_delay.seconds)
+  {
+    ptpClock->snap.drift = saturate64((hold->freq + HOLDOVER_ONE/2) >> HOLDOVER_FRAC_BITS);
+    ptpClock->snap.delay = ptpClock->one_way_delay.nanoseconds;
+    ptpClock->snap.servo_state = ptpClock->servo_stats.state;
+    ptpClock->snap.parent_port_id = ptpClock->parent_port_id;
+    ptpClock->snap.parent_communication_technology = ptpClock->parent_communication_technology;
+    memcpy(ptpClock->snap.parent_uuid, ptpClock->parent_uuid, PTP_UUID_LENGTH);
+    ptpClock->snap_valid = TRUE;
+
+    saveSnapshot(&ptpClock->snap);
+  }
+}
+
 void updateClock(RunTimeOpts *rtOpts, PtpClock *ptpClock)
 {
-  Integer32 adj;
+  Integer32 adj, offset, error;
   TimeInternal timeTmp;
-  static unsigned long ulCount = 0;
+  const ServoOps *servo;
+  Boolean measured;
 
   DBGV("updateClock\n");
 
-  if(ptpClock->offset_from_master.seconds)
+  /* the frequency, measured from sync to sync; the first measurement after
+     a cold start is where the servo engine starts from */
+  measured = rateSample(rtOpts, ptpClock);
+  if(measured)
+  {
+    resetServo(SERVO_ACQUIRE, rtOpts, ptpClock);
+
+    /* the delays measured so far were thrown off by the frequency error */
+    ptpClock->owd_filt.s_exp = 0;
+  }
+
+  /* syncs are arriving again, so the servo takes over from holdover, from
+     the frequency and in the state it had */
+  if(ptpClock->hold.active)
   {
-    /* if secs, reset clock or set freq adjustment to max */
+    ptpClock->hold.active = FALSE;
+    resetServo(ptpClock->servo_stats.state, rtOpts, ptpClock);
+  }
+
+  if(ptpClock->servo != servoSelected(rtOpts))
+    resetServo(SERVO_ACQUIRE, rtOpts, ptpClock);
+  servo = servoOps[ptpClock->servo];
+
+  offset = saturateNs(&ptpClock->offset_from_master);
+
+  if(!rtOpts->noResetClock && labs(offset) >= rtOpts->stepThreshold &&
+    labs(offset) >= rtOpts->slewThreshold)
+  {
+    /* too far out to slew, reset clock */
     if(!rtOpts->noAdjust)
     {
-      if(!rtOpts->noResetClock)
-      {
-        getTime(&timeTmp);
-        subTime(&timeTmp, &timeTmp, &ptpClock->offset_from_master);
-        setTime(&timeTmp);
-        initClock(rtOpts, ptpClock);
-      }
-      else
-      {
-        adj = ptpClock->offset_from_master.nanoseconds > 0 ? ADJ_MAX : -ADJ_MAX;
-        adjFreq(-adj);
-      }
+      getTime(&timeTmp);
+      subTime(&timeTmp, &timeTmp, &ptpClock->offset_from_master);
+      setTime(&timeTmp);
+      initClock(rtOpts, ptpClock);
     }
   }
   else
   {
-    /* the PI controller */
-
-    /* no negative or zero attenuation */
-    if(rtOpts->ap < 1)
-     rtOpts->ap = 1;
-    if(rtOpts->ai < 1)
-      rtOpts->ai = 1;
-
-    /* adjust the filter components each time, till we reach the max */
-    ulCount++;
-    if(!ulCount % 2)
+    /*
+     * Offsets too large for the servo engine are slewed out at a bounded
+     * rate instead of being stepped.  The part not slewed out yet is held
+     * back from the engine, and the slew rate is fed forward on top of its
+     * output, so the engine only sees how far the clock is off the slew and
+     * its frequency estimate carries on undisturbed.
+     */
+    if(ptpClock->slewing)
+      advanceSlew(ptpClock);
+
+    /* the offset that built up while the frequency was measured is slewed
+       out too, rather than wind it into the engine's frequency */
+    error = slewError(ptpClock);
+    if(labs(error) >= rtOpts->slewThreshold || measured)
     {
-      rtOpts->ai++;
-      if(rtOpts->ai > MAX_AI)
-      {
-        rtOpts->ai = MAX_AI;
-      }
-      rtOpts->ap = rtOpts->ai / 100;
-      if(rtOpts->ap < DEFAULT_AP)
-      {
-        rtOpts->ap = DEFAULT_AP;
-      }
+      startSlew(offset, rtOpts, ptpClock);
+      error = slewError(ptpClock);
     }
 
-    /* the accumulator for the I component */
-    ptpClock->observed_drift += ptpClock->offset_from_master.nanoseconds/rtOpts->ai;
+    /* the servo engine, unless still out of range or still waiting for
+       the frequency and a delay measured on it */
+    if(labs(error) < rtOpts->slewThreshold && ptpClock->rate.delayed)
+    {
+      adj = servo->sample(error, rtOpts, ptpClock);
+
+      ptpClock->servo_stats.samples++;
+      ptpClock->servo_stats.offset = error;
+      ptpClock->servo_stats.adj = adj;
+      servo->stats(ptpClock, &ptpClock->servo_stats);
+
+      /* the frequency learned for holdover, while tracking */
+      if(!ptpClock->slewing)
+        averageHoldover(error, rtOpts, ptpClock);
+    }
+    else
+      adj = ptpClock->observed_drift;
 
-    adj = ptpClock->offset_from_master.nanoseconds/rtOpts->ap + ptpClock->observed_drift;
+    /* the slew, fed forward */
+    if(ptpClock->slewing)
+      adj += ptpClock->slew_residual > 0 ? ptpClock->slew_rate : -ptpClock->slew_rate;
 
     /* apply controller output as a clock tick rate adjustment */
     if(!rtOpts->noAdjust)
       adjFreq(-adj);
+
+    pdvSteer(adj, rtOpts, ptpClock);
+    rateSteer(adj, rtOpts, ptpClock);
   }
 
   if(rtOpts->displayStats)
@@ -177,3 +502,105 @@ void updateClock(RunTimeOpts *rtOpts, PtpClock *ptpClock)
   DBG("observed drift: %10d\n", ptpClock->observed_drift);
 }
 
+
+/* forget the frequency learned for holdover */
+void initHoldover(PtpClock *ptpClock)
+{
+  memset(&ptpClock->hold, 0, sizeof(ptpClock->hold));
+}
+
+/* recall the servo state saved before the last restart, if there is one */
+void initSnapshot(PtpClock *ptpClock)
+{
+  ptpClock->snap_valid = loadSnapshot(&ptpClock->snap);
+  if(!ptpClock->snap_valid)
+    memset(&ptpClock->snap, 0, sizeof(ptpClock->snap));
+}
+
+/*
+ * The master has been lost.  Rather than free-run at the raw oscillator
+ * error, keep steering on the frequency learned while slave, if a block of
+ * it has been averaged.
+ */
+void startHoldover(RunTimeOpts *rtOpts, PtpClock *ptpClock)
+{
+  initClock(rtOpts, ptpClock);
+
+  if(rtOpts->holdoverWindow <= 0 || !ptpClock->hold.blocks)
+    return;
+
+  DBG("holdover\n");
+
+  ptpClock->hold.active = TRUE;
+  ptpClock->hold.adj = 0;
+  updateHoldover(rtOpts, ptpClock);
+}
+
+/*
+ * Called on every pass of the protocol engine.  A slave whose syncs are
+ * late goes into holdover straight away, rather than leave the last
+ * proportional correction applied until the sync receipt timeout.  In
+ * holdover, apply the holdover frequency, extrapolated along the drift rate
+ * if asked to, and bound the time error.  The bound is the offset at the
+ * last servo update, plus the frequency uncertainty integrated since, plus
+ * the drift rate not modelled integrated twice.  The frequency is taken to wander by
+ * its deviation once a block, and by the drift rate too if that is not
+ * being followed.
+ */
+void updateHoldover(RunTimeOpts *rtOpts, PtpClock *ptpClock)
+{
+  HoldoverModel *hold = &ptpClock->hold;
+  TimeInternal now, elapsed;
+  Integer64 freq, wander, bound;
+  Integer32 t, adj;
+  Boolean entering = FALSE;
+
+  if(!hold->active)
+  {
+    if(ptpClock->port_state != PTP_SLAVE || ptpClock->slewing ||
+      rtOpts->holdoverWindow <= 0 || !hold->blocks)
+      return;
+
+    getTime(&now);
+    subTime(&elapsed, &now, &ptpClock->sync_receive_time);
+    if(elapsed.seconds < HOLDOVER_MAX_GAP_S && elapsed.seconds*1000 + elapsed.nanoseconds/1000000 <
+      HOLDOVER_LATE_SYNCS*PTP_SYNC_INTERVAL_TIMEOUT(ptpClock->sync_interval))
+      return;
+
+    DBG("holdover, syncs late\n");
+
+    hold->active = TRUE;
+    entering = TRUE;
+  }
+
+  getTime(&now);
+  subTime(&elapsed, &now, &hold->last);
+  t = elapsed.seconds < 0 ? 0 : elapsed.seconds;
+  if(t > HOLDOVER_MAX_S)
+    t = HOLDOVER_MAX_S;
+
+  /* the block mean is the frequency half a block before the last update */
+  freq = hold->freq;
+  if(rtOpts->holdoverDriftRate)
+    freq += hold->rate*(rtOpts->holdoverWindow/2 + t);
+
+  adj = saturate64((freq + HOLDOVER_ONE/2) >> HOLDOVER_FRAC_BITS);
+  if(entering || adj != hold->adj)
+  {
+    hold->adj = adj;
+    if(!rtOpts->noAdjust)
+      adjFreq(-adj);
+  }
+
+  wander = (Integer64)hold->freq_dev*HOLDOVER_ONE / rtOpts->holdoverWindow;
+  if(!rtOpts->holdoverDriftRate)
+    wander += abs64(hold->rate);
+  if(wander > ((Integer64)1 << 40))
+    wander = (Integer64)1 << 40;
+
+  bound = (Integer64)hold->te + (Integer64)hold->freq_dev*t +
+    (((wander*t) >> HOLDOVER_FRAC_BITS)*t) / 2;
+  hold->bound = saturate64(bound);
+
+  DBGV("holdover %dppb, time error within %dns\n", hold->adj, hold->bound);
+}
@@ -0,0 +1,111 @@
+/* ptpd_servo_kalman.c */
+
+#include "../ptpd.h"
+
+/*
+ * A Kalman filter over the offset x and the frequency error f, with the
+ * correction applied as a known input, so that between samples
+ *
+ *   x += (f - adj)*dt
+ *
+ * The process noise lets both wander, and the measurement noise is learned
+ * from the innovations, so the gains follow the path the syncs take.  The
+ * frequency steered on is f, and the offset is taken out over KALMAN_TAU
+ * sync intervals.
+ */
+static void kalmanReset(UInteger8 state, RunTimeOpts *rtOpts, PtpClock *ptpClock)
+{
+  KalmanServo *k = &ptpClock->servo_state.kalman;
+
+  memset(k, 0, sizeof(*k));
+  k->f = k->adj = ptpClock->observed_drift;
+  k->r = k->p00 = KALMAN_R_INIT;
+  if(ptpClock->observed_drift)
+    k->p11 = KALMAN_F_WARM*KALMAN_F_WARM;
+  else
+    k->p11 = KALMAN_F_COLD*KALMAN_F_COLD;
+}
+
+static Integer32 kalmanSample(Integer32 error, RunTimeOpts *rtOpts, PtpClock *ptpClock)
+{
+  KalmanServo *k = &ptpClock->servo_state.kalman;
+  TimeInternal elapsed;
+  float dt, innov, s, k0, k1, p00, p01, adj;
+
+  subTime(&elapsed, &ptpClock->sync_receive_time, &k->last);
+  k->last = ptpClock->sync_receive_time;
+  dt = elapsed.seconds + elapsed.nanoseconds/1e9f;
+
+  /* the offset filter averages each offset with the one before, which a
+     reset may have cleared, so the first is left out, and the next only
+     gives the offset */
+  if(k->n < 2)
+  {
+    if(k->n++)
+      k->x = error;
+    return k->adj;
+  }
+  if(dt <= 0)
+    return k->adj;
+
+  /* predict */
+  k->x += (k->f - k->adj)*dt;
+  k->p00 += dt*(2*k->p01 + dt*k->p11) + KALMAN_QX*dt;
+  k->p01 += dt*k->p11;
+  k->p11 += KALMAN_QF*dt;
+
+  /* update */
+  innov = error - k->x;
+  p00 = k->p00;
+  p01 = k->p01;
+  s = p00 + k->r;
+  k0 = p00/s;
+  k1 = p01/s;
+  k->x += k0*innov;
+  k->f += k1*innov;
+  k->p00 -= k0*p00;
+  k->p01 -= k0*p01;
+  k->p11 -= k1*p01;
+
+  /* an innovation's square is the predicted variance plus the measurement
+     noise, on average; one far outside that is a step in the path, not
+     noise, so it is left out */
+  if(innov*innov < KALMAN_GATE*KALMAN_GATE*s)
+  {
+    k->r += (innov*innov - p00 - k->r)/16;
+    if(k->r < KALMAN_R_MIN)
+      k->r = KALMAN_R_MIN;
+    else if(k->r > KALMAN_R_MAX)
+      k->r = KALMAN_R_MAX;
+  }
+  k->spread += ((innov < 0 ? -innov : innov) - k->spread)/16;
+
+  if(k->f > ADJ_MAX)
+    k->f = ADJ_MAX;
+  else if(k->f < -ADJ_MAX)
+    k->f = -ADJ_MAX;
+
+  adj = k->f + k->x/(KALMAN_TAU*dt);
+  if(adj > ADJ_MAX)
+    adj = ADJ_MAX;
+  else if(adj < -ADJ_MAX)
+    adj = -ADJ_MAX;
+
+  ptpClock->observed_drift = k->f;
+  k->adj = (Integer32)adj;
+  return k->adj;
+}
+
+static void kalmanStats(PtpClock *ptpClock, ServoStats *stats)
+{
+  stats->freq = ptpClock->observed_drift;
+  stats->spread = ptpClock->servo_state.kalman.spread;
+
+  /* tracking once the filter is running */
+  stats->state = ptpClock->servo_state.kalman.n >= 2 ? SERVO_TRACK : SERVO_ACQUIRE;
+  stats->transitions = stats->state == SERVO_TRACK;
+}
+
+const ServoOps servoKalman = {
+  "kalman", kalmanReset, kalmanSample, kalmanStats
+};
@@ -0,0 +1,137 @@
+/* ptpd_servo_linreg.c */
+
+#include "../ptpd.h"
+
+/*
+ * Least squares over a sliding window.  Adding back the correction applied
+ * since the reset to each offset gives the phase the clock would have had
+ * if it had been left alone, which is a line whose slope is the frequency
+ * error whatever the engine has done meanwhile.  The line is fitted to the
+ * last LINREG_WINDOW points, its slope is the frequency to steer on, and its
+ * value now, less the correction applied, is the offset to take out over
+ * LINREG_TAU sync intervals.  The offset noise is averaged over the window
+ * rather than passed through the proportional term as the PI engine does.
+ */
+static void linregReset(UInteger8 state, RunTimeOpts *rtOpts, PtpClock *ptpClock)
+{
+  memset(&ptpClock->servo_state.linreg, 0, sizeof(ptpClock->servo_state.linreg));
+  ptpClock->servo_state.linreg.adj = ptpClock->observed_drift;
+}
+
+/* milliseconds from b to a */
+static Integer64 elapsedMs(TimeInternal *a, TimeInternal *b)
+{
+  TimeInternal elapsed;
+
+  subTime(&elapsed, a, b);
+  return (Integer64)elapsed.seconds*1000 + elapsed.nanoseconds/1000000;
+}
+
+static Integer32 linregSample(Integer32 error, RunTimeOpts *rtOpts, PtpClock *ptpClock)
+{
+  LinregServo *lr = &ptpClock->servo_state.linreg;
+  TimeInternal *now = &ptpClock->sync_receive_time;
+  TimeInternal elapsed;
+  Integer64 r, y, sr, sy, srr, sry, num, den, f, a, x, res, tau, adj;
+  Integer32 i, k, newest;
+
+  /* the offset filter averages each offset with the one before, which a
+     reset may have cleared, so the first is left out */
+  if(!lr->primed)
+  {
+    lr->primed = TRUE;
+    return lr->adj;
+  }
+
+  /* the correction applied since the last point, the whole seconds and
+     the nanoseconds taken apart so that neither product can overflow */
+  if(lr->n)
+  {
+    newest = (lr->head + LINREG_WINDOW - 1) % LINREG_WINDOW;
+    subTime(&elapsed, now, &lr->t[newest]);
+    lr->applied += (Integer64)lr->adj*elapsed.seconds +
+      (Integer64)lr->adj*elapsed.nanoseconds / 1000000000;
+  }
+
+  lr->t[lr->head] = *now;
+  lr->y[lr->head] = error + lr->applied;
+  newest = lr->head;
+  lr->head = (lr->head + 1) % LINREG_WINDOW;
+  if(lr->n < LINREG_WINDOW)
+    lr->n++;
+
+  /* too few points for a line */
+  if(lr->n < 3)
+  {
+    lr->adj = ptpClock->observed_drift;
+    return lr->adj;
+  }
+
+  /* times in msec and phases in nsec, both from the newest point */
+  sr = sy = srr = sry = 0;
+  for(i = 0; i < lr->n; i++)
+  {
+    k = (newest + LINREG_WINDOW - i) % LINREG_WINDOW;
+    r = elapsedMs(&lr->t[k], now);
+    y = lr->y[k] - lr->y[newest];
+    sr += r;
+    sy += y;
+    srr += r*r;
+    sry += r*y;
+  }
+  num = lr->n*sry - sr*sy;
+  den = lr->n*srr - sr*sr;
+  if(den <= 0)
+  {
+    lr->adj = ptpClock->observed_drift;
+    return lr->adj;
+  }
+
+  /* the slope in ppb, and the line's value now */
+  f = num/den*1000 + num%den*1000/den;
+  if(f > ADJ_MAX)
+    f = ADJ_MAX;
+  else if(f < -ADJ_MAX)
+    f = -ADJ_MAX;
+  a = (sy - f*sr/1000) / lr->n;
+  x = error + a;
+
+  /* the mean |residual| */
+  res = 0;
+  for(i = 0; i < lr->n; i++)
+  {
+    k = (newest + LINREG_WINDOW - i) % LINREG_WINDOW;
+    r = elapsedMs(&lr->t[k], now);
+    y = lr->y[k] - lr->y[newest] - a - f*r/1000;
+    res += y < 0 ? -y : y;
+  }
+  lr->spread = res / lr->n;
+
+  /* LINREG_TAU of the mean interval between the points, in msec */
+  tau = -sr*2*LINREG_TAU / (lr->n*(lr->n - 1));
+  if(tau < 1)
+    tau = 1;
+
+  ptpClock->observed_drift = f;
+  adj = f + x*1000/tau;
+  if(adj > ADJ_MAX)
+    adj = ADJ_MAX;
+  else if(adj < -ADJ_MAX)
+    adj = -ADJ_MAX;
+  lr->adj = adj;
+  return lr->adj;
+}
+
+static void linregStats(PtpClock *ptpClock, ServoStats *stats)
+{
+  stats->freq = ptpClock->observed_drift;
+  stats->spread = ptpClock->servo_state.linreg.spread;
+
+  /* tracking once there is a line to steer on */
+  stats->state = ptpClock->servo_state.linreg.n >= 3 ? SERVO_TRACK : SERVO_ACQUIRE;
+  stats->transitions = stats->state == SERVO_TRACK;
+}
+
+const ServoOps servoLinreg = {
+  "linreg", linregReset, linregSample, linregStats
+};
@@ -0,0 +1,122 @@
+/* ptpd_servo_pi.c */
+
+#include "../ptpd.h"
+
+/*
+ * The PI controller, with the gains scheduled on lock.  It acquires with
+ * the default gains, which take out the frequency error quickly, and once
+ * the moving mean of the offset is small against its moving deviation it
+ * tracks with the maximum gains, which pass on less of the offset noise.  A
+ * bias that grows well past that again, as after a frequency jump, takes it
+ * back to acquiring.  A gain fixed in RunTimeOpts is used as it is, and
+ * stops the schedule.  The I term accumulates in observed_drift, so it
+ * carries the frequency over a change of gains or a reset.
+ */
+static void piEnter(UInteger8 state, RunTimeOpts *rtOpts, PtpClock *ptpClock)
+{
+  PiServo *pi = &ptpClock->servo_state.pi;
+
+  if(state != pi->state)
+    pi->transitions++;
+  pi->state = state;
+  pi->count = 0;
+
+  if(state == SERVO_TRACK)
+  {
+    pi->sched_ap = MAX_AP;
+    pi->sched_ai = MAX_AI;
+  }
+  else
+  {
+    pi->sched_ap = DEFAULT_AP;
+    pi->sched_ai = DEFAULT_AI;
+  }
+
+  pi->ap = rtOpts->ap != SCHEDULED_GAIN ? rtOpts->ap : pi->sched_ap;
+  pi->ai = rtOpts->ai != SCHEDULED_GAIN ? rtOpts->ai : pi->sched_ai;
+
+  /* no negative or zero attenuation */
+  if(pi->ap < 1)
+    pi->ap = 1;
+  if(pi->ai < 1)
+    pi->ai = 1;
+
+  DBG("servo %s\n", state == SERVO_TRACK ? "tracking" : "acquiring");
+}
+
+/* start in the state given, which is tracking after a warm start from a
+   snapshot saved while tracking */
+static void piReset(UInteger8 state, RunTimeOpts *rtOpts, PtpClock *ptpClock)
+{
+  memset(&ptpClock->servo_state.pi, 0, sizeof(ptpClock->servo_state.pi));
+  piEnter(state, rtOpts, ptpClock);
+  ptpClock->servo_state.pi.transitions = 0;
+}
+
+/* follow the offset's mean and variance, and change state on them */
+static void piSchedule(Integer32 error, RunTimeOpts *rtOpts, PtpClock *ptpClock)
+{
+  PiServo *pi = &ptpClock->servo_state.pi;
+  Integer64 dev, bias;
+
+  pi->mean += (error - pi->mean) / (1 << PI_LOCK_SHIFT);
+  dev = (Integer64)(error - pi->mean)*(error - pi->mean);
+  pi->var += (dev - pi->var) / (1 << PI_LOCK_SHIFT);
+
+  if(++pi->count < PI_LOCK_SAMPLES ||
+    rtOpts->ap != SCHEDULED_GAIN || rtOpts->ai != SCHEDULED_GAIN)
+    return;
+
+  bias = (Integer64)labs(pi->mean)*PI_LOCK_DIV;
+  if(pi->state == SERVO_ACQUIRE)
+  {
+    /* a large deviation is still the transient, not noise */
+    if((bias*bias <= pi->var || labs(pi->mean) < PI_LOCK_MIN) &&
+      pi->var <= (Integer64)PI_LOCK_MAX*PI_LOCK_MAX)
+      piEnter(SERVO_TRACK, rtOpts, ptpClock);
+  }
+  else
+  {
+    if(bias*bias > PI_UNLOCK*PI_UNLOCK*pi->var &&
+      labs(pi->mean) >= PI_UNLOCK*PI_LOCK_MIN)
+      piEnter(SERVO_ACQUIRE, rtOpts, ptpClock);
+  }
+}
+
+static Integer32 piSample(Integer32 error, RunTimeOpts *rtOpts, PtpClock *ptpClock)
+{
+  PiServo *pi = &ptpClock->servo_state.pi;
+  Integer32 sum, ai;
+
+  piSchedule(error, rtOpts, ptpClock);
+
+  /* the gains are for syncs at the default interval, so the I component
+     is scaled to the interval, or faster syncs would make the loop faster
+     too and take it past its damping */
+  ai = (Integer32)(((Integer64)pi->ai*PTP_SYNC_INTERVAL_TIMEOUT(DEFAULT_SYNC_INTERVAL)) /
+    PTP_SYNC_INTERVAL_TIMEOUT(ptpClock->sync_interval));
+  if(ai < 1)
+    ai = 1;
+
+  /* the accumulator for the I component; the remainder is carried, or the
+     tracking gains would leave offsets under MAX_AI nsec uncorrected */
+  sum = error + pi->residue;
+  ptpClock->observed_drift += sum/ai;
+  pi->residue = sum%ai;
+
+  pi->spread += labs(error) - (pi->spread >> SERVO_SPREAD_SHIFT);
+
+  return error/pi->ap + ptpClock->observed_drift;
+}
+
+static void piStats(PtpClock *ptpClock, ServoStats *stats)
+{
+  stats->freq = ptpClock->observed_drift;
+  stats->spread = ptpClock->servo_state.pi.spread >> SERVO_SPREAD_SHIFT;
+  stats->state = ptpClock->servo_state.pi.state;
+  stats->transitions = ptpClock->servo_state.pi.transitions;
+}
+
+const ServoOps servoPI = {
+  "pi", piReset, piSample, piStats
+};
@@ -2,40 +2,21 @@
 
 #include "../ptpd.h"
 
-static int iElapsedMilliSeconds = 0;
-
-void initTimer(void)
+/* the interval timers run on the application's timer wheel, which calls
+   this when one expires; timerExpired() then only has to look at the flag.
+   The application polls the protocol engine less often than the shortest
+   intervals, so it is asked to run it now */
+static void timerExpire(void *arg)
 {
-  DBG("initTimer\n");
-  
-  iElapsedMilliSeconds = 0;
-}
+  IntervalTimer *timer = (IntervalTimer *)arg;
 
-void timerTick(int iTickMilliSeconds)
-{
-    iElapsedMilliSeconds += iTickMilliSeconds;
+  timer->expire = TRUE;
+  timerWake();
 }
 
-void timerUpdate(IntervalTimer *itimer)
+void initTimer(void)
 {
-  int i, delta;
-  
-  delta = iElapsedMilliSeconds / 1000;
-
-  if(delta <= 0)
-    return;
-
-  iElapsedMilliSeconds %= 1000;
-
-  for(i = 0; i < TIMER_ARRAY_SIZE; ++i)
-  {
-    if(itimer[i].interval > 0 && (itimer[i].left -= delta) <= 0)
-    {
-      itimer[i].left = itimer[i].interval;
-      itimer[i].expire = TRUE;
-      DBGV("timerUpdate: timer %u expired\n", i);
-    }
-  }
+  DBG("initTimer\n");
 }
 
 void timerStop(UInteger16 index, IntervalTimer *itimer)
@@ -44,24 +25,29 @@ void timerStop(UInteger16 index, IntervalTimer *itimer)
     return;
   
   itimer[index].interval = 0;
+  WheelTimerStop(&itimer[index].wheel);
 }
 
-void timerStart(UInteger16 index, UInteger16 interval, IntervalTimer *itimer)
+/* interval in msec */
+void timerStart(UInteger16 index, UInteger32 interval, IntervalTimer *itimer)
 {
   if(index >= TIMER_ARRAY_SIZE)
     return;
   
   itimer[index].expire = FALSE;
-  itimer[index].left = interval;
-  itimer[index].interval = itimer[index].left;
+  itimer[index].interval = interval;
+
+  if(interval > 0)
+    WheelTimerStart(timerWheel(), &itimer[index].wheel, timerExpire,
+                    &itimer[index], interval, interval);
+  else
+    WheelTimerStop(&itimer[index].wheel);
   
-  DBGV("timerStart: set timer %d to %d\n", index, interval);
+  DBGV("timerStart: set timer %d to %dms\n", index, interval);
 }
 
 Boolean timerExpired(UInteger16 index, IntervalTimer *itimer)
 {
-  timerUpdate(itimer);
-  
   if(index >= TIMER_ARRAY_SIZE)
     return FALSE;
   
@@ -72,4 +58,3 @@ Boolean timerExpired(UInteger16 index, IntervalTimer *itimer)
   
   return TRUE;
 }
-
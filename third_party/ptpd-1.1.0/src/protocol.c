@@ -101,6 +101,9 @@ protocol(RunTimeOpts * rtOpts, PtpClock * ptpClock)
 Boolean
 doInit(RunTimeOpts * rtOpts, PtpClock * ptpClock)
 {
+    if (rtOpts->ptpVersion == VERSION_PTP_V2)
+        return doInitV2(rtOpts, ptpClock);
+
     DBG("manufacturerIdentity: %s\n", MANUFACTURER_ID);
 
     /* initialize networking */
@@ -113,11 +116,13 @@ doInit(RunTimeOpts * rtOpts, PtpClock * ptpClock)
     /* initialize other stuff */
     initData(rtOpts, ptpClock);
     initTimer();
+    initHoldover(ptpClock);
+    initSnapshot(ptpClock);
     initClock(rtOpts, ptpClock);
     m1(ptpClock);
     msgPackHeader(ptpClock->msgObuf, ptpClock);
 
-    DBG("sync message interval: %d\n", PTP_SYNC_INTERVAL_TIMEOUT(ptpClock->sync_interval));
+    DBG("sync message interval: %dms\n", PTP_SYNC_INTERVAL_TIMEOUT(ptpClock->sync_interval));
     DBG("clock identifier: %s\n", ptpClock->clock_identifier);
     DBG("256*log2(clock variance): %d\n", ptpClock->clock_variance);
     DBG("clock stratum: %d\n", ptpClock->clock_stratum);
@@ -146,8 +151,15 @@ doState(RunTimeOpts * rtOpts, PtpClock * ptpClock)
 {
     UInteger8 state;
 
+    if (rtOpts->ptpVersion == VERSION_PTP_V2) {
+        doStateV2(rtOpts, ptpClock);
+        return;
+    }
+
     ptpClock->message_activity = FALSE;
 
+    updateHoldover(rtOpts, ptpClock);
+
     switch (ptpClock->port_state) {
     case PTP_LISTENING:
     case PTP_PASSIVE:
@@ -217,6 +229,11 @@ doState(RunTimeOpts * rtOpts, PtpClock * ptpClock)
 void
 toState(UInteger8 state, RunTimeOpts * rtOpts, PtpClock * ptpClock)
 {
+    if (rtOpts->ptpVersion == VERSION_PTP_V2) {
+        toStateV2(state, rtOpts, ptpClock);
+        return;
+    }
+
     ptpClock->message_activity = TRUE;
 
     /* leaving state tasks */
@@ -227,7 +244,7 @@ toState(UInteger8 state, RunTimeOpts * rtOpts, PtpClock * ptpClock)
         break;
 
     case PTP_SLAVE:
-        initClock(rtOpts, ptpClock);
+        startHoldover(rtOpts, ptpClock);
         break;
 
     default:
@@ -498,10 +515,14 @@ handleSync(MsgHeader * header, Octet * msgIbuf, ssize_t length, TimeInternal * t
             s1(header, sync, ptpClock);
 
             if (!(--ptpClock->R)) {
-                issueDelayReq(rtOpts, ptpClock);
-
-                ptpClock->Q = 0;
-                ptpClock->R = getRand(&ptpClock->random_seed) % (PTP_DELAY_REQ_INTERVAL - 2) + 2;
+                /* a Delay_Req the master has no credit for waits a sync */
+                if (delayReqAllowed(rtOpts, ptpClock)) {
+                    issueDelayReq(rtOpts, ptpClock);
+
+                    ptpClock->Q = 0;
+                    ptpClock->R = delayReqInterval(rtOpts, ptpClock);
+                } else
+                    ptpClock->R = 1;
                 DBG("Q = %d, R = %d\n", ptpClock->Q, ptpClock->R);
             }
             DBGV("SYNC_RECEIPT_TIMER reset\n");
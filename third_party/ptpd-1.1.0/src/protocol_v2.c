@@ -0,0 +1,875 @@
+/**
+ * @file   protocol_v2.c
+ * @date   Sat Oct 17 2026
+ *
+ * @brief  The state machine for IEEE 1588-2008 (PTPv2)
+ *
+ * The v2 engine run in place of the v1 one in protocol.c when
+ * rtOpts->ptpVersion is 2.  Masters are found from their Announce
+ * messages, and the offset and delay from Sync, Follow_Up, Delay_Req and
+ * Delay_Resp, which go through the same servo, filters and Delay_Req
+ * scheduling as v1.  Messages of the other version are ignored, so v1 and
+ * v2 clocks may share a network without seeing each other.
+ */
+
+#include "ptpd.h"
+
+static void handleV2(RunTimeOpts *, PtpClock *);
+static void handleAnnounce(MsgHeaderV2 *, Octet *, ssize_t, Boolean, RunTimeOpts *, PtpClock *);
+static void handleSyncV2(MsgHeaderV2 *, Octet *, ssize_t, TimeInternal *, Boolean, RunTimeOpts *, PtpClock *);
+static void handleFollowUpV2(MsgHeaderV2 *, Octet *, ssize_t, Boolean, RunTimeOpts *, PtpClock *);
+static void handleDelayReqV2(MsgHeaderV2 *, Octet *, ssize_t, TimeInternal *, Boolean, RunTimeOpts *, PtpClock *);
+static void handleDelayRespV2(MsgHeaderV2 *, Octet *, ssize_t, Boolean, RunTimeOpts *, PtpClock *);
+
+static void issueAnnounce(RunTimeOpts *, PtpClock *);
+static void issueSyncV2(RunTimeOpts *, PtpClock *);
+static void issueFollowUpV2(TimeInternal *, RunTimeOpts *, PtpClock *);
+static void issueDelayReqV2(RunTimeOpts *, PtpClock *);
+static void issueDelayRespV2(TimeInternal *, MsgHeaderV2 *, RunTimeOpts *, PtpClock *);
+
+static void addForeignV2(Octet *, MsgHeaderV2 *, PtpClock *);
+static void ageForeignV2(PtpClock *);
+static void calibratedV2(RunTimeOpts *, PtpClock *);
+
+static Boolean
+samePortIdentity(PortIdentity * a, PortIdentity * b)
+{
+    return a->portNumber == b->portNumber
+        && !memcmp(a->clockIdentity, b->clockIdentity, PTP_V2_CLOCK_IDENTITY_LENGTH);
+}
+
+/* v2 times are unsigned, and no older than the epoch */
+static void
+toInternalTimeV2(TimeInternal * internal, TimeRepresentation * external)
+{
+    internal->seconds = external->seconds;
+    internal->nanoseconds = external->nanoseconds;
+}
+
+static void
+fromInternalTimeV2(TimeInternal * internal, TimeRepresentation * external)
+{
+    external->seconds = internal->seconds;
+    external->nanoseconds = internal->nanoseconds;
+}
+
+/* a correctionField, in nsec with 16 fraction bits */
+static void
+correctionToInternalTime(TimeInternal * time, Integer64 correction)
+{
+    Integer64 nsec = correction / 65536;
+
+    time->seconds = (Integer32)(nsec / 1000000000);
+    time->nanoseconds = (Integer32)(nsec % 1000000000);
+}
+
+/* the Announce receipt timeout for Announces sent at an interval, in msec */
+static UInteger32
+announceReceiptTimeout(Integer8 logInterval, PtpClock * ptpClock)
+{
+    return ptpClock->announce_receipt_timeout * PTP_V2_LOG_INTERVAL_TIMEOUT(logInterval);
+}
+
+/* syncs until the next Delay_Req, but no fewer than keep to the master's
+   logMinDelayReqInterval */
+static UInteger16
+delayReqIntervalV2(RunTimeOpts * rtOpts, PtpClock * ptpClock)
+{
+    UInteger16 syncs;
+    Integer32 log;
+
+    syncs = delayReqInterval(rtOpts, ptpClock);
+    log = ptpClock->log_min_delay_req_interval - ptpClock->sync_interval;
+    if (log > 0 && log < 16 && syncs < (1 << log))
+        syncs = 1 << log;
+
+    return syncs;
+}
+
+/* count a sync towards the next Delay_Req, and send it when due.  This is
+   done once the sync's offset is taken, from the Follow_Up of a two-step
+   Sync, so that the delay measured goes with that offset and the time it
+   was received at */
+static void
+countDelayReqV2(RunTimeOpts * rtOpts, PtpClock * ptpClock)
+{
+    if (--ptpClock->R)
+        return;
+
+    /* a Delay_Req the master has no credit for waits a sync */
+    if (delayReqAllowed(rtOpts, ptpClock)) {
+        issueDelayReqV2(rtOpts, ptpClock);
+
+        ptpClock->Q = 0;
+        ptpClock->R = delayReqIntervalV2(rtOpts, ptpClock);
+    } else
+        ptpClock->R = 1;
+    DBG("Q = %d, R = %d\n", ptpClock->Q, ptpClock->R);
+}
+
+Boolean
+doInitV2(RunTimeOpts * rtOpts, PtpClock * ptpClock)
+{
+    DBG("manufacturerIdentity: %s\n", MANUFACTURER_ID);
+
+    /* initialize networking */
+    netShutdown(&ptpClock->netPath);
+    if (!netInit(&ptpClock->netPath, rtOpts, ptpClock)) {
+        ERROR("failed to initialize network\n");
+        toStateV2(PTP_FAULTY, rtOpts, ptpClock);
+        return FALSE;
+    }
+    /* initialize other stuff */
+    initData(rtOpts, ptpClock);
+    initDataV2(rtOpts, ptpClock);
+    initTimer();
+    initHoldover(ptpClock);
+    initSnapshot(ptpClock);
+    initClock(rtOpts, ptpClock);
+    m1V2(ptpClock);
+
+    /* the foreign master time window moves on each announce interval */
+    timerStart(FOREIGN_MASTER_TIMER, PTP_V2_LOG_INTERVAL_TIMEOUT(ptpClock->log_announce_interval), ptpClock->itimer);
+
+    DBG("sync message interval: %dms\n", PTP_V2_LOG_INTERVAL_TIMEOUT(ptpClock->sync_interval));
+    DBG("announce message interval: %dms\n", PTP_V2_LOG_INTERVAL_TIMEOUT(ptpClock->log_announce_interval));
+    DBG("domain number: %d\n", ptpClock->domain_number);
+    DBG("priority1 %d, priority2 %d\n", ptpClock->priority1, ptpClock->priority2);
+    DBG("clock class %d, accuracy %02x, variance %04x\n",
+        ptpClock->clock_quality.clockClass, ptpClock->clock_quality.clockAccuracy,
+        ptpClock->clock_quality.offsetScaledLogVariance);
+    DBG("clock identity: %02hhx%02hhx%02hhx%02hhx%02hhx%02hhx%02hhx%02hhx\n",
+        ptpClock->port_identity.clockIdentity[0], ptpClock->port_identity.clockIdentity[1],
+        ptpClock->port_identity.clockIdentity[2], ptpClock->port_identity.clockIdentity[3],
+        ptpClock->port_identity.clockIdentity[4], ptpClock->port_identity.clockIdentity[5],
+        ptpClock->port_identity.clockIdentity[6], ptpClock->port_identity.clockIdentity[7]);
+
+    toStateV2(PTP_LISTENING, rtOpts, ptpClock);
+    return TRUE;
+}
+
+/* handle actions and events for 'port_state' */
+void
+doStateV2(RunTimeOpts * rtOpts, PtpClock * ptpClock)
+{
+    UInteger8 state;
+    PortIdentity parent;
+    Boolean new_parent;
+
+    ptpClock->message_activity = FALSE;
+
+    updateHoldover(rtOpts, ptpClock);
+
+    if (timerExpired(FOREIGN_MASTER_TIMER, ptpClock->itimer))
+        ageForeignV2(ptpClock);
+
+    switch (ptpClock->port_state) {
+    case PTP_LISTENING:
+    case PTP_PASSIVE:
+    case PTP_UNCALIBRATED:
+    case PTP_SLAVE:
+    case PTP_MASTER:
+        if (ptpClock->record_update) {
+            ptpClock->record_update = FALSE;
+            parent = ptpClock->parent_port_identity;
+            state = bmcV2(ptpClock->foreign, rtOpts, ptpClock);
+            new_parent = !samePortIdentity(&parent, &ptpClock->parent_port_identity);
+            /* a port slaves to a master it has just chosen only once it
+               is calibrated to it, and a slave whose master changes
+               calibrates again */
+            if (state == PTP_SLAVE && (ptpClock->port_state != PTP_SLAVE || new_parent))
+                state = PTP_UNCALIBRATED;
+            if (state != ptpClock->port_state
+                || (state == PTP_UNCALIBRATED && new_parent))
+                toStateV2(state, rtOpts, ptpClock);
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    switch (ptpClock->port_state) {
+    case PTP_FAULTY:
+        /* imaginary troubleshooting */
+
+        DBG("event FAULT_CLEARED\n");
+        toStateV2(PTP_INITIALIZING, rtOpts, ptpClock);
+        return;
+
+    case PTP_LISTENING:
+    case PTP_PASSIVE:
+    case PTP_UNCALIBRATED:
+    case PTP_SLAVE:
+        handleV2(rtOpts, ptpClock);
+
+        if (timerExpired(ANNOUNCE_RECEIPT_TIMER, ptpClock->itimer)) {
+            DBG("event ANNOUNCE_RECEIPT_TIMEOUT_EXPIRES\n");
+            ptpClock->number_foreign_records = 0;
+            ptpClock->foreign_record_i = 0;
+            if (!rtOpts->slaveOnly && ptpClock->clock_quality.clockClass != PTP_V2_SLAVE_ONLY_CLOCK_CLASS) {
+                m1V2(ptpClock);
+                toStateV2(PTP_MASTER, rtOpts, ptpClock);
+            } else if (ptpClock->port_state != PTP_LISTENING)
+                toStateV2(PTP_LISTENING, rtOpts, ptpClock);
+        }
+        break;
+
+    case PTP_MASTER:
+        if (timerExpired(SYNC_INTERVAL_TIMER, ptpClock->itimer)) {
+            DBGV("event SYNC_INTERVAL_TIMEOUT_EXPIRES\n");
+            issueSyncV2(rtOpts, ptpClock);
+        }
+        if (timerExpired(ANNOUNCE_INTERVAL_TIMER, ptpClock->itimer)) {
+            DBGV("event ANNOUNCE_INTERVAL_TIMEOUT_EXPIRES\n");
+            issueAnnounce(rtOpts, ptpClock);
+        }
+        handleV2(rtOpts, ptpClock);
+
+        if (rtOpts->slaveOnly || ptpClock->clock_quality.clockClass == PTP_V2_SLAVE_ONLY_CLOCK_CLASS)
+            toStateV2(PTP_LISTENING, rtOpts, ptpClock);
+
+        break;
+
+    case PTP_DISABLED:
+        handleV2(rtOpts, ptpClock);
+        break;
+
+    default:
+        DBG("do unrecognized state\n");
+        break;
+    }
+}
+
+/* perform actions required when leaving 'port_state' and entering 'state' */
+void
+toStateV2(UInteger8 state, RunTimeOpts * rtOpts, PtpClock * ptpClock)
+{
+    ForeignMasterRecord *best;
+
+    ptpClock->message_activity = TRUE;
+
+    /* leaving state tasks */
+    switch (ptpClock->port_state) {
+    case PTP_MASTER:
+        timerStop(SYNC_INTERVAL_TIMER, ptpClock->itimer);
+        timerStop(ANNOUNCE_INTERVAL_TIMER, ptpClock->itimer);
+        timerStart(ANNOUNCE_RECEIPT_TIMER,
+            announceReceiptTimeout(ptpClock->log_announce_interval, ptpClock), ptpClock->itimer);
+        break;
+
+    case PTP_SLAVE:
+        startHoldover(rtOpts, ptpClock);
+        break;
+
+    default:
+        break;
+    }
+
+    /* entering state tasks */
+    switch (state) {
+    case PTP_INITIALIZING:
+        DBG("state PTP_INITIALIZING\n");
+        timerStop(ANNOUNCE_RECEIPT_TIMER, ptpClock->itimer);
+
+        ptpClock->port_state = PTP_INITIALIZING;
+        break;
+
+    case PTP_FAULTY:
+        DBG("state PTP_FAULTY\n");
+        timerStop(ANNOUNCE_RECEIPT_TIMER, ptpClock->itimer);
+
+        ptpClock->port_state = PTP_FAULTY;
+        break;
+
+    case PTP_DISABLED:
+        DBG("state change to PTP_DISABLED\n");
+        timerStop(ANNOUNCE_RECEIPT_TIMER, ptpClock->itimer);
+
+        ptpClock->port_state = PTP_DISABLED;
+        break;
+
+    case PTP_LISTENING:
+        DBG("state PTP_LISTENING\n");
+
+        timerStart(ANNOUNCE_RECEIPT_TIMER,
+            announceReceiptTimeout(ptpClock->log_announce_interval, ptpClock), ptpClock->itimer);
+
+        ptpClock->port_state = PTP_LISTENING;
+        break;
+
+    case PTP_MASTER:
+        DBG("state PTP_MASTER\n");
+
+        timerStart(SYNC_INTERVAL_TIMER, PTP_V2_LOG_INTERVAL_TIMEOUT(ptpClock->sync_interval), ptpClock->itimer);
+        timerStart(ANNOUNCE_INTERVAL_TIMER, PTP_V2_LOG_INTERVAL_TIMEOUT(ptpClock->log_announce_interval), ptpClock->itimer);
+        timerStop(ANNOUNCE_RECEIPT_TIMER, ptpClock->itimer);
+
+        /* a slave took the interval its master asked for */
+        ptpClock->log_min_delay_req_interval = rtOpts->delayReqInterval;
+
+        ptpClock->port_state = PTP_MASTER;
+        break;
+
+    case PTP_PASSIVE:
+        DBG("state PTP_PASSIVE\n");
+        ptpClock->port_state = PTP_PASSIVE;
+        break;
+
+    case PTP_UNCALIBRATED:
+        DBG("state PTP_UNCALIBRATED\n");
+
+        initClock(rtOpts, ptpClock);
+
+        /* R as for v1, to fill the offset filter before the first delay */
+        ptpClock->Q = 0;
+        ptpClock->R = getRand(&ptpClock->random_seed) % 4 + 4;
+        DBG("Q = %d, R = %d\n", ptpClock->Q, ptpClock->R);
+
+        ptpClock->waitingForFollow = FALSE;
+        ptpClock->delay_req_send_time.seconds = 0;
+        ptpClock->delay_req_send_time.nanoseconds = 0;
+        ptpClock->delay_req_receive_time.seconds = 0;
+        ptpClock->delay_req_receive_time.nanoseconds = 0;
+
+        /* the master is lost after the Announces it said it would send */
+        best = &ptpClock->foreign[ptpClock->foreign_record_best];
+        timerStart(ANNOUNCE_RECEIPT_TIMER,
+            announceReceiptTimeout(best->header_v2.logMessageInterval, ptpClock), ptpClock->itimer);
+
+        ptpClock->port_state = PTP_UNCALIBRATED;
+        break;
+
+    case PTP_SLAVE:
+        DBG("state PTP_PTP_SLAVE\n");
+        ptpClock->port_state = PTP_SLAVE;
+        break;
+
+    default:
+        DBG("to unrecognized state\n");
+        break;
+    }
+
+    NOTIFY("Port state changed to %s\n", translatePortState(ptpClock));
+
+    if (rtOpts->displayStats)
+        displayStats(rtOpts, ptpClock);
+}
+
+/* check and handle received messages; unlike v1, a malformed message is
+   dropped rather than taken as a fault */
+static void
+handleV2(RunTimeOpts * rtOpts, PtpClock * ptpClock)
+{
+    int ret;
+    ssize_t length;
+    Boolean isFromSelf;
+    TimeInternal time = {0, 0};
+    MsgHeaderV2 *header = &ptpClock->msgTmpHeaderV2;
+
+    if (!ptpClock->message_activity) {
+        ret = netSelect(0, &ptpClock->netPath);
+        if (ret < 0) {
+            PERROR("failed to poll sockets");
+            toStateV2(PTP_FAULTY, rtOpts, ptpClock);
+            return;
+        } else if (!ret) {
+            DBGV("handle: nothing\n");
+            return;
+        }
+        /* else length > 0 */
+    }
+    DBGV("handle: something\n");
+
+    length = netRecvEvent(ptpClock->msgIbuf, &time, &ptpClock->netPath);
+    if (length < 0) {
+        PERROR("failed to receive on the event socket");
+        toStateV2(PTP_FAULTY, rtOpts, ptpClock);
+        return;
+    } else if (!length) {
+        length = netRecvGeneral(ptpClock->msgIbuf, &ptpClock->netPath);
+        if (length < 0) {
+            PERROR("failed to receive on the general socket");
+            toStateV2(PTP_FAULTY, rtOpts, ptpClock);
+            return;
+        } else if (!length)
+            return;
+    }
+    ptpClock->message_activity = TRUE;
+
+    if (length < V2_HEADER_LENGTH) {
+        ERROR("message shorter than header length\n");
+        return;
+    }
+    msgUnpackHeaderV2(ptpClock->msgIbuf, header);
+
+    DBGV("event Receipt of Message\n"
+        "   version %d\n"
+        "   type %d\n"
+        "   sequence %d\n"
+        "   time %us %dns\n",
+        header->versionPTP, header->messageType, header->sequenceId,
+        time.seconds, time.nanoseconds);
+
+    if (header->versionPTP != VERSION_PTP_V2) {
+        DBGV("ignore version %d message\n", header->versionPTP);
+        return;
+    }
+    if (header->domainNumber != ptpClock->domain_number) {
+        DBGV("ignore message from domain %d\n", header->domainNumber);
+        return;
+    }
+    isFromSelf = samePortIdentity(&header->sourcePortIdentity, &ptpClock->port_identity);
+
+    /*
+     * subtract the inbound latency adjustment if it is not a loop back
+     * and the time stamp seems reasonable
+     */
+    if (!isFromSelf && time.seconds > 0)
+        subTime(&time, &time, &rtOpts->inboundLatency);
+
+    switch (header->messageType) {
+    case PTP_V2_ANNOUNCE:
+        handleAnnounce(header, ptpClock->msgIbuf, length, isFromSelf, rtOpts, ptpClock);
+        break;
+
+    case PTP_V2_SYNC:
+        handleSyncV2(header, ptpClock->msgIbuf, length, &time, isFromSelf, rtOpts, ptpClock);
+        break;
+
+    case PTP_V2_FOLLOW_UP:
+        handleFollowUpV2(header, ptpClock->msgIbuf, length, isFromSelf, rtOpts, ptpClock);
+        break;
+
+    case PTP_V2_DELAY_REQ:
+        handleDelayReqV2(header, ptpClock->msgIbuf, length, &time, isFromSelf, rtOpts, ptpClock);
+        break;
+
+    case PTP_V2_DELAY_RESP:
+        handleDelayRespV2(header, ptpClock->msgIbuf, length, isFromSelf, rtOpts, ptpClock);
+        break;
+
+    default:
+        DBGV("handle: unsupported message type %d\n", header->messageType);
+        break;
+    }
+}
+
+static void
+handleAnnounce(MsgHeaderV2 * header, Octet * msgIbuf, ssize_t length, Boolean isFromSelf, RunTimeOpts * rtOpts, PtpClock * ptpClock)
+{
+    if (length < V2_ANNOUNCE_PACKET_LENGTH) {
+        ERROR("short announce message\n");
+        return;
+    }
+    if (isFromSelf) {
+        DBGV("handleAnnounce: ignore from self\n");
+        return;
+    }
+    switch (ptpClock->port_state) {
+    case PTP_FAULTY:
+    case PTP_INITIALIZING:
+    case PTP_DISABLED:
+        DBGV("handleAnnounce: disreguard\n");
+        return;
+
+    case PTP_UNCALIBRATED:
+    case PTP_SLAVE:
+        if (samePortIdentity(&header->sourcePortIdentity, &ptpClock->parent_port_identity)) {
+            DBGV("ANNOUNCE_RECEIPT_TIMER reset\n");
+            timerStart(ANNOUNCE_RECEIPT_TIMER,
+                announceReceiptTimeout(header->logMessageInterval, ptpClock), ptpClock->itimer);
+        }
+        /* fall through */
+
+    default:
+        ptpClock->record_update = TRUE;
+        addForeignV2(msgIbuf, header, ptpClock);
+        break;
+    }
+}
+
+static void
+handleSyncV2(MsgHeaderV2 * header, Octet * msgIbuf, ssize_t length, TimeInternal * time, Boolean isFromSelf, RunTimeOpts * rtOpts, PtpClock * ptpClock)
+{
+    MsgSyncV2 *sync;
+    TimeInternal originTimestamp;
+
+    if (length < V2_SYNC_PACKET_LENGTH) {
+        ERROR("short sync message\n");
+        return;
+    }
+    switch (ptpClock->port_state) {
+    case PTP_UNCALIBRATED:
+    case PTP_SLAVE:
+        if (isFromSelf) {
+            DBG("handleSync: ignore from self\n");
+            return;
+        }
+        if (!samePortIdentity(&header->sourcePortIdentity, &ptpClock->parent_port_identity)) {
+            DBGV("handleSync: unwanted\n");
+            return;
+        }
+
+        if (header->logMessageInterval != PTP_V2_LOG_INTERVAL_UNUSED)
+            ptpClock->sync_interval = header->logMessageInterval;
+        ptpClock->parent_last_sync_sequence_number = header->sequenceId;
+        ptpClock->parent_followup_capable = !!(header->flagField[0] & PTP_V2_TWO_STEP);
+        ptpClock->sync_receive_time.seconds = time->seconds;
+        ptpClock->sync_receive_time.nanoseconds = time->nanoseconds;
+        correctionToInternalTime(&ptpClock->sync_correction, header->correctionField);
+
+        if (!ptpClock->parent_followup_capable) {
+            ptpClock->waitingForFollow = FALSE;
+
+            sync = &ptpClock->msgTmp.sync_v2;
+            msgUnpackSyncV2(msgIbuf, sync);
+            toInternalTimeV2(&originTimestamp, &sync->originTimestamp);
+            addTime(&originTimestamp, &originTimestamp, &ptpClock->sync_correction);
+            updateOffset(&originTimestamp, &ptpClock->sync_receive_time,
+                &ptpClock->ofm_filt, rtOpts, ptpClock);
+            updateClock(rtOpts, ptpClock);
+            calibratedV2(rtOpts, ptpClock);
+            countDelayReqV2(rtOpts, ptpClock);
+        } else {
+            ptpClock->waitingForFollow = TRUE;
+        }
+
+#ifndef NO_FILE_SYSTEM
+        if (rtOpts->recordFP != NULL)
+            fprintf(rtOpts->recordFP, "%d %llu\n",
+                header->sequenceId,
+                ((time->seconds * 1000000000ULL) +
+                 time->nanoseconds));
+#endif
+        break;
+
+    case PTP_MASTER:
+        /* the master's own Sync, timestamped as it went out */
+        if (isFromSelf && ptpClock->clock_followup_capable) {
+            addTime(time, time, &rtOpts->outboundLatency);
+            issueFollowUpV2(time, rtOpts, ptpClock);
+        }
+        break;
+
+    default:
+        DBGV("handleSync: disreguard\n");
+        return;
+    }
+}
+
+static void
+handleFollowUpV2(MsgHeaderV2 * header, Octet * msgIbuf, ssize_t length, Boolean isFromSelf, RunTimeOpts * rtOpts, PtpClock * ptpClock)
+{
+    MsgFollowUpV2 *follow;
+    TimeInternal preciseOriginTimestamp, correction;
+
+    if (length < V2_FOLLOW_UP_PACKET_LENGTH) {
+        ERROR("short folow up message\n");
+        return;
+    }
+    switch (ptpClock->port_state) {
+    case PTP_UNCALIBRATED:
+    case PTP_SLAVE:
+        if (isFromSelf) {
+            DBG("handleFollowUp: ignore from self\n");
+            return;
+        }
+
+        if (ptpClock->waitingForFollow
+            && header->sequenceId == ptpClock->parent_last_sync_sequence_number
+            && samePortIdentity(&header->sourcePortIdentity, &ptpClock->parent_port_identity)) {
+            ptpClock->waitingForFollow = FALSE;
+
+            follow = &ptpClock->msgTmp.follow_v2;
+            msgUnpackFollowUpV2(msgIbuf, follow);
+
+            /* the corrections of both the Sync and the Follow_Up */
+            toInternalTimeV2(&preciseOriginTimestamp, &follow->preciseOriginTimestamp);
+            correctionToInternalTime(&correction, header->correctionField);
+            addTime(&preciseOriginTimestamp, &preciseOriginTimestamp, &ptpClock->sync_correction);
+            addTime(&preciseOriginTimestamp, &preciseOriginTimestamp, &correction);
+            updateOffset(&preciseOriginTimestamp, &ptpClock->sync_receive_time,
+                &ptpClock->ofm_filt, rtOpts, ptpClock);
+            updateClock(rtOpts, ptpClock);
+            calibratedV2(rtOpts, ptpClock);
+            countDelayReqV2(rtOpts, ptpClock);
+        } else {
+            DBGV("handleFollowUp: unwanted\n");
+        }
+        break;
+
+    default:
+        DBGV("handleFollowUp: disreguard\n");
+        return;
+    }
+}
+
+static void
+handleDelayReqV2(MsgHeaderV2 * header, Octet * msgIbuf, ssize_t length, TimeInternal * time, Boolean isFromSelf, RunTimeOpts * rtOpts, PtpClock * ptpClock)
+{
+    if (length < V2_DELAY_REQ_PACKET_LENGTH) {
+        ERROR("short delay request message\n");
+        return;
+    }
+    switch (ptpClock->port_state) {
+    case PTP_MASTER:
+        if (isFromSelf) {
+            DBG("handleDelayReq: ignore from self\n");
+            return;
+        }
+        issueDelayRespV2(time, header, rtOpts, ptpClock);
+        break;
+
+    case PTP_UNCALIBRATED:
+    case PTP_SLAVE:
+        if (isFromSelf) {
+            DBG("handleDelayReq: self\n");
+
+            ptpClock->delay_req_send_time.seconds = time->seconds;
+            ptpClock->delay_req_send_time.nanoseconds = time->nanoseconds;
+
+            addTime(&ptpClock->delay_req_send_time, &ptpClock->delay_req_send_time, &rtOpts->outboundLatency);
+
+            if (ptpClock->delay_req_receive_time.seconds) {
+                updateDelay(&ptpClock->delay_req_send_time,
+                        &ptpClock->delay_req_receive_time,
+                        &ptpClock->owd_filt, rtOpts,
+                        ptpClock);
+
+                ptpClock->delay_req_send_time.seconds = 0;
+                ptpClock->delay_req_send_time.nanoseconds = 0;
+                ptpClock->delay_req_receive_time.seconds = 0;
+                ptpClock->delay_req_receive_time.nanoseconds = 0;
+            }
+        }
+        break;
+
+    default:
+        DBGV("handleDelayReq: disreguard\n");
+        return;
+    }
+}
+
+static void
+handleDelayRespV2(MsgHeaderV2 * header, Octet * msgIbuf, ssize_t length, Boolean isFromSelf, RunTimeOpts * rtOpts, PtpClock * ptpClock)
+{
+    MsgDelayRespV2 *resp;
+    TimeInternal correction;
+
+    if (length < V2_DELAY_RESP_PACKET_LENGTH) {
+        ERROR("short delay response message\n");
+        return;
+    }
+    switch (ptpClock->port_state) {
+    case PTP_UNCALIBRATED:
+    case PTP_SLAVE:
+        if (isFromSelf) {
+            DBG("handleDelayResp: ignore from self\n");
+            return;
+        }
+        resp = &ptpClock->msgTmp.resp_v2;
+        msgUnpackDelayRespV2(msgIbuf, resp);
+
+        if (ptpClock->sentDelayReq
+            && header->sequenceId == ptpClock->sentDelayReqSequenceId
+            && samePortIdentity(&resp->requestingPortIdentity, &ptpClock->port_identity)
+            && samePortIdentity(&header->sourcePortIdentity, &ptpClock->parent_port_identity)) {
+            ptpClock->sentDelayReq = FALSE;
+
+            if (header->logMessageInterval != PTP_V2_LOG_INTERVAL_UNUSED)
+                ptpClock->log_min_delay_req_interval = header->logMessageInterval;
+
+            toInternalTimeV2(&ptpClock->delay_req_receive_time, &resp->receiveTimestamp);
+            correctionToInternalTime(&correction, header->correctionField);
+            subTime(&ptpClock->delay_req_receive_time, &ptpClock->delay_req_receive_time, &correction);
+
+            if (ptpClock->delay_req_send_time.seconds) {
+                updateDelay(&ptpClock->delay_req_send_time, &ptpClock->delay_req_receive_time,
+                    &ptpClock->owd_filt, rtOpts, ptpClock);
+
+                ptpClock->delay_req_send_time.seconds = 0;
+                ptpClock->delay_req_send_time.nanoseconds = 0;
+                ptpClock->delay_req_receive_time.seconds = 0;
+                ptpClock->delay_req_receive_time.nanoseconds = 0;
+            }
+        } else {
+            DBGV("handleDelayResp: unwanted\n");
+        }
+        break;
+
+    default:
+        DBGV("handleDelayResp: disreguard\n");
+        return;
+    }
+}
+
+/* pack and send various messages */
+static void
+issueAnnounce(RunTimeOpts * rtOpts, PtpClock * ptpClock)
+{
+    TimeInternal internalTime;
+    TimeRepresentation originTimestamp;
+
+    ++ptpClock->sent_announce_sequence_id;
+
+    getTime(&internalTime);
+    fromInternalTimeV2(&internalTime, &originTimestamp);
+    msgPackAnnounce(ptpClock->msgObuf, &originTimestamp, ptpClock);
+
+    if (!netSendGeneral(ptpClock->msgObuf, V2_ANNOUNCE_PACKET_LENGTH, &ptpClock->netPath))
+        toStateV2(PTP_FAULTY, rtOpts, ptpClock);
+    else
+        DBGV("sent announce message\n");
+}
+
+static void
+issueSyncV2(RunTimeOpts * rtOpts, PtpClock * ptpClock)
+{
+    TimeInternal internalTime;
+    TimeRepresentation originTimestamp;
+
+    ++ptpClock->sent_sync_sequence_id;
+
+    getTime(&internalTime);
+    fromInternalTimeV2(&internalTime, &originTimestamp);
+    msgPackSyncV2(ptpClock->msgObuf, &originTimestamp, ptpClock);
+
+    if (!netSendEvent(ptpClock->msgObuf, V2_SYNC_PACKET_LENGTH, &ptpClock->netPath))
+        toStateV2(PTP_FAULTY, rtOpts, ptpClock);
+    else
+        DBGV("sent sync message\n");
+}
+
+static void
+issueFollowUpV2(TimeInternal * time, RunTimeOpts * rtOpts, PtpClock * ptpClock)
+{
+    TimeRepresentation preciseOriginTimestamp;
+
+    fromInternalTimeV2(time, &preciseOriginTimestamp);
+    msgPackFollowUpV2(ptpClock->msgObuf, &preciseOriginTimestamp, ptpClock);
+
+    if (!netSendGeneral(ptpClock->msgObuf, V2_FOLLOW_UP_PACKET_LENGTH, &ptpClock->netPath))
+        toStateV2(PTP_FAULTY, rtOpts, ptpClock);
+    else
+        DBGV("sent followup message\n");
+}
+
+static void
+issueDelayReqV2(RunTimeOpts * rtOpts, PtpClock * ptpClock)
+{
+    TimeInternal internalTime;
+    TimeRepresentation originTimestamp;
+
+    ptpClock->sentDelayReq = TRUE;
+    ++ptpClock->sentDelayReqSequenceId;
+
+    getTime(&internalTime);
+    fromInternalTimeV2(&internalTime, &originTimestamp);
+    msgPackDelayReqV2(ptpClock->msgObuf, &originTimestamp, ptpClock);
+
+    if (!netSendEvent(ptpClock->msgObuf, V2_DELAY_REQ_PACKET_LENGTH, &ptpClock->netPath))
+        toStateV2(PTP_FAULTY, rtOpts, ptpClock);
+    else
+        DBGV("sent delay request message\n");
+}
+
+static void
+issueDelayRespV2(TimeInternal * time, MsgHeaderV2 * header, RunTimeOpts * rtOpts, PtpClock * ptpClock)
+{
+    TimeRepresentation receiveTimestamp;
+
+    fromInternalTimeV2(time, &receiveTimestamp);
+    msgPackDelayRespV2(ptpClock->msgObuf, header, &receiveTimestamp, ptpClock);
+
+    if (!netSendGeneral(ptpClock->msgObuf, V2_DELAY_RESP_PACKET_LENGTH, &ptpClock->netPath))
+        toStateV2(PTP_FAULTY, rtOpts, ptpClock);
+    else
+        DBGV("sent delay response message\n");
+}
+
+/* add or update an entry in the foreign master data set from an Announce */
+static void
+addForeignV2(Octet * buf, MsgHeaderV2 * header, PtpClock * ptpClock)
+{
+    int i, j;
+    Boolean found = FALSE;
+
+    DBGV("updateForeign\n");
+
+    j = ptpClock->foreign_record_best;
+    for (i = 0; i < ptpClock->number_foreign_records; ++i) {
+        if (samePortIdentity(&header->sourcePortIdentity, &ptpClock->foreign[j].header_v2.sourcePortIdentity)) {
+            ++ptpClock->foreign[j].foreign_master_syncs;
+            ++ptpClock->foreign[j].foreign_master_window[ptpClock->foreign_window_i];
+            found = TRUE;
+            DBGV("updateForeign: update record %d\n", j);
+            break;
+        }
+        j = (j + 1) % ptpClock->number_foreign_records;
+    }
+
+    if (!found) {
+        if (ptpClock->number_foreign_records < ptpClock->max_foreign_records)
+            ++ptpClock->number_foreign_records;
+
+        j = ptpClock->foreign_record_i;
+        ptpClock->foreign[j].foreign_master_syncs = 1;
+        memset(ptpClock->foreign[j].foreign_master_window, 0, sizeof(ptpClock->foreign[j].foreign_master_window));
+        ptpClock->foreign[j].foreign_master_window[ptpClock->foreign_window_i] = 1;
+
+        DBG("updateForeign: new record (%d,%d)\n",
+            ptpClock->foreign_record_i, ptpClock->number_foreign_records);
+
+        ptpClock->foreign_record_i = (ptpClock->foreign_record_i + 1) % ptpClock->max_foreign_records;
+    }
+    msgUnpackHeaderV2(buf, &ptpClock->foreign[j].header_v2);
+    msgUnpackAnnounce(buf, &ptpClock->foreign[j].announce);
+}
+
+/* an uncalibrated port is calibrated to its master, and slaves to it, once
+   it has an offset and a delay to correct it with */
+static void
+calibratedV2(RunTimeOpts * rtOpts, PtpClock * ptpClock)
+{
+    if (ptpClock->port_state == PTP_UNCALIBRATED
+        && (ptpClock->one_way_delay.seconds || ptpClock->one_way_delay.nanoseconds))
+        toStateV2(PTP_SLAVE, rtOpts, ptpClock);
+}
+
+/* move the foreign master time window on by an announce interval, so that
+   foreign_master_syncs counts only the Announces within it (9.3.2.5), and
+   drop the records left with none */
+static void
+ageForeignV2(PtpClock * ptpClock)
+{
+    ForeignMasterRecord *record;
+    Integer16 i, last;
+    UInteger8 k;
+
+    k = (ptpClock->foreign_window_i + 1) % PTP_V2_FOREIGN_MASTER_TIME_WINDOW;
+    ptpClock->foreign_window_i = k;
+
+    for (i = 0; i < ptpClock->number_foreign_records;) {
+        record = &ptpClock->foreign[i];
+        record->foreign_master_syncs -= record->foreign_master_window[k];
+        record->foreign_master_window[k] = 0;
+        if (record->foreign_master_syncs) {
+            ++i;
+            continue;
+        }
+
+        DBG("ageForeignV2: drop record %d\n", i);
+
+        /* the last record takes its place, and is aged in turn */
+        last = --ptpClock->number_foreign_records;
+        if (i < last)
+            *record = ptpClock->foreign[last];
+        if (ptpClock->foreign_record_best == i)
+            ptpClock->foreign_record_best = 0;
+        else if (ptpClock->foreign_record_best == last)
+            ptpClock->foreign_record_best = i;
+        ptpClock->foreign_record_i = ptpClock->number_foreign_records;
+        ptpClock->record_update = TRUE;
+    }
+}
@@ -33,8 +33,8 @@ main(int argc, char **argv)
 	rtOpts.outboundLatency.nanoseconds = DEFAULT_OUTBOUND_LATENCY;
 	rtOpts.noResetClock = DEFAULT_NO_RESET_CLOCK;
 	rtOpts.s = DEFAULT_DELAY_S;
-	rtOpts.ap = DEFAULT_AP;
-	rtOpts.ai = DEFAULT_AI;
+	rtOpts.ap = SCHEDULED_GAIN;
+	rtOpts.ai = SCHEDULED_GAIN;
 	rtOpts.max_foreign_records = DEFAULT_MAX_FOREIGN_RECORDS;
 	rtOpts.currentUtcOffset = DEFAULT_UTC_OFFSET;
 	rtOpts.logFd = -1;
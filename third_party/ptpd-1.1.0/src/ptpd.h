@@ -34,6 +34,12 @@ void    m1 (PtpClock *);
 void    s1 (MsgHeader *, MsgSync *, PtpClock *);
 void    initData(RunTimeOpts *, PtpClock *);
 
+/* bmc_v2.c */
+UInteger8 bmcV2(ForeignMasterRecord *, RunTimeOpts *, PtpClock *);
+void    m1V2(PtpClock *);
+void    s1V2(MsgHeaderV2 *, MsgAnnounce *, PtpClock *);
+void    initDataV2(RunTimeOpts *, PtpClock *);
+
 /* probe.c */
 void    probe(RunTimeOpts *, PtpClock *);
 
@@ -46,4 +52,9 @@ void    protocol(RunTimeOpts *, PtpClock *);
 void protocol_first(RunTimeOpts*,PtpClock*);
 void protocol_loop(RunTimeOpts*,PtpClock*);
 
+/* protocol_v2.c, which protocol.c hands over to for rtOpts->ptpVersion 2 */
+Boolean doInitV2(RunTimeOpts *, PtpClock *);
+void    doStateV2(RunTimeOpts *, PtpClock *);
+void    toStateV2(UInteger8, RunTimeOpts *, PtpClock *);
+
 #endif
@@ -0,0 +1,166 @@
+//*****************************************************************************
+//
+// wakeup.c - A millisecond time base with a programmable wakeup, for running
+// the timer wheel without a periodic tick.
+//
+// Timer 4 counts processor clocks down through its full 32-bit range and
+// never stops or reloads, so the time it keeps does not depend on how often
+// anything reads it.  WakeupNow() folds the clocks counted since the last
+// call into a count of whole milliseconds, carrying the remainder.  The
+// wakeup is the timer's match interrupt, set to the count at which the
+// requested millisecond begins.
+//
+// This is not the PTP clock and is never steered; it only has to tell the
+// timer wheel how much time has passed.  Everything here runs in the main
+// loop except the interrupt handler, which only clears the interrupt.
+//
+//*****************************************************************************
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "inc/hw_memmap.h"
+#include "inc/hw_timer.h"
+#include "inc/hw_types.h"
+#include "driverlib/rom.h"
+#include "driverlib/rom_map.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
+#include "wakeup.h"
+
+//*****************************************************************************
+//
+// The timer used for the time base and wakeup.
+//
+//*****************************************************************************
+#define WAKEUP_TIMER_BASE       TIMER4_BASE
+#define WAKEUP_TIMER_PERIPH     SYSCTL_PERIPH_TIMER4
+
+//*****************************************************************************
+//
+// Read the timer counter.
+//
+//*****************************************************************************
+#define WAKEUP_TIMER_VALUE()    HWREG(WAKEUP_TIMER_BASE + TIMER_O_TAR)
+
+//*****************************************************************************
+//
+// The processor clocks in a millisecond, the milliseconds counted so far,
+// the clocks counted towards the next one, and the timer count at which
+// they were counted.
+//
+//*****************************************************************************
+static uint32_t g_ui32WakeupClocksPerMs;
+static uint32_t g_ui32WakeupMs;
+static uint32_t g_ui32WakeupRemainder;
+static uint32_t g_ui32WakeupOrigin;
+
+//*****************************************************************************
+//
+// Start the time base at zero milliseconds.
+//
+//*****************************************************************************
+void
+WakeupInit(uint32_t ui32SysClock)
+{
+    MAP_SysCtlPeripheralEnable(WAKEUP_TIMER_PERIPH);
+    while(!MAP_SysCtlPeripheralReady(WAKEUP_TIMER_PERIPH))
+    {
+    }
+
+    MAP_TimerConfigure(WAKEUP_TIMER_BASE, TIMER_CFG_PERIODIC);
+    MAP_TimerLoadSet(WAKEUP_TIMER_BASE, TIMER_A, 0xFFFFFFFF);
+
+    //
+    // Interrupt on a match rather than on the timeout, and start with the
+    // match as far off as it can be.
+    //
+    HWREG(WAKEUP_TIMER_BASE + TIMER_O_TAMR) |= TIMER_TAMR_TAMIE;
+    MAP_TimerMatchSet(WAKEUP_TIMER_BASE, TIMER_A, 0);
+    MAP_TimerIntClear(WAKEUP_TIMER_BASE, TIMER_TIMA_MATCH);
+    MAP_TimerIntEnable(WAKEUP_TIMER_BASE, TIMER_TIMA_MATCH);
+
+    g_ui32WakeupClocksPerMs = ui32SysClock / 1000;
+    g_ui32WakeupMs = 0;
+    g_ui32WakeupRemainder = 0;
+
+    MAP_TimerEnable(WAKEUP_TIMER_BASE, TIMER_A);
+    g_ui32WakeupOrigin = WAKEUP_TIMER_VALUE();
+}
+
+//*****************************************************************************
+//
+// Return the time in milliseconds since WakeupInit().
+//
+//*****************************************************************************
+uint32_t
+WakeupNow(void)
+{
+    uint32_t ui32Count, ui32Elapsed, ui32Ms;
+
+    //
+    // The timer counts down, so this is correct across a wrap.
+    //
+    ui32Count = WAKEUP_TIMER_VALUE();
+    ui32Elapsed = g_ui32WakeupOrigin - ui32Count;
+    g_ui32WakeupOrigin = ui32Count;
+
+    ui32Ms = ui32Elapsed / g_ui32WakeupClocksPerMs;
+    g_ui32WakeupRemainder += ui32Elapsed - (ui32Ms * g_ui32WakeupClocksPerMs);
+    if(g_ui32WakeupRemainder >= g_ui32WakeupClocksPerMs)
+    {
+        g_ui32WakeupRemainder -= g_ui32WakeupClocksPerMs;
+        ui32Ms++;
+    }
+    g_ui32WakeupMs += ui32Ms;
+
+    return(g_ui32WakeupMs);
+}
+
+//*****************************************************************************
+//
+// Have the wakeup interrupt taken at the start of the given millisecond, or
+// WAKEUP_MAX_MS from now if that is sooner.  Returns false, and sets nothing,
+// if that millisecond has already begun.
+//
+//*****************************************************************************
+bool
+WakeupSet(uint32_t ui32Ms)
+{
+    uint32_t ui32Delta, ui32Clocks;
+
+    ui32Delta = ui32Ms - WakeupNow();
+    if((int32_t)ui32Delta <= 0)
+    {
+        return(false);
+    }
+    if(ui32Delta > WAKEUP_MAX_MS)
+    {
+        ui32Delta = WAKEUP_MAX_MS;
+    }
+
+    ui32Clocks = (ui32Delta * g_ui32WakeupClocksPerMs) - g_ui32WakeupRemainder;
+    MAP_TimerMatchSet(WAKEUP_TIMER_BASE, TIMER_A,
+                      g_ui32WakeupOrigin - ui32Clocks);
+
+    //
+    // If the count went past the match while it was being set, the
+    // interrupt will not be taken, so the caller must not wait for it.
+    //
+    if((g_ui32WakeupOrigin - WAKEUP_TIMER_VALUE()) >= ui32Clocks)
+    {
+        return(false);
+    }
+
+    return(true);
+}
+
+//*****************************************************************************
+//
+// Clear the wakeup interrupt.  This is called from its interrupt handler.
+//
+//*****************************************************************************
+void
+WakeupIntClear(void)
+{
+    MAP_TimerIntClear(WAKEUP_TIMER_BASE, TIMER_TIMA_MATCH);
+}
@@ -0,0 +1,59 @@
+//*****************************************************************************
+//
+// wakeup.h - A millisecond time base with a programmable wakeup, for running
+// the timer wheel without a periodic tick.
+//
+//*****************************************************************************
+
+#ifndef __WAKEUP_H__
+#define __WAKEUP_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+//*****************************************************************************
+//
+// The interrupt used for the wakeup.
+//
+//*****************************************************************************
+#define WAKEUP_INT              INT_TIMER4A
+
+//*****************************************************************************
+//
+// The furthest ahead that a wakeup is set.  WakeupNow() must be called at
+// least once every 35 seconds, which waking at least this often ensures.
+//
+//*****************************************************************************
+#define WAKEUP_MAX_MS           10000
+
+//*****************************************************************************
+//
+// Prototypes.
+//
+//*****************************************************************************
+extern void WakeupInit(uint32_t ui32SysClock);
+extern uint32_t WakeupNow(void);
+extern bool WakeupSet(uint32_t ui32Ms);
+extern void WakeupIntClear(void);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __WAKEUP_H__
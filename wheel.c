@@ -0,0 +1,421 @@
+//*****************************************************************************
+//
+// wheel.c - A hierarchical timer wheel with millisecond resolution.
+//
+// A timer due in fewer than 32^(N+1) ms from the wheel's current time goes in
+// level N, in the slot given by bits 5N to 5N+4 of its expiry time.  When the
+// current time crosses a multiple of 32^N ms, the slot of level N that covers
+// the next 32^N ms is emptied and its timers are put back in, which places
+// them one level lower.  Each level keeps a bit mask of the slots that hold
+// timers, so that runs of empty milliseconds are skipped and the next expiry
+// is found in a few instructions per level.
+//
+// This file has no hardware dependencies and is also built into the host
+// tools.
+//
+//*****************************************************************************
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "wheel.h"
+
+//*****************************************************************************
+//
+// Count leading zeros.
+//
+//*****************************************************************************
+#if defined(ccs)
+#define WHEEL_CLZ(x)            _norm(x)
+#else
+#define WHEEL_CLZ(x)            __builtin_clz(x)
+#endif
+
+//*****************************************************************************
+//
+// The mask of the slot index bits, and the mask of the time bits below level
+// N's slot index.
+//
+//*****************************************************************************
+#define WHEEL_SLOT_MASK         (WHEEL_SLOTS - 1)
+#define WHEEL_LEVEL_MASK(n)     ((1 << ((n) * WHEEL_SLOT_BITS)) - 1)
+
+//*****************************************************************************
+//
+// The level number marking a timer on the list of timers due.
+//
+//*****************************************************************************
+#define WHEEL_DUE               WHEEL_LEVELS
+
+//*****************************************************************************
+//
+// The number of the lowest set bit of a non-zero value.
+//
+//*****************************************************************************
+static uint32_t
+WheelLowestBit(uint32_t ui32Value)
+{
+    return(31 - WHEEL_CLZ(ui32Value & (0 - ui32Value)));
+}
+
+//*****************************************************************************
+//
+// Rotate a slot mask so that the given slot is in bit 0.
+//
+//*****************************************************************************
+static uint32_t
+WheelRotate(uint32_t ui32Mask, uint32_t ui32Slot)
+{
+    if(ui32Slot == 0)
+    {
+        return(ui32Mask);
+    }
+
+    return((ui32Mask >> ui32Slot) | (ui32Mask << (WHEEL_SLOTS - ui32Slot)));
+}
+
+//*****************************************************************************
+//
+// Put a timer in the slot for its expiry time.  A timer already due is put in
+// the slot for the current time, so that it runs on the next advance.
+//
+//*****************************************************************************
+static void
+WheelInsert(tWheel *psWheel, tWheelTimer *psTimer)
+{
+    uint32_t ui32Delta, ui32Place, ui32Level, ui32Slot;
+
+    if((int32_t)(psTimer->ui32Expiry - psWheel->ui32Now) < 0)
+    {
+        psTimer->ui32Expiry = psWheel->ui32Now;
+    }
+
+    //
+    // A timer beyond the reach of the wheel goes in the furthest slot, and
+    // is put back in when that slot is emptied.
+    //
+    ui32Delta = psTimer->ui32Expiry - psWheel->ui32Now;
+    ui32Place = psTimer->ui32Expiry;
+    if(ui32Delta >= WHEEL_RANGE_MS)
+    {
+        ui32Delta = WHEEL_RANGE_MS - 1;
+        ui32Place = psWheel->ui32Now + ui32Delta;
+    }
+
+    for(ui32Level = 0;
+        (ui32Level < (WHEEL_LEVELS - 1)) &&
+        (ui32Delta > WHEEL_LEVEL_MASK(ui32Level + 1));
+        ui32Level++)
+    {
+    }
+    ui32Slot = (ui32Place >> (ui32Level * WHEEL_SLOT_BITS)) & WHEEL_SLOT_MASK;
+
+    psTimer->psWheel = psWheel;
+    psTimer->ui8Level = ui32Level;
+    psTimer->ui8Slot = ui32Slot;
+    psTimer->psPrev = 0;
+    psTimer->psNext = psWheel->ppsSlot[ui32Level][ui32Slot];
+    if(psTimer->psNext)
+    {
+        psTimer->psNext->psPrev = psTimer;
+    }
+    psWheel->ppsSlot[ui32Level][ui32Slot] = psTimer;
+    psWheel->pui32Occupied[ui32Level] |= 1 << ui32Slot;
+}
+
+//*****************************************************************************
+//
+// Take a timer out of its slot, or out of the list of timers due.
+//
+//*****************************************************************************
+static void
+WheelRemove(tWheelTimer *psTimer)
+{
+    tWheel *psWheel;
+
+    psWheel = psTimer->psWheel;
+
+    if(psTimer->psPrev)
+    {
+        psTimer->psPrev->psNext = psTimer->psNext;
+    }
+    else if(psTimer->ui8Level == WHEEL_DUE)
+    {
+        psWheel->psDue = psTimer->psNext;
+    }
+    else
+    {
+        psWheel->ppsSlot[psTimer->ui8Level][psTimer->ui8Slot] =
+            psTimer->psNext;
+        if(psTimer->psNext == 0)
+        {
+            psWheel->pui32Occupied[psTimer->ui8Level] &=
+                ~(1 << psTimer->ui8Slot);
+        }
+    }
+    if(psTimer->psNext)
+    {
+        psTimer->psNext->psPrev = psTimer->psPrev;
+    }
+
+    psTimer->psWheel = 0;
+}
+
+//*****************************************************************************
+//
+// Empty the slot of each level that covers the time from the current time,
+// which is a multiple of 32 ms, and put its timers back in lower down.
+//
+//*****************************************************************************
+static void
+WheelCascade(tWheel *psWheel)
+{
+    tWheelTimer *psTimer;
+    uint32_t ui32Level, ui32Slot;
+
+    for(ui32Level = 1; ui32Level < WHEEL_LEVELS; ui32Level++)
+    {
+        ui32Slot = ((psWheel->ui32Now >> (ui32Level * WHEEL_SLOT_BITS)) &
+                    WHEEL_SLOT_MASK);
+
+        while((psTimer = psWheel->ppsSlot[ui32Level][ui32Slot]) != 0)
+        {
+            WheelRemove(psTimer);
+            WheelInsert(psWheel, psTimer);
+        }
+
+        //
+        // The level above only moves on when this one wraps.
+        //
+        if(ui32Slot != 0)
+        {
+            break;
+        }
+    }
+}
+
+//*****************************************************************************
+//
+// Set up an empty wheel.  pfnNow returns the current time in milliseconds.
+//
+//*****************************************************************************
+void
+WheelInit(tWheel *psWheel, uint32_t (*pfnNow)(void))
+{
+    uint32_t ui32Level, ui32Slot;
+
+    psWheel->pfnNow = pfnNow;
+    psWheel->ui32Now = pfnNow();
+    psWheel->psDue = 0;
+
+    for(ui32Level = 0; ui32Level < WHEEL_LEVELS; ui32Level++)
+    {
+        psWheel->pui32Occupied[ui32Level] = 0;
+        for(ui32Slot = 0; ui32Slot < WHEEL_SLOTS; ui32Slot++)
+        {
+            psWheel->ppsSlot[ui32Level][ui32Slot] = 0;
+        }
+    }
+}
+
+//*****************************************************************************
+//
+// Start a timer, or restart it if it is running.  pfnHandler is called with
+// pvArg ui32DelayMs from now and, if ui32PeriodMs is not zero, every
+// ui32PeriodMs after that.
+//
+//*****************************************************************************
+void
+WheelTimerStart(tWheel *psWheel, tWheelTimer *psTimer,
+                void (*pfnHandler)(void *pvArg), void *pvArg,
+                uint32_t ui32DelayMs, uint32_t ui32PeriodMs)
+{
+    if(psTimer->psWheel)
+    {
+        WheelRemove(psTimer);
+    }
+
+    psTimer->pfnHandler = pfnHandler;
+    psTimer->pvArg = pvArg;
+    psTimer->ui32Period = ui32PeriodMs;
+    psTimer->ui32Expiry = psWheel->pfnNow() + ui32DelayMs;
+
+    WheelInsert(psWheel, psTimer);
+}
+
+//*****************************************************************************
+//
+// Stop a timer.  Stopping a stopped timer does nothing.
+//
+//*****************************************************************************
+void
+WheelTimerStop(tWheelTimer *psTimer)
+{
+    if(psTimer->psWheel)
+    {
+        WheelRemove(psTimer);
+    }
+}
+
+//*****************************************************************************
+//
+// Returns true if a timer is running.
+//
+//*****************************************************************************
+bool
+WheelTimerActive(const tWheelTimer *psTimer)
+{
+    return(psTimer->psWheel != 0);
+}
+
+//*****************************************************************************
+//
+// Run every timer due at or before ui32Now, in order of expiry.  A periodic
+// timer that has fallen more than a period behind runs once, not once for
+// each period missed.
+//
+//*****************************************************************************
+void
+WheelAdvance(tWheel *psWheel, uint32_t ui32Now)
+{
+    tWheelTimer *psTimer;
+    uint32_t ui32Tick, ui32Slot, ui32Bits, ui32Behind;
+
+    while((int32_t)(ui32Now - psWheel->ui32Now) >= 0)
+    {
+        ui32Tick = psWheel->ui32Now;
+        ui32Slot = ui32Tick & WHEEL_SLOT_MASK;
+        if(ui32Slot == 0)
+        {
+            WheelCascade(psWheel);
+        }
+
+        //
+        // Find the next millisecond in this turn of level 0 with timers, or
+        // go to the start of the next turn.
+        //
+        ui32Bits = psWheel->pui32Occupied[0] >> ui32Slot;
+        if(ui32Bits == 0)
+        {
+            ui32Tick = (ui32Tick | WHEEL_SLOT_MASK) + 1;
+        }
+        else
+        {
+            ui32Slot += WheelLowestBit(ui32Bits);
+            ui32Tick = (ui32Tick & ~WHEEL_SLOT_MASK) + ui32Slot;
+        }
+        if((int32_t)(ui32Now - ui32Tick) < 0)
+        {
+            psWheel->ui32Now = ui32Now + 1;
+            break;
+        }
+        psWheel->ui32Now = ui32Tick;
+        if(ui32Bits == 0)
+        {
+            continue;
+        }
+
+        //
+        // Move the timers due now to a list of their own, so that a timer
+        // started again by a handler goes in a slot that is not being run.
+        // Anything started for now or earlier goes in the next slot.
+        //
+        psWheel->ui32Now = ui32Tick + 1;
+        psWheel->psDue = psWheel->ppsSlot[0][ui32Slot];
+        psWheel->ppsSlot[0][ui32Slot] = 0;
+        psWheel->pui32Occupied[0] &= ~(1 << ui32Slot);
+        for(psTimer = psWheel->psDue; psTimer; psTimer = psTimer->psNext)
+        {
+            psTimer->ui8Level = WHEEL_DUE;
+        }
+
+        while((psTimer = psWheel->psDue) != 0)
+        {
+            WheelRemove(psTimer);
+
+            if(psTimer->ui32Period)
+            {
+                ui32Behind = ui32Now - psTimer->ui32Expiry;
+                psTimer->ui32Expiry += (psTimer->ui32Period *
+                                        ((ui32Behind / psTimer->ui32Period) +
+                                         1));
+                WheelInsert(psWheel, psTimer);
+            }
+
+            psTimer->pfnHandler(psTimer->pvArg);
+        }
+    }
+}
+
+//*****************************************************************************
+//
+// Find the time at which the next timer expires.  Returns false if no timers
+// are running.
+//
+//*****************************************************************************
+bool
+WheelNextExpiry(tWheel *psWheel, uint32_t *pui32Ms)
+{
+    tWheelTimer *psTimer;
+    uint32_t ui32Level, ui32Slot, ui32Mask, ui32Next, ui32Best;
+    bool bFound;
+
+    bFound = false;
+    ui32Best = 0;
+
+    for(ui32Level = 0; ui32Level < WHEEL_LEVELS; ui32Level++)
+    {
+        ui32Mask = psWheel->pui32Occupied[ui32Level];
+        if(ui32Mask == 0)
+        {
+            continue;
+        }
+
+        //
+        // Level 0 slots are single milliseconds, starting with the current
+        // one.  The slots of the levels above are emptied at the start of
+        // the span they cover, so the current slot is next due a full turn
+        // from now, unless the current time is the start of its span and the
+        // slot has yet to be emptied.  The earliest timer of a level is in
+        // its first slot in that order.
+        //
+        ui32Slot = ((psWheel->ui32Now >> (ui32Level * WHEEL_SLOT_BITS)) &
+                    WHEEL_SLOT_MASK);
+        if((ui32Level != 0) &&
+           (psWheel->ui32Now & WHEEL_LEVEL_MASK(ui32Level)))
+        {
+            ui32Slot++;
+        }
+        ui32Next = WheelLowestBit(WheelRotate(ui32Mask,
+                                              ui32Slot & WHEEL_SLOT_MASK));
+
+        if(ui32Level == 0)
+        {
+            ui32Next += psWheel->ui32Now;
+        }
+        else
+        {
+            psTimer = psWheel->ppsSlot[ui32Level]
+                                      [(ui32Slot + ui32Next) & WHEEL_SLOT_MASK];
+            ui32Next = psTimer->ui32Expiry;
+            for(psTimer = psTimer->psNext; psTimer; psTimer = psTimer->psNext)
+            {
+                if((psTimer->ui32Expiry - psWheel->ui32Now) <
+                   (ui32Next - psWheel->ui32Now))
+                {
+                    ui32Next = psTimer->ui32Expiry;
+                }
+            }
+        }
+
+        if(!bFound ||
+           ((ui32Next - psWheel->ui32Now) < (ui32Best - psWheel->ui32Now)))
+        {
+            ui32Best = ui32Next;
+            bFound = true;
+        }
+    }
+
+    *pui32Ms = ui32Best;
+
+    return(bFound);
+}
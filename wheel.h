@@ -0,0 +1,141 @@
+//*****************************************************************************
+//
+// wheel.h - A hierarchical timer wheel with millisecond resolution.
+//
+// Timers are kept in four levels of 32 slots.  Level 0 holds the timers due
+// in the next 32 ms, one slot per millisecond; each level above holds 32
+// times the span of the one below, so the wheel reaches 2^20 ms (about 17
+// minutes) ahead, and timers further out than that are carried down from
+// the top level until they come within reach.  Starting and stopping a timer
+// costs the same however many timers are running.
+//
+// The wheel does not read a clock itself.  WheelAdvance() is given the time
+// and runs every timer that has come due, and WheelNextExpiry() gives the
+// time at which the next timer expires, so the caller can sleep until then.
+// The time source given to WheelInit() is only used to find when a timer
+// started now should expire.
+//
+// None of these functions may be called from an interrupt handler that can
+// preempt another call on the same wheel.
+//
+//*****************************************************************************
+
+#ifndef __WHEEL_H__
+#define __WHEEL_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+//*****************************************************************************
+//
+// The shape of the wheel.
+//
+//*****************************************************************************
+#define WHEEL_LEVELS            4
+#define WHEEL_SLOT_BITS         5
+#define WHEEL_SLOTS             (1 << WHEEL_SLOT_BITS)
+#define WHEEL_RANGE_MS          (1 << (WHEEL_LEVELS * WHEEL_SLOT_BITS))
+
+//*****************************************************************************
+//
+// A timer.  A timer that is all zeros is stopped, so timers in zeroed
+// structures need no further set up.
+//
+//*****************************************************************************
+typedef struct tWheelTimer
+{
+    //
+    // The links of the slot list, and the wheel the timer is on, or NULL if
+    // it is stopped.
+    //
+    struct tWheelTimer *psNext;
+    struct tWheelTimer *psPrev;
+    struct tWheel *psWheel;
+
+    //
+    // The time at which the timer expires, and the period after which it
+    // expires again, or 0 if it expires only once.
+    //
+    uint32_t ui32Expiry;
+    uint32_t ui32Period;
+
+    //
+    // The function called when the timer expires.
+    //
+    void (*pfnHandler)(void *pvArg);
+    void *pvArg;
+
+    //
+    // The slot the timer is in.
+    //
+    uint8_t ui8Level;
+    uint8_t ui8Slot;
+}
+tWheelTimer;
+
+//*****************************************************************************
+//
+// A wheel.
+//
+//*****************************************************************************
+typedef struct tWheel
+{
+    //
+    // Where the current time comes from.
+    //
+    uint32_t (*pfnNow)(void);
+
+    //
+    // The next millisecond to be run.  Every timer due before this has been
+    // run.
+    //
+    uint32_t ui32Now;
+
+    //
+    // For each level, a bit for each slot that holds timers, and the slots.
+    //
+    uint32_t pui32Occupied[WHEEL_LEVELS];
+    tWheelTimer *ppsSlot[WHEEL_LEVELS][WHEEL_SLOTS];
+
+    //
+    // The timers taken from the slot being run that have yet to run.
+    //
+    tWheelTimer *psDue;
+}
+tWheel;
+
+//*****************************************************************************
+//
+// Prototypes.
+//
+//*****************************************************************************
+extern void WheelInit(tWheel *psWheel, uint32_t (*pfnNow)(void));
+extern void WheelTimerStart(tWheel *psWheel, tWheelTimer *psTimer,
+                            void (*pfnHandler)(void *pvArg), void *pvArg,
+                            uint32_t ui32DelayMs, uint32_t ui32PeriodMs);
+extern void WheelTimerStop(tWheelTimer *psTimer);
+extern bool WheelTimerActive(const tWheelTimer *psTimer);
+extern void WheelAdvance(tWheel *psWheel, uint32_t ui32Now);
+extern bool WheelNextExpiry(tWheel *psWheel, uint32_t *pui32Ms);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __WHEEL_H__
@@ -0,0 +1,204 @@
+//*****************************************************************************
+//
+// workq.c - A prioritised, run-to-completion work queue serviced from the
+// main loop.
+//
+// The pending jobs are a bit mask, bit N for the job at index N of the table.
+// Interrupt handlers set bits and the main loop clears them, each through
+// the bit-band alias of the mask, so neither needs a critical section.  The
+// time of the first post, and the count of posts, are written only by the
+// interrupt handler that posts a job, and the count of runs only by the main
+// loop, so each job must be posted from interrupt handlers of one priority.
+//
+//*****************************************************************************
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "inc/hw_types.h"
+#include "driverlib/cpu.h"
+#include "utils/ustdlib.h"
+#include "hotpath.h"
+#include "workq.h"
+
+//*****************************************************************************
+//
+// The job table and the jobs waiting to run.
+//
+//*****************************************************************************
+static const tWorkJob *g_psWorkJobs;
+static uint32_t g_ui32WorkNumJobs;
+static volatile uint32_t g_ui32WorkPending;
+
+//*****************************************************************************
+//
+// For each job, the hot-path time at which it was posted while not pending,
+// the number of times it was posted, and the number of times it ran.  Posts
+// less runs is the number of posts absorbed by one already pending.
+//
+//*****************************************************************************
+static volatile uint32_t g_pui32WorkPosted[WORK_MAX_JOBS];
+static volatile uint32_t g_pui32WorkPosts[WORK_MAX_JOBS];
+static volatile uint32_t g_pui32WorkRuns[WORK_MAX_JOBS];
+
+//*****************************************************************************
+//
+// Set up the queue with a table of jobs, highest priority first.
+//
+//*****************************************************************************
+void
+WorkInit(const tWorkJob *psJobs, uint32_t ui32NumJobs)
+{
+    uint32_t ui32Job;
+
+    if(ui32NumJobs > WORK_MAX_JOBS)
+    {
+        ui32NumJobs = WORK_MAX_JOBS;
+    }
+
+    g_ui32WorkPending = 0;
+    for(ui32Job = 0; ui32Job < WORK_MAX_JOBS; ui32Job++)
+    {
+        g_pui32WorkPosts[ui32Job] = 0;
+        g_pui32WorkRuns[ui32Job] = 0;
+    }
+
+    g_psWorkJobs = psJobs;
+    g_ui32WorkNumJobs = ui32NumJobs;
+}
+
+//*****************************************************************************
+//
+// Ask for a job to be run.  This may be called from an interrupt handler.
+//
+//*****************************************************************************
+void
+WorkPost(uint32_t ui32Job)
+{
+    if(!HWREGBITW(&g_ui32WorkPending, ui32Job))
+    {
+        g_pui32WorkPosted[ui32Job] = HOTPATH_NOW();
+    }
+    g_pui32WorkPosts[ui32Job]++;
+
+    HWREGBITW(&g_ui32WorkPending, ui32Job) = 1;
+}
+
+//*****************************************************************************
+//
+// Returns true if any job is waiting to run.
+//
+//*****************************************************************************
+bool
+WorkPending(void)
+{
+    return(g_ui32WorkPending != 0);
+}
+
+//*****************************************************************************
+//
+// Run the highest priority pending job, if there is one.  Returns false if
+// there was nothing to run.
+//
+//*****************************************************************************
+bool
+WorkRunNext(void)
+{
+    const tWorkJob *psJob;
+    uint32_t ui32Pending;
+    uint32_t ui32Job;
+
+    ui32Pending = g_ui32WorkPending;
+    if(ui32Pending == 0)
+    {
+        return(false);
+    }
+
+    for(ui32Job = 0; !(ui32Pending & (1 << ui32Job)); ui32Job++)
+    {
+    }
+    psJob = &g_psWorkJobs[ui32Job];
+
+    //
+    // Clear the bit before running the job, so that a post made while it
+    // runs has it run again.
+    //
+    HWREGBITW(&g_ui32WorkPending, ui32Job) = 0;
+
+    HOTPATH_LATENCY(psJob->ui32Point,
+                    HOTPATH_NOW() - g_pui32WorkPosted[ui32Job]);
+    HOTPATH_ENTER(psJob->ui32Point);
+    psJob->pfnHandler();
+    HOTPATH_EXIT(psJob->ui32Point);
+
+    g_pui32WorkRuns[ui32Job]++;
+
+    return(true);
+}
+
+//*****************************************************************************
+//
+// Run jobs until none are pending.
+//
+//*****************************************************************************
+void
+WorkRun(void)
+{
+    while(WorkRunNext())
+    {
+    }
+}
+
+//*****************************************************************************
+//
+// Sleep until the next interrupt, unless a job is pending.  Interrupts are
+// masked between the check and the sleep so that a job posted in between
+// wakes the processor at once rather than at the interrupt after; the
+// handler runs when they are unmasked again.
+//
+//*****************************************************************************
+void
+WorkSleep(void)
+{
+    CPUcpsid();
+    if(!WorkPending())
+    {
+        CPUwfi();
+    }
+    CPUcpsie();
+}
+
+//*****************************************************************************
+//
+// Format the post and run counts of each job, one line per job.  Returns the
+// length of the text, which is truncated to fit the buffer.
+//
+//*****************************************************************************
+uint32_t
+WorkFormat(char *pcBuf, uint32_t ui32Size)
+{
+    uint32_t ui32Len, ui32Job, ui32Posts, ui32Runs;
+
+    if(ui32Size == 0)
+    {
+        return(0);
+    }
+
+    pcBuf[0] = '\0';
+    ui32Len = 0;
+    for(ui32Job = 0; ui32Job < g_ui32WorkNumJobs; ui32Job++)
+    {
+        ui32Runs = g_pui32WorkRuns[ui32Job];
+        ui32Posts = g_pui32WorkPosts[ui32Job];
+
+        ui32Len += usnprintf(pcBuf + ui32Len, ui32Size - ui32Len,
+                             "job=%s posts=%u runs=%u merged=%u\n",
+                             g_psWorkJobs[ui32Job].pcName, ui32Posts,
+                             ui32Runs, ui32Posts - ui32Runs);
+        if(ui32Len >= ui32Size)
+        {
+            return(ui32Size - 1);
+        }
+    }
+
+    return(ui32Len);
+}
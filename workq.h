@@ -0,0 +1,97 @@
+//*****************************************************************************
+//
+// workq.h - A prioritised, run-to-completion work queue serviced from the
+// main loop.
+//
+// The application describes its deferred work as a table of jobs, highest
+// priority first.  Interrupt handlers capture whatever must be taken at
+// interrupt time (a timestamp, a flag) and post a job; the main loop runs
+// the pending jobs one at a time, always choosing the highest priority one,
+// and each job runs to completion before the next is chosen.  Posting a job
+// that is already pending does nothing more, so a job must handle all of the
+// work that has built up since it last ran.
+//
+// When the hot-path instrumentation is built in, each job is run as a
+// hot-path entry point and records the time from its first post to its
+// start as its latency.
+//
+//*****************************************************************************
+
+#ifndef __WORKQ_H__
+#define __WORKQ_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//*****************************************************************************
+//
+// If building with a C++ compiler, make all of the definitions in this header
+// have a C binding.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+//*****************************************************************************
+//
+// The most jobs that the queue can hold: one bit of the pending mask each.
+//
+//*****************************************************************************
+#define WORK_MAX_JOBS           32
+
+//*****************************************************************************
+//
+// The size of the buffer needed by WorkFormat() for the largest job table.
+//
+//*****************************************************************************
+#define WORK_TEXT_SIZE          (WORK_MAX_JOBS * 48)
+
+//*****************************************************************************
+//
+// A job.
+//
+//*****************************************************************************
+typedef struct
+{
+    //
+    // A short name for reports.
+    //
+    const char *pcName;
+
+    //
+    // The work to do, called from the main loop.
+    //
+    void (*pfnHandler)(void);
+
+    //
+    // The HOTPATH_* entry point that the job's figures are recorded under.
+    //
+    uint32_t ui32Point;
+}
+tWorkJob;
+
+//*****************************************************************************
+//
+// Prototypes.
+//
+//*****************************************************************************
+extern void WorkInit(const tWorkJob *psJobs, uint32_t ui32NumJobs);
+extern void WorkPost(uint32_t ui32Job);
+extern bool WorkPending(void);
+extern bool WorkRunNext(void);
+extern void WorkRun(void);
+extern void WorkSleep(void);
+extern uint32_t WorkFormat(char *pcBuf, uint32_t ui32Size);
+
+//*****************************************************************************
+//
+// Mark the end of the C bindings section for C++ compilers.
+//
+//*****************************************************************************
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __WORKQ_H__